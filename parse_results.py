@@ -91,6 +91,7 @@ def parse_file(filename, core_map):
     data = None
     cycle_regex = re.compile(r'Done: Core (?P<core_id>\d+): Fetched \d+ : Committed \d+ : At time : (?P<cycle>\d+)')
     edp_regex = re.compile(r'Energy Delay product \(EDP\) = (?P<edp>\d*\.?\d+) J\.s')
+    estimate_regex = re.compile(r'Core (?P<core_id>\d+): interference cycles \d+ estimated alone time \d+ estimated slowdown (?P<slowdown>\d*\.?\d+)')
     
     max_slowdown = 0
     total_num_cycles = 0
@@ -101,12 +102,21 @@ def parse_file(filename, core_map):
             if match:
                 core = match.group('core_id')
                 cycles = int(match.group('cycle'))
-                slowdown = cycles / float(SINGLE_THREAD_TIME[core_map[core]])
                 data['CYCLES'][int(core)] = cycles
-                data['SLOWDOWN'][int(core)] = slowdown
+                # without an alone run time, the online estimate is used
+                if core_map[core] in SINGLE_THREAD_TIME:
+                    slowdown = cycles / float(SINGLE_THREAD_TIME[core_map[core]])
+                    data['SLOWDOWN'][int(core)] = slowdown
+                    if max_slowdown < slowdown:
+                        max_slowdown = slowdown
+                total_num_cycles += cycles
+
+            match = estimate_regex.match(line)
+            if match and core_map[match.group('core_id')] not in SINGLE_THREAD_TIME:
+                slowdown = float(match.group('slowdown'))
+                data['SLOWDOWN'][int(match.group('core_id'))] = slowdown
                 if max_slowdown < slowdown:
                     max_slowdown = slowdown
-                total_num_cycles += cycles
 
             match = edp_regex.match(line)
             if match:
@@ -0,0 +1,598 @@
+#define _POSIX_C_SOURCE 200809L	// strtok_r
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "params.h"
+#include "memory_controller.h"
+#include "address_map.h"
+
+static const char *field_names[NUM_ADDRESS_FIELDS] =
+  { "channel", "rank", "bank", "row", "column" };
+
+// order of the two fixed mappings, least significant field first
+#define MAPPING_1_ORDER "column,channel,bank,rank,row"
+#define MAPPING_2_ORDER "channel,bank,rank,column,row"
+
+// the compiled mapping
+static USIMM_STATE field_map_t address_map[NUM_ADDRESS_FIELDS];
+
+// ADDRESS_MAP_HASH lines seen in the config file
+static USIMM_STATE int num_map_hashes = 0;
+static USIMM_STATE int map_hash_field[MAX_MAP_HASHES];
+static USIMM_STATE int map_hash_bit[MAX_MAP_HASHES];
+static USIMM_STATE unsigned long long int map_hash_mask[MAX_MAP_HASHES];
+
+// Counts that are not powers of two (e.g. 3 or 6 channels) cannot be
+// carved out of address bits. The line address is then decoded as a
+// mixed-radix number: each listed field takes (line mod count) and
+// passes on (line / count), with the row taking the final quotient.
+// Divisions use precomputed reciprocals.
+typedef struct
+{
+  int field;
+  unsigned long long int radix;
+  unsigned long long int weight;	// place value of this digit within its field
+  unsigned long long int magic;	// floor(2^(63+shift) / radix) + 1
+  int shift;			// ceil(log2(radix))
+} map_digit_t;
+
+static USIMM_STATE int map_by_division = 0;
+static USIMM_STATE int num_map_digits = 0;
+static USIMM_STATE map_digit_t map_digit[MAX_MAP_SEGMENTS * NUM_ADDRESS_FIELDS];
+static USIMM_STATE map_digit_t field_modulus[NUM_ADDRESS_FIELDS];
+static USIMM_STATE int map_xor_mode[NUM_ADDRESS_FIELDS];
+static USIMM_STATE int line_offset_bits;
+
+
+  static int
+lookup_field (const char *name, size_t length)
+{
+  for (int f = 0; f < NUM_ADDRESS_FIELDS; f++)
+  {
+    if (strlen (field_names[f]) == length
+        && strncmp (name, field_names[f], length) == 0)
+      return f;
+  }
+  return -1;
+}
+
+
+  static int
+count_of_field (int field)
+{
+  switch (field)
+  {
+    case CHANNEL_FIELD:
+      return NUM_CHANNELS;
+    case RANK_FIELD:
+      return NUM_RANKS;
+    case BANK_FIELD:
+      return NUM_BANKS;
+    case ROW_FIELD:
+      return NUM_ROWS;
+    case COLUMN_FIELD:
+      return NUM_COLUMNS;
+    default:
+      return 1;
+  }
+}
+
+
+  static int
+field_width (int field)
+{
+  return log_base2 (count_of_field (field));
+}
+
+
+  static int
+is_power_of_2 (unsigned long long int value)
+{
+  return value && !(value & (value - 1));
+}
+
+
+// Set up x / radix as a multiply and shift. With numerators below
+// 2^63, m = floor(2^(63+l) / radix) + 1 with l = ceil(log2(radix))
+// gives the exact quotient for every radix, including powers of two.
+  static void
+init_reciprocal (map_digit_t * d, unsigned long long int radix)
+{
+  int l = 0;
+  while ((1ULL << l) < radix)
+    l++;
+  d->radix = radix;
+  d->shift = l;
+  d->magic =
+    (unsigned long long int) ((((unsigned __int128) 1) << (63 + l)) / radix) + 1;
+}
+
+
+  static inline unsigned long long int
+divide (const map_digit_t * d, unsigned long long int x)
+{
+  return (unsigned long long int) (((unsigned __int128) x * d->magic) >>
+      (63 + d->shift));
+}
+
+
+// Assign the next 'count' address bits to 'field'
+  static void
+place_field_bits (int field, int count, int *next_bit)
+{
+  field_map_t *m = &address_map[field];
+  for (int i = 0; i < count; i++)
+  {
+    m->bit_position[m->width] = *next_bit;
+    m->width++;
+    (*next_bit)++;
+  }
+}
+
+
+// Fold the placed bits of a field into runs of contiguous address bits
+  static int
+build_segments (int field)
+{
+  field_map_t *m = &address_map[field];
+  m->num_segments = 0;
+  for (int i = 0; i < m->width;)
+  {
+    int start = i;
+    while ((i + 1 < m->width)
+        && (m->bit_position[i + 1] == m->bit_position[i] + 1))
+      i++;
+    i++;
+    if (m->num_segments == MAX_MAP_SEGMENTS)
+    {
+      fprintf (usimm_out, "PANIC: ADDRESS_MAP_ORDER splits the %s field into more than %d pieces\n",
+          field_names[field], MAX_MAP_SEGMENTS);
+      return -1;
+    }
+    int width = i - start;
+    int src = m->bit_position[start];
+    m->segment_mask[m->num_segments] = ((1ULL << width) - 1) << src;
+    m->segment_shift[m->num_segments] = src - start;
+    m->num_segments++;
+  }
+  return 0;
+}
+
+
+// Address bits of 'src' that get XORed into each bit of 'dst'.
+// mode 1 pairs dst bit i with src bit i (permutation-based
+// interleaving), mode 2 folds every src bit into dst.
+  static void
+add_field_xor (unsigned long long int *xor_mask, int dst, int src, int mode)
+{
+  field_map_t *d = &address_map[dst];
+  field_map_t *s = &address_map[src];
+  if (mode == 0 || d->width == 0 || s->width == 0)
+    return;
+  for (int i = 0; i < d->width; i++)
+  {
+    for (int j = i; j < s->width; j += d->width)
+    {
+      xor_mask[i] |= 1ULL << s->bit_position[j];
+      if (mode == 1)
+        break;
+    }
+  }
+}
+
+
+// The mapping is a permutation of the address space if and only if
+// its matrix over GF(2) is invertible: a row per address bit, the bit
+// itself and the bits XORed into it. Gaussian elimination on the rows.
+  static int
+xor_matrix_invertible (unsigned long long int
+    xor_mask[NUM_ADDRESS_FIELDS][MAX_MAP_FIELD_BITS])
+{
+  unsigned long long int rows[64];
+
+  for (int p = 0; p < 64; p++)
+    rows[p] = 1ULL << p;
+  for (int f = 0; f < NUM_ADDRESS_FIELDS; f++)
+    for (int i = 0; i < address_map[f].width; i++)
+      rows[address_map[f].bit_position[i]] |= xor_mask[f][i];
+  for (int col = 0; col < 64; col++)
+  {
+    int pivot = col;
+    while (pivot < 64 && !(rows[pivot] >> col & 1))
+      pivot++;
+    if (pivot == 64)
+      return 0;
+    unsigned long long int row = rows[pivot];
+    rows[pivot] = rows[col];
+    rows[col] = row;
+    for (int r = 0; r < 64; r++)
+      if (r != col && (rows[r] >> col & 1))
+        rows[r] ^= row;
+  }
+  return 1;
+}
+
+
+// Compile the order for the division path. Only power-of-two fields
+// may be split with a width; the row has to come last and whole since
+// it takes whatever is left of the line address.
+  static int
+init_division_map (char *order)
+{
+  unsigned long long int remaining[NUM_ADDRESS_FIELDS];
+  unsigned long long int weight[NUM_ADDRESS_FIELDS];
+  char leftover[] = MAPPING_1_ORDER;
+  int row_seen = 0;
+
+  if (num_map_hashes)
+  {
+    fprintf (usimm_out, "PANIC: ADDRESS_MAP_HASH needs power-of-two channel, rank, bank and column counts\n");
+    return -1;
+  }
+
+  for (int f = 0; f < NUM_ADDRESS_FIELDS; f++)
+  {
+    remaining[f] = count_of_field (f);
+    weight[f] = 1;
+    init_reciprocal (&field_modulus[f], count_of_field (f));
+  }
+  map_xor_mode[CHANNEL_FIELD] = ADDRESS_MAP_CHANNEL_XOR;
+  map_xor_mode[RANK_FIELD] = ADDRESS_MAP_RANK_XOR;
+  map_xor_mode[BANK_FIELD] = ADDRESS_MAP_BANK_XOR;
+  map_xor_mode[ROW_FIELD] = 0;
+  map_xor_mode[COLUMN_FIELD] = 0;
+
+  // the listed fields, then whatever is left in the order of mapping 1
+  num_map_digits = 0;
+  for (int pass = 0; pass < 2; pass++)
+  {
+    char *list = pass ? leftover : order;
+    for (char *save, *tok = strtok_r (list, ", ", &save); tok;
+        tok = strtok_r (NULL, ", ", &save))
+    {
+      char *colon = strchr (tok, ':');
+      size_t length = colon ? (size_t) (colon - tok) : strlen (tok);
+      int field = lookup_field (tok, length);
+      if (field < 0)
+      {
+        fprintf (usimm_out, "PANIC: unknown field %s in ADDRESS_MAP_ORDER\n", tok);
+        return -1;
+      }
+      if (pass && (field == ROW_FIELD ? row_seen : remaining[field] <= 1))
+        continue;
+      if (row_seen)
+      {
+        fprintf (usimm_out, "PANIC: with a non power-of-two geometry the row has to be the last field of ADDRESS_MAP_ORDER\n");
+        return -1;
+      }
+      if (field == ROW_FIELD)
+      {
+        if (colon)
+        {
+          fprintf (usimm_out, "PANIC: with a non power-of-two geometry the row field cannot be split\n");
+          return -1;
+        }
+        row_seen = 1;
+        continue;
+      }
+      unsigned long long int radix = remaining[field];
+      if (colon)
+      {
+        int count = atoi (colon + 1);
+        if (!is_power_of_2 (remaining[field]) || count < 0
+            || (1ULL << count) > remaining[field])
+        {
+          fprintf (usimm_out, "PANIC: ADDRESS_MAP_ORDER cannot take %d bits of the %s field (%d values left)\n",
+              count, field_names[field], (int) remaining[field]);
+          return -1;
+        }
+        radix = 1ULL << count;
+      }
+      if (radix <= 1)
+        continue;
+      map_digit_t *d = &map_digit[num_map_digits++];
+      d->field = field;
+      d->weight = weight[field];
+      init_reciprocal (d, radix);
+      weight[field] *= radix;
+      remaining[field] /= radix;
+    }
+  }
+  return 0;
+}
+
+
+  void
+reset_address_map ()
+{
+  num_map_hashes = 0;
+}
+
+
+  int
+add_address_map_hash (char *field_bit, unsigned long long int mask)
+{
+  size_t length = strlen (field_bit);
+  size_t name_length = length;
+  while (name_length > 0 && field_bit[name_length - 1] >= '0'
+      && field_bit[name_length - 1] <= '9')
+    name_length--;
+  int field = lookup_field (field_bit, name_length);
+  if (field < 0 || name_length == length)
+  {
+    fprintf (usimm_out, "PANIC: ADDRESS_MAP_HASH expects <field><bit> such as bank0, got %s\n",
+        field_bit);
+    return 0;
+  }
+  if (num_map_hashes == MAX_MAP_HASHES)
+  {
+    fprintf (usimm_out, "PANIC: more than %d ADDRESS_MAP_HASH lines\n", MAX_MAP_HASHES);
+    return 0;
+  }
+  map_hash_field[num_map_hashes] = field;
+  map_hash_bit[num_map_hashes] = atoi (&field_bit[name_length]);
+  map_hash_mask[num_map_hashes] = mask;
+  num_map_hashes++;
+  return 1;
+}
+
+
+  int
+init_address_map ()
+{
+  char order[256];
+  int remaining[NUM_ADDRESS_FIELDS];
+  int next_bit = log_base2 (CACHE_LINE_SIZE);
+  unsigned long long int xor_mask[NUM_ADDRESS_FIELDS][MAX_MAP_FIELD_BITS];
+
+  if (ADDRESS_MAPPING == 1)
+    strcpy (order, MAPPING_1_ORDER);
+  else if (ADDRESS_MAPPING == 2)
+    strcpy (order, MAPPING_2_ORDER);
+  else if (ADDRESS_MAPPING == 3 && ADDRESS_MAP_ORDER[0])
+  {
+    strncpy (order, ADDRESS_MAP_ORDER, sizeof (order) - 1);
+    order[sizeof (order) - 1] = 0;
+  }
+  else
+  {
+    fprintf (usimm_out, "PANIC: ADDRESS_MAPPING %d is not supported (ADDRESS_MAPPING 3 needs an ADDRESS_MAP_ORDER)\n",
+        ADDRESS_MAPPING);
+    return -1;
+  }
+
+  line_offset_bits = log_base2 (CACHE_LINE_SIZE);
+  map_by_division = !(is_power_of_2 (NUM_CHANNELS)
+      && is_power_of_2 (NUM_RANKS) && is_power_of_2 (NUM_BANKS)
+      && is_power_of_2 (NUM_ROWS) && is_power_of_2 (NUM_COLUMNS));
+  if (map_by_division)
+  {
+    return init_division_map (order);
+  }
+
+  for (int f = 0; f < NUM_ADDRESS_FIELDS; f++)
+  {
+    address_map[f].width = 0;
+    remaining[f] = field_width (f);
+    for (int i = 0; i < MAX_MAP_FIELD_BITS; i++)
+      xor_mask[f][i] = 0;
+  }
+
+  // place the fields in the listed order, least significant first
+  for (char *save, *tok = strtok_r (order, ", ", &save); tok;
+      tok = strtok_r (NULL, ", ", &save))
+  {
+    char *colon = strchr (tok, ':');
+    size_t length = colon ? (size_t) (colon - tok) : strlen (tok);
+    int field = lookup_field (tok, length);
+    if (field < 0)
+    {
+      fprintf (usimm_out, "PANIC: unknown field %s in ADDRESS_MAP_ORDER\n", tok);
+      return -1;
+    }
+    int count = colon ? atoi (colon + 1) : remaining[field];
+    if (count < 0 || count > remaining[field])
+    {
+      fprintf (usimm_out, "PANIC: ADDRESS_MAP_ORDER gives the %s field more than its %d bits\n",
+          field_names[field], field_width (field));
+      return -1;
+    }
+    place_field_bits (field, count, &next_bit);
+    remaining[field] -= count;
+  }
+
+  // whatever is left goes on top, in the order of mapping 1
+  strcpy (order, MAPPING_1_ORDER);
+  for (char *save, *tok = strtok_r (order, ",", &save); tok;
+      tok = strtok_r (NULL, ",", &save))
+  {
+    int field = lookup_field (tok, strlen (tok));
+    place_field_bits (field, remaining[field], &next_bit);
+    remaining[field] = 0;
+  }
+
+  if (next_bit > 63)
+  {
+    fprintf (usimm_out, "PANIC: address mapping needs %d address bits, at most 63 are supported\n",
+        next_bit);
+    return -1;
+  }
+
+  for (int f = 0; f < NUM_ADDRESS_FIELDS; f++)
+    if (build_segments (f))
+      return -1;
+
+  // XOR hashing
+  add_field_xor (xor_mask[BANK_FIELD], BANK_FIELD, ROW_FIELD,
+      ADDRESS_MAP_BANK_XOR);
+  add_field_xor (xor_mask[CHANNEL_FIELD], CHANNEL_FIELD, ROW_FIELD,
+      ADDRESS_MAP_CHANNEL_XOR);
+  add_field_xor (xor_mask[RANK_FIELD], RANK_FIELD, ROW_FIELD,
+      ADDRESS_MAP_RANK_XOR);
+  for (int h = 0; h < num_map_hashes; h++)
+  {
+    int field = map_hash_field[h];
+    int bit = map_hash_bit[h];
+    if (bit >= address_map[field].width)
+    {
+      fprintf (usimm_out, "PANIC: ADDRESS_MAP_HASH %s%d, the %s field only has %d bits\n",
+          field_names[field], bit, field_names[field],
+          address_map[field].width);
+      return -1;
+    }
+    // the field's own address bit is always part of the hash
+    xor_mask[field][bit] |=
+      map_hash_mask[h] & ~(1ULL << address_map[field].bit_position[bit]);
+  }
+  // masks that take each other's hashed bits (bank0 ^= b1 with
+  // bank1 ^= b0) can map two addresses to the same location
+  if (!xor_matrix_invertible (xor_mask))
+  {
+    fprintf (usimm_out, "PANIC: the ADDRESS_MAP_HASH and XOR masks map two addresses to the same location\n");
+    return -1;
+  }
+
+  for (int f = 0; f < NUM_ADDRESS_FIELDS; f++)
+  {
+    field_map_t *m = &address_map[f];
+    m->num_xor_bits = 0;
+    for (int i = 0; i < m->width; i++)
+    {
+      if (xor_mask[f][i])
+      {
+        m->xor_bit[m->num_xor_bits] = i;
+        m->xor_mask[m->num_xor_bits] = xor_mask[f][i];
+        m->num_xor_bits++;
+      }
+    }
+  }
+  return 0;
+}
+
+
+// Division path: peel the digits off the line address with the
+// precomputed reciprocals. The row is the final quotient, wrapped to
+// NUM_ROWS the same way the bit path drops bits above the row field.
+// XOR modes fold the row into a field, modulo its count when that is
+// not a power of two.
+  static void
+decode_by_division (unsigned long long int addr,
+    unsigned long long int *value)
+{
+  unsigned long long int line = addr >> line_offset_bits;
+
+  for (int f = 0; f < NUM_ADDRESS_FIELDS; f++)
+    value[f] = 0;
+  for (int i = 0; i < num_map_digits; i++)
+  {
+    const map_digit_t *d = &map_digit[i];
+    unsigned long long int q = divide (d, line);
+    value[d->field] += (line - q * d->radix) * d->weight;
+    line = q;
+  }
+  value[ROW_FIELD] =
+    line - divide (&field_modulus[ROW_FIELD], line) * NUM_ROWS;
+
+  for (int f = 0; f < NUM_ADDRESS_FIELDS; f++)
+  {
+    const map_digit_t *m = &field_modulus[f];
+    unsigned long long int row = value[ROW_FIELD];
+    if (!map_xor_mode[f] || m->radix <= 1)
+      continue;
+    if (is_power_of_2 (m->radix))
+    {
+      unsigned long long int fold = row & (m->radix - 1);
+      if (map_xor_mode[f] == 2)
+        for (row >>= m->shift; row; row >>= m->shift)
+          fold ^= row & (m->radix - 1);
+      value[f] ^= fold;
+    }
+    else
+    {
+      unsigned long long int sum = value[f] + row;
+      value[f] = sum - divide (m, sum) * m->radix;
+    }
+  }
+}
+
+
+// Bit path, branch-free: gather each field from its segments, then
+// fold in the parity of its hash masks.
+  static void
+decode_by_bits (unsigned long long int addr, unsigned long long int *value)
+{
+  for (int f = 0; f < NUM_ADDRESS_FIELDS; f++)
+  {
+    const field_map_t *m = &address_map[f];
+    unsigned long long int v = 0;
+    for (int s = 0; s < m->num_segments; s++)
+      v |= (addr & m->segment_mask[s]) >> m->segment_shift[s];
+    for (int x = 0; x < m->num_xor_bits; x++)
+      v ^= (unsigned long long int) __builtin_parityll (addr & m->xor_mask[x])
+        << m->xor_bit[x];
+    value[f] = v;
+  }
+}
+
+
+  dram_address_t
+decode_address (long long int physical_address)
+{
+  dram_address_t this_a;
+  unsigned long long int value[NUM_ADDRESS_FIELDS];
+
+  if (map_by_division)
+    decode_by_division (physical_address, value);
+  else
+    decode_by_bits (physical_address, value);
+
+  this_a.actual_address = physical_address;
+  this_a.channel = value[CHANNEL_FIELD];
+  this_a.rank = value[RANK_FIELD];
+  this_a.bank = value[BANK_FIELD];
+  this_a.bank_group = this_a.bank % NUM_BANK_GROUPS;
+  this_a.row = value[ROW_FIELD];
+  this_a.column = value[COLUMN_FIELD];
+  return this_a;
+}
+
+
+  void
+print_address_map ()
+{
+  fprintf (usimm_out, "\n---------------\n");
+  fprintf (usimm_out, "- Address Map -\n");
+  fprintf (usimm_out, "---------------\n");
+  if (map_by_division)
+  {
+    // least significant digit first
+    fprintf (usimm_out, "line address (a >> %d) decoded by division:", line_offset_bits);
+    for (int i = 0; i < num_map_digits; i++)
+      fprintf (usimm_out, " %s%%%llu", field_names[map_digit[i].field],
+          map_digit[i].radix);
+    fprintf (usimm_out, " row%%%d\n", NUM_ROWS);
+    for (int f = 0; f < NUM_ADDRESS_FIELDS; f++)
+      if (map_xor_mode[f] && field_modulus[f].radix > 1)
+        fprintf (usimm_out, "%-8s XOR-hashed with the row (mode %d)\n", field_names[f],
+            map_xor_mode[f]);
+    return;
+  }
+  for (int f = 0; f < NUM_ADDRESS_FIELDS; f++)
+  {
+    const field_map_t *m = &address_map[f];
+    fprintf (usimm_out, "%-8s %2d bits :", field_names[f], m->width);
+    for (int s = m->num_segments - 1; s >= 0; s--)
+    {
+      int lo = __builtin_ctzll (m->segment_mask[s]);
+      int hi = 63 - __builtin_clzll (m->segment_mask[s]);
+      if (hi == lo)
+        fprintf (usimm_out, " a[%d]", lo);
+      else
+        fprintf (usimm_out, " a[%d:%d]", hi, lo);
+    }
+    if (m->num_xor_bits)
+      fprintf (usimm_out, "  (%d bits XOR-hashed)", m->num_xor_bits);
+    fprintf (usimm_out, "\n");
+  }
+}
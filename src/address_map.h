@@ -0,0 +1,88 @@
+#ifndef __ADDRESS_MAP_H__
+#define __ADDRESS_MAP_H__
+
+#include "memory_controller.h"
+
+// Address mapping engine.
+//
+// The mapping is described in the config file as a list of fields
+// from the least significant bit (just above the cache-line offset)
+// to the most significant bit, for example
+//
+//   ADDRESS_MAPPING     3
+//   ADDRESS_MAP_ORDER   column:3,channel,bank:2,rank,bank,column,row
+//
+// A field given without a width takes all of its remaining bits.
+// Fields that are not listed are placed above the listed ones.
+// ADDRESS_MAPPING 1 and 2 are the two fixed orders of earlier
+// versions and are compiled by the same engine.
+//
+// On top of the bit selection, any bit of a field can be XORed with
+// the parity of a set of physical address bits:
+//
+//   ADDRESS_MAP_BANK_XOR     1   // bank ^= low row bits (permutation-based interleaving)
+//   ADDRESS_MAP_CHANNEL_XOR  2   // channel ^= row bits folded to channel width
+//   ADDRESS_MAP_RANK_XOR     1   // rank ^= low row bits
+//   ADDRESS_MAP_HASH  bank1  0x1fe000   // bank bit 1 = parity(address & mask)
+//
+// A hash always includes the field bit's own address bit. Masks that
+// take each other's hashed bits can still map two addresses to the
+// same location (bank0 ^= b1 together with bank1 ^= b0 when b0 and b1
+// are the two bank bits): the hashes are checked at start-up to be an
+// invertible matrix over GF(2), so every accepted mapping is a
+// permutation of the address space.
+//
+// The mapping is compiled once into per-field masks so decoding an
+// address is a fixed sequence of and/shift/parity operations.
+//
+// If any of NUM_CHANNELS, NUM_RANKS, NUM_BANKS or NUM_COLUMNS is not a
+// power of two (e.g. 3 channels or 6 banks), the same order is applied
+// to the line address by division instead: each field takes the
+// remainder by its count (or by 2^n for a field:n split of a
+// power-of-two field) and the row takes what is left, modulo NUM_ROWS.
+// The row must then be the last field. The XOR modes still XOR the
+// row into power-of-two fields and add it modulo the count into the
+// others; ADDRESS_MAP_HASH is not available. The divisions are
+// multiplications by reciprocals computed at start-up.
+
+#define MAX_MAP_SEGMENTS 16
+#define MAX_MAP_FIELD_BITS 64
+#define MAX_MAP_HASHES 64
+
+typedef enum
+{
+  CHANNEL_FIELD, RANK_FIELD, BANK_FIELD, ROW_FIELD, COLUMN_FIELD, NUM_ADDRESS_FIELDS
+} address_field_t;
+
+// a field is gathered from a few runs of contiguous address bits
+typedef struct
+{
+  int width;
+  int num_segments;
+  unsigned long long int segment_mask[MAX_MAP_SEGMENTS];
+  int segment_shift[MAX_MAP_SEGMENTS];
+  // physical address bit feeding each bit of the field
+  int bit_position[MAX_MAP_FIELD_BITS];
+  // field bits that are XOR-hashed, and the address bits they fold in
+  int num_xor_bits;
+  int xor_bit[MAX_MAP_FIELD_BITS];
+  unsigned long long int xor_mask[MAX_MAP_FIELD_BITS];
+} field_map_t;
+
+// forget the ADDRESS_MAP_HASH lines of the last system
+void reset_address_map ();
+
+// record an ADDRESS_MAP_HASH line from the config file
+int add_address_map_hash (char *field_bit, unsigned long long int mask);
+
+// compile the configured mapping; call after all config files are read.
+// -1 if the mapping is not valid
+int init_address_map ();
+
+// decompose a physical address into channel, rank, bank, row and column
+dram_address_t decode_address (long long int physical_address);
+
+// print the compiled mapping
+void print_address_map ();
+
+#endif // __ADDRESS_MAP_H__
@@ -3,6 +3,7 @@
 #define __CONFIG_FILE_IN_H__
 
 #include "params.h"
+#include "address_map.h"
 
 #define 	EOL 	10
 #define 	CR 	13
@@ -58,8 +59,71 @@ typedef enum {
 
 	wq_capacity_token,
 	address_mapping_token,
+	address_map_order_token,
+	address_map_bank_xor_token,
+	address_map_channel_xor_token,
+	address_map_rank_xor_token,
+	address_map_hash_token,
 	wq_lookup_latency_token,
 
+	dram_device_token,
+	dram_device_path_token,
+	chips_per_rank_token,
+	core_power_token,
+	misc_power_token,
+	num_bank_groups_token,
+	t_ccd_s_token,
+	t_ccd_l_token,
+	t_rrd_s_token,
+	t_rrd_l_token,
+	t_wtr_s_token,
+	t_wtr_l_token,
+	t_rfc2_token,
+	t_rfc4_token,
+	t_rfcpb_token,
+	refresh_mode_token,
+	refresh_granularity_token,
+	refresh_pause_segments_token,
+	refresh_policy_token,
+	row_predictor_token,
+	speculative_activate_token,
+	speculative_precharge_token,
+	page_policy_token,
+	page_timeout_token,
+	page_hit_cap_token,
+	write_drain_policy_token,
+	write_hi_wm_token,
+	write_lo_wm_token,
+	write_batch_per_rank_token,
+	eager_writeback_token,
+	qos_policy_token,
+	qos_classes_token,
+	qos_shares_token,
+	interference_stats_token,
+	core_policy_token,
+	mshr_size_token,
+	llc_size_token,
+	llc_ways_token,
+	llc_latency_token,
+	llc_replacement_token,
+	prefetcher_token,
+	prefetch_degree_token,
+	prefetch_buffer_token,
+	prefetch_priority_token,
+	trace_format_token,
+	stall_stats_token,
+	bus_stats_token,
+	bus_stats_interval_token,
+	energy_stats_token,
+	energy_interval_token,
+	power_policy_token,
+	power_timeout_token,
+	dvfs_devices_token,
+	dvfs_policy_token,
+	dvfs_interval_token,
+	dvfs_target_util_token,
+	dvfs_relock_token,
+
 	comment_token,
 	unknown_token
 }token_t;
@@ -158,23 +222,150 @@ token_t tokenize(char * input){
 	return wq_capacity_token;
   } else if (strncmp(input, "ADDRESS_MAPPING",length) == 0) {
 	return address_mapping_token;
+  } else if (strncmp(input, "ADDRESS_MAP_ORDER",length) == 0) {
+	return address_map_order_token;
+  } else if (strncmp(input, "ADDRESS_MAP_BANK_XOR",length) == 0) {
+	return address_map_bank_xor_token;
+  } else if (strncmp(input, "ADDRESS_MAP_CHANNEL_XOR",length) == 0) {
+	return address_map_channel_xor_token;
+  } else if (strncmp(input, "ADDRESS_MAP_RANK_XOR",length) == 0) {
+	return address_map_rank_xor_token;
+  } else if (strncmp(input, "ADDRESS_MAP_HASH",length) == 0) {
+	return address_map_hash_token;
   } else if (strncmp(input, "WQ_LOOKUP_LATENCY",length) == 0) {
 	return wq_lookup_latency_token;
+  } else if (strncmp(input, "DRAM_DEVICE",length) == 0) {
+	return dram_device_token;
+  } else if (strncmp(input, "DRAM_DEVICE_PATH",length) == 0) {
+	return dram_device_path_token;
+  } else if (strncmp(input, "CHIPS_PER_RANK",length) == 0) {
+	return chips_per_rank_token;
+  } else if (strncmp(input, "CORE_POWER",length) == 0) {
+	return core_power_token;
+  } else if (strncmp(input, "MISC_POWER",length) == 0) {
+	return misc_power_token;
+  } else if (strncmp(input, "NUM_BANK_GROUPS",length) == 0) {
+	return num_bank_groups_token;
+  } else if (strncmp(input, "T_CCD_S",length) == 0) {
+	return t_ccd_s_token;
+  } else if (strncmp(input, "T_CCD_L",length) == 0) {
+	return t_ccd_l_token;
+  } else if (strncmp(input, "T_RRD_S",length) == 0) {
+	return t_rrd_s_token;
+  } else if (strncmp(input, "T_RRD_L",length) == 0) {
+	return t_rrd_l_token;
+  } else if (strncmp(input, "T_WTR_S",length) == 0) {
+	return t_wtr_s_token;
+  } else if (strncmp(input, "T_WTR_L",length) == 0) {
+	return t_wtr_l_token;
+  } else if (strncmp(input, "T_RFC2",length) == 0) {
+	return t_rfc2_token;
+  } else if (strncmp(input, "T_RFC4",length) == 0) {
+	return t_rfc4_token;
+  } else if (strncmp(input, "T_RFCPB",length) == 0) {
+	return t_rfcpb_token;
+  } else if (strncmp(input, "REFRESH_MODE",length) == 0) {
+	return refresh_mode_token;
+  } else if (strncmp(input, "REFRESH_GRANULARITY",length) == 0) {
+	return refresh_granularity_token;
+  } else if (strncmp(input, "REFRESH_PAUSE_SEGMENTS",length) == 0) {
+	return refresh_pause_segments_token;
+  } else if (strncmp(input, "REFRESH_POLICY",length) == 0) {
+	return refresh_policy_token;
+  } else if (strncmp(input, "ROW_PREDICTOR",length) == 0) {
+	return row_predictor_token;
+  } else if (strncmp(input, "SPECULATIVE_ACTIVATE",length) == 0) {
+	return speculative_activate_token;
+  } else if (strncmp(input, "SPECULATIVE_PRECHARGE",length) == 0) {
+	return speculative_precharge_token;
+  } else if (strncmp(input, "PAGE_POLICY",length) == 0) {
+	return page_policy_token;
+  } else if (strncmp(input, "PAGE_TIMEOUT",length) == 0) {
+	return page_timeout_token;
+  } else if (strncmp(input, "PAGE_HIT_CAP",length) == 0) {
+	return page_hit_cap_token;
+  } else if (strncmp(input, "WRITE_DRAIN_POLICY",length) == 0) {
+	return write_drain_policy_token;
+  } else if (strncmp(input, "WRITE_HI_WM",length) == 0) {
+	return write_hi_wm_token;
+  } else if (strncmp(input, "WRITE_LO_WM",length) == 0) {
+	return write_lo_wm_token;
+  } else if (strncmp(input, "WRITE_BATCH_PER_RANK",length) == 0) {
+	return write_batch_per_rank_token;
+  } else if (strncmp(input, "EAGER_WRITEBACK",length) == 0) {
+	return eager_writeback_token;
+  } else if (strncmp(input, "QOS_POLICY",length) == 0) {
+	return qos_policy_token;
+  } else if (strncmp(input, "QOS_CLASSES",length) == 0) {
+	return qos_classes_token;
+  } else if (strncmp(input, "QOS_SHARES",length) == 0) {
+	return qos_shares_token;
+  } else if (strncmp(input, "INTERFERENCE_STATS",length) == 0) {
+	return interference_stats_token;
+  } else if (strncmp(input, "CORE_POLICY",length) == 0) {
+	return core_policy_token;
+  } else if (strncmp(input, "MSHR_SIZE",length) == 0) {
+	return mshr_size_token;
+  } else if (strncmp(input, "LLC_SIZE",length) == 0) {
+	return llc_size_token;
+  } else if (strncmp(input, "LLC_WAYS",length) == 0) {
+	return llc_ways_token;
+  } else if (strncmp(input, "LLC_LATENCY",length) == 0) {
+	return llc_latency_token;
+  } else if (strncmp(input, "LLC_REPLACEMENT",length) == 0) {
+	return llc_replacement_token;
+  } else if (strncmp(input, "PREFETCHER",length) == 0) {
+	return prefetcher_token;
+  } else if (strncmp(input, "PREFETCH_DEGREE",length) == 0) {
+	return prefetch_degree_token;
+  } else if (strncmp(input, "PREFETCH_BUFFER",length) == 0) {
+	return prefetch_buffer_token;
+  } else if (strncmp(input, "PREFETCH_PRIORITY",length) == 0) {
+	return prefetch_priority_token;
+  } else if (strncmp(input, "TRACE_FORMAT",length) == 0) {
+	return trace_format_token;
+  } else if (strncmp(input, "STALL_STATS",length) == 0) {
+	return stall_stats_token;
+  } else if (strncmp(input, "BUS_STATS",length) == 0) {
+	return bus_stats_token;
+  } else if (strncmp(input, "BUS_STATS_INTERVAL",length) == 0) {
+	return bus_stats_interval_token;
+  } else if (strncmp(input, "ENERGY_STATS",length) == 0) {
+	return energy_stats_token;
+  } else if (strncmp(input, "ENERGY_INTERVAL",length) == 0) {
+	return energy_interval_token;
+  } else if (strncmp(input, "POWER_POLICY",length) == 0) {
+	return power_policy_token;
+  } else if (strncmp(input, "POWER_TIMEOUT",length) == 0) {
+	return power_timeout_token;
+  } else if (strncmp(input, "DVFS_DEVICES",length) == 0) {
+	return dvfs_devices_token;
+  } else if (strncmp(input, "DVFS_POLICY",length) == 0) {
+	return dvfs_policy_token;
+  } else if (strncmp(input, "DVFS_INTERVAL",length) == 0) {
+	return dvfs_interval_token;
+  } else if (strncmp(input, "DVFS_TARGET_UTIL",length) == 0) {
+	return dvfs_target_util_token;
+  } else if (strncmp(input, "DVFS_RELOCK",length) == 0) {
+	return dvfs_relock_token;
   }
 
   else {
-	printf("PANIC :Unknown token %s\n",input);
+	fprintf(usimm_out, "PANIC :Unknown token %s\n",input);
 	return unknown_token;
   }
 }
 
 
-void read_config_file(FILE * fin)
+// -1 if an ADDRESS_MAP_HASH line is bad
+int read_config_file(FILE * fin)
 {
 	char 	c;
 	char 	input_string[256];
 	int	input_int;
 	float   input_float;
+	unsigned long long int input_mask;
+	char	field_bit[256];
 
 	while ((c = fgetc(fin)) != EOF){
 		if((c != EOL) && (c != CR) && (c != SPACE) && (c != TAB)){
@@ -415,90 +606,587 @@ void read_config_file(FILE * fin)
 				ADDRESS_MAPPING= input_int;
 				break;
 			
+			case address_map_order_token:
+				fscanf(fin,"%255s",ADDRESS_MAP_ORDER);
+				break;
+
+			case address_map_bank_xor_token:
+				fscanf(fin,"%d",&input_int);
+				ADDRESS_MAP_BANK_XOR = input_int;
+				break;
+
+			case address_map_channel_xor_token:
+				fscanf(fin,"%d",&input_int);
+				ADDRESS_MAP_CHANNEL_XOR = input_int;
+				break;
+
+			case address_map_rank_xor_token:
+				fscanf(fin,"%d",&input_int);
+				ADDRESS_MAP_RANK_XOR = input_int;
+				break;
+
+			case address_map_hash_token:
+				fscanf(fin,"%255s %llx",field_bit,&input_mask);
+				if (!add_address_map_hash(field_bit, input_mask))
+					return -1;
+				break;
+
 			case wq_lookup_latency_token:
 				fscanf(fin,"%d",&input_int);
 				WQ_LOOKUP_LATENCY = input_int;
 				break;
 
+			case dram_device_token:
+				fscanf(fin,"%255s",DRAM_DEVICE);
+				break;
+
+			case dram_device_path_token:
+				fscanf(fin,"%1023s",DRAM_DEVICE_PATH);
+				break;
+
+			case chips_per_rank_token:
+				fscanf(fin,"%d",&input_int);
+				CHIPS_PER_RANK = input_int;
+				break;
+
+			case core_power_token:
+				fscanf(fin,"%f",&input_float);
+				CORE_POWER = input_float;
+				break;
+
+			case misc_power_token:
+				fscanf(fin,"%f",&input_float);
+				MISC_POWER = input_float;
+				break;
+
+			case num_bank_groups_token:
+				fscanf(fin,"%d",&input_int);
+				NUM_BANK_GROUPS = input_int;
+				break;
+
+			case t_ccd_s_token:
+				fscanf(fin,"%d",&input_int);
+				T_CCD_S = input_int*PROCESSOR_CLK_MULTIPLIER;
+				break;
+
+			case t_ccd_l_token:
+				fscanf(fin,"%d",&input_int);
+				T_CCD_L = input_int*PROCESSOR_CLK_MULTIPLIER;
+				break;
+
+			case t_rrd_s_token:
+				fscanf(fin,"%d",&input_int);
+				T_RRD_S = input_int*PROCESSOR_CLK_MULTIPLIER;
+				break;
+
+			case t_rrd_l_token:
+				fscanf(fin,"%d",&input_int);
+				T_RRD_L = input_int*PROCESSOR_CLK_MULTIPLIER;
+				break;
+
+			case t_wtr_s_token:
+				fscanf(fin,"%d",&input_int);
+				T_WTR_S = input_int*PROCESSOR_CLK_MULTIPLIER;
+				break;
+
+			case t_wtr_l_token:
+				fscanf(fin,"%d",&input_int);
+				T_WTR_L = input_int*PROCESSOR_CLK_MULTIPLIER;
+				break;
+
+			case t_rfc2_token:
+				fscanf(fin,"%d",&input_int);
+				T_RFC2 = input_int*PROCESSOR_CLK_MULTIPLIER;
+				break;
+
+			case t_rfc4_token:
+				fscanf(fin,"%d",&input_int);
+				T_RFC4 = input_int*PROCESSOR_CLK_MULTIPLIER;
+				break;
+
+			case t_rfcpb_token:
+				fscanf(fin,"%d",&input_int);
+				T_RFCPB = input_int*PROCESSOR_CLK_MULTIPLIER;
+				break;
+
+			case refresh_mode_token:
+				fscanf(fin,"%d",&input_int);
+				REFRESH_MODE = input_int;
+				break;
+
+			case refresh_granularity_token:
+				fscanf(fin,"%d",&input_int);
+				REFRESH_GRANULARITY = input_int;
+				break;
+
+			case refresh_pause_segments_token:
+				fscanf(fin,"%d",&input_int);
+				REFRESH_PAUSE_SEGMENTS = input_int;
+				break;
+
+			case refresh_policy_token:
+				fscanf(fin,"%d",&input_int);
+				REFRESH_POLICY = input_int;
+				break;
+
+			case row_predictor_token:
+				fscanf(fin,"%d",&input_int);
+				ROW_PREDICTOR = input_int;
+				break;
+
+			case speculative_activate_token:
+				fscanf(fin,"%d",&input_int);
+				SPECULATIVE_ACTIVATE = input_int;
+				break;
+
+			case speculative_precharge_token:
+				fscanf(fin,"%d",&input_int);
+				SPECULATIVE_PRECHARGE = input_int;
+				break;
+
+			case page_policy_token:
+				fscanf(fin,"%d",&input_int);
+				PAGE_POLICY = input_int;
+				break;
+
+			case page_timeout_token:
+				fscanf(fin,"%d",&input_int);
+				PAGE_TIMEOUT = input_int*PROCESSOR_CLK_MULTIPLIER;
+				break;
+
+			case page_hit_cap_token:
+				fscanf(fin,"%d",&input_int);
+				PAGE_HIT_CAP = input_int;
+				break;
+
+			case write_drain_policy_token:
+				fscanf(fin,"%d",&input_int);
+				WRITE_DRAIN_POLICY = input_int;
+				break;
+
+			case write_hi_wm_token:
+				fscanf(fin,"%d",&input_int);
+				WRITE_HI_WM = input_int;
+				break;
+
+			case write_lo_wm_token:
+				fscanf(fin,"%d",&input_int);
+				WRITE_LO_WM = input_int;
+				break;
+
+			case write_batch_per_rank_token:
+				fscanf(fin,"%d",&input_int);
+				WRITE_BATCH_PER_RANK = input_int;
+				break;
+
+			case eager_writeback_token:
+				fscanf(fin,"%d",&input_int);
+				EAGER_WRITEBACK = input_int;
+				break;
+
+			case qos_policy_token:
+				fscanf(fin,"%d",&input_int);
+				QOS_POLICY = input_int;
+				break;
+
+			case qos_classes_token:
+				fscanf(fin,"%255s",QOS_CLASSES);
+				break;
+
+			case qos_shares_token:
+				fscanf(fin,"%255s",QOS_SHARES);
+				break;
+
+			case interference_stats_token:
+				fscanf(fin,"%d",&input_int);
+				INTERFERENCE_STATS = input_int;
+				break;
+
+			case core_policy_token:
+				fscanf(fin,"%d",&input_int);
+				CORE_POLICY = input_int;
+				break;
+
+			case mshr_size_token:
+				fscanf(fin,"%d",&input_int);
+				MSHR_SIZE = input_int;
+				break;
+
+			case llc_size_token:
+				fscanf(fin,"%d",&input_int);
+				LLC_SIZE = input_int;
+				break;
+
+			case llc_ways_token:
+				fscanf(fin,"%d",&input_int);
+				LLC_WAYS = input_int;
+				break;
+
+			case llc_latency_token:
+				fscanf(fin,"%d",&input_int);
+				LLC_LATENCY = input_int;
+				break;
+
+			case llc_replacement_token:
+				fscanf(fin,"%d",&input_int);
+				LLC_REPLACEMENT = input_int;
+				break;
+
+			case prefetcher_token:
+				fscanf(fin,"%d",&input_int);
+				PREFETCHER = input_int;
+				break;
+
+			case prefetch_degree_token:
+				fscanf(fin,"%d",&input_int);
+				PREFETCH_DEGREE = input_int;
+				break;
+
+			case prefetch_buffer_token:
+				fscanf(fin,"%d",&input_int);
+				PREFETCH_BUFFER = input_int;
+				break;
+
+			case prefetch_priority_token:
+				fscanf(fin,"%d",&input_int);
+				PREFETCH_PRIORITY = input_int;
+				break;
+
+			case trace_format_token:
+				fscanf(fin,"%d",&input_int);
+				TRACE_FORMAT = input_int;
+				break;
+
+			case stall_stats_token:
+				fscanf(fin,"%d",&input_int);
+				STALL_STATS = input_int;
+				break;
+
+			case bus_stats_token:
+				fscanf(fin,"%d",&input_int);
+				BUS_STATS = input_int;
+				break;
+
+			case bus_stats_interval_token:
+				fscanf(fin,"%d",&input_int);
+				BUS_STATS_INTERVAL = input_int;
+				break;
+
+			case energy_stats_token:
+				fscanf(fin,"%d",&input_int);
+				ENERGY_STATS = input_int;
+				break;
+
+			case energy_interval_token:
+				fscanf(fin,"%d",&input_int);
+				ENERGY_INTERVAL = input_int;
+				break;
+
+			case power_policy_token:
+				fscanf(fin,"%d",&input_int);
+				POWER_POLICY = input_int;
+				break;
+
+			case power_timeout_token:
+				fscanf(fin,"%d",&input_int);
+				POWER_TIMEOUT = input_int*PROCESSOR_CLK_MULTIPLIER;
+				break;
+
+			case dvfs_devices_token:
+				fscanf(fin,"%1023s",DVFS_DEVICES);
+				break;
+
+			case dvfs_policy_token:
+				fscanf(fin,"%d",&input_int);
+				DVFS_POLICY = input_int;
+				break;
+
+			case dvfs_interval_token:
+				fscanf(fin,"%d",&input_int);
+				DVFS_INTERVAL = input_int;
+				break;
+
+			case dvfs_target_util_token:
+				fscanf(fin,"%d",&input_int);
+				DVFS_TARGET_UTIL = input_int;
+				break;
+
+			case dvfs_relock_token:
+				fscanf(fin,"%d",&input_int);
+				DVFS_RELOCK = input_int*PROCESSOR_CLK_MULTIPLIER;
+				break;
+
 			case unknown_token:
 			default:
-				printf("PANIC: bad token in cfg file\n");
+				fprintf(usimm_out, "PANIC: bad token in cfg file\n");
 				break;
 
 		}
 	}
+	return 0;
+}
+
+
+// Every parameter back to zero before a config file is read, as on a
+// thread that has not simulated yet. NUMCORES is set by the caller.
+void reset_params()
+{
+	PROCESSOR_CLK_MULTIPLIER = 0;
+	ROBSIZE = 0;
+	MAX_RETIRE = 0;
+	MAX_FETCH = 0;
+	PIPELINEDEPTH = 0;
+	CORE_POWER = 0;
+	MISC_POWER = 0;
+	NUM_CHANNELS = 0;
+	NUM_RANKS = 0;
+	NUM_BANKS = 0;
+	NUM_BANK_GROUPS = 0;
+	NUM_ROWS = 0;
+	NUM_COLUMNS = 0;
+	CACHE_LINE_SIZE = 0;
+	ADDRESS_BITS = 0;
+	DRAM_DEVICE[0] = '\0';
+	DRAM_DEVICE_PATH[0] = '\0';
+	CHIPS_PER_RANK = 0;
+	DRAM_CLK_FREQUENCY = 0;
+	T_RCD = 0;
+	T_RP = 0;
+	T_CAS = 0;
+	T_RAS = 0;
+	T_RC = 0;
+	T_CWD = 0;
+	T_WR = 0;
+	T_WTR = 0;
+	T_WTR_S = 0;
+	T_WTR_L = 0;
+	T_RTRS = 0;
+	T_DATA_TRANS = 0;
+	T_RTP = 0;
+	T_CCD = 0;
+	T_CCD_S = 0;
+	T_CCD_L = 0;
+	T_XP = 0;
+	T_XP_DLL = 0;
+	T_CKE = 0;
+	T_PD_MIN = 0;
+	T_RRD = 0;
+	T_RRD_S = 0;
+	T_RRD_L = 0;
+	T_FAW = 0;
+	T_REFI = 0;
+	T_RFC = 0;
+	T_RFC2 = 0;
+	T_RFC4 = 0;
+	T_RFCPB = 0;
+	REFRESH_MODE = 0;
+	REFRESH_GRANULARITY = 0;
+	REFRESH_PAUSE_SEGMENTS = 0;
+	REFRESH_POLICY = 0;
+	ROW_PREDICTOR = 0;
+	SPECULATIVE_ACTIVATE = 0;
+	SPECULATIVE_PRECHARGE = 0;
+	PAGE_POLICY = 0;
+	PAGE_TIMEOUT = 0;
+	PAGE_HIT_CAP = 0;
+	POWER_POLICY = 0;
+	POWER_TIMEOUT = 0;
+	WRITE_DRAIN_POLICY = 0;
+	WRITE_HI_WM = 0;
+	WRITE_LO_WM = 0;
+	WRITE_BATCH_PER_RANK = 0;
+	EAGER_WRITEBACK = 0;
+	QOS_POLICY = 0;
+	QOS_CLASSES[0] = '\0';
+	QOS_SHARES[0] = '\0';
+	INTERFERENCE_STATS = 0;
+	CORE_POLICY = 0;
+	MSHR_SIZE = 0;
+	LLC_SIZE = 0;
+	LLC_WAYS = 0;
+	LLC_LATENCY = 0;
+	LLC_REPLACEMENT = 0;
+	PREFETCHER = 0;
+	PREFETCH_DEGREE = 0;
+	PREFETCH_BUFFER = 0;
+	PREFETCH_PRIORITY = 0;
+	TRACE_FORMAT = 0;
+	STALL_STATS = 0;
+	BUS_STATS = 0;
+	BUS_STATS_INTERVAL = 0;
+	ENERGY_STATS = 0;
+	ENERGY_INTERVAL = 0;
+	DVFS_DEVICES[0] = '\0';
+	DVFS_POLICY = 0;
+	DVFS_INTERVAL = 0;
+	DVFS_TARGET_UTIL = 0;
+	DVFS_RELOCK = 0;
+	VDD = 0;
+	IDD0 = 0;
+	IDD1 = 0;
+	IDD2P0 = 0;
+	IDD2P1 = 0;
+	IDD2N = 0;
+	IDD3P = 0;
+	IDD3N = 0;
+	IDD4R = 0;
+	IDD4W = 0;
+	IDD5 = 0;
+	WQ_CAPACITY = 0;
+	ADDRESS_MAPPING = 0;
+	ADDRESS_MAP_ORDER[0] = '\0';
+	ADDRESS_MAP_BANK_XOR = 0;
+	ADDRESS_MAP_CHANNEL_XOR = 0;
+	ADDRESS_MAP_RANK_XOR = 0;
+	WQ_LOOKUP_LATENCY = 0;
 }
 
 
 void print_params()
 {
-	printf("----------------------------------------------------------------------------------------\n");
-	printf("------------------------\n");
-	printf("- SIMULATOR PARAMETERS -\n");
-	printf("------------------------\n");
-	printf("\n-------------\n");
-	printf("- PROCESSOR -\n");
-	printf("-------------\n");
-	printf("PROCESSOR_CLK_MULTIPLIER:   %6d\n", PROCESSOR_CLK_MULTIPLIER);
-	printf("ROBSIZE:                    %6d\n", ROBSIZE);
-	printf("MAX_FETCH:                  %6d\n", MAX_FETCH);
-	printf("MAX_RETIRE:                 %6d\n", MAX_RETIRE);
-	printf("PIPELINEDEPTH:              %6d\n", PIPELINEDEPTH);          
-
-	printf("\n---------------\n");
-	printf("- DRAM Config -\n");
-	printf("---------------\n");
-	printf("NUM_CHANNELS:               %6d\n", NUM_CHANNELS);
-  printf("NUM_RANKS:                  %6d\n", NUM_RANKS);
-  printf("NUM_BANKS:                  %6d\n", NUM_BANKS);
-  printf("NUM_ROWS:                   %6d\n", NUM_ROWS);
-  printf("NUM_COLUMNS:                %6d\n", NUM_COLUMNS);
-
-	printf("\n---------------\n");
-	printf("- DRAM Timing -\n");
-	printf("---------------\n");
-	printf("T_RCD:                      %6d\n", T_RCD);
-  printf("T_RP:                       %6d\n", T_RP);
-  printf("T_CAS:                      %6d\n", T_CAS);
-  printf("T_RC:                       %6d\n", T_RC);
-  printf("T_RAS:                      %6d\n", T_RAS);
-  printf("T_RRD:                      %6d\n", T_RRD);
-  printf("T_FAW:                      %6d\n", T_FAW);
-  printf("T_WR:                       %6d\n", T_WR);
-  printf("T_WTR:                      %6d\n", T_WTR);
-  printf("T_RTP:                      %6d\n", T_RTP);
-  printf("T_CCD:                      %6d\n", T_CCD);
-  printf("T_RFC:                      %6d\n", T_RFC);
-  printf("T_REFI:                     %6d\n", T_REFI);
-  printf("T_CWD:                      %6d\n", T_CWD);
-  printf("T_RTRS:                     %6d\n", T_RTRS);
-  printf("T_PD_MIN:                   %6d\n", T_PD_MIN);
-  printf("T_XP:                       %6d\n", T_XP);
-  printf("T_XP_DLL:                   %6d\n", T_XP_DLL);
-  printf("T_DATA_TRANS:               %6d\n", T_DATA_TRANS);
-
-	printf("\n---------------------------\n");
-	printf("- DRAM Idd Specifications -\n");
-	printf("---------------------------\n");
-
-	printf("VDD:                        %05.2f\n", VDD);
-  printf("IDD0:                       %05.2f\n", IDD0);
-  printf("IDD2P0:                     %05.2f\n", IDD2P0);
-  printf("IDD2P1:                     %05.2f\n", IDD2P1);
-  printf("IDD2N:                      %05.2f\n", IDD2N);
-  printf("IDD3P:                      %05.2f\n", IDD3P);
-  printf("IDD3N:                      %05.2f\n", IDD3N);
-  printf("IDD4R:                      %05.2f\n", IDD4R);
-  printf("IDD4W:                      %05.2f\n", IDD4W);
-  printf("IDD5:                       %05.2f\n", IDD5);
-
-	printf("\n-------------------\n");
-	printf("- DRAM Controller -\n");
-	printf("-------------------\n");
-	printf("WQ_CAPACITY:                %6d\n", WQ_CAPACITY);
-  printf("ADDRESS_MAPPING:            %6d\n", ADDRESS_MAPPING);
-  printf("WQ_LOOKUP_LATENCY:          %6d\n", WQ_LOOKUP_LATENCY);
-	printf("\n----------------------------------------------------------------------------------------\n");
+	fprintf(usimm_out, "----------------------------------------------------------------------------------------\n");
+	fprintf(usimm_out, "------------------------\n");
+	fprintf(usimm_out, "- SIMULATOR PARAMETERS -\n");
+	fprintf(usimm_out, "------------------------\n");
+	fprintf(usimm_out, "\n-------------\n");
+	fprintf(usimm_out, "- PROCESSOR -\n");
+	fprintf(usimm_out, "-------------\n");
+	fprintf(usimm_out, "PROCESSOR_CLK_MULTIPLIER:   %6d\n", PROCESSOR_CLK_MULTIPLIER);
+	fprintf(usimm_out, "ROBSIZE:                    %6d\n", ROBSIZE);
+	fprintf(usimm_out, "MAX_FETCH:                  %6d\n", MAX_FETCH);
+	fprintf(usimm_out, "MAX_RETIRE:                 %6d\n", MAX_RETIRE);
+	fprintf(usimm_out, "PIPELINEDEPTH:              %6d\n", PIPELINEDEPTH);          
+  fprintf(usimm_out, "CORE_POWER:                 %6.2f\n", CORE_POWER);
+  fprintf(usimm_out, "MISC_POWER:                 %6.2f\n", MISC_POWER);
+
+	fprintf(usimm_out, "\n---------------\n");
+	fprintf(usimm_out, "- DRAM Config -\n");
+	fprintf(usimm_out, "---------------\n");
+	fprintf(usimm_out, "NUM_CHANNELS:               %6d\n", NUM_CHANNELS);
+  fprintf(usimm_out, "NUM_RANKS:                  %6d\n", NUM_RANKS);
+  fprintf(usimm_out, "NUM_BANKS:                  %6d\n", NUM_BANKS);
+  fprintf(usimm_out, "NUM_BANK_GROUPS:            %6d\n", NUM_BANK_GROUPS);
+  fprintf(usimm_out, "NUM_ROWS:                   %6d\n", NUM_ROWS);
+  fprintf(usimm_out, "NUM_COLUMNS:                %6d\n", NUM_COLUMNS);
+  fprintf(usimm_out, "DRAM_DEVICE:                %s\n", DRAM_DEVICE);
+  fprintf(usimm_out, "CHIPS_PER_RANK:             %6d\n", CHIPS_PER_RANK);
+
+	fprintf(usimm_out, "\n---------------\n");
+	fprintf(usimm_out, "- DRAM Timing -\n");
+	fprintf(usimm_out, "---------------\n");
+	fprintf(usimm_out, "T_RCD:                      %6d\n", T_RCD);
+  fprintf(usimm_out, "T_RP:                       %6d\n", T_RP);
+  fprintf(usimm_out, "T_CAS:                      %6d\n", T_CAS);
+  fprintf(usimm_out, "T_RC:                       %6d\n", T_RC);
+  fprintf(usimm_out, "T_RAS:                      %6d\n", T_RAS);
+  fprintf(usimm_out, "T_RRD:                      %6d\n", T_RRD);
+  fprintf(usimm_out, "T_FAW:                      %6d\n", T_FAW);
+  fprintf(usimm_out, "T_WR:                       %6d\n", T_WR);
+  fprintf(usimm_out, "T_WTR:                      %6d\n", T_WTR);
+  fprintf(usimm_out, "T_RTP:                      %6d\n", T_RTP);
+  fprintf(usimm_out, "T_CCD:                      %6d\n", T_CCD);
+  fprintf(usimm_out, "T_CCD_S:                    %6d\n", T_CCD_S);
+  fprintf(usimm_out, "T_CCD_L:                    %6d\n", T_CCD_L);
+  fprintf(usimm_out, "T_RRD_S:                    %6d\n", T_RRD_S);
+  fprintf(usimm_out, "T_RRD_L:                    %6d\n", T_RRD_L);
+  fprintf(usimm_out, "T_WTR_S:                    %6d\n", T_WTR_S);
+  fprintf(usimm_out, "T_WTR_L:                    %6d\n", T_WTR_L);
+  fprintf(usimm_out, "T_RFC:                      %6d\n", T_RFC);
+  fprintf(usimm_out, "T_RFC2:                     %6d\n", T_RFC2);
+  fprintf(usimm_out, "T_RFC4:                     %6d\n", T_RFC4);
+  fprintf(usimm_out, "T_RFCPB:                    %6d\n", T_RFCPB);
+  fprintf(usimm_out, "T_REFI:                     %6d\n", T_REFI);
+  fprintf(usimm_out, "T_CWD:                      %6d\n", T_CWD);
+  fprintf(usimm_out, "T_RTRS:                     %6d\n", T_RTRS);
+  fprintf(usimm_out, "T_PD_MIN:                   %6d\n", T_PD_MIN);
+  fprintf(usimm_out, "T_XP:                       %6d\n", T_XP);
+  fprintf(usimm_out, "T_XP_DLL:                   %6d\n", T_XP_DLL);
+  fprintf(usimm_out, "T_DATA_TRANS:               %6d\n", T_DATA_TRANS);
+
+	fprintf(usimm_out, "\n---------------------------\n");
+	fprintf(usimm_out, "- DRAM Idd Specifications -\n");
+	fprintf(usimm_out, "---------------------------\n");
+
+	fprintf(usimm_out, "VDD:                        %05.2f\n", VDD);
+  fprintf(usimm_out, "IDD0:                       %05.2f\n", IDD0);
+  fprintf(usimm_out, "IDD2P0:                     %05.2f\n", IDD2P0);
+  fprintf(usimm_out, "IDD2P1:                     %05.2f\n", IDD2P1);
+  fprintf(usimm_out, "IDD2N:                      %05.2f\n", IDD2N);
+  fprintf(usimm_out, "IDD3P:                      %05.2f\n", IDD3P);
+  fprintf(usimm_out, "IDD3N:                      %05.2f\n", IDD3N);
+  fprintf(usimm_out, "IDD4R:                      %05.2f\n", IDD4R);
+  fprintf(usimm_out, "IDD4W:                      %05.2f\n", IDD4W);
+  fprintf(usimm_out, "IDD5:                       %05.2f\n", IDD5);
+
+	fprintf(usimm_out, "\n-------------------\n");
+	fprintf(usimm_out, "- DRAM Controller -\n");
+	fprintf(usimm_out, "-------------------\n");
+	fprintf(usimm_out, "WQ_CAPACITY:                %6d\n", WQ_CAPACITY);
+  fprintf(usimm_out, "ADDRESS_MAPPING:            %6d\n", ADDRESS_MAPPING);
+  if (ADDRESS_MAPPING == 3)
+    fprintf(usimm_out, "ADDRESS_MAP_ORDER:          %s\n", ADDRESS_MAP_ORDER);
+  fprintf(usimm_out, "ADDRESS_MAP_BANK_XOR:       %6d\n", ADDRESS_MAP_BANK_XOR);
+  fprintf(usimm_out, "ADDRESS_MAP_CHANNEL_XOR:    %6d\n", ADDRESS_MAP_CHANNEL_XOR);
+  fprintf(usimm_out, "ADDRESS_MAP_RANK_XOR:       %6d\n", ADDRESS_MAP_RANK_XOR);
+  fprintf(usimm_out, "WQ_LOOKUP_LATENCY:          %6d\n", WQ_LOOKUP_LATENCY);
+  fprintf(usimm_out, "REFRESH_MODE:               %6d\n", REFRESH_MODE);
+  fprintf(usimm_out, "REFRESH_GRANULARITY:        %6d\n", REFRESH_GRANULARITY);
+  fprintf(usimm_out, "REFRESH_PAUSE_SEGMENTS:     %6d\n", REFRESH_PAUSE_SEGMENTS);
+  fprintf(usimm_out, "REFRESH_POLICY:             %6d\n", REFRESH_POLICY);
+  fprintf(usimm_out, "ROW_PREDICTOR:              %6d\n", ROW_PREDICTOR);
+  fprintf(usimm_out, "SPECULATIVE_ACTIVATE:       %6d\n", SPECULATIVE_ACTIVATE);
+  fprintf(usimm_out, "SPECULATIVE_PRECHARGE:      %6d\n", SPECULATIVE_PRECHARGE);
+  fprintf(usimm_out, "PAGE_POLICY:                %6d\n", PAGE_POLICY);
+  fprintf(usimm_out, "PAGE_TIMEOUT:               %6d\n", PAGE_TIMEOUT);
+  fprintf(usimm_out, "PAGE_HIT_CAP:               %6d\n", PAGE_HIT_CAP);
+  fprintf(usimm_out, "POWER_POLICY:               %6d\n", POWER_POLICY);
+  fprintf(usimm_out, "POWER_TIMEOUT:              %6d\n", POWER_TIMEOUT);
+  fprintf(usimm_out, "WRITE_DRAIN_POLICY:         %6d\n", WRITE_DRAIN_POLICY);
+  fprintf(usimm_out, "WRITE_HI_WM:                %6d\n", WRITE_HI_WM);
+  fprintf(usimm_out, "WRITE_LO_WM:                %6d\n", WRITE_LO_WM);
+  fprintf(usimm_out, "WRITE_BATCH_PER_RANK:       %6d\n", WRITE_BATCH_PER_RANK);
+  fprintf(usimm_out, "EAGER_WRITEBACK:            %6d\n", EAGER_WRITEBACK);
+  fprintf(usimm_out, "QOS_POLICY:                 %6d\n", QOS_POLICY);
+  if (QOS_POLICY)
+  {
+    fprintf(usimm_out, "QOS_CLASSES:                %s\n", QOS_CLASSES);
+    fprintf(usimm_out, "QOS_SHARES:                 %s\n", QOS_SHARES);
+  }
+  fprintf(usimm_out, "INTERFERENCE_STATS:         %6d\n", INTERFERENCE_STATS);
+  fprintf(usimm_out, "CORE_POLICY:                %6d\n", CORE_POLICY);
+  fprintf(usimm_out, "MSHR_SIZE:                  %6d\n", MSHR_SIZE);
+  fprintf(usimm_out, "LLC_SIZE:                   %6d\n", LLC_SIZE);
+  if (LLC_SIZE)
+  {
+    fprintf(usimm_out, "LLC_WAYS:                   %6d\n", LLC_WAYS);
+    fprintf(usimm_out, "LLC_LATENCY:                %6d\n", LLC_LATENCY);
+    fprintf(usimm_out, "LLC_REPLACEMENT:            %6d\n", LLC_REPLACEMENT);
+  }
+  fprintf(usimm_out, "PREFETCHER:                 %6d\n", PREFETCHER);
+  if (PREFETCHER)
+  {
+    fprintf(usimm_out, "PREFETCH_DEGREE:            %6d\n", PREFETCH_DEGREE);
+    fprintf(usimm_out, "PREFETCH_BUFFER:            %6d\n", PREFETCH_BUFFER);
+    fprintf(usimm_out, "PREFETCH_PRIORITY:          %6d\n", PREFETCH_PRIORITY);
+  }
+  fprintf(usimm_out, "TRACE_FORMAT:               %6d\n", TRACE_FORMAT);
+  fprintf(usimm_out, "STALL_STATS:                %6d\n", STALL_STATS);
+  fprintf(usimm_out, "BUS_STATS:                  %6d\n", BUS_STATS);
+  if (BUS_STATS)
+    fprintf(usimm_out, "BUS_STATS_INTERVAL:         %6d\n", BUS_STATS_INTERVAL);
+  fprintf(usimm_out, "ENERGY_STATS:               %6d\n", ENERGY_STATS);
+  if (ENERGY_STATS)
+    fprintf(usimm_out, "ENERGY_INTERVAL:            %6d\n", ENERGY_INTERVAL);
+  if (DVFS_DEVICES[0])
+  {
+    fprintf(usimm_out, "DVFS_DEVICES:               %s\n", DVFS_DEVICES);
+    fprintf(usimm_out, "DVFS_POLICY:                %6d\n", DVFS_POLICY);
+    fprintf(usimm_out, "DVFS_INTERVAL:              %6d\n", DVFS_INTERVAL);
+    fprintf(usimm_out, "DVFS_TARGET_UTIL:           %6d\n", DVFS_TARGET_UTIL);
+    fprintf(usimm_out, "DVFS_RELOCK:                %6d\n", DVFS_RELOCK);
+  }
+	print_address_map();
+	fprintf(usimm_out, "\n----------------------------------------------------------------------------------------\n");
 
 
 }
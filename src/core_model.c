@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "params.h"
+#include "memory_controller.h"
+#include "processor.h"
+#include "core_model.h"
+#include "llc.h"
+#include "prefetch.h"
+
+extern USIMM_STATE long long int CYCLE_VAL;
+extern USIMM_STATE struct robstructure *ROB;
+
+// an instruction in the ROB, seq being its fetch number
+typedef struct
+{
+  long long int seq;
+  int index;
+} rob_ref_t;
+
+typedef struct
+{
+  long long int pc;
+  rob_ref_t read;
+} dependence_entry_t;
+
+typedef struct
+{
+  rob_ref_t read;
+  rob_ref_t producer;		// index -1 if none
+} held_read_t;
+
+typedef struct
+{
+  // ROB entries of the reads in the read queues
+  int *outstanding;
+  int num_outstanding;
+  held_read_t *held;
+  int num_held;
+  dependence_entry_t *last_read_from_pc;
+  rob_ref_t last_read;
+  // stats
+  long long int reads_issued;
+  long long int held_on_dependence;
+  long long int held_on_mshr;
+  long long int held_on_writeback;
+  long long int outstanding_sum;
+  long long int outstanding_cycles;
+} core_t;
+
+static USIMM_STATE core_t *cores;
+
+static const char *core_policy_names[] = { "ooo", "mlp", "blocking" };
+
+
+  int
+init_core_model ()
+{
+  if (CORE_POLICY < OOO_CORE_POLICY || CORE_POLICY > BLOCKING_CORE_POLICY)
+  {
+    fprintf (usimm_out, "PANIC: unknown CORE_POLICY %d\n", CORE_POLICY);
+    return -1;
+  }
+  if (MSHR_SIZE < 0)
+  {
+    fprintf (usimm_out, "PANIC: MSHR_SIZE must not be negative\n");
+    return -1;
+  }
+  cores = alloc_system_memory (NUMCORES, sizeof (core_t));
+  for (int c = 0; c < NUMCORES; c++)
+  {
+    cores[c].outstanding = alloc_system_memory (ROBSIZE, sizeof (int));
+    cores[c].held = alloc_system_memory (ROBSIZE, sizeof (held_read_t));
+    cores[c].last_read_from_pc =
+      alloc_system_memory (DEPENDENCE_TABLE_SIZE, sizeof (dependence_entry_t));
+    for (int i = 0; i < DEPENDENCE_TABLE_SIZE; i++)
+      cores[c].last_read_from_pc[i].read.index = -1;
+    cores[c].last_read.index = -1;
+  }
+  return 0;
+}
+
+
+// has the instruction returned its data (or retired)
+  static int
+completed (int core, rob_ref_t ref)
+{
+  return ref.index < 0 || ref.seq < committed[core]
+    || ROB[core].comptime[ref.index] < CYCLE_VAL;
+}
+
+
+  static int
+mshr_free (int core)
+{
+  return !MSHR_SIZE || cores[core].num_outstanding < MSHR_SIZE;
+}
+
+
+// can the read's LLC miss evict its victim now (see llc.h)
+  static int
+fill_allowed (int core, int index)
+{
+  return llc_fill_allowed (ROB[core].mem_address[index]);
+}
+
+
+// send a read to memory, or serve it from the LLC, the prefetch buffer or
+// the write or read queue
+  static void
+issue_read (int core, int index)
+{
+  core_t *cm = &cores[core];
+  long long int address = ROB[core].mem_address[index];
+
+  cm->reads_issued++;
+  if (llc_read (address, core))
+  {
+    ROB[core].comptime[index] = CYCLE_VAL + LLC_LATENCY + PIPELINEDEPTH;
+    return;
+  }
+  int served = prefetch_lookup (core, index);
+  if (served == PREFETCH_LATE)
+    cm->outstanding[cm->num_outstanding++] = index;
+  else if (served == PREFETCH_MISS)
+  {
+    int lat = read_matches_write_or_read_queue (address);
+    if (lat)
+      ROB[core].comptime[index] = CYCLE_VAL + lat + PIPELINEDEPTH;
+    else
+    {
+      insert_read (address, CYCLE_VAL, core, index,
+          ROB[core].instrpc[index]);
+      cm->outstanding[cm->num_outstanding++] = index;
+    }
+  }
+  prefetch_train (core, address, ROB[core].instrpc[index]);
+}
+
+
+  void
+fetch_read (int core, int index)
+{
+  core_t *cm = &cores[core];
+  rob_ref_t read = { fetched[core], index };
+  rob_ref_t producer = { 0, -1 };
+
+  if (CORE_POLICY == MLP_CORE_POLICY)
+  {
+    long long int pc = ROB[core].instrpc[index];
+    dependence_entry_t *e =
+      &cm->last_read_from_pc[(unsigned long long) pc % DEPENDENCE_TABLE_SIZE];
+    if (e->read.index >= 0 && e->pc == pc)
+      producer = e->read;
+    e->pc = pc;
+    e->read = read;
+  }
+  else if (CORE_POLICY == BLOCKING_CORE_POLICY)
+    producer = cm->last_read;
+  cm->last_read = read;
+
+  if (completed (core, producer) && mshr_free (core)
+      && fill_allowed (core, index))
+  {
+    issue_read (core, index);
+    return;
+  }
+  if (!completed (core, producer))
+    cm->held_on_dependence++;
+  else if (!mshr_free (core))
+    cm->held_on_mshr++;
+  else
+    cm->held_on_writeback++;
+  cm->held[cm->num_held].read = read;
+  cm->held[cm->num_held].producer = producer;
+  cm->num_held++;
+}
+
+
+  void
+update_core_model (int core)
+{
+  core_t *cm = &cores[core];
+
+  for (int i = 0; i < cm->num_outstanding;)
+  {
+    if (ROB[core].comptime[cm->outstanding[i]] < CYCLE_VAL)
+      cm->outstanding[i] = cm->outstanding[--cm->num_outstanding];
+    else
+      i++;
+  }
+  if (cm->num_outstanding)
+  {
+    cm->outstanding_sum += cm->num_outstanding;
+    cm->outstanding_cycles++;
+  }
+
+  // oldest first; the rest keep their order
+  int kept = 0;
+  for (int i = 0; i < cm->num_held; i++)
+  {
+    held_read_t *h = &cm->held[i];
+    if (completed (core, h->producer) && mshr_free (core)
+        && fill_allowed (core, h->read.index))
+      issue_read (core, h->read.index);
+    else
+      cm->held[kept++] = *h;
+  }
+  cm->num_held = kept;
+}
+
+
+  void
+print_core_model_stats ()
+{
+  fprintf (usimm_out, "------------------------------------\n");
+  fprintf (usimm_out, "Core model: %s", core_policy_names[CORE_POLICY]);
+  if (MSHR_SIZE)
+    fprintf (usimm_out, ", %d MSHRs\n", MSHR_SIZE);
+  else
+    fprintf (usimm_out, ", no MSHR limit\n");
+  for (int c = 0; c < NUMCORES; c++)
+  {
+    core_t *cm = &cores[c];
+    fprintf (usimm_out, "Core %d: reads issued %lld, held on a dependence %lld, held on full MSHRs %lld, average MLP %.2f\n",
+        c, cm->reads_issued, cm->held_on_dependence, cm->held_on_mshr,
+        cm->outstanding_cycles ?
+        (double) cm->outstanding_sum / cm->outstanding_cycles : 0.0);
+    if (LLC_SIZE)
+      fprintf (usimm_out, "Core %d: reads held on a write-back to a full write queue %lld\n",
+          c, cm->held_on_writeback);
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef __CORE_MODEL_H__
+#define __CORE_MODEL_H__
+
+// Core model: when the reads a core fetches are sent to memory.
+//
+// The ROB in main.c fetches MAX_FETCH and retires MAX_RETIRE
+// instructions a cycle in order. By default every read goes to the read
+// queue as soon as it is fetched, so a core keeps as many reads in
+// flight as its ROB holds. That overstates the memory-level parallelism
+// (MLP) of traces whose loads depend on each other, such as the pointer
+// chasing in canneal. The core model can hold reads back in the ROB
+// until they may issue:
+//
+//   CORE_POLICY  0   // ooo: reads issue when fetched
+//   CORE_POLICY  1   // mlp: a read waits for the read it depends on
+//   CORE_POLICY  2   // blocking: a read waits for all older reads
+//   MSHR_SIZE    N   // reads a core can have in the read queues, 0 for
+//                    // no limit
+//
+// Traces carry no register dependences, so policy 1 takes the load PC
+// (instrpc) as the hint: a read depends on the last older read fetched
+// from the same PC, as a loop walking a linked list issues its loads
+// from one PC, each needing the address the previous one returned.
+// Policy 2 models a core that stalls on every read miss (MLP of 1).
+// Reads that find their data in the LLC (see llc.h) or the write or
+// read queue are served without an MSHR. A read whose LLC miss would
+// evict a dirty line into a full write queue is held too. Held reads
+// issue oldest first once their producer has completed, an MSHR is
+// free and the write-back fits. Retirement
+// stays in order for all policies.
+//
+// The number of reads held back and the average number of reads each
+// core has in flight (its MLP) are printed at the end.
+
+#define OOO_CORE_POLICY 0
+#define MLP_CORE_POLICY 1
+#define BLOCKING_CORE_POLICY 2
+
+// entries of the per-core table of the last read from each PC
+#define DEPENDENCE_TABLE_SIZE 256
+
+// allocate the core state and check CORE_POLICY; -1 if it is unknown
+int init_core_model ();
+
+// a read was fetched into ROB entry 'index' of 'core' (with its
+// mem_address and instrpc set): send it to memory or hold it back
+void fetch_read (int core, int index);
+
+// free the MSHRs of completed reads and issue held reads that may go;
+// called every cycle for each core before it fetches
+void update_core_model (int core);
+
+void print_core_model_stats ();
+
+#endif // __CORE_MODEL_H__
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utlist.h"
+
+#include "params.h"
+#include "memory_controller.h"
+#include "data_bus.h"
+
+extern USIMM_STATE long long int CYCLE_VAL;
+
+#define max(a,b) (((a)>(b))?(a):(b))
+#define min(a,b) (((a)<(b))?(a):(b))
+
+typedef enum
+{
+  BUS_READ, BUS_WRITE, BUS_READ_TO_WRITE, BUS_WRITE_TO_READ,
+  BUS_RANK_SWITCH, BUS_REFRESH, BUS_PENDING, BUS_EMPTY, NUM_BUS_STATES
+} bus_state_t;
+
+static const char *bus_state_names[NUM_BUS_STATES] = {
+  "read", "write", "r2w", "w2r", "rank_sw", "refresh", "pending", "empty"
+};
+
+typedef struct
+{
+  long long int end;		// end of the last burst
+  int last_type;		// READ or WRITE, -1 before the first burst
+  int last_rank;
+  int last_bank;
+  long long int empty;		// idle cycles since 'end' with empty queues
+  long long int refresh;	// idle cycles since 'end' held by refresh
+  long long int cycles[NUM_BUS_STATES];
+  long long int (*series)[NUM_BUS_STATES];	// per BUS_STATS_INTERVAL
+  long long int intervals;	// entries allocated in 'series'
+} bus_t;
+
+static USIMM_STATE bus_t *buses;
+
+
+  int
+init_data_bus ()
+{
+  if (!BUS_STATS)
+    return 0;
+  if (BUS_STATS_INTERVAL < 0)
+  {
+    fprintf (usimm_out, "PANIC: BUS_STATS_INTERVAL must be >= 0\n");
+    return -1;
+  }
+  buses = alloc_system_memory (NUM_CHANNELS, sizeof (bus_t));
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    buses[c].last_type = -1;
+  return 0;
+}
+
+
+// charge 'cycles' bus cycles from cycle '*at' on to 'state', split over
+// the intervals of the time series
+  static void
+charge (bus_t * bus, bus_state_t state, long long int *at,
+    long long int cycles)
+{
+  bus->cycles[state] += cycles;
+  while (BUS_STATS_INTERVAL && cycles > 0)
+  {
+    long long int interval = *at / BUS_STATS_INTERVAL;
+    long long int part =
+      min (cycles, (interval + 1) * BUS_STATS_INTERVAL - *at);
+    if (interval >= bus->intervals)
+    {
+      long long int n = max (2 * bus->intervals, interval + 1);
+      bus->series =
+        realloc_system_memory (bus->series, n * sizeof (*bus->series));
+      memset (bus->series + bus->intervals, 0,
+          (n - bus->intervals) * sizeof (*bus->series));
+      bus->intervals = n;
+    }
+    bus->series[interval][state] += part;
+    *at += part;
+    cycles -= part;
+  }
+  if (!BUS_STATS_INTERVAL)
+    *at += cycles;
+}
+
+
+// charge the idle cycles from the end of the last burst to 'start';
+// 'turnaround' of them at most were needed after the last burst
+  static void
+charge_gap (bus_t * bus, long long int start, bus_state_t turn_state,
+    long long int turnaround)
+{
+  long long int at = bus->end;
+  long long int gap = start - bus->end;
+
+  if (gap <= 0)
+    return;
+  long long int empty = min (bus->empty, gap);
+  long long int refresh = min (bus->refresh, gap - empty);
+  turnaround = min (turnaround, gap - empty - refresh);
+  charge (bus, BUS_EMPTY, &at, empty);
+  charge (bus, BUS_REFRESH, &at, refresh);
+  charge (bus, turn_state, &at, turnaround);
+  charge (bus, BUS_PENDING, &at, gap - empty - refresh - turnaround);
+  bus->empty = 0;
+  bus->refresh = 0;
+}
+
+
+  void
+observe_data_bus (request_t * request, command_t cmd)
+{
+  if (!BUS_STATS || (cmd != COL_READ_CMD && cmd != COL_WRITE_CMD))
+    return;
+  bus_t *bus = &buses[request->dram_addr.channel];
+  int type = cmd == COL_READ_CMD ? READ : WRITE;
+  int rank = request->dram_addr.rank;
+  int bank = request->dram_addr.bank;
+  long long int start = CYCLE_VAL + (type == READ ? T_CAS : T_CWD);
+  bus_state_t turn_state = BUS_RANK_SWITCH;
+  long long int turnaround = 0;
+
+  // the least gap the timing constraints of issue_request_command ()
+  // leave between the two bursts
+  if (bus->last_type == WRITE && type == READ && bus->last_rank == rank)
+  {
+    turn_state = BUS_WRITE_TO_READ;
+    turnaround =
+      (is_same_bank_group (bank, bus->last_bank) ? T_WTR_L : T_WTR_S)
+      + T_CAS;
+  }
+  else if (bus->last_type >= 0 && bus->last_type != type)
+  {
+    turn_state = type == READ ? BUS_WRITE_TO_READ : BUS_READ_TO_WRITE;
+    turnaround = T_RTRS;
+  }
+  else if (bus->last_type >= 0 && bus->last_rank != rank)
+    turnaround = T_RTRS;
+  charge_gap (bus, start, turn_state, turnaround);
+
+  long long int at = start;
+  charge (bus, type == READ ? BUS_READ : BUS_WRITE, &at, T_DATA_TRANS);
+  bus->end = start + T_DATA_TRANS;
+  bus->last_type = type;
+  bus->last_rank = rank;
+  bus->last_bank = bank;
+}
+
+
+// 1 if every request queued on the channel waits for a refresh
+  static int
+held_by_refresh (int channel)
+{
+  request_t *curr = NULL;
+
+  LL_FOREACH (read_queue_head[channel], curr)
+    if (curr->stall_cause != STALL_REFRESH)
+      return 0;
+  LL_FOREACH (write_queue_head[channel], curr)
+    if (curr->stall_cause != STALL_REFRESH)
+      return 0;
+  return 1;
+}
+
+
+  void
+account_data_bus (int channel)
+{
+  if (!BUS_STATS)
+    return;
+  bus_t *bus = &buses[channel];
+
+  // a burst is on the bus or on its way
+  if (CYCLE_VAL < bus->end)
+    return;
+  if (!read_queue_length[channel] && !write_queue_length[channel])
+    bus->empty += PROCESSOR_CLK_MULTIPLIER;
+  else if (held_by_refresh (channel))
+    bus->refresh += PROCESSOR_CLK_MULTIPLIER;
+}
+
+
+  static void
+print_shares (long long int *cycles)
+{
+  long long int total = 0;
+
+  for (int s = 0; s < NUM_BUS_STATES; s++)
+    total += cycles[s];
+  for (int s = 0; s < NUM_BUS_STATES; s++)
+    fprintf (usimm_out, " %7.2f", total ? 100.0 * cycles[s] / total : 0.0);
+  long long int busy = cycles[BUS_READ] + cycles[BUS_WRITE];
+  long long int queued = total - cycles[BUS_EMPTY];
+  fprintf (usimm_out, " %7.2f %7.2f\n", total ? 100.0 * busy / total : 0.0,
+      queued ? 100.0 * busy / queued : 0.0);
+}
+
+
+  static void
+print_header (const char *first)
+{
+  fprintf (usimm_out, "%s", first);
+  for (int s = 0; s < NUM_BUS_STATES; s++)
+    fprintf (usimm_out, " %7s", bus_state_names[s]);
+  fprintf (usimm_out, " %7s %7s\n", "util", "eff");
+}
+
+
+  void
+print_data_bus_stats ()
+{
+  if (!BUS_STATS)
+    return;
+  // the idle time after the last burst
+  for (int c = 0; c < NUM_CHANNELS; c++)
+  {
+    bus_t *bus = &buses[c];
+    if (CYCLE_VAL > bus->end)
+      charge_gap (bus, CYCLE_VAL, BUS_RANK_SWITCH, 0);
+    bus->end = max (bus->end, CYCLE_VAL);
+  }
+
+  fprintf (usimm_out, "------------------------------------\n");
+  fprintf (usimm_out, "Data bus: %% of CPU cycles\n");
+  print_header ("          ");
+  for (int c = 0; c < NUM_CHANNELS; c++)
+  {
+    fprintf (usimm_out, "Channel %d ", c);
+    print_shares (buses[c].cycles);
+  }
+  if (!BUS_STATS_INTERVAL)
+    return;
+  fprintf (usimm_out, "Data bus time series: %% of every %d CPU cycles\n",
+      BUS_STATS_INTERVAL);
+  print_header ("       cycle channel");
+  for (long long int i = 0; i * BUS_STATS_INTERVAL < CYCLE_VAL; i++)
+    for (int c = 0; c < NUM_CHANNELS; c++)
+    {
+      long long int none[NUM_BUS_STATES] = { 0 };
+      fprintf (usimm_out, "%12lld %7d", i * BUS_STATS_INTERVAL, c);
+      print_shares (i < buses[c].intervals ? buses[c].series[i] : none);
+    }
+}
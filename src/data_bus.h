@@ -0,0 +1,53 @@
+#ifndef __DATA_BUS_H__
+#define __DATA_BUS_H__
+
+#include "memory_controller.h"
+
+// Data-bus occupancy.
+//
+// With
+//
+//   BUS_STATS  1
+//
+// in the config file, every CPU cycle of each channel's data bus is put
+// in one of:
+//
+// - read, write: a burst is on the bus (T_DATA_TRANS after the column
+//   command's T_CAS or T_CWD);
+// - r2w, w2r: the turnaround a write burst needs after a read burst
+//   (T_RTRS) or a read burst after a write burst of the same rank
+//   (T_WTR + T_CAS), T_RTRS for another rank;
+// - rank_sw: the T_RTRS between bursts of the same type from different
+//   ranks;
+// - refresh: idle while a refresh held back every queued request;
+// - pending: idle with requests queued for other reasons (bank timing,
+//   tCCD, the scheduler);
+// - empty: idle with empty read and write queues.
+//
+// Bursts are accounted by issue_request_command () as their column
+// commands issue. The idle gap before a burst is charged first to the
+// cycles the queues were empty, then to refresh, then to the
+// turnaround the burst needed after the previous one, and the rest to
+// pending. The shares of each channel are printed at the end, with the
+// data-bus utilization (read + write) and the efficiency (read + write
+// over the cycles with requests queued). With
+//
+//   BUS_STATS_INTERVAL  <cycles>
+//
+// the shares of every interval of that many CPU cycles are printed
+// too, as a time series.
+
+// -1 if BUS_STATS_INTERVAL is negative
+int init_data_bus ();
+
+// account for a command issued for a request (called by
+// issue_request_command)
+void observe_data_bus (request_t * request, command_t cmd);
+
+// look at an idle data bus in this DRAM cycle (called after all
+// commands of the cycle are issued)
+void account_data_bus (int channel);
+
+void print_data_bus_stats ();
+
+#endif // __DATA_BUS_H__
@@ -0,0 +1,449 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "params.h"
+#include "memory_controller.h"
+#include "energy.h"
+#include "dvfs.h"
+
+extern USIMM_STATE long long int CYCLE_VAL;
+
+#define max(a,b) (((a)>(b))?(a):(b))
+
+// the timings and currents an operating point sets
+#define NUM_DVFS_TIMINGS 23
+#define NUM_DVFS_CURRENTS 10
+// index of T_DATA_TRANS in the timings (see list_parameters ())
+#define DATA_TRANS_TIMING 16
+
+typedef struct
+{
+  char device[256];
+  int frequency;		// MHz
+  int timing[NUM_DVFS_TIMINGS];	// CPU cycles at the base DRAM clock
+  float current[NUM_DVFS_CURRENTS];
+  long long int cycles;		// CPU cycles spent at the point
+  double energy;		// pJ charged at the point
+  long long int switches;	// switches to the point
+} dvfs_point_t;
+
+static USIMM_STATE dvfs_point_t *points;
+static USIMM_STATE int num_points;
+
+static USIMM_STATE int *timings[NUM_DVFS_TIMINGS];
+static USIMM_STATE float *currents[NUM_DVFS_CURRENTS];
+
+static USIMM_STATE int requested_point;
+// cycle and total energy of the last switch
+static USIMM_STATE long long int switch_cycle;
+static USIMM_STATE double switch_energy;
+// column commands when the interval began
+static USIMM_STATE long long int interval_bursts;
+static USIMM_STATE long long int stats_relock_cycles;
+
+static int bandwidth_point ();
+
+typedef struct
+{
+  const char *name;
+  int (*choose) ();
+} dvfs_policy_t;
+
+static dvfs_policy_t dvfs_policies[] = {
+  {"none", NULL},
+  {"bandwidth", bandwidth_point},
+};
+
+#define NUM_DVFS_POLICIES \
+  ((int) (sizeof (dvfs_policies) / sizeof (dvfs_policies[0])))
+
+
+// as in the .vi files, in the order of list_parameters ()
+static const char *timing_names[NUM_DVFS_TIMINGS] = {
+  "T_RCD", "T_RP", "T_CAS", "T_RC", "T_RAS", "T_RRD", "T_FAW", "T_WR",
+  "T_WTR", "T_RTP", "T_CCD", "T_CWD", "T_RTRS", "T_PD_MIN", "T_XP",
+  "T_XP_DLL", "T_DATA_TRANS", "T_CCD_S", "T_CCD_L", "T_RRD_S", "T_RRD_L",
+  "T_WTR_S", "T_WTR_L"
+};
+static const char *current_names[NUM_DVFS_CURRENTS] = {
+  "VDD", "IDD0", "IDD2P0", "IDD2P1", "IDD2N", "IDD3P", "IDD3N", "IDD4R",
+  "IDD4W", "IDD5"
+};
+
+// a timing a device leaves out follows another one it sets, as for
+// DRAM_DEVICE in usimm_init_system (); {timing, follows}
+static const char *timing_defaults[][2] = {
+  {"T_CCD_S", "T_CCD"}, {"T_CCD_L", "T_CCD"}, {"T_RRD_S", "T_RRD"},
+  {"T_RRD_L", "T_RRD"}, {"T_WTR_S", "T_WTR"}, {"T_WTR_L", "T_WTR"}
+};
+
+#define NUM_TIMING_DEFAULTS \
+  ((int) (sizeof (timing_defaults) / sizeof (timing_defaults[0])))
+
+
+  static void
+list_parameters ()
+{
+  int *t[NUM_DVFS_TIMINGS] = {
+    &T_RCD, &T_RP, &T_CAS, &T_RC, &T_RAS, &T_RRD, &T_FAW, &T_WR, &T_WTR,
+    &T_RTP, &T_CCD, &T_CWD, &T_RTRS, &T_PD_MIN, &T_XP, &T_XP_DLL,
+    &T_DATA_TRANS, &T_CCD_S, &T_CCD_L, &T_RRD_S, &T_RRD_L, &T_WTR_S,
+    &T_WTR_L
+  };
+  float *i[NUM_DVFS_CURRENTS] = {
+    &VDD, &IDD0, &IDD2P0, &IDD2P1, &IDD2N, &IDD3P, &IDD3N, &IDD4R, &IDD4W,
+    &IDD5
+  };
+
+  memcpy (timings, t, sizeof (timings));
+  memcpy (currents, i, sizeof (currents));
+}
+
+
+// index of 'name' in 'names', -1 if it is not there
+  static int
+find_name (const char **names, int num_names, const char *name)
+{
+  for (int n = 0; n < num_names; n++)
+    if (!strcmp (names[n], name))
+      return n;
+  return -1;
+}
+
+
+  static void
+save_point (dvfs_point_t * p)
+{
+  for (int t = 0; t < NUM_DVFS_TIMINGS; t++)
+    p->timing[t] = *timings[t];
+  for (int i = 0; i < NUM_DVFS_CURRENTS; i++)
+    p->current[i] = *currents[i];
+}
+
+
+  static void
+load_point (dvfs_point_t * p)
+{
+  for (int t = 0; t < NUM_DVFS_TIMINGS; t++)
+    *timings[t] = p->timing[t];
+  for (int i = 0; i < NUM_DVFS_CURRENTS; i++)
+    *currents[i] = p->current[i];
+}
+
+
+  static void
+add_point (dvfs_point_t * values, const char *device, int frequency)
+{
+  points = realloc_system_memory (points,
+      (num_points + 1) * sizeof (dvfs_point_t));
+  memset (&points[num_points], 0, sizeof (dvfs_point_t));
+  snprintf (points[num_points].device, sizeof (points[num_points].device),
+      "%s", device);
+  points[num_points].frequency = frequency;
+  memcpy (points[num_points].timing, values->timing, sizeof (values->timing));
+  memcpy (points[num_points].current, values->current,
+      sizeof (values->current));
+  num_points++;
+}
+
+
+  static void
+add_base_point ()
+{
+  dvfs_point_t base;
+
+  list_parameters ();
+  save_point (&base);
+  add_point (&base, DRAM_DEVICE, DRAM_CLK_FREQUENCY);
+}
+
+
+// 0 if the device has no value for 'name'
+  static int
+read_value (FILE * vi, const char *device, const char *name,
+    const char *format, void *value)
+{
+  if (fscanf (vi, format, value) != 1)
+  {
+    fprintf (usimm_out, "PANIC: DVFS device %s has no value for %s\n",
+        device, name);
+    return 0;
+  }
+  return 1;
+}
+
+
+  void
+reset_dvfs_points ()
+{
+  points = NULL;
+  num_points = 0;
+}
+
+
+  int
+add_dvfs_point (FILE * vi, const char *device)
+{
+  int base = DRAM_CLK_FREQUENCY;
+  int frequency = 0;
+  int set[NUM_DVFS_TIMINGS] = { 0 };
+  char name[256];
+  int unused;
+  int ok = 1;
+
+  if (!num_points)
+    add_base_point ();
+
+  // the device's own values, in its DRAM cycles; the DRAM parameters
+  // are left alone
+  dvfs_point_t p = points[0];
+  while (ok && fscanf (vi, "%255s", name) == 1)
+  {
+    int t = find_name (timing_names, NUM_DVFS_TIMINGS, name);
+    int i = find_name (current_names, NUM_DVFS_CURRENTS, name);
+
+    if (!strncmp (name, "//", 2))
+    {
+      int c;
+      while ((c = fgetc (vi)) != '\n' && c != EOF)
+        ;
+    }
+    else if (!strcmp (name, "DRAM_CLK_FREQUENCY"))
+      ok = read_value (vi, device, name, "%d", &frequency);
+    else if (t >= 0)
+    {
+      ok = read_value (vi, device, name, "%d", &p.timing[t]);
+      set[t] = 1;
+    }
+    else if (i >= 0)
+      ok = read_value (vi, device, name, "%f", &p.current[i]);
+    // refresh timings are a time, those of point 0 are kept
+    else if (!strcmp (name, "T_RFC") || !strcmp (name, "T_REFI"))
+      ok = read_value (vi, device, name, "%d", &unused);
+    else
+    {
+      fprintf (usimm_out, "PANIC: DVFS device %s sets %s, which is not a timing or current of an operating point\n",
+          device, name);
+      return -1;
+    }
+  }
+  if (!ok)
+    return -1;
+  if (frequency <= 0 || frequency > base)
+  {
+    fprintf (usimm_out, "PANIC: DVFS device %s runs at %d MHz, DRAM_DEVICE at %d: a DVFS point cannot be faster\n",
+        device, frequency, base);
+    return -1;
+  }
+
+  // the timings the device sets, to whole DRAM cycles at the base
+  // clock; the others are point 0's
+  for (int t = 0; t < NUM_DVFS_TIMINGS; t++)
+    if (set[t])
+      p.timing[t] = (int) (((long long int) p.timing[t] * base + frequency - 1)
+          / frequency) * PROCESSOR_CLK_MULTIPLIER;
+  for (int d = 0; d < NUM_TIMING_DEFAULTS; d++)
+  {
+    int t = find_name (timing_names, NUM_DVFS_TIMINGS, timing_defaults[d][0]);
+    int from = find_name (timing_names, NUM_DVFS_TIMINGS, timing_defaults[d][1]);
+    if (!set[t] && set[from])
+      p.timing[t] = p.timing[from];
+  }
+  add_point (&p, device, frequency);
+  return 0;
+}
+
+
+  int
+init_dvfs ()
+{
+  if (DVFS_POLICY < 0 || DVFS_POLICY >= NUM_DVFS_POLICIES)
+  {
+    fprintf (usimm_out, "PANIC: unknown DVFS_POLICY %d\n", DVFS_POLICY);
+    return -1;
+  }
+  if (!num_points)
+    add_base_point ();
+  if (DVFS_POLICY != NO_DVFS_POLICY && num_points < 2)
+  {
+    fprintf (usimm_out, "PANIC: DVFS_POLICY %d needs DVFS_DEVICES\n",
+        DVFS_POLICY);
+    return -1;
+  }
+  dvfs_point = 0;
+  requested_point = 0;
+  switch_cycle = 0;
+  switch_energy = 0;
+  interval_bursts = 0;
+  stats_relock_cycles = 0;
+  return 0;
+}
+
+
+  int
+request_dvfs_point (int point)
+{
+  if (point < 0 || point >= num_points)
+  {
+    fprintf (usimm_out, "PANIC: unknown DVFS point %d\n", point);
+    return -1;
+  }
+  requested_point = point;
+  return 0;
+}
+
+
+  int
+get_num_dvfs_points ()
+{
+  return num_points;
+}
+
+
+  static long long int
+bursts ()
+{
+  long long int n = 0;
+
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    for (int r = 0; r < NUM_RANKS; r++)
+      for (int b = 0; b < NUM_BANKS; b++)
+        n += stats_num_read[c][r][b] + stats_num_write[c][r][b];
+  return n;
+}
+
+
+// the slowest point at which the last interval's bursts would have
+// kept the data buses busy at most DVFS_TARGET_UTIL % of the time
+  static int
+bandwidth_point ()
+{
+  long long int n = bursts () - interval_bursts;
+  double busy = (double) n * T_DATA_TRANS / NUM_CHANNELS / DVFS_INTERVAL;
+  int best = 0;
+
+  for (int p = 1; p < num_points; p++)
+  {
+    double predicted =
+      busy * points[p].timing[DATA_TRANS_TIMING] / T_DATA_TRANS;
+    if (100 * predicted <= DVFS_TARGET_UTIL
+        && points[p].frequency < points[best].frequency)
+      best = p;
+  }
+  return best;
+}
+
+
+// close the rows and wake the ranks of a channel, and hold its banks
+// until the DLL is relocked
+  static void
+relock_channel (int channel)
+{
+  long long int start = CYCLE_VAL;
+
+  for (int r = 0; r < NUM_RANKS; r++)
+    for (int b = 0; b < NUM_BANKS; b++)
+      if (dram_state[channel][r][b].state == ROW_ACTIVE
+          || dram_state[channel][r][b].state == ACTIVE_POWER_DOWN)
+        start = max (start, dram_state[channel][r][b].next_pre);
+  long long int end = start + T_RP + DVFS_RELOCK;
+
+  for (int r = 0; r < NUM_RANKS; r++)
+  {
+    for (int b = 0; b < NUM_BANKS; b++)
+    {
+      bank_t *bank = &dram_state[channel][r][b];
+      if (bank->state == ROW_ACTIVE || bank->state == ACTIVE_POWER_DOWN)
+        stats_num_precharge[channel][r][b]++;
+      if (bank->state != REFRESHING)
+      {
+        bank->state = IDLE;
+        bank->active_row = -1;
+      }
+      bank->next_pre = max (bank->next_pre, end);
+      bank->next_act = max (bank->next_act, end);
+      bank->next_read = max (bank->next_read, end);
+      bank->next_write = max (bank->next_write, end);
+      bank->next_powerdown = max (bank->next_powerdown, end);
+      bank->next_powerup = max (bank->next_powerup, end);
+      bank->next_refresh = max (bank->next_refresh, end);
+    }
+    update_residency (channel, r);
+  }
+  stats_relock_cycles += end - CYCLE_VAL;
+}
+
+
+  void
+update_dvfs ()
+{
+  dvfs_policy_t *policy = &dvfs_policies[DVFS_POLICY];
+
+  if (num_points < 2)
+    return;
+  if (policy->choose && CYCLE_VAL && CYCLE_VAL % DVFS_INTERVAL <
+      PROCESSOR_CLK_MULTIPLIER)
+  {
+    requested_point = policy->choose ();
+    interval_bursts = bursts ();
+  }
+  if (requested_point == dvfs_point)
+    return;
+
+  // the time at the old point is charged at its currents
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    for (int r = 0; r < NUM_RANKS; r++)
+      settle_residency (c, r);
+  double energy = total_energy ();
+  points[dvfs_point].cycles += CYCLE_VAL - switch_cycle;
+  points[dvfs_point].energy += energy - switch_energy;
+  switch_cycle = CYCLE_VAL;
+  switch_energy = energy;
+
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    relock_channel (c);
+  dvfs_point = requested_point;
+  load_point (&points[dvfs_point]);
+  points[dvfs_point].switches++;
+}
+
+
+  void
+print_dvfs_stats ()
+{
+  // ns per CPU cycle
+  double cycle_ns =
+    1000.0 / ((double) DRAM_CLK_FREQUENCY * PROCESSOR_CLK_MULTIPLIER);
+  long long int switches = 0;
+
+  if (num_points < 2)
+    return;
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    for (int r = 0; r < NUM_RANKS; r++)
+      settle_residency (c, r);
+  points[dvfs_point].cycles += CYCLE_VAL - switch_cycle;
+  points[dvfs_point].energy += total_energy () - switch_energy;
+  switch_cycle = CYCLE_VAL;
+  switch_energy = total_energy ();
+
+  fprintf (usimm_out, "------------------------------------\n");
+  fprintf (usimm_out, "DVFS policy: %s, DVFS_INTERVAL %d, DVFS_TARGET_UTIL %d%%\n",
+      dvfs_policies[DVFS_POLICY].name, DVFS_INTERVAL, DVFS_TARGET_UTIL);
+  fprintf (usimm_out, "%-6s %-20s %6s %8s %8s %12s %10s\n", "point",
+      "device", "MHz", "switches", "time%", "energy_uJ", "power_mW");
+  for (int p = 0; p < num_points; p++)
+  {
+    dvfs_point_t *point = &points[p];
+    fprintf (usimm_out, "%-6d %-20s %6d %8lld %8.2f %12.2f %10.2f\n", p,
+        point->device, point->frequency, point->switches,
+        CYCLE_VAL ? 100.0 * point->cycles / CYCLE_VAL : 0.0,
+        point->energy / 1e6,
+        point->cycles ? point->energy / (point->cycles * cycle_ns) : 0.0);
+    switches += point->switches;
+  }
+  fprintf (usimm_out, "%lld switches, %lld CPU cycles relocking (%.2f%% per channel)\n",
+      switches, stats_relock_cycles / NUM_CHANNELS,
+      CYCLE_VAL ? 100.0 * stats_relock_cycles / NUM_CHANNELS / CYCLE_VAL :
+      0.0);
+}
@@ -0,0 +1,84 @@
+#ifndef __DVFS_H__
+#define __DVFS_H__
+
+#include <stdio.h>
+
+#include "memory_controller.h"
+
+// Memory DVFS.
+//
+// The DRAM runs at one of a list of operating points. Point 0 is the
+// DRAM_DEVICE the system was configured with, and
+//
+//   DVFS_DEVICES  <file.vi>:<file.vi>...
+//
+// adds one point per .vi file, each with its own DRAM_CLK_FREQUENCY,
+// no faster than point 0's, its own timings and its own IDD values and
+// VDD. A point's timings are converted to CPU cycles at the base DRAM
+// clock, rounded up to whole DRAM cycles of point 0: the controller
+// still looks at the channels every PROCESSOR_CLK_MULTIPLIER CPU
+// cycles, the slower clock shows in the longer timings (T_DATA_TRANS
+// above all, so in the bandwidth). The timings and currents a .vi file
+// leaves out are point 0's. Refresh timings (T_REFI, T_RFC) are a time,
+// the same at every point: they are skipped in the file and stay those
+// of point 0. Any other parameter in the file is an error.
+//
+// A switch moves all channels at once, at the start of a DRAM cycle:
+// open rows are closed, powered down ranks are woken up, and no command
+// may issue until T_RP after the last pending precharge plus
+//
+//   DVFS_RELOCK  N   // DRAM cycles (tDLLK) to relock the DLL, 512 by default
+//
+// A DVFS policy chooses the point every DVFS_INTERVAL CPU cycles; any
+// other code (a scheduler) can ask for a point with
+// request_dvfs_point (), which takes effect at the next DRAM cycle:
+//
+//   DVFS_POLICY       0   // none: the point only changes on request
+//   DVFS_POLICY       1   // bandwidth: the slowest point that keeps the
+//                         // data-bus utilization under DVFS_TARGET_UTIL %
+//   DVFS_INTERVAL     N   // CPU cycles between decisions, 100000 by default
+//   DVFS_TARGET_UTIL  N   // %, 50 by default
+//
+// The bandwidth policy measures the data-bus utilization of the last
+// interval (the bursts of all channels over the time at the current
+// point) and scales it by each point's T_DATA_TRANS to predict it at
+// that point.
+//
+// Energy is charged with ENERGY_STATS (turned on with DVFS_DEVICES, see
+// energy.h) at the IDD values of the point in use, and the memory
+// system power and EDP of the run come from that energy: the
+// calculate_power () table only knows the last point. The time and
+// energy at each point, the switches and the cycles lost to relocking
+// are printed at the end.
+
+#define NO_DVFS_POLICY 0
+#define BANDWIDTH_DVFS_POLICY 1
+
+// operating point in use
+USIMM_GLOBAL int dvfs_point;
+
+// forget the operating points of the last system, whose memory went
+// with it (see usimm_free_system ())
+void reset_dvfs_points ();
+
+// make the device .vi file 'vi' describes the next operating point; -1
+// if the file is not a valid operating point
+int add_dvfs_point (FILE * vi, const char *device);
+
+// check DVFS_POLICY and start at point 0; -1 if it is unknown or has
+// no DVFS_DEVICES
+int init_dvfs ();
+
+// switch to 'point' at the next DRAM cycle; -1 if there is no such point
+int request_dvfs_point (int point);
+
+// run the policy and make a pending switch; called every DRAM cycle
+// before update_memory ()
+void update_dvfs ();
+
+// operating points, point 0 included
+int get_num_dvfs_points ();
+
+void print_dvfs_stats ();
+
+#endif // __DVFS_H__
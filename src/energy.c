@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "params.h"
+#include "memory_controller.h"
+#include "energy.h"
+
+extern USIMM_STATE long long int CYCLE_VAL;
+
+typedef enum
+{
+  ENERGY_BACKGROUND, ENERGY_ACT, ENERGY_READ, ENERGY_WRITE,
+  ENERGY_READ_TERMINATE, ENERGY_WRITE_TERMINATE, ENERGY_TERM_READ_OTHER,
+  ENERGY_TERM_WRITE_OTHER, ENERGY_REFRESH, NUM_ENERGY_PARTS
+} energy_part_t;
+
+static const char *energy_part_names[NUM_ENERGY_PARTS] = {
+  "bg", "act", "read", "write", "rd_term", "wr_term", "termRoth",
+  "termWoth", "refresh"
+};
+
+typedef struct
+{
+  double pj[NUM_ENERGY_PARTS];
+} energy_t;
+
+static USIMM_STATE energy_t **rank_energy;
+static USIMM_STATE energy_t *thread_energy;
+
+// energy of every rank, [interval][channel * NUM_RANKS + rank]
+static USIMM_STATE double *series;
+static USIMM_STATE long long int intervals;
+
+// ns per CPU cycle
+static USIMM_STATE double cycle_ns;
+
+// mW per chip, as in calculate_power () (the termination power is the
+// ODT_*_MW of memory_controller.h); the IDD values are read when energy
+// is charged, they change with the DVFS operating point
+#define act_mw ((IDD0 - (IDD3N * T_RAS + IDD2N * (T_RC - T_RAS)) / T_RC) * VDD)
+#define read_mw ((IDD4R - IDD3N) * VDD)
+#define write_mw ((IDD4W - IDD3N) * VDD)
+#define ref_mw ((IDD5 - IDD3N) * VDD)
+
+
+  static double
+background_mw (residency_t state)
+{
+  switch (state)
+  {
+    case RESIDENCY_ACTIVE_STANDBY:
+      return IDD3N * VDD;
+    case RESIDENCY_PRECHARGE_POWER_DOWN_SLOW:
+      return IDD2P0 * VDD;
+    case RESIDENCY_PRECHARGE_POWER_DOWN_FAST:
+      return IDD2P1 * VDD;
+    case RESIDENCY_ACTIVE_POWER_DOWN:
+      return IDD3P * VDD;
+    default:
+      return IDD2N * VDD;
+  }
+}
+
+
+  int
+init_energy ()
+{
+  series = NULL;
+  intervals = 0;
+  if (!ENERGY_STATS)
+    return 0;
+  if (ENERGY_INTERVAL < 0)
+  {
+    fprintf (usimm_out, "PANIC: ENERGY_INTERVAL must be >= 0\n");
+    return -1;
+  }
+  rank_energy = alloc_rank_table (sizeof (energy_t));
+  thread_energy = alloc_system_memory (NUMCORES, sizeof (energy_t));
+  cycle_ns = 1000.0 / ((double) DRAM_CLK_FREQUENCY * PROCESSOR_CLK_MULTIPLIER);
+  return 0;
+}
+
+
+// 'pj' picojoules of a rank's chips at cycle 'at'
+  static void
+add (int channel, int rank, int thread, energy_part_t part, long long int at,
+    double pj)
+{
+  pj *= CHIPS_PER_RANK;
+  rank_energy[channel][rank].pj[part] += pj;
+  if (thread >= 0 && thread < NUMCORES)
+    thread_energy[thread].pj[part] += pj;
+  if (!ENERGY_INTERVAL)
+    return;
+  long long int interval = (at < 0 ? 0 : at) / ENERGY_INTERVAL;
+  int ranks = NUM_CHANNELS * NUM_RANKS;
+  if (interval >= intervals)
+  {
+    long long int n = 2 * intervals > interval + 1 ? 2 * intervals
+      : interval + 1;
+    series = realloc_system_memory (series, n * ranks * sizeof (double));
+    memset (series + intervals * ranks, 0,
+        (n - intervals) * ranks * sizeof (double));
+    intervals = n;
+  }
+  series[interval * ranks + channel * NUM_RANKS + rank] += pj;
+}
+
+
+  void
+charge_command_energy (int channel, int rank, int thread, command_t cmd)
+{
+  double burst_ns = T_DATA_TRANS * cycle_ns;
+
+  if (!ENERGY_STATS)
+    return;
+  switch (cmd)
+  {
+    case ACT_CMD:
+      add (channel, rank, thread, ENERGY_ACT, CYCLE_VAL,
+          act_mw * T_RC * cycle_ns);
+      break;
+    case COL_READ_CMD:
+      add (channel, rank, thread, ENERGY_READ, CYCLE_VAL, read_mw * burst_ns);
+      add (channel, rank, thread, ENERGY_READ_TERMINATE, CYCLE_VAL,
+          ODT_DQ_MW * burst_ns);
+      for (int r = 0; r < NUM_RANKS; r++)
+        if (r != rank)
+          add (channel, r, thread, ENERGY_TERM_READ_OTHER, CYCLE_VAL,
+              ODT_TERM_READ_OTHER_MW * burst_ns);
+      break;
+    case COL_WRITE_CMD:
+      add (channel, rank, thread, ENERGY_WRITE, CYCLE_VAL,
+          write_mw * burst_ns);
+      add (channel, rank, thread, ENERGY_WRITE_TERMINATE, CYCLE_VAL,
+          ODT_TERM_WRITE_MW * burst_ns);
+      for (int r = 0; r < NUM_RANKS; r++)
+        if (r != rank)
+          add (channel, r, thread, ENERGY_TERM_WRITE_OTHER, CYCLE_VAL,
+              ODT_TERM_WRITE_OTHER_MW * burst_ns);
+      break;
+    default:
+      break;
+  }
+}
+
+
+  void
+charge_refresh_energy (int channel, int rank, long long int cycles)
+{
+  if (!ENERGY_STATS)
+    return;
+  add (channel, rank, -1, ENERGY_REFRESH, CYCLE_VAL,
+      ref_mw * cycles * cycle_ns);
+}
+
+
+  void
+charge_bank_refresh_energy (int channel, int rank, int refreshes)
+{
+  if (!ENERGY_STATS)
+    return;
+  // calculate_power () charges T_RFC of every T_REFI to a rank, in
+  // which each of its banks does one REFpb
+  add (channel, rank, -1, ENERGY_REFRESH, CYCLE_VAL,
+      ref_mw * T_RFC / NUM_BANKS * refreshes * cycle_ns);
+}
+
+
+  void
+charge_background_energy (int channel, int rank, residency_t state,
+    long long int from, long long int cycles)
+{
+  if (!ENERGY_STATS)
+    return;
+  // split over the intervals of the time series
+  while (cycles > 0)
+  {
+    long long int part = cycles;
+    if (ENERGY_INTERVAL && part > ENERGY_INTERVAL - from % ENERGY_INTERVAL)
+      part = ENERGY_INTERVAL - from % ENERGY_INTERVAL;
+    add (channel, rank, -1, ENERGY_BACKGROUND, from,
+        background_mw (state) * part * cycle_ns);
+    from += part;
+    cycles -= part;
+  }
+}
+
+
+  static double
+total (energy_t * e)
+{
+  double sum = 0;
+
+  for (int p = 0; p < NUM_ENERGY_PARTS; p++)
+    sum += e->pj[p];
+  return sum;
+}
+
+
+  double
+total_energy ()
+{
+  double sum = 0;
+
+  if (!ENERGY_STATS)
+    return 0;
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    for (int r = 0; r < NUM_RANKS; r++)
+      sum += total (&rank_energy[c][r]);
+  return sum;
+}
+
+
+  double
+average_power ()
+{
+  if (!ENERGY_STATS || !CYCLE_VAL)
+    return 0;
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    for (int r = 0; r < NUM_RANKS; r++)
+      settle_residency (c, r);
+  // pJ / ns = mW
+  return total_energy () / (CYCLE_VAL * cycle_ns);
+}
+
+
+  static void
+print_parts (energy_t * e)
+{
+  // uJ
+  for (int p = 0; p < NUM_ENERGY_PARTS; p++)
+    fprintf (usimm_out, " %10.2f", e->pj[p] / 1e6);
+  fprintf (usimm_out, " %10.2f", total (e) / 1e6);
+}
+
+
+  void
+print_energy_stats ()
+{
+  double seconds_ns = CYCLE_VAL * cycle_ns;
+  double system = 0;
+
+  if (!ENERGY_STATS)
+    return;
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    for (int r = 0; r < NUM_RANKS; r++)
+      settle_residency (c, r);
+
+  fprintf (usimm_out, "------------------------------------\n");
+  fprintf (usimm_out, "Energy per command (uJ) and average power (mW)\n");
+  fprintf (usimm_out, "%-16s", "");
+  for (int p = 0; p < NUM_ENERGY_PARTS; p++)
+    fprintf (usimm_out, " %10s", energy_part_names[p]);
+  fprintf (usimm_out, " %10s %10s\n", "total", "mW");
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    for (int r = 0; r < NUM_RANKS; r++)
+    {
+      energy_t *e = &rank_energy[c][r];
+      fprintf (usimm_out, "Channel %d Rank %d", c, r);
+      print_parts (e);
+      // pJ / ns = mW
+      fprintf (usimm_out, " %10.2f\n",
+          seconds_ns ? total (e) / seconds_ns : 0.0);
+      system += total (e);
+    }
+  for (int t = 0; t < NUMCORES; t++)
+  {
+    fprintf (usimm_out, "Core %-11d", t);
+    print_parts (&thread_energy[t]);
+    fprintf (usimm_out, " %10.2f\n",
+        seconds_ns ? total (&thread_energy[t]) / seconds_ns : 0.0);
+  }
+  fprintf (usimm_out, "Memory system energy %.2f uJ, average power %.2f mW\n",
+      system / 1e6, seconds_ns ? system / seconds_ns : 0.0);
+  if (!ENERGY_INTERVAL)
+    return;
+
+  int ranks = NUM_CHANNELS * NUM_RANKS;
+  double interval_ns = ENERGY_INTERVAL * cycle_ns;
+  double peak = 0;
+  long long int peak_cycle = 0;
+  fprintf (usimm_out, "Power time series (mW) every %d CPU cycles\n",
+      ENERGY_INTERVAL);
+  fprintf (usimm_out, "%12s %10s", "cycle", "total");
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    for (int r = 0; r < NUM_RANKS; r++)
+      fprintf (usimm_out, "   c%dr%-3d", c, r);
+  fprintf (usimm_out, "\n");
+  for (long long int i = 0; i * ENERGY_INTERVAL < CYCLE_VAL; i++)
+  {
+    double sum = 0;
+    // the last interval may be cut short
+    long long int cycles = CYCLE_VAL - i * ENERGY_INTERVAL;
+    double ns = cycles < ENERGY_INTERVAL ? cycles * cycle_ns : interval_ns;
+    for (int k = 0; i < intervals && k < ranks; k++)
+      sum += series[i * ranks + k];
+    fprintf (usimm_out, "%12lld %10.2f", i * ENERGY_INTERVAL, sum / ns);
+    for (int k = 0; k < ranks; k++)
+      fprintf (usimm_out, " %8.2f",
+          i < intervals ? series[i * ranks + k] / ns : 0.0);
+    fprintf (usimm_out, "\n");
+    if (sum / ns > peak)
+    {
+      peak = sum / ns;
+      peak_cycle = i * ENERGY_INTERVAL;
+    }
+  }
+  fprintf (usimm_out, "Peak power %.2f mW in the interval from cycle %lld\n",
+      peak, peak_cycle);
+}
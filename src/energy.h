@@ -0,0 +1,66 @@
+#ifndef __ENERGY_H__
+#define __ENERGY_H__
+
+#include "memory_controller.h"
+
+// Per-command energy.
+//
+// calculate_power () derives the power of each rank at the end of a
+// run from averages (the mean gap between activates, the share of time
+// in each power state, a fixed refresh duty cycle). With
+//
+//   ENERGY_STATS  1
+//
+// in the config file, energy is also charged as it is spent, in the
+// manner of DRAMPower, from the same IDD values and VDD of the .vi
+// file and the same termination model:
+//
+// - every ACT: (IDD0 - the standby current over T_RC) over T_RC;
+// - every column command: IDD4R or IDD4W over IDD3N for T_DATA_TRANS,
+//   with the termination power of the rank and of the other ranks of
+//   the channel;
+// - every REF: IDD5 over IDD3N for the cycles it refreshes (the part a
+//   paused REF did not do is given back); a per-bank REF is a share
+//   of the rank's refresh energy per window;
+// - every interval a rank spends in a power state (see
+//   update_residency ()): IDD2N, IDD3N, IDD2P0, IDD2P1 or IDD3P.
+//
+// Energy is kept per rank and per part, and per thread for the
+// commands of its requests (ACT, column commands and their
+// termination); background and refresh energy, and speculative ACTs,
+// belong to no thread. With
+//
+//   ENERGY_INTERVAL  <cycles>
+//
+// the power of every rank in every interval of that many CPU cycles is
+// printed as a time series, with the peak interval.
+
+// -1 if ENERGY_INTERVAL is negative
+int init_energy ();
+
+// an ACT, COL_READ_CMD or COL_WRITE_CMD to a rank, for 'thread' (-1
+// for none)
+void charge_command_energy (int channel, int rank, int thread,
+    command_t cmd);
+
+// 'cycles' of all-bank refresh on a rank, negative for the part of a
+// paused REF that was not done
+void charge_refresh_energy (int channel, int rank, long long int cycles);
+
+// 'refreshes' per-bank REFs to a bank of a rank
+void charge_bank_refresh_energy (int channel, int rank, int refreshes);
+
+// 'cycles' from cycle 'from' in power state 'state' (called by the
+// residency accounting of the controller)
+void charge_background_energy (int channel, int rank, residency_t state,
+    long long int from, long long int cycles);
+
+// pJ charged so far to all ranks
+double total_energy ();
+
+// mW, the energy charged to all ranks over the cycles simulated
+double average_power ();
+
+void print_energy_stats ();
+
+#endif // __ENERGY_H__
@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "utlist.h"
+
+#include "params.h"
+#include "memory_controller.h"
+#include "qos.h"
+#include "interference.h"
+
+extern USIMM_STATE long long int CYCLE_VAL;
+extern USIMM_STATE long long int *time_done;
+
+// interference is charged (INTERFERENCE_STATS or the slowdown QoS policy)
+static USIMM_STATE int enabled;
+
+// last row each thread accessed in each bank
+static USIMM_STATE long long int ****shadow_row;
+
+// reads of each thread waiting in each bank and each channel, and the
+// banks and channels that have any
+static USIMM_STATE int ****waiting_bank_reads;
+static USIMM_STATE int **waiting_channel_reads;
+static USIMM_STATE int *waiting_banks;
+static USIMM_STATE int *waiting_channels;
+
+// threads delayed by the command being observed
+static USIMM_STATE int *delayed;
+
+
+  void
+init_interference ()
+{
+  enabled = INTERFERENCE_STATS || QOS_POLICY == SLOWDOWN_QOS_POLICY;
+  interference_cycles = alloc_system_memory (NUMCORES, sizeof (double));
+  shadow_row = alloc_system_memory (NUMCORES, sizeof (long long int ***));
+  waiting_bank_reads = alloc_system_memory (NUMCORES, sizeof (int ***));
+  waiting_channel_reads = alloc_system_memory (NUMCORES, sizeof (int *));
+  waiting_banks = alloc_system_memory (NUMCORES, sizeof (int));
+  waiting_channels = alloc_system_memory (NUMCORES, sizeof (int));
+  delayed = alloc_system_memory (NUMCORES, sizeof (int));
+  for (int t = 0; t < NUMCORES; t++)
+  {
+    shadow_row[t] = alloc_bank_table (sizeof (long long int));
+    waiting_bank_reads[t] = alloc_bank_table (sizeof (int));
+    waiting_channel_reads[t] = alloc_system_memory (NUM_CHANNELS, sizeof (int));
+    for (int c = 0; c < NUM_CHANNELS; c++)
+      for (int r = 0; r < NUM_RANKS; r++)
+        for (int b = 0; b < NUM_BANKS; b++)
+          shadow_row[t][c][r][b] = -1;
+  }
+}
+
+
+// count a read of the thread in or out of its bank and channel
+  static void
+count_waiting (request_t * request, int delta)
+{
+  int t = request->thread_id;
+  dram_address_t *a = &request->dram_addr;
+  int *bank_reads = &waiting_bank_reads[t][a->channel][a->rank][a->bank];
+  int *channel_reads = &waiting_channel_reads[t][a->channel];
+
+  if (delta > 0 && !(*bank_reads)++)
+    waiting_banks[t]++;
+  if (delta < 0 && !--(*bank_reads))
+    waiting_banks[t]--;
+  if (delta > 0 && !(*channel_reads)++)
+    waiting_channels[t]++;
+  if (delta < 0 && !--(*channel_reads))
+    waiting_channels[t]--;
+}
+
+
+  void
+observe_interference_read (request_t * request)
+{
+  if (enabled)
+    count_waiting (request, 1);
+}
+
+
+// number of banks (channels if !banks) the thread has reads waiting on
+  static int
+parallelism (int thread, int banks)
+{
+  int count = banks ? waiting_banks[thread] : waiting_channels[thread];
+  return count ? count : 1;
+}
+
+
+// delay the reads of other threads waiting on the channel (on the bank
+// if 'bank' >= 0) by 'cycles'
+  static void
+delay_other_reads (request_t * request, int bank, int cycles)
+{
+  request_t *ptr = NULL;
+
+  for (int t = 0; t < NUMCORES; t++)
+    delayed[t] = 0;
+  LL_FOREACH (read_queue_head[request->dram_addr.channel], ptr)
+  {
+    if (ptr->request_served || ptr->thread_id == request->thread_id)
+      continue;
+    if (bank >= 0 && (ptr->dram_addr.rank != request->dram_addr.rank
+          || ptr->dram_addr.bank != bank))
+      continue;
+    ptr->interference += cycles;
+    delayed[ptr->thread_id] = 1;
+  }
+  for (int t = 0; t < NUMCORES; t++)
+    if (delayed[t])
+      interference_cycles[t] += (double) cycles / parallelism (t, bank >= 0);
+}
+
+
+  void
+observe_interference (request_t * request, command_t cmd)
+{
+  int t = request->thread_id;
+  int channel = request->dram_addr.channel;
+  int rank = request->dram_addr.rank;
+  int bank = request->dram_addr.bank;
+
+  if (!enabled)
+    return;
+  switch (cmd)
+  {
+    case ACT_CMD:
+      delay_other_reads (request, bank, T_RCD);
+      break;
+    case PRE_CMD:
+      // the row would still be open in an alone run
+      if (request->operation_type == READ
+          && shadow_row[t][channel][rank][bank] == request->dram_addr.row)
+      {
+        request->interference += T_RP + T_RCD;
+        interference_cycles[t] += (double) (T_RP + T_RCD) / parallelism (t, 1);
+      }
+      delay_other_reads (request, bank, T_RP);
+      break;
+    case COL_READ_CMD:
+    case COL_WRITE_CMD:
+      if (cmd == COL_READ_CMD)
+        count_waiting (request, -1);
+      shadow_row[t][channel][rank][bank] = request->dram_addr.row;
+      delay_other_reads (request, -1, T_DATA_TRANS);
+      break;
+    default:
+      break;
+  }
+}
+
+
+  double
+estimated_slowdown (int thread)
+{
+  long long int time = time_done[thread] ? time_done[thread] : CYCLE_VAL;
+  double alone = time - interference_cycles[thread];
+
+  if (alone < 1)
+    alone = 1;
+  return time / alone;
+}
+
+
+  void
+print_interference_stats ()
+{
+  if (!INTERFERENCE_STATS)
+    return;
+  fprintf (usimm_out, "------------------------------------\n");
+  for (int t = 0; t < NUMCORES; t++)
+  {
+    double alone = time_done[t] - interference_cycles[t];
+    if (alone < 1)
+      alone = 1;
+    fprintf (usimm_out, "Core %d: interference cycles %.0f estimated alone time %.0f estimated slowdown %.3f\n",
+        t, interference_cycles[t], alone, estimated_slowdown (t));
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef __INTERFERENCE_H__
+#define __INTERFERENCE_H__
+
+#include "memory_controller.h"
+
+// Online slowdown estimation.
+//
+// Each read counts the cycles other threads delayed it (its
+// interference), in the manner of STFM (Mutlu and Moscibroda,
+// MICRO 2007), as commands are issued by issue_request_command ():
+//
+// - bank: an ACT or PRE of another thread delays the reads waiting for
+//   the same bank by T_RCD or T_RP;
+// - bus: a column command of another thread delays the reads waiting
+//   on the same channel by T_DATA_TRANS;
+// - row conflict: a read that has to precharge a row another thread
+//   opened, where its own thread's last row in the bank (its row
+//   buffer in an alone run) was the row it wants, is delayed by
+//   T_RP + T_RCD.
+//
+// Every thread delayed by a command is also charged the delay, once
+// for all its waiting reads, divided by the number of banks (channels
+// for the bus) it has reads waiting on, since waits that overlap stall
+// the core only once (STFM's bank waiting parallelism). The waiting
+// reads of each thread are counted per bank and channel as they are
+// queued and served. The alone-run time of a thread is estimated as
+// its execution time less its charged interference, and its slowdown
+// as the ratio of the two.
+//
+//   INTERFERENCE_STATS  1   // estimate, and print the estimates at the end
+//
+// so slowdowns need no separate alone runs. The slowdown-first QoS
+// policy (see qos.h) ranks threads by the same estimate and turns the
+// estimation on by itself.
+
+// interference charged to each thread so far
+USIMM_GLOBAL double *interference_cycles;
+
+void init_interference ();
+
+// count a read accepted by the controller as waiting (called by
+// insert_read)
+void observe_interference_read (request_t * request);
+
+// account for a command issued for a request (called by
+// issue_request_command)
+void observe_interference (request_t * request, command_t cmd);
+
+// estimated slowdown of a thread so far (at the end of the run once
+// it is done)
+double estimated_slowdown (int thread);
+
+void print_interference_stats ();
+
+#endif // __INTERFERENCE_H__
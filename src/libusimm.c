@@ -0,0 +1,338 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "utlist.h"
+
+#include "params.h"
+#include "memory_controller.h"
+#include "address_map.h"
+#include "processor.h"
+#include "usimm.h"
+#include "libusimm.h"
+
+extern USIMM_STATE long long int CYCLE_VAL;
+extern USIMM_STATE struct robstructure *ROB;
+extern USIMM_STATE long long int *time_done;
+
+typedef struct
+{
+  request_t *request;		// NULL once the completion time is known
+  long long int address;
+  long long int arrival;
+  long long int done;		// completion cycle
+  long long int order;		// enqueue order, breaks ties in done
+  int write;
+  usimm_callback_t callback;
+  void *context;
+} pending_t;
+
+struct usimm
+{
+  // pending requests by id, an index into 'pending'; a request in the
+  // controller carries its id in user_ptr
+  pending_t *pending;
+  int max_pending;
+  int *free_ids;
+  int num_free;
+  int num_pending;
+  // ids of the requests whose completion time is known, a heap on done
+  int *heap;
+  int heap_size;
+  // callbacks to run this cycle
+  pending_t *due;
+  int max_due;
+  long long int next_order;
+  usimm_stats_t stats;
+  double read_latency_sum;
+  double write_latency_sum;
+};
+
+// this thread has a memory system (see usimm.h)
+static USIMM_STATE int created;
+
+
+  static int
+completes_before (usimm_t * mem, int a, int b)
+{
+  pending_t *p = &mem->pending[a];
+  pending_t *q = &mem->pending[b];
+  return p->done < q->done || (p->done == q->done && p->order < q->order);
+}
+
+
+  static void
+heap_swap (usimm_t * mem, int i, int j)
+{
+  int id = mem->heap[i];
+  mem->heap[i] = mem->heap[j];
+  mem->heap[j] = id;
+}
+
+
+// the completion time of the pending request is known
+  static void
+heap_push (usimm_t * mem, int id)
+{
+  int i = mem->heap_size++;
+
+  mem->heap[i] = id;
+  while (i > 0 && completes_before (mem, mem->heap[i], mem->heap[(i - 1) / 2]))
+  {
+    heap_swap (mem, i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
+
+
+  static int
+heap_pop (usimm_t * mem)
+{
+  int id = mem->heap[0];
+  int i = 0;
+
+  mem->heap[0] = mem->heap[--mem->heap_size];
+  for (;;)
+  {
+    int first = i;
+    int l = 2 * i + 1;
+    int r = l + 1;
+    if (l < mem->heap_size && completes_before (mem, mem->heap[l], mem->heap[first]))
+      first = l;
+    if (r < mem->heap_size && completes_before (mem, mem->heap[r], mem->heap[first]))
+      first = r;
+    if (first == i)
+      return id;
+    heap_swap (mem, i, first);
+    i = first;
+  }
+}
+
+
+  static void
+add_pending (usimm_t * mem, request_t * request, long long int address,
+    long long int done, int write, usimm_callback_t callback, void *context)
+{
+  if (!mem->num_free)
+  {
+    int max = mem->max_pending ? 2 * mem->max_pending : 256;
+    mem->pending = realloc (mem->pending, max * sizeof (pending_t));
+    mem->free_ids = realloc (mem->free_ids, max * sizeof (int));
+    mem->heap = realloc (mem->heap, max * sizeof (int));
+    for (int id = max - 1; id >= mem->max_pending; id--)
+      mem->free_ids[mem->num_free++] = id;
+    mem->max_pending = max;
+  }
+
+  int id = mem->free_ids[--mem->num_free];
+  pending_t *p = &mem->pending[id];
+
+  mem->num_pending++;
+  p->request = request;
+  p->address = address;
+  p->arrival = CYCLE_VAL;
+  p->done = done;
+  p->order = mem->next_order++;
+  p->write = write;
+  p->callback = callback;
+  p->context = context;
+  if (request)
+  {
+    // the controller frees user_ptr with the request
+    request->user_ptr = malloc (sizeof (int));
+    *(int *) request->user_ptr = id;
+  }
+  else
+    heap_push (mem, id);
+}
+
+
+  usimm_t *
+usimm_create (const char *config_file, int num_cores, FILE * out)
+{
+  if (created || num_cores < 1)
+    return NULL;
+  usimm_out = out ? out : stdout;
+
+  FILE *config = fopen (config_file, "r");
+  if (!config)
+  {
+    fprintf (usimm_out, "Missing system configuration file.  Quitting. \n");
+    return NULL;
+  }
+  NUMCORES = num_cores;
+  // empty ROBs: the modules that look at them see no instructions
+  ROB = alloc_system_memory (NUMCORES, sizeof (struct robstructure));
+  committed = alloc_system_memory (NUMCORES, sizeof (long long int));
+  fetched = alloc_system_memory (NUMCORES, sizeof (long long int));
+  time_done = alloc_system_memory (NUMCORES, sizeof (long long int));
+  if (usimm_init_system (config, config_file))
+  {
+    usimm_free_system ();
+    return NULL;
+  }
+  created = 1;
+  return calloc (1, sizeof (usimm_t));
+}
+
+
+  int
+usimm_enqueue_read (usimm_t * mem, int core, long long int address,
+    long long int pc, usimm_callback_t callback, void *context)
+{
+  int latency = read_matches_write_or_read_queue (address);
+
+  if (latency)
+  {
+    mem->stats.reads_merged++;
+    add_pending (mem, NULL, address, CYCLE_VAL + latency, 0, callback,
+        context);
+  }
+  else
+    add_pending (mem, insert_read (address, CYCLE_VAL, core, -1, pc),
+        address, 0, 0, callback, context);
+  return 1;
+}
+
+
+  int
+usimm_enqueue_write (usimm_t * mem, int core, long long int address,
+    usimm_callback_t callback, void *context)
+{
+  if (write_exists_in_write_queue (address))
+  {
+    mem->stats.writes_merged++;
+    add_pending (mem, NULL, address, CYCLE_VAL, 1, callback, context);
+    return 1;
+  }
+  if (write_queue_length[decode_address (address).channel] >= WQ_CAPACITY)
+    return 0;
+  add_pending (mem, insert_write (address, CYCLE_VAL, core, -1), address, 0,
+      1, callback, context);
+  return 1;
+}
+
+
+// requests issued this DRAM cycle know their completion time now; the
+// controller frees them in the next update_memory ()
+  static void
+collect_served (usimm_t * mem, request_t * head)
+{
+  request_t *ptr = NULL;
+
+  LL_FOREACH (head, ptr)
+  {
+    if (!ptr->request_served || !ptr->user_ptr)
+      continue;
+    int id = *(int *) ptr->user_ptr;
+    free (ptr->user_ptr);
+    ptr->user_ptr = NULL;
+    mem->pending[id].done = ptr->completion_time;
+    mem->pending[id].request = NULL;
+    heap_push (mem, id);
+  }
+}
+
+
+  static void
+run_callbacks (usimm_t * mem)
+{
+  int num_due = 0;
+
+  // move the due requests out first, callbacks may enqueue new ones
+  while (mem->heap_size && mem->pending[mem->heap[0]].done <= CYCLE_VAL)
+  {
+    int id = heap_pop (mem);
+    if (num_due == mem->max_due)
+    {
+      mem->max_due = mem->max_due ? 2 * mem->max_due : 256;
+      mem->due = realloc (mem->due, mem->max_due * sizeof (pending_t));
+    }
+    mem->due[num_due++] = mem->pending[id];
+    mem->free_ids[mem->num_free++] = id;
+    mem->num_pending--;
+  }
+
+  for (int i = 0; i < num_due; i++)
+  {
+    pending_t *p = &mem->due[i];
+    if (p->write)
+    {
+      mem->stats.writes++;
+      mem->write_latency_sum += CYCLE_VAL - p->arrival;
+    }
+    else
+    {
+      mem->stats.reads++;
+      mem->read_latency_sum += CYCLE_VAL - p->arrival;
+    }
+    if (p->callback)
+      p->callback (p->context, p->address, CYCLE_VAL);
+  }
+}
+
+
+  void
+usimm_tick (usimm_t * mem, long long int cycles)
+{
+  for (long long int n = 0; n < cycles; n++)
+  {
+    if (CYCLE_VAL % PROCESSOR_CLK_MULTIPLIER == 0)
+    {
+      usimm_memory_cycle ();
+      for (int c = 0; c < NUM_CHANNELS; c++)
+      {
+        collect_served (mem, read_queue_head[c]);
+        collect_served (mem, write_queue_head[c]);
+      }
+    }
+    run_callbacks (mem);
+    CYCLE_VAL++;
+  }
+}
+
+
+  void
+usimm_stats (usimm_t * mem, usimm_stats_t * stats)
+{
+  *stats = mem->stats;
+  stats->cycles = CYCLE_VAL;
+  stats->pending = mem->num_pending;
+  stats->average_read_latency =
+    stats->reads ? mem->read_latency_sum / stats->reads : 0.0;
+  stats->average_write_latency =
+    stats->writes ? mem->write_latency_sum / stats->writes : 0.0;
+}
+
+
+  void
+usimm_print_stats (usimm_t * mem)
+{
+  usimm_stats_t stats;
+
+  usimm_stats (mem, &stats);
+  // every core ran for the whole simulation
+  for (int c = 0; c < NUMCORES; c++)
+    time_done[c] = CYCLE_VAL;
+  fprintf (usimm_out, "Cycles %lld\n", CYCLE_VAL);
+  fprintf (usimm_out, "Reads completed: %lld (merged %lld), average latency %.2f\n",
+      stats.reads, stats.reads_merged, stats.average_read_latency);
+  fprintf (usimm_out, "Writes completed: %lld (merged %lld), average latency %.2f\n",
+      stats.writes, stats.writes_merged, stats.average_write_latency);
+  fprintf (usimm_out, "Requests pending: %lld\n", stats.pending);
+  usimm_print_memory_stats ();
+}
+
+
+  void
+usimm_destroy (usimm_t * mem)
+{
+  free (mem->pending);
+  free (mem->free_ids);
+  free (mem->heap);
+  free (mem->due);
+  free (mem);
+  usimm_free_system ();
+  ROB = NULL;
+  committed = fetched = time_done = NULL;
+  created = 0;
+}
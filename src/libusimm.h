@@ -0,0 +1,85 @@
+#ifndef __LIBUSIMM_H__
+#define __LIBUSIMM_H__
+
+#include <stdio.h>
+
+// libusimm: the USIMM memory system as a library, for execution-driven
+// simulation.
+//
+// A core simulator creates a memory system from a system configuration
+// file, hands it the reads and writes that miss its caches, and advances
+// it in CPU cycles. A request's callback runs in usimm_tick () at the
+// cycle its data arrives (a read) or is written to the DRAM (a write).
+//
+//   usimm_t *mem = usimm_create ("input/4channel.cfg", 4, NULL);
+//   ...
+//   usimm_enqueue_read (mem, core, address, pc, read_done, context);
+//   usimm_tick (mem, 1);
+//
+// Addresses are physical byte addresses below 2^ADDRESS_BITS, which is
+// raised by ceil_log2 (num_cores) bits over the config's value as for
+// the trace driver. A read of a line that is in the write queue or the
+// read queue is served after WQ_LOOKUP_LATENCY or RQ_LOOKUP_LATENCY, and
+// a write of a line in the write queue merges with it at once.
+// usimm_enqueue_write () refuses writes while the channel's write queue
+// holds WQ_CAPACITY writes; the caller retries after a tick. Reads are
+// always taken.
+//
+// The scheduler is chosen when the library is built:
+//
+//   make lib SCHEDULER=scheduler-close.c
+//
+// gives ../lib/libusimm.a and ../lib/libusimm.so. The simulator state is
+// per thread (see usimm.h): a thread has one memory system at a time and
+// can create another once it destroyed it; other threads can have their
+// own.
+// The core model, LLC and prefetchers are part of the trace driver and
+// are not used here.
+
+typedef struct usimm usimm_t;
+
+// a request completed at CPU cycle 'cycle'
+typedef void (*usimm_callback_t) (void *context, long long int address,
+    long long int cycle);
+
+typedef struct
+{
+  long long int cycles;		// CPU cycles simulated
+  long long int reads;		// reads completed, merged ones included
+  long long int writes;		// writes completed, merged ones included
+  long long int reads_merged;	// reads served by the queues
+  long long int writes_merged;	// writes merged in the write queue
+  long long int pending;	// requests whose callback has not run
+  double average_read_latency;	// CPU cycles from enqueue to callback
+  double average_write_latency;
+} usimm_stats_t;
+
+// read the system configuration and set up a memory system for
+// 'num_cores' cores; what it prints goes to 'out' (NULL for stdout).
+// NULL on errors, or if this thread has a memory system
+usimm_t *usimm_create (const char *config_file, int num_cores, FILE * out);
+
+// free the memory system; the callbacks of its pending requests never
+// run. The thread can create another one
+void usimm_destroy (usimm_t * mem);
+
+// enqueue a read of 'address' by 'core' from load PC 'pc' (0 if
+// unknown); 'callback' may be NULL. Returns 1
+int usimm_enqueue_read (usimm_t * mem, int core, long long int address,
+    long long int pc, usimm_callback_t callback, void *context);
+
+// enqueue a write; 0 if the write queue is full, else 1
+int usimm_enqueue_write (usimm_t * mem, int core, long long int address,
+    usimm_callback_t callback, void *context);
+
+// advance by 'cycles' CPU cycles, running the callbacks of the requests
+// that complete
+void usimm_tick (usimm_t * mem, long long int cycles);
+
+void usimm_stats (usimm_t * mem, usimm_stats_t * stats);
+
+// print the controller, scheduler and power stats, as the trace driver
+// does at the end of a simulation
+void usimm_print_stats (usimm_t * mem);
+
+#endif // __LIBUSIMM_H__
@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "params.h"
+#include "memory_controller.h"
+#include "address_map.h"
+#include "llc.h"
+
+extern USIMM_STATE long long int CYCLE_VAL;
+
+// SRRIP re-reference prediction values
+#define RRPV_MAX 3
+#define RRPV_INSERT 2
+
+typedef struct
+{
+  long long int read_hits;
+  long long int read_misses;
+  long long int write_hits;
+  long long int write_misses;
+  long long int writebacks;
+} llc_stats_t;
+
+static USIMM_STATE long long int num_sets;
+// per line, set after set
+static USIMM_STATE unsigned long long int *tags;
+static USIMM_STATE unsigned char *dirty;
+static USIMM_STATE unsigned char *replacement;	// LRU age or RRPV
+static USIMM_STATE int *owner;		// core that last wrote the line
+static USIMM_STATE unsigned int random_state = 1;
+static USIMM_STATE llc_stats_t *stats;
+
+static const char *replacement_names[] = { "LRU", "random", "SRRIP" };
+
+
+  int
+init_llc ()
+{
+  if (!LLC_SIZE)
+    return 0;
+  if (LLC_REPLACEMENT < LRU_REPLACEMENT
+      || LLC_REPLACEMENT > SRRIP_REPLACEMENT)
+  {
+    fprintf (usimm_out, "PANIC: unknown LLC_REPLACEMENT %d\n", LLC_REPLACEMENT);
+    return -1;
+  }
+  if (LLC_WAYS < 1 || LLC_WAYS > LLC_MAX_WAYS)
+  {
+    fprintf (usimm_out, "PANIC: LLC_WAYS must be 1 to %d\n", LLC_MAX_WAYS);
+    return -1;
+  }
+  num_sets = LLC_SIZE * 1024LL / ((long long int) LLC_WAYS * CACHE_LINE_SIZE);
+  if (num_sets < 1)
+  {
+    fprintf (usimm_out, "PANIC: LLC_SIZE %d KB is less than one set\n", LLC_SIZE);
+    return -1;
+  }
+  tags = alloc_system_memory (num_sets * LLC_WAYS,
+      sizeof (unsigned long long int));
+  dirty = alloc_system_memory (num_sets * LLC_WAYS, sizeof (unsigned char));
+  replacement = alloc_system_memory (num_sets * LLC_WAYS,
+      sizeof (unsigned char));
+  owner = alloc_system_memory (num_sets * LLC_WAYS, sizeof (int));
+  stats = alloc_system_memory (NUMCORES, sizeof (llc_stats_t));
+  random_state = 1;
+  return 0;
+}
+
+
+// way holding the tag in a set, -1 if none
+  static int
+find_way (const unsigned long long int *set_tags, unsigned long long int tag)
+{
+  int way = -1;
+  for (int w = 0; w < LLC_WAYS; w++)
+    way = set_tags[w] == tag ? w : way;
+  return way;
+}
+
+
+// update the replacement state of a way on a hit or a fill
+  static void
+touch (unsigned char *set_repl, int way, int fill)
+{
+  switch (LLC_REPLACEMENT)
+  {
+    case LRU_REPLACEMENT:
+      if (fill)
+        set_repl[way] = LLC_WAYS - 1;
+      for (int w = 0; w < LLC_WAYS; w++)
+        set_repl[w] += set_repl[w] < set_repl[way];
+      set_repl[way] = 0;
+      break;
+    case SRRIP_REPLACEMENT:
+      set_repl[way] = fill ? RRPV_INSERT : 0;
+      break;
+    default:
+      break;
+  }
+}
+
+
+// way a miss in the set fills; with 'fill' the replacement state moves
+// on as the fill needs (the random sequence, SRRIP ageing)
+  static int
+victim_way (const unsigned long long int *set_tags, unsigned char *set_repl,
+    int fill)
+{
+  int way = find_way (set_tags, 0);
+  if (way >= 0)
+    return way;
+
+  switch (LLC_REPLACEMENT)
+  {
+    case LRU_REPLACEMENT:
+      way = 0;
+      for (int w = 1; w < LLC_WAYS; w++)
+        if (set_repl[w] > set_repl[way])
+          way = w;
+      return way;
+    case RANDOM_REPLACEMENT:
+    {
+      unsigned int next = random_state * 1103515245 + 12345;
+      if (fill)
+        random_state = next;
+      return (next >> 16) % LLC_WAYS;
+    }
+    default:
+      // the first way to reach RRPV_MAX as the set ages
+      way = 0;
+      for (int w = 1; w < LLC_WAYS; w++)
+        if (set_repl[w] > set_repl[way])
+          way = w;
+      if (fill)
+      {
+        int age = RRPV_MAX - set_repl[way];
+        for (int w = 0; w < LLC_WAYS; w++)
+          set_repl[w] += age;
+      }
+      return way;
+  }
+}
+
+
+// look up the line, allocating it on a miss; returns the line index and
+// whether it hit
+  static long long int
+access_line (long long int physical_address, int thread_id, int *hit)
+{
+  unsigned long long int line = physical_address / CACHE_LINE_SIZE;
+  long long int set = line % num_sets;
+  unsigned long long int *set_tags = &tags[set * LLC_WAYS];
+  unsigned char *set_repl = &replacement[set * LLC_WAYS];
+  int way = find_way (set_tags, line + 1);
+
+  *hit = way >= 0;
+  if (!*hit)
+  {
+    way = victim_way (set_tags, set_repl, 1);
+    long long int index = set * LLC_WAYS + way;
+    if (set_tags[way] && dirty[index])
+    {
+      long long int victim = (set_tags[way] - 1) * CACHE_LINE_SIZE;
+      if (!write_exists_in_write_queue (victim))
+        insert_write (victim, CYCLE_VAL, owner[index], 0);
+      stats[owner[index]].writebacks++;
+    }
+    set_tags[way] = line + 1;
+    dirty[index] = 0;
+    owner[index] = thread_id;
+  }
+  touch (set_repl, way, !*hit);
+  return set * LLC_WAYS + way;
+}
+
+
+  int
+llc_fill_allowed (long long int physical_address)
+{
+  if (!LLC_SIZE)
+    return 1;
+  unsigned long long int line = physical_address / CACHE_LINE_SIZE;
+  long long int set = line % num_sets;
+  unsigned long long int *set_tags = &tags[set * LLC_WAYS];
+  if (find_way (set_tags, line + 1) >= 0)
+    return 1;
+  int way = victim_way (set_tags, &replacement[set * LLC_WAYS], 0);
+  if (!set_tags[way] || !dirty[set * LLC_WAYS + way])
+    return 1;
+  long long int victim = (set_tags[way] - 1) * CACHE_LINE_SIZE;
+  return write_queue_length[decode_address (victim).channel] < WQ_CAPACITY;
+}
+
+
+  int
+llc_read (long long int physical_address, int thread_id)
+{
+  int hit;
+
+  if (!LLC_SIZE)
+    return 0;
+  access_line (physical_address, thread_id, &hit);
+  if (hit)
+    stats[thread_id].read_hits++;
+  else
+    stats[thread_id].read_misses++;
+  return hit;
+}
+
+
+  int
+llc_write (long long int physical_address, int thread_id)
+{
+  int hit;
+
+  if (!LLC_SIZE)
+    return 0;
+  long long int index = access_line (physical_address, thread_id, &hit);
+  dirty[index] = 1;
+  owner[index] = thread_id;
+  if (hit)
+    stats[thread_id].write_hits++;
+  else
+    stats[thread_id].write_misses++;
+  return 1;
+}
+
+
+  void
+print_llc_stats ()
+{
+  if (!LLC_SIZE)
+    return;
+  fprintf (usimm_out, "------------------------------------\n");
+  fprintf (usimm_out, "LLC: %d KB, %d ways, %lld sets, %s replacement\n", LLC_SIZE,
+      LLC_WAYS, num_sets, replacement_names[LLC_REPLACEMENT]);
+  for (int t = 0; t < NUMCORES; t++)
+  {
+    llc_stats_t *s = &stats[t];
+    long long int reads = s->read_hits + s->read_misses;
+    long long int writes = s->write_hits + s->write_misses;
+    fprintf (usimm_out, "Core %d: read hits %lld of %lld (%.2f%%), write hits %lld of %lld (%.2f%%), write-backs %lld\n",
+        t, s->read_hits, reads, reads ? 100.0 * s->read_hits / reads : 0.0,
+        s->write_hits, writes, writes ? 100.0 * s->write_hits / writes : 0.0,
+        s->writebacks);
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef __LLC_H__
+#define __LLC_H__
+
+// Last-level cache filter.
+//
+// Trace reads and writes normally go straight to the read and write
+// queues, as if the traces were recorded below the last-level cache.
+// With LLC_SIZE set, pre-LLC traces can be replayed instead: every read
+// and write first looks up a set-associative write-back cache shared by
+// all cores, and only misses and dirty evictions reach the controller.
+//
+//   LLC_SIZE         N   // KB, 0 (the default) for no LLC
+//   LLC_WAYS         N   // associativity, 16 by default, at most 64
+//   LLC_LATENCY      N   // hit latency in CPU cycles, 20 by default
+//   LLC_REPLACEMENT  0   // LRU
+//   LLC_REPLACEMENT  1   // random
+//   LLC_REPLACEMENT  2   // SRRIP (Jaleel et al., ISCA 2010)
+//
+// Lines are CACHE_LINE_SIZE bytes. A read hit completes after
+// LLC_LATENCY; a read miss allocates the line and goes to memory. A
+// write allocates the line without fetching it (the trace writes whole
+// lines) and marks it dirty, so writes reach memory only when a dirty
+// line is evicted. The line is filled when the miss is sent, so a later
+// read of it hits even before the data returns, as if merged into the
+// miss. A miss that would evict a dirty line into a full write queue
+// is held (llc_fill_allowed () says so) until the queue drains.
+//
+// The tags of a set are packed together, a line address plus one (0
+// marks an invalid way), and compared without branches so the compiler
+// can vectorize the lookup.
+//
+// Hits, misses and write-backs of each core are printed at the end.
+
+#define LRU_REPLACEMENT 0
+#define RANDOM_REPLACEMENT 1
+#define SRRIP_REPLACEMENT 2
+
+#define LLC_MAX_WAYS 64
+
+// allocate the cache and check its parameters; -1 if they are bad
+int init_llc ();
+
+// 0 if a miss on the line would now evict a dirty line to a channel
+// whose write queue is full, 1 otherwise
+int llc_fill_allowed (long long int physical_address);
+
+// look up a read; 1 on a hit, 0 on a miss (or without an LLC)
+int llc_read (long long int physical_address, int thread_id);
+
+// write a line; 1 if the LLC took it, 0 without an LLC
+int llc_write (long long int physical_address, int thread_id);
+
+void print_llc_stats ();
+
+#endif // __LLC_H__
@@ -0,0 +1,381 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/stat.h>
+
+#include "params.h"
+#include "memory_controller.h"
+#include "address_map.h"
+#include "libusimm.h"
+
+// Loaded-latency curves.
+//
+//   usimm-curve [options] outdir config...
+//
+//   -w percent   writes among the requests, 33 by default
+//   -l percent   row locality: the chance a request goes to the line
+//                after the previous one of its source, 0 by default
+//   -b banks     bank spread: requests go to this many banks, spread
+//                over channels and ranks first, all by default
+//   -c cores     traffic sources, 1 by default
+//   -n requests  requests per load point, 20000 by default
+//   -s rate      load step in requests per 1000 CPU cycles, 5 by default
+//   -m rate      highest load, 1000 by default
+//
+// drives the memory system of each config (through libusimm.h) with
+// open-loop traffic at increasing loads: requests arrive at random
+// (Poisson) times at the offered rate whatever the state of the
+// queues. Each load point runs on a fresh memory system, destroyed
+// before the next one is created. The first tenth of each point's requests warms
+// it up. Read latency is measured from arrival to the data into a
+// histogram; bandwidth is the requests completed per cycle while
+// requests arrive. A point is saturated when it completes less than 95%
+// of the offered load, or its queues hold more than MAX_PENDING
+// requests; the curve stops at the first one. Each config's curve goes
+// to outdir/<config name>.curve, one line per load point.
+// Build with "make curve SCHEDULER=scheduler-*.c".
+
+#define MAX_PENDING 4096
+#define HISTOGRAM_BIN 10		// CPU cycles
+#define HISTOGRAM_BINS 4096		// the last one counts all longer latencies
+#define SATURATION 0.95
+#define CPU_FREQUENCY 3.2e9		// Hz, as for the EDP in main.c
+
+typedef struct
+{
+  const char *config;
+  int write_percent;
+  int locality_percent;
+  int bank_spread;		// 0 for all banks
+  int cores;
+  long long int requests;
+  double rate;			// offered requests per 1000 CPU cycles
+  double max_rate;
+} point_config_t;
+
+typedef struct point point_t;
+
+typedef struct
+{
+  point_t *point;
+  long long int index;
+  long long int arrival;
+  int write;
+} request_record_t;
+
+struct point
+{
+  point_config_t cfg;
+  int status;			// 0 done, else failed
+  int saturated;
+  request_record_t *records;
+  unsigned long long int random_state;
+  long long int *last_line;	// per source, -1 before its first request
+  long long int measure_start;	// arrival of the first measured request
+  long long int measure_end;	// arrival of the last request
+  long long int completed;	// requests completed in the window
+  long long int reads;		// measured reads completed
+  double latency_sum;
+  long long int latency_max;
+  long long int histogram[HISTOGRAM_BINS];
+  double offered;		// requests per 1000 cycles in the window
+  double achieved;
+  double bandwidth;		// GB/s
+  double line_size;
+};
+
+
+  static unsigned long long int
+next_random (point_t * p)
+{
+  // xorshift64*
+  p->random_state ^= p->random_state >> 12;
+  p->random_state ^= p->random_state << 25;
+  p->random_state ^= p->random_state >> 27;
+  return p->random_state * 2685821657736338717ULL;
+}
+
+
+  static double
+uniform (point_t * p)
+{
+  return (next_random (p) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+// banks are numbered channel first, then rank, then bank, so a small
+// spread still uses every channel
+  static int
+in_spread (point_t * p, long long int address)
+{
+  if (!p->cfg.bank_spread)
+    return 1;
+  dram_address_t a = decode_address (address);
+  long long int index =
+    ((long long int) a.bank * NUM_RANKS + a.rank) * NUM_CHANNELS + a.channel;
+  return index < p->cfg.bank_spread;
+}
+
+
+  static long long int
+next_address (point_t * p, int source)
+{
+  long long int lines = (1LL << ADDRESS_BITS) / CACHE_LINE_SIZE;
+  long long int line;
+
+  if (p->last_line[source] >= 0
+      && uniform (p) * 100 < p->cfg.locality_percent)
+  {
+    line = (p->last_line[source] + 1) % lines;
+    if (in_spread (p, line * CACHE_LINE_SIZE))
+    {
+      p->last_line[source] = line;
+      return line * CACHE_LINE_SIZE;
+    }
+  }
+  do
+    line = next_random (p) % lines;
+  while (!in_spread (p, line * CACHE_LINE_SIZE));
+  p->last_line[source] = line;
+  return line * CACHE_LINE_SIZE;
+}
+
+
+  static void
+request_done (void *context, long long int address, long long int cycle)
+{
+  request_record_t *r = context;
+  point_t *p = r->point;
+
+  // measure_start stays -1 until the warm-up requests are injected
+  int measuring = p->measure_start >= 0 && cycle >= p->measure_start;
+
+  if (measuring && cycle <= p->measure_end)
+    p->completed++;
+  if (r->write || !measuring)
+    return;
+  if (r->index < p->cfg.requests / 10)
+    return;
+  long long int latency = cycle - r->arrival;
+  p->reads++;
+  p->latency_sum += latency;
+  if (latency > p->latency_max)
+    p->latency_max = latency;
+  long long int bin = latency / HISTOGRAM_BIN;
+  p->histogram[bin < HISTOGRAM_BINS ? bin : HISTOGRAM_BINS - 1]++;
+}
+
+
+  static double
+percentile (point_t * p, double fraction)
+{
+  long long int target = (long long int) ceil (fraction * p->reads);
+  long long int seen = 0;
+
+  for (int b = 0; b < HISTOGRAM_BINS; b++)
+  {
+    seen += p->histogram[b];
+    if (seen >= target && seen)
+      return (b + 1) * HISTOGRAM_BIN;
+  }
+  return p->latency_max;
+}
+
+
+  static void
+run_point (point_t * p)
+{
+  FILE *discard = fopen ("/dev/null", "w");
+  usimm_t *mem = usimm_create (p->cfg.config, p->cfg.cores, discard);
+  usimm_stats_t stats;
+
+  p->status = -1;
+  if (!mem)
+  {
+    fclose (discard);
+    return;
+  }
+  p->line_size = CACHE_LINE_SIZE;
+  p->records = calloc (p->cfg.requests, sizeof (request_record_t));
+  p->last_line = malloc (p->cfg.cores * sizeof (long long int));
+  for (int c = 0; c < p->cfg.cores; c++)
+    p->last_line[c] = -1;
+  p->random_state = 0x9e3779b97f4a7c15ULL;
+  p->measure_start = p->measure_end = -1;
+
+  long long int warmup = p->cfg.requests / 10;
+  double mean_gap = 1000.0 / p->cfg.rate;
+  double next_arrival = 0;
+  long long int cycle = 0;
+  long long int injected = 0;
+
+  while (injected < p->cfg.requests)
+  {
+    while (injected < p->cfg.requests && next_arrival <= cycle)
+    {
+      request_record_t *r = &p->records[injected];
+      int source = injected % p->cfg.cores;
+      long long int address = next_address (p, source);
+      r->point = p;
+      r->index = injected;
+      r->arrival = cycle;
+      r->write = uniform (p) * 100 < p->cfg.write_percent;
+      if (injected == warmup)
+        p->measure_start = cycle;
+      if (r->write)
+      {
+        // a full write queue holds the generator back, which shows as
+        // saturation
+        if (!usimm_enqueue_write (mem, source, address, request_done, r))
+          break;
+      }
+      else
+        usimm_enqueue_read (mem, source, address, 0, request_done, r);
+      injected++;
+      next_arrival += -log (1.0 - uniform (p)) * mean_gap;
+    }
+    p->measure_end = cycle;
+    usimm_tick (mem, 1);
+    cycle++;
+    usimm_stats (mem, &stats);
+    if (stats.pending > MAX_PENDING)
+    {
+      p->saturated = 1;
+      break;
+    }
+  }
+
+  long long int window = p->measure_end - p->measure_start + 1;
+  p->offered = 1000.0 * (injected - warmup) / window;
+  p->achieved = 1000.0 * p->completed / window;
+  p->bandwidth = p->achieved / 1000 * p->line_size * CPU_FREQUENCY / 1e9;
+  if (p->achieved < SATURATION * p->offered)
+    p->saturated = 1;
+  // let the measured reads finish, unless the queues are backed up
+  for (long long int n = 0; !p->saturated && n < 1000000; n += 1000)
+  {
+    usimm_stats (mem, &stats);
+    if (!stats.pending)
+      break;
+    usimm_tick (mem, 1000);
+  }
+  usimm_destroy (mem);
+  fclose (discard);
+  p->status = 0;
+}
+
+
+  static int
+run_curve (point_config_t * cfg, const char *output)
+{
+  FILE *out = fopen (output, "w");
+
+  if (!out)
+  {
+    printf ("Cannot write %s\n", output);
+    return -1;
+  }
+  fprintf (out, "# %s: writes %d%%, locality %d%%, %d banks, %d sources, %lld requests per point\n",
+      cfg->config, cfg->write_percent, cfg->locality_percent,
+      cfg->bank_spread, cfg->cores, cfg->requests);
+  fprintf (out, "# %8s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+      "offered", "achieved", "GB/s", "avg_lat", "p50", "p90", "p99",
+      "max_lat", "saturated");
+
+  for (double rate = cfg->rate;; rate += cfg->rate)
+  {
+    point_t *p = calloc (1, sizeof (point_t));
+
+    p->cfg = *cfg;
+    p->cfg.rate = rate;
+    run_point (p);
+    if (p->status)
+    {
+      printf ("%s: cannot set up the memory system\n", cfg->config);
+      fclose (out);
+      return -1;
+    }
+    fprintf (out, "%10.3f %10.3f %10.3f %10.1f %10.0f %10.0f %10.0f %10lld %10d\n",
+        p->offered, p->achieved, p->bandwidth,
+        p->reads ? p->latency_sum / p->reads : 0.0, percentile (p, 0.5),
+        percentile (p, 0.9), percentile (p, 0.99), p->latency_max,
+        p->saturated);
+    fflush (out);
+    int last = p->saturated || rate + cfg->rate > cfg->max_rate;
+    free (p->records);
+    free (p->last_line);
+    free (p);
+    if (last)
+      break;
+  }
+  fclose (out);
+  return 0;
+}
+
+
+  int
+main (int argc, char *argv[])
+{
+  point_config_t cfg = { NULL, 33, 0, 0, 1, 20000, 5, 1000 };
+  int opt;
+  int failed = 0;
+
+  while ((opt = getopt (argc, argv, "w:l:b:c:n:s:m:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'w':
+        cfg.write_percent = atoi (optarg);
+        break;
+      case 'l':
+        cfg.locality_percent = atoi (optarg);
+        break;
+      case 'b':
+        cfg.bank_spread = atoi (optarg);
+        break;
+      case 'c':
+        cfg.cores = atoi (optarg);
+        break;
+      case 'n':
+        cfg.requests = atoll (optarg);
+        break;
+      case 's':
+        cfg.rate = atof (optarg);
+        break;
+      case 'm':
+        cfg.max_rate = atof (optarg);
+        break;
+      default:
+        optind = argc;
+        break;
+    }
+  }
+  if (optind + 2 > argc || cfg.cores < 1 || cfg.requests < 10
+      || cfg.rate <= 0)
+  {
+    printf ("usage: %s [-w write%%] [-l locality%%] [-b banks] [-c cores] [-n requests] [-s rate step] [-m max rate] outdir config...\n",
+        argv[0]);
+    return -3;
+  }
+  const char *outdir = argv[optind];
+  mkdir (outdir, 0777);
+
+  for (int i = optind + 1; i < argc; i++)
+  {
+    const char *slash = strrchr (argv[i], '/');
+    const char *name = slash ? slash + 1 : argv[i];
+    char *output = malloc (strlen (outdir) + strlen (name) + 8);
+
+    sprintf (output, "%s/%s.curve", outdir, name);
+    cfg.config = argv[i];
+    if (run_curve (&cfg, output))
+      failed = 1;
+    else
+      printf ("%s\n", output);
+    free (output);
+  }
+  return failed;
+}
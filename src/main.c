@@ -1,11 +1,30 @@
+#define _POSIX_C_SOURCE 200809L	// strtok_r
 #include<stdio.h>
 #include<stdlib.h>
 #include<string.h>
 #include<assert.h>
 
+// the simulator variables are defined here (see usimm.h)
+#define USIMM_DEFINE_GLOBALS
+#include "usimm.h"
 #include "processor.h"
 #include "configfile.h"
 #include "memory_controller.h"
+#include "refresh_policy.h"
+#include "row_predictor.h"
+#include "page_policy.h"
+#include "power_policy.h"
+#include "write_drain.h"
+#include "qos.h"
+#include "interference.h"
+#include "core_model.h"
+#include "llc.h"
+#include "prefetch.h"
+#include "open_loop.h"
+#include "stall.h"
+#include "data_bus.h"
+#include "energy.h"
+#include "dvfs.h"
 #include "scheduler.h"
 #include "params.h"
 
@@ -13,9 +32,9 @@
 long long int BIGNUM = 1000000;
 
 
-int expt_done = 0;
+USIMM_STATE int expt_done = 0;
 
-long long int CYCLE_VAL = 0;
+USIMM_STATE long long int CYCLE_VAL = 0;
 
   long long int
 get_current_cycle ()
@@ -23,29 +42,471 @@ get_current_cycle ()
   return CYCLE_VAL;
 }
 
-struct robstructure *ROB;
+USIMM_STATE struct robstructure *ROB;
 
-FILE **tif;			/* The handles to the trace input files. */
-FILE *config_file;
-FILE *vi_file;
+USIMM_STATE FILE **tif;			/* The handles to the trace input files. */
+USIMM_STATE FILE *config_file;
+USIMM_STATE FILE *vi_file;
 
-int *prefixtable;
+
+/* The DRAM parts of the supplied configs, used when the config file
+   does not name a DRAM_DEVICE. Channel/core counts outside this table
+   get the smallest part whose ranks hold 2^ADDRESS_BITS bytes per
+   core. */
+static const struct
+{
+  int channels;
+  int min_cores;
+  int max_cores;
+  const char *device;
+  int chips_per_rank;
+  long long int rank_gbits;
+} default_devices[] =
+{
+  { 1, 1, 1, "1Gb_x4.vi", 16, 16 },
+  { 1, 2, 2, "2Gb_x4.vi", 16, 32 },
+  { 1, 3, 4, "4Gb_x4.vi", 16, 64 },
+  { 4, 1, 1, "1Gb_x16.vi", 4, 4 },
+  { 4, 2, 2, "1Gb_x8.vi", 8, 8 },
+  { 4, 3, 4, "2Gb_x8.vi", 8, 16 },
+  { 4, 5, 8, "4Gb_x8.vi", 8, 32 },
+  { 4, 9, 16, "4Gb_x4.vi", 16, 64 },
+};
+#define NUM_DEFAULT_DEVICES ((int) (sizeof (default_devices) / sizeof (default_devices[0])))
+
+  static int
+default_dram_device ()
+{
+  long long int total_gbits = ((1LL << ADDRESS_BITS) >> 27) * NUMCORES;
+  long long int ranks = (long long int) NUM_CHANNELS * NUM_RANKS;
+  int best = -1;
+  int fit = -1;
+
+  for (int d = 0; d < NUM_DEFAULT_DEVICES; d++)
+  {
+    if (default_devices[d].channels == NUM_CHANNELS
+        && NUMCORES >= default_devices[d].min_cores
+        && NUMCORES <= default_devices[d].max_cores)
+    {
+      best = d;
+      break;
+    }
+  }
+  for (int d = 0; best < 0 && d < NUM_DEFAULT_DEVICES; d++)
+  {
+    if (default_devices[d].rank_gbits * ranks < total_gbits)
+      continue;
+    if (fit < 0
+        || default_devices[d].rank_gbits < default_devices[fit].rank_gbits
+        || (default_devices[d].rank_gbits == default_devices[fit].rank_gbits
+          && default_devices[d].chips_per_rank <
+          default_devices[fit].chips_per_rank))
+      fit = d;
+  }
+  if (best < 0)
+    best = fit;
+  if (best < 0)
+  {
+    fprintf (usimm_out, "PANIC:: Channel - Core configuration not supported, set DRAM_DEVICE\n");
+    return -1;
+  }
+  strcpy (DRAM_DEVICE, default_devices[best].device);
+  if (CHIPS_PER_RANK <= 0)
+    CHIPS_PER_RANK = default_devices[best].chips_per_rank;
+  return 0;
+}
+
+
+/* Open a device (DRAM_DEVICE, or a DVFS operating point) as given,
+   else look for it in each directory of DRAM_DEVICE_PATH and then next
+   to the config file. */
+  static FILE *
+open_dram_device (const char *device, const char *config_file_name)
+{
+  char path[1536];
+  char dirs[sizeof (DRAM_DEVICE_PATH) + 1];
+  FILE *fp;
+
+  if (device[0] == '/')
+    return fopen (device, "r");
+
+  strcpy (dirs, DRAM_DEVICE_PATH[0] ? DRAM_DEVICE_PATH : "input");
+  for (char *save, *dir = strtok_r (dirs, ":", &save); dir;
+      dir = strtok_r (NULL, ":", &save))
+  {
+    snprintf (path, sizeof (path), "%s/%s", dir, device);
+    if ((fp = fopen (path, "r")))
+      return fp;
+  }
+
+  const char *slash = strrchr (config_file_name, '/');
+  int dir_length = slash ? (int) (slash - config_file_name) : 1;
+  snprintf (path, sizeof (path), "%.*s/%s", dir_length,
+      slash ? config_file_name : ".", device);
+  return fopen (path, "r");
+}
+
+USIMM_STATE int *prefixtable;
 // Moved the following to memory_controller.h so that they are visible
 // from the scheduler.
 //long long int *committed;
 //long long int *fetched;
-long long int *time_done;
-long long int total_time_done;
-float core_power = 0;
-
+USIMM_STATE long long int *time_done;
+USIMM_STATE long long int total_time_done;
+USIMM_STATE float core_power = 0;
+/* trace addresses are prefixed with their core above this bit */
+static USIMM_STATE int core_prefix_shift;
+
+/* a system was initialized on this thread and not freed yet */
+static USIMM_STATE int system_initialized;
+
+/* Read the system configuration and the DRAM device it names, fill in
+   the defaults and initialize the controller, its modules and the
+   scheduler.  NUMCORES and ROB must be set. */
   int
-main (int argc, char *argv[])
+usimm_init_system (FILE * config, const char *config_file_name)
+{
+  int pow_of_2_cores;
+
+  if (system_initialized)
+  {
+    fprintf (usimm_out, "PANIC: the last memory system of this thread was not freed\n");
+    return -5;
+  }
+  system_initialized = 1;
+
+  /* Start from the state of a thread that has not simulated yet. */
+  reset_params ();
+  reset_address_map ();
+  reset_dvfs_points ();
+  expt_done = 0;
+  CYCLE_VAL = 0;
+
+  CORE_POWER = -1;
+  MISC_POWER = -1;
+  WRITE_HI_WM = -1;
+  WRITE_LO_WM = -1;
+  SPECULATIVE_PRECHARGE = 1;
+  int bad_config = read_config_file (config);
+  fclose (config);
+  if (bad_config)
+    return -5;
+
+
+  /* Find the appropriate .vi file to read */
+  if (!DRAM_DEVICE[0] && default_dram_device ())
+    return -5;
+  if (CHIPS_PER_RANK <= 0)
+  {
+    char *width = strstr (DRAM_DEVICE, "_x");
+    if (!width || atoi (width + 2) <= 0)
+    {
+      fprintf (usimm_out, "PANIC: cannot tell the width of DRAM_DEVICE %s, set CHIPS_PER_RANK\n",
+          DRAM_DEVICE);
+      return -5;
+    }
+    CHIPS_PER_RANK = 64 / atoi (width + 2);
+  }
+  vi_file = open_dram_device (DRAM_DEVICE, config_file_name);
+  fprintf (usimm_out, "Reading vi file: %s\t\n%d Chips per Rank\n", DRAM_DEVICE,
+      CHIPS_PER_RANK);
+  if (!vi_file)
+  {
+    fprintf (usimm_out, "Missing DRAM chip parameter file.  Quitting. \n");
+    return -5;
+  }
+
+
+
+  if (!((NUM_CHANNELS & (NUM_CHANNELS - 1)) || (NUM_RANKS & (NUM_RANKS - 1))
+        || (NUM_BANKS & (NUM_BANKS - 1)) || (NUM_ROWS & (NUM_ROWS - 1))
+        || (NUM_COLUMNS & (NUM_COLUMNS - 1))))
+  {
+    assert ((log_base2 (NUM_CHANNELS) + log_base2 (NUM_RANKS) +
+          log_base2 (NUM_BANKS) + log_base2 (NUM_ROWS) +
+          log_base2 (NUM_COLUMNS) + log_base2 (CACHE_LINE_SIZE)) ==
+        ADDRESS_BITS);
+  }
+  else
+  {
+    /* Not a power of two: addresses are decoded by division (see
+       address_map.h), the geometry only has to cover the address
+       space. */
+    double capacity = (double) NUM_CHANNELS * NUM_RANKS * NUM_BANKS *
+      NUM_ROWS * NUM_COLUMNS * CACHE_LINE_SIZE;
+    if (capacity < (double) (1LL << ADDRESS_BITS))
+    {
+      fprintf (usimm_out, "PANIC: %d channels x %d ranks x %d banks x %d rows x %d columns x %d bytes do not cover %d address bits\n",
+          NUM_CHANNELS, NUM_RANKS, NUM_BANKS, NUM_ROWS, NUM_COLUMNS,
+          CACHE_LINE_SIZE, ADDRESS_BITS);
+      fclose (vi_file);
+      return -5;
+    }
+  }
+  /* Increase the address space and rows per bank depending on the number of input traces. */
+  core_prefix_shift = ADDRESS_BITS;
+  ADDRESS_BITS = ADDRESS_BITS + ceil_log2 (NUMCORES);
+  if (NUMCORES == 1)
+  {
+    pow_of_2_cores = 1;
+  }
+  else
+  {
+    pow_of_2_cores = 1 << ((int) log_base2 (NUMCORES - 1) + 1);
+  }
+  NUM_ROWS = NUM_ROWS * pow_of_2_cores;
+
+  bad_config = read_config_file (vi_file);
+  fclose (vi_file);
+  if (bad_config)
+    return -5;
+  /* The rest of the system is 10 W per channel, and the cores grow
+     from 5 W by 5/3 W per extra channel: 5/10 W for the supplied
+     1-channel config, 10/40 W for the 4-channel one. */
+  if (CORE_POWER < 0)
+    CORE_POWER = 5 + 5 * (NUM_CHANNELS - 1) / 3.0;
+  if (MISC_POWER < 0)
+    MISC_POWER = 10 * NUM_CHANNELS;
+  /* Without bank groups all banks form one group, timed by the plain
+     T_CCD, T_RRD and T_WTR. */
+  if (NUM_BANK_GROUPS <= 0)
+    NUM_BANK_GROUPS = 1;
+  if (NUM_BANKS % NUM_BANK_GROUPS)
+  {
+    fprintf (usimm_out, "PANIC: %d banks cannot be split into %d bank groups\n",
+        NUM_BANKS, NUM_BANK_GROUPS);
+    return -5;
+  }
+  T_CCD_S = T_CCD_S ? T_CCD_S : T_CCD;
+  T_CCD_L = T_CCD_L ? T_CCD_L : T_CCD;
+  T_RRD_S = T_RRD_S ? T_RRD_S : T_RRD;
+  T_RRD_L = T_RRD_L ? T_RRD_L : T_RRD;
+  T_WTR_S = T_WTR_S ? T_WTR_S : T_WTR;
+  T_WTR_L = T_WTR_L ? T_WTR_L : T_WTR;
+  /* Refresh modes, see params.h. */
+  if (REFRESH_GRANULARITY == 0)
+    REFRESH_GRANULARITY = 1;
+  if (REFRESH_GRANULARITY != 1 && REFRESH_GRANULARITY != 2
+      && REFRESH_GRANULARITY != 4)
+  {
+    fprintf (usimm_out, "PANIC: REFRESH_GRANULARITY must be 1, 2 or 4\n");
+    return -5;
+  }
+  if (REFRESH_MODE != ALL_BANK_REFRESH && REFRESH_MODE != PER_BANK_REFRESH)
+  {
+    fprintf (usimm_out, "PANIC: REFRESH_MODE must be 0 (all-bank) or 1 (per-bank)\n");
+    return -5;
+  }
+  if (REFRESH_MODE == PER_BANK_REFRESH && REFRESH_GRANULARITY != 1)
+  {
+    fprintf (usimm_out, "PANIC: fine granularity refresh applies to all-bank refresh only\n");
+    return -5;
+  }
+  if (REFRESH_PAUSE_SEGMENTS < 0)
+    REFRESH_PAUSE_SEGMENTS = 0;
+  /* in whole DRAM cycles, refresh deadlines are checked once per DRAM
+     cycle */
+  T_RFC2 = T_RFC2 ? T_RFC2 :
+    T_RFC / PROCESSOR_CLK_MULTIPLIER * 3 / 4 * PROCESSOR_CLK_MULTIPLIER;
+  T_RFC4 = T_RFC4 ? T_RFC4 :
+    T_RFC / PROCESSOR_CLK_MULTIPLIER / 2 * PROCESSOR_CLK_MULTIPLIER;
+  T_RFCPB = T_RFCPB ? T_RFCPB :
+    T_RFC / PROCESSOR_CLK_MULTIPLIER / 2 * PROCESSOR_CLK_MULTIPLIER;
+  if (PAGE_TIMEOUT <= 0)
+    PAGE_TIMEOUT = T_RC;
+  if (PAGE_HIT_CAP <= 0)
+    PAGE_HIT_CAP = 4;
+  /* DVFS operating points, after the timings of point 0 are complete. */
+  if (DVFS_DEVICES[0])
+  {
+    char devices[sizeof (DVFS_DEVICES)];
+    strcpy (devices, DVFS_DEVICES);
+    for (char *save, *device = strtok_r (devices, ":", &save); device;
+        device = strtok_r (NULL, ":", &save))
+    {
+      FILE *fp = open_dram_device (device, config_file_name);
+      if (!fp)
+      {
+        fprintf (usimm_out, "Missing DVFS device %s.  Quitting. \n", device);
+        return -5;
+      }
+      bad_config = add_dvfs_point (fp, device);
+      fclose (fp);
+      if (bad_config)
+        return -5;
+    }
+    ENERGY_STATS = 1;
+  }
+  if (DVFS_INTERVAL <= 0)
+    DVFS_INTERVAL = 100000;
+  if (DVFS_TARGET_UTIL <= 0)
+    DVFS_TARGET_UTIL = 50;
+  if (DVFS_RELOCK <= 0)
+    DVFS_RELOCK = 512 * PROCESSOR_CLK_MULTIPLIER;
+  if (WRITE_HI_WM < 0)
+    WRITE_HI_WM = 40;
+  if (WRITE_LO_WM < 0)
+    WRITE_LO_WM = 20;
+  if (LLC_WAYS <= 0)
+    LLC_WAYS = 16;
+  if (LLC_LATENCY <= 0)
+    LLC_LATENCY = 20;
+  if (PREFETCH_DEGREE <= 0)
+    PREFETCH_DEGREE = 2;
+  if (PREFETCH_BUFFER <= 0)
+    PREFETCH_BUFFER = 64;
+  if (WRITE_LO_WM > WRITE_HI_WM || WRITE_HI_WM >= WQ_CAPACITY)
+  {
+    fprintf (usimm_out, "PANIC: write watermarks need WRITE_LO_WM <= WRITE_HI_WM < WQ_CAPACITY\n");
+    return -5;
+  }
+  if (init_address_map ())
+    return -5;
+  print_params ();
+
+  for (int i = 0; i < NUMCORES; i++)
+  {
+    ROB[i].comptime = alloc_system_memory (ROBSIZE, sizeof (long long int));
+    ROB[i].mem_address =
+      alloc_system_memory (ROBSIZE, sizeof (long long int));
+    ROB[i].instrpc = alloc_system_memory (ROBSIZE, sizeof (long long int));
+    ROB[i].optype = alloc_system_memory (ROBSIZE, sizeof (int));
+  }
+  if (init_memory_controller_vars () || init_refresh_policy ()
+      || init_row_predictor () || init_page_policy ()
+      || init_power_policy () || init_write_drain () || init_qos ())
+    return -5;
+  init_interference ();
+  if (init_core_model () || init_llc () || init_prefetch ()
+      || init_open_loop ())
+    return -5;
+  init_stall ();
+  if (init_data_bus () || init_energy () || init_dvfs ())
+    return -5;
+  init_scheduler_vars ();
+  return 0;
+}
+
+
+/* Free the requests still queued and the memory of the system, which
+   may have failed to initialize. */
+  void
+usimm_free_system ()
+{
+  for (int c = 0; read_queue_head && c < NUM_CHANNELS; c++)
+  {
+    request_t *queues[2] = { read_queue_head[c], write_queue_head[c] };
+    for (int q = 0; q < 2; q++)
+      while (queues[q])
+      {
+        request_t *next = queues[q]->next;
+        free (queues[q]->user_ptr);
+        free (queues[q]);
+        queues[q] = next;
+      }
+  }
+  free_system_memory ();
+  read_queue_head = write_queue_head = NULL;
+  system_initialized = 0;
+}
+
+
+/* One DRAM cycle of the memory system. */
+  void
+usimm_memory_cycle ()
+{
+  /* Switch the DRAM operating point if the DVFS policy says so. */
+  update_dvfs ();
+
+  /* Execute function to find ready instructions. */
+  update_memory ();
+  update_qos ();
+  update_prefetch ();
+
+  /* Execute user-provided function to select ready instructions for issue. */
+  /* Based on this selection, update DRAM data structures and set 
+     instruction completion times. */
+  for (int c = 0; c < NUM_CHANNELS; c++)
+  {
+    update_refresh_state (c);
+    schedule (c);
+    refresh_policy (c);
+    speculate (c);
+    page_policy (c);
+    write_drain (c);
+    power_policy (c);
+    account_stalls (c);
+    account_data_bus (c);
+  }
+}
+
+
+/* Print the stats of the controller, its modules and the scheduler, and
+   the DRAM power; returns the memory system power in mW. */
+  float
+usimm_print_memory_stats ()
 {
+  /* Print all other memory system stats. */
+  scheduler_stats ();
+  print_stats ();
+  print_refresh_policy_stats ();
+  print_row_predictor_stats ();
+  print_page_policy_stats ();
+  print_power_policy_stats ();
+  print_write_drain_stats ();
+  print_qos_stats ();
+  print_llc_stats ();
+  print_prefetch_stats ();
+  print_open_loop_stats ();
+  print_core_model_stats ();
+  print_interference_stats ();
+  print_stall_stats ();
+  print_data_bus_stats ();
+  print_energy_stats ();
+  print_dvfs_stats ();
+
+  /*Print Cycle Stats */
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    for (int r = 0; r < NUM_RANKS; r++)
+      calculate_power (c, r, 0, CHIPS_PER_RANK);
+
+  fprintf
+    (usimm_out, "\n#-------------------------------------- Power Stats ----------------------------------------------\n");
+  fprintf
+    (usimm_out, "Note:  1. termRoth/termWoth is the power dissipated in the ODT resistors when Read/Writes terminate \n");
+  fprintf (usimm_out, "          in other ranks on the same channel\n");
+  fprintf
+    (usimm_out, "#-------------------------------------------------------------------------------------------------\n\n");
+
+
+  /*Print Power Stats */
+  float total_system_power = 0;
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    for (int r = 0; r < NUM_RANKS; r++)
+      total_system_power += calculate_power (c, r, 1, CHIPS_PER_RANK);
+
+  fprintf
+    (usimm_out, "\n#-------------------------------------------------------------------------------------------------\n");
+  /* calculate_power () only knows the DVFS point in use at the end; the
+     energy charged at each point gives the power of the whole run. */
+  if (get_num_dvfs_points () > 1)
+  {
+    fprintf (usimm_out, "Power above at DVFS point %d only, total from the energy at every point\n",
+        dvfs_point);
+    total_system_power = average_power ();
+  }
+  fprintf (usimm_out, "Total memory system power = %f W\n", total_system_power / 1000);
+  return total_system_power;
+}
 
-  printf ("---------------------------------------------\n");
-  printf ("-- USIMM: the Utah SImulated Memory Module --\n");
-  printf ("--              Version: 1.3               --\n");
-  printf ("---------------------------------------------\n");
+
+  static int
+run_simulation (usimm_sim_t * sim)
+{
+  fprintf (usimm_out, "---------------------------------------------\n");
+  fprintf (usimm_out, "-- USIMM: the Utah SImulated Memory Module --\n");
+  fprintf (usimm_out, "--              Version: 1.3               --\n");
+  fprintf (usimm_out, "---------------------------------------------\n");
 
   int numc = 0;
   int num_ret = 0;
@@ -57,52 +518,50 @@ main (int argc, char *argv[])
   int currMTapp;
   long long int maxtd;
   int maxcr;
-  int pow_of_2_cores;
   char newstr[MAXTRACELINESIZE];
   int *nonmemops;
   char *opertype;
   long long int *addr;
   long long int *instrpc;
-  int chips_per_rank = -1;
 
   /* Initialization code. */
-  printf ("Initializing.\n");
+  fprintf (usimm_out, "Initializing.\n");
 
-  if (argc < 3)
+  if (!sim->config_file || sim->num_traces < 1)
   {
-    printf
-      ("Need at least one input configuration file and one trace file as argument.  Quitting.\n");
+    fprintf
+      (usimm_out, "Need at least one input configuration file and one trace file as argument.  Quitting.\n");
     return -3;
   }
 
-  config_file = fopen (argv[1], "r");
+  config_file = fopen (sim->config_file, "r");
   if (!config_file)
   {
-    printf ("Missing system configuration file.  Quitting. \n");
+    fprintf (usimm_out, "Missing system configuration file.  Quitting. \n");
     return -4;
   }
 
-  NUMCORES = argc - 2;
+  NUMCORES = sim->num_traces;
 
 
-  ROB =
-    (struct robstructure *) malloc (sizeof (struct robstructure) * NUMCORES);
-  tif = (FILE **) malloc (sizeof (FILE *) * NUMCORES);
-  committed = (long long int *) malloc (sizeof (long long int) * NUMCORES);
-  fetched = (long long int *) malloc (sizeof (long long int) * NUMCORES);
-  time_done = (long long int *) malloc (sizeof (long long int) * NUMCORES);
-  nonmemops = (int *) malloc (sizeof (int) * NUMCORES);
-  opertype = (char *) malloc (sizeof (char) * NUMCORES);
-  addr = (long long int *) malloc (sizeof (long long int) * NUMCORES);
-  instrpc = (long long int *) malloc (sizeof (long long int) * NUMCORES);
-  prefixtable = (int *) malloc (sizeof (int) * NUMCORES);
+  ROB = alloc_system_memory (NUMCORES, sizeof (struct robstructure));
+  tif = alloc_system_memory (NUMCORES, sizeof (FILE *));
+  committed = alloc_system_memory (NUMCORES, sizeof (long long int));
+  fetched = alloc_system_memory (NUMCORES, sizeof (long long int));
+  time_done = alloc_system_memory (NUMCORES, sizeof (long long int));
+  nonmemops = alloc_system_memory (NUMCORES, sizeof (int));
+  opertype = alloc_system_memory (NUMCORES, sizeof (char));
+  addr = alloc_system_memory (NUMCORES, sizeof (long long int));
+  instrpc = alloc_system_memory (NUMCORES, sizeof (long long int));
+  prefixtable = alloc_system_memory (NUMCORES, sizeof (int));
   currMTapp = -1;
   for (numc = 0; numc < NUMCORES; numc++)
   {
-    tif[numc] = fopen (argv[numc + 2], "r");
+    const char *trace_name = sim->trace_names[numc];
+    tif[numc] = sim->traces ? sim->traces[numc] : fopen (trace_name, "r");
     if (!tif[numc])
     {
-      printf ("Missing input trace file %d.  Quitting. \n", numc);
+      fprintf (usimm_out, "Missing input trace file %d.  Quitting. \n", numc);
       return -5;
     }
 
@@ -117,21 +576,21 @@ main (int argc, char *argv[])
     prefixtable[numc] = numc;
 
     /* Find the start of the filename.  It's after the last "/". */
-    for (fnstart = strlen (argv[numc + 2]); fnstart >= 0; fnstart--)
+    for (fnstart = strlen (trace_name); fnstart >= 0; fnstart--)
     {
-      if (argv[numc + 2][fnstart] == '/')
+      if (trace_name[fnstart] == '/')
       {
         break;
       }
     }
     fnstart++;		/* fnstart is either the letter after the last / or the 0th letter. */
 
-    if ((strlen (argv[numc + 2]) - fnstart) > 2)
+    if ((strlen (trace_name) - fnstart) > 2)
     {
-      if ((argv[numc + 2][fnstart + 0] == 'M')
-          && (argv[numc + 2][fnstart + 1] == 'T'))
+      if ((trace_name[fnstart + 0] == 'M')
+          && (trace_name[fnstart + 1] == 'T'))
       {
-        if (argv[numc + 2][fnstart + 2] == '0')
+        if (trace_name[fnstart + 2] == '0')
         {
           currMTapp = numc;
         }
@@ -139,9 +598,9 @@ main (int argc, char *argv[])
         {
           if (currMTapp < 0)
           {
-            printf
-              ("Poor set of input parameters.  Input file %s starts with \"MT\", but there is no preceding input file starting with \"MT0\".  Quitting.\n",
-               argv[numc + 2]);
+            fprintf
+              (usimm_out, "Poor set of input parameters.  Input file %s starts with \"MT\", but there is no preceding input file starting with \"MT0\".  Quitting.\n",
+               trace_name);
             return -6;
           }
           else
@@ -149,9 +608,9 @@ main (int argc, char *argv[])
         }
       }
     }
-    printf
-      ("Core %d: Input trace file %s : Addresses will have prefix %d\n",
-       numc, argv[numc + 2], prefixtable[numc]);
+    fprintf
+      (usimm_out, "Core %d: Input trace file %s : Addresses will have prefix %d\n",
+       numc, trace_name, prefixtable[numc]);
 
     committed[numc] = 0;
     fetched[numc] = 0;
@@ -162,115 +621,17 @@ main (int argc, char *argv[])
     ROB[numc].tracedone = 0;
   }
 
-  read_config_file (config_file);
-
-
-  /* Find the appropriate .vi file to read */
-  if (NUM_CHANNELS == 1 && NUMCORES == 1)
-  {
-    vi_file = fopen ("input/1Gb_x4.vi", "r");
-    chips_per_rank = 16;
-    printf ("Reading vi file: 1Gb_x4.vi\t\n%d Chips per Rank\n",
-        chips_per_rank);
-  }
-  else if (NUM_CHANNELS == 1 && NUMCORES == 2)
-  {
-    vi_file = fopen ("input/2Gb_x4.vi", "r");
-    chips_per_rank = 16;
-    printf ("Reading vi file: 2Gb_x4.vi\t\n%d Chips per Rank\n",
-        chips_per_rank);
-  }
-  else if (NUM_CHANNELS == 1 && (NUMCORES > 2) && (NUMCORES <= 4))
-  {
-    vi_file = fopen ("input/4Gb_x4.vi", "r");
-    chips_per_rank = 16;
-    printf ("Reading vi file: 4Gb_x4.vi\t\n%d Chips per Rank\n",
-        chips_per_rank);
-  }
-  else if (NUM_CHANNELS == 4 && NUMCORES == 1)
-  {
-    vi_file = fopen ("input/1Gb_x16.vi", "r");
-    chips_per_rank = 4;
-    printf ("Reading vi file: 1Gb_x16.vi\t\n%d Chips per Rank\n",
-        chips_per_rank);
-  }
-  else if (NUM_CHANNELS == 4 && NUMCORES == 2)
-  {
-    vi_file = fopen ("input/1Gb_x8.vi", "r");
-    chips_per_rank = 8;
-    printf ("Reading vi file: 1Gb_x8.vi\t\n%d Chips per Rank\n",
-        chips_per_rank);
-  }
-  else if (NUM_CHANNELS == 4 && (NUMCORES > 2) && (NUMCORES <= 4))
-  {
-    vi_file = fopen ("input/2Gb_x8.vi", "r");
-    chips_per_rank = 8;
-    printf ("Reading vi file: 2Gb_x8.vi\t\n%d Chips per Rank\n",
-        chips_per_rank);
-  }
-  else if (NUM_CHANNELS == 4 && (NUMCORES > 4) && (NUMCORES <= 8))
-  {
-    vi_file = fopen ("input/4Gb_x8.vi", "r");
-    chips_per_rank = 8;
-    printf ("Reading vi file: 4Gb_x8.vi\t\n%d Chips per Rank\n",
-        chips_per_rank);
-  }
-  else if (NUM_CHANNELS == 4 && (NUMCORES > 8) && (NUMCORES <= 16))
-  {
-    vi_file = fopen ("input/4Gb_x4.vi", "r");
-    chips_per_rank = 16;
-    printf ("Reading vi file: 4Gb_x4.vi\t\n%d Chips per Rank\n",
-        chips_per_rank);
-  }
-  else
-  {
-    printf ("PANIC:: Channel - Core configuration not supported\n");
-    assert (-1);
-  }
-
-  if (!vi_file)
-  {
-    printf ("Missing DRAM chip parameter file.  Quitting. \n");
-    return -5;
-  }
-
-
-
-  assert ((log_base2 (NUM_CHANNELS) + log_base2 (NUM_RANKS) +
-        log_base2 (NUM_BANKS) + log_base2 (NUM_ROWS) +
-        log_base2 (NUM_COLUMNS) + log_base2 (CACHE_LINE_SIZE)) ==
-      ADDRESS_BITS);
-  /* Increase the address space and rows per bank depending on the number of input traces. */
-  ADDRESS_BITS = ADDRESS_BITS + log_base2 (NUMCORES);
-  if (NUMCORES == 1)
-  {
-    pow_of_2_cores = 1;
-  }
-  else
-  {
-    pow_of_2_cores = 1 << ((int) log_base2 (NUMCORES - 1) + 1);
-  }
-  NUM_ROWS = NUM_ROWS * pow_of_2_cores;
-
-  read_config_file (vi_file);
-  print_params ();
-
-  for (int i = 0; i < NUMCORES; i++)
-  {
-    ROB[i].comptime =
-      (long long int *) malloc (sizeof (long long int) * ROBSIZE);
-    ROB[i].mem_address =
-      (long long int *) malloc (sizeof (long long int) * ROBSIZE);
-    ROB[i].instrpc =
-      (long long int *) malloc (sizeof (long long int) * ROBSIZE);
-    ROB[i].optype = (int *) malloc (sizeof (int) * ROBSIZE);
-  }
-  init_memory_controller_vars ();
-  init_scheduler_vars ();
+  /* usimm_init_system () closes the config file */
+  FILE *config = config_file;
+  config_file = NULL;
+  int status = usimm_init_system (config, sim->config_file);
+  if (status)
+    return status;
   /* Done initializing. */
 
-  /* Must start by reading one line of each trace file. */
-  for (numc = 0; numc < NUMCORES; numc++)
+  /* Must start by reading one line of each trace file (timestamped
+     traces are read as they are injected, see open_loop.h). */
+  for (numc = 0; TRACE_FORMAT == USIMM_TRACE && numc < NUMCORES; numc++)
   {
     if (fgets (newstr, MAXTRACELINESIZE, tif[numc]))
     {
@@ -282,7 +643,7 @@ main (int argc, char *argv[])
               (newstr, "%d %c %Lx %Lx", &nonmemops[numc],
                &opertype[numc], &addr[numc], &instrpc[numc]) < 1)
           {
-            printf ("Panic.  Poor trace format.\n");
+            fprintf (usimm_out, "Panic.  Poor trace format.\n");
             return -4;
           }
         }
@@ -294,20 +655,20 @@ main (int argc, char *argv[])
                 (newstr, "%d %c %Lx", &nonmemops[numc],
                  &opertype[numc], &addr[numc]) < 1)
             {
-              printf ("Panic.  Poor trace format.\n");
+              fprintf (usimm_out, "Panic.  Poor trace format.\n");
               return -3;
             }
           }
           else
           {
-            printf ("Panic.  Poor trace format.\n");
+            fprintf (usimm_out, "Panic.  Poor trace format.\n");
             return -2;
           }
         }
       }
       else
       {
-        printf ("Panic.  Poor trace format.\n");
+        fprintf (usimm_out, "Panic.  Poor trace format.\n");
         return -1;
       }
     }
@@ -324,7 +685,7 @@ main (int argc, char *argv[])
   }
 
 
-  printf ("Starting simulation.\n");
+  fprintf (usimm_out, "Starting simulation.\n");
   while (!expt_done)
   {
 
@@ -351,17 +712,7 @@ main (int argc, char *argv[])
 
     if (CYCLE_VAL % PROCESSOR_CLK_MULTIPLIER == 0)
     {
-      /* Execute function to find ready instructions. */
-      update_memory ();
-
-      /* Execute user-provided function to select ready instructions for issue. */
-      /* Based on this selection, update DRAM data structures and set 
-         instruction completion times. */
-      for (int c = 0; c < NUM_CHANNELS; c++)
-      {
-        schedule (c);
-        gather_stats (c);
-      }
+      usimm_memory_cycle ();
     }
 
     /* For each core, bring in new instructions from the trace file to
@@ -370,7 +721,7 @@ main (int argc, char *argv[])
     writeqfull = 0;
     for (int c = 0; c < NUM_CHANNELS; c++)
     {
-      if (write_queue_length[c] == WQ_CAPACITY)
+      if (write_queue_length[c] >= WQ_CAPACITY)
       {
         writeqfull = 1;
         break;
@@ -379,6 +730,24 @@ main (int argc, char *argv[])
 
     for (numc = 0; numc < NUMCORES; numc++)
     {
+      if (TRACE_FORMAT == TIMESTAMPED_TRACE)
+      {
+        int status = inject_open_loop (numc, tif[numc],
+            (long long int) prefixtable[numc] << core_prefix_shift);
+        if (status < 0)
+        {
+          fprintf (usimm_out, "Panic.  Poor trace format.\n");
+          return -1;
+        }
+        if (status)
+        {
+          num_done++;
+          if (!time_done[numc])
+            time_done[numc] = CYCLE_VAL;
+        }
+        continue;
+      }
+      update_core_model (numc);
       if (!ROB[numc].tracedone)
       {			/* Try to fetch if EOF has not been encountered. */
         num_fetch = 0;
@@ -402,36 +771,30 @@ main (int argc, char *argv[])
           }
           else
           {		/* Done consuming non-memory-ops.  Must now consume the memory rd or wr. */
+            /* A write whose LLC fill would evict a dirty line into a
+               full write queue waits for the queue to drain. */
+            if (opertype[numc] == 'W'
+                && !llc_fill_allowed (addr[numc] +
+                  ((long long int) prefixtable[numc] << core_prefix_shift)))
+              break;
             if (opertype[numc] == 'R')
             {
-              addr[numc] = addr[numc] + (long long int) ((long long int) prefixtable[numc] << (ADDRESS_BITS - log_base2 (NUMCORES)));	// Add MSB bits so each trace accesses a different address space.
+              addr[numc] = addr[numc] + (long long int) ((long long int) prefixtable[numc] << core_prefix_shift);	// Add MSB bits so each trace accesses a different address space.
               ROB[numc].mem_address[ROB[numc].tail] = addr[numc];
               ROB[numc].optype[ROB[numc].tail] = opertype[numc];
               ROB[numc].comptime[ROB[numc].tail] =
                 CYCLE_VAL + BIGNUM;
               ROB[numc].instrpc[ROB[numc].tail] = instrpc[numc];
 
-              // Check to see if the read is for buffered data in write queue - 
-              // return constant latency if match in WQ
-              // add in read queue otherwise
-              int lat =
-                read_matches_write_or_read_queue (addr[numc]);
-              if (lat)
-              {
-                ROB[numc].comptime[ROB[numc].tail] =
-                  CYCLE_VAL + lat + PIPELINEDEPTH;
-              }
-              else
-              {
-                insert_read (addr[numc], CYCLE_VAL, numc,
-                    ROB[numc].tail, instrpc[numc]);
-              }
+              // Served from the write or read queue, added to the read
+              // queue, or held back by the core model (see core_model.h)
+              fetch_read (numc, ROB[numc].tail);
             }
             else
             {	/* This must be a 'W'.  We are confirming that while reading the trace. */
               if (opertype[numc] == 'W')
               {
-                addr[numc] = addr[numc] + (long long int) ((long long int) prefixtable[numc] << (ADDRESS_BITS - log_base2 (NUMCORES)));	// Add MSB bits so each trace accesses a different address space.
+                addr[numc] = addr[numc] + (long long int) ((long long int) prefixtable[numc] << core_prefix_shift);	// Add MSB bits so each trace accesses a different address space.
                 ROB[numc].mem_address[ROB[numc].tail] =
                   addr[numc];
                 ROB[numc].optype[ROB[numc].tail] =
@@ -440,13 +803,15 @@ main (int argc, char *argv[])
                   CYCLE_VAL + PIPELINEDEPTH;
                 /* Also, add this to the write queue. */
 
-                if (!write_exists_in_write_queue (addr[numc]))
+                // a write the LLC takes reaches memory when evicted
+                if (!llc_write (addr[numc], numc)
+                    && !write_exists_in_write_queue (addr[numc]))
                   insert_write (addr[numc], CYCLE_VAL, numc,
                       ROB[numc].tail);
 
                 for (int c = 0; c < NUM_CHANNELS; c++)
                 {
-                  if (write_queue_length[c] == WQ_CAPACITY)
+                  if (write_queue_length[c] >= WQ_CAPACITY)
                   {
                     writeqfull = 1;
                     break;
@@ -455,7 +820,7 @@ main (int argc, char *argv[])
               }
               else
               {
-                printf ("Panic.  Poor trace format. \n");
+                fprintf (usimm_out, "Panic.  Poor trace format. \n");
                 return -1;
               }
             }
@@ -478,7 +843,7 @@ main (int argc, char *argv[])
                        &nonmemops[numc], &opertype[numc],
                        &addr[numc], &instrpc[numc]) < 1)
                   {
-                    printf ("Panic.  Poor trace format.\n");
+                    fprintf (usimm_out, "Panic.  Poor trace format.\n");
                     return -4;
                   }
                 }
@@ -491,21 +856,21 @@ main (int argc, char *argv[])
                          &nonmemops[numc], &opertype[numc],
                          &addr[numc]) < 1)
                     {
-                      printf
-                        ("Panic.  Poor trace format.\n");
+                      fprintf
+                        (usimm_out, "Panic.  Poor trace format.\n");
                       return -3;
                     }
                   }
                   else
                   {
-                    printf ("Panic.  Poor trace format.\n");
+                    fprintf (usimm_out, "Panic.  Poor trace format.\n");
                     return -2;
                   }
                 }
               }
               else
               {
-                printf ("Panic.  Poor trace format.\n");
+                fprintf (usimm_out, "Panic.  Poor trace format.\n");
                 return -1;
               }
             }
@@ -544,15 +909,18 @@ main (int argc, char *argv[])
       {
         if (write_queue_length[numch])
           break;
+        /* Open-loop reads have no ROB entry to wait for. */
+        if (TRACE_FORMAT == TIMESTAMPED_TRACE && read_queue_length[numch])
+          break;
       }
       if (numch == NUM_CHANNELS)
         expt_done = 1;	/* All traces have been consumed and the write queues are drained. */
     }
 
     /* Printing details for testing.  Remove later. */
-    //printf("Cycle: %lld\n", CYCLE_VAL);
+    //fprintf(usimm_out, "Cycle: %lld\n", CYCLE_VAL);
     //for (numc=0; numc < NUMCORES; numc++) {
-    // printf("C%d: Inf %d : Hd %d : Tl %d : Comp %lld : type %c : addr %x : TD %d\n", numc, ROB[numc].inflight, ROB[numc].head, ROB[numc].tail, ROB[numc].comptime[ROB[numc].head], ROB[numc].optype[ROB[numc].head], ROB[numc].mem_address[ROB[numc].head], ROB[numc].tracedone);
+    // fprintf(usimm_out, "C%d: Inf %d : Hd %d : Tl %d : Comp %lld : type %c : addr %x : TD %d\n", numc, ROB[numc].inflight, ROB[numc].head, ROB[numc].tail, ROB[numc].comptime[ROB[numc].head], ROB[numc].optype[ROB[numc].head], ROB[numc].mem_address[ROB[numc].head], ROB[numc].tracedone);
     //}
 
     CYCLE_VAL++;		/* Advance the simulation cycle. */
@@ -576,88 +944,79 @@ main (int argc, char *argv[])
   core_power = 0;
   for (numc = 0; numc < NUMCORES; numc++)
   {
-    /* A core has peak power of 10 W in a 4-channel config.  Peak power is consumed while the thread is running, else the core is perfectly power gated. */
+    /* A core consumes CORE_POWER while its thread is running, else it is perfectly power gated. */
     core_power =
-      core_power + (10 * ((float) time_done[numc] / (float) CYCLE_VAL));
-  }
-  if (NUM_CHANNELS == 1)
-  {
-    /* The core is more energy-efficient in our single-channel configuration. */
-    core_power = core_power / 2.0;
+      core_power + (CORE_POWER * ((float) time_done[numc] / (float) CYCLE_VAL));
   }
 
 
 
-  printf ("Done with loop. Printing stats.\n");
-  printf ("Cycles %lld\n", CYCLE_VAL);
+  fprintf (usimm_out, "Done with loop. Printing stats.\n");
+  fprintf (usimm_out, "Cycles %lld\n", CYCLE_VAL);
   total_time_done = 0;
   for (numc = 0; numc < NUMCORES; numc++)
   {
-    printf
-      ("Done: Core %d: Fetched %lld : Committed %lld : At time : %lld\n",
+    fprintf
+      (usimm_out, "Done: Core %d: Fetched %lld : Committed %lld : At time : %lld\n",
        numc, fetched[numc], committed[numc], time_done[numc]);
     total_time_done += time_done[numc];
   }
-  printf ("Sum of execution times for all programs: %lld\n", total_time_done);
-  printf ("Num reads merged: %lld\n", num_read_merge);
-  printf ("Num writes merged: %lld\n", num_write_merge);
-  /* Print all other memory system stats. */
-  scheduler_stats ();
-  print_stats ();
+  fprintf (usimm_out, "Sum of execution times for all programs: %lld\n", total_time_done);
+  fprintf (usimm_out, "Num reads merged: %lld\n", num_read_merge);
+  fprintf (usimm_out, "Num writes merged: %lld\n", num_write_merge);
+  float total_system_power = usimm_print_memory_stats ();
+
+  sim->cycles = CYCLE_VAL;
+  sim->total_time_done = total_time_done;
+  sim->memory_power = total_system_power / 1000;
+  sim->system_power = MISC_POWER + core_power + total_system_power / 1000;
+  sim->edp =
+    (MISC_POWER + core_power +
+     total_system_power / 1000) * (float) ((double) CYCLE_VAL /
+       (double) 3200000000) *
+    (float) ((double) CYCLE_VAL / (double) 3200000000);
+
+  fprintf (usimm_out, "Miscellaneous system power = %g W  # Processor uncore power, disk, I/O, cooling, etc.\n",
+      MISC_POWER);
+  fprintf (usimm_out, "Processor core power = %f W  # Assuming that each core consumes %g W when running\n",
+      core_power, CORE_POWER);
+  fprintf (usimm_out, "Total system power = %f W # Sum of the previous three lines\n",
+      sim->system_power);
+  fprintf (usimm_out, "Energy Delay product (EDP) = %2.9f J.s\n", sim->edp);
+  return 0;
+}
 
-  /*Print Cycle Stats */
-  for (int c = 0; c < NUM_CHANNELS; c++)
-    for (int r = 0; r < NUM_RANKS; r++)
-      calculate_power (c, r, 0, chips_per_rank);
 
-  printf
-    ("\n#-------------------------------------- Power Stats ----------------------------------------------\n");
-  printf
-    ("Note:  1. termRoth/termWoth is the power dissipated in the ODT resistors when Read/Writes terminate \n");
-  printf ("          in other ranks on the same channel\n");
-  printf
-    ("#-------------------------------------------------------------------------------------------------\n\n");
+  int
+usimm_sim_run (usimm_sim_t * sim)
+{
+  usimm_out = sim->out ? sim->out : stdout;
+  config_file = NULL;
+  tif = NULL;
+
+  int status = run_simulation (sim);
+
+  /* Close what run_simulation () opened, also when it failed, and free
+     the system for the next simulation on this thread. */
+  if (config_file)
+    fclose (config_file);
+  for (int numc = 0; !sim->traces && tif && numc < NUMCORES; numc++)
+    if (tif[numc])
+      fclose (tif[numc]);
+  usimm_free_system ();
+  return status;
+}
 
 
-  /*Print Power Stats */
-  float total_system_power = 0;
-  for (int c = 0; c < NUM_CHANNELS; c++)
-    for (int r = 0; r < NUM_RANKS; r++)
-      total_system_power += calculate_power (c, r, 1, chips_per_rank);
-
-  printf
-    ("\n#-------------------------------------------------------------------------------------------------\n");
-  if (NUM_CHANNELS == 4)
-  {				/* Assuming that this is 4channel.cfg  */
-    printf ("Total memory system power = %f W\n",
-        total_system_power / 1000);
-    printf
-      ("Miscellaneous system power = 40 W  # Processor uncore power, disk, I/O, cooling, etc.\n");
-    printf
-      ("Processor core power = %f W  # Assuming that each core consumes 10 W when running\n",
-       core_power);
-    printf ("Total system power = %f W # Sum of the previous three lines\n",
-        40 + core_power + total_system_power / 1000);
-    printf ("Energy Delay product (EDP) = %2.9f J.s\n",
-        (40 + core_power +
-         total_system_power / 1000) * (float) ((double) CYCLE_VAL /
-           (double) 3200000000) *
-        (float) ((double) CYCLE_VAL / (double) 3200000000));
-  }
-  else
-  {				/* Assuming that this is 1channel.cfg  */
-    printf ("Total memory system power = %f W\n",
-        total_system_power / 1000);
-    printf ("Miscellaneous system power = 10 W  # Processor uncore power, disk, I/O, cooling, etc.\n");	/* The total 40 W misc power will be split across 4 channels, only 1 of which is being considered in the 1-channel experiment. */
-    printf ("Processor core power = %f W  # Assuming that each core consumes 5 W\n", core_power);	/* Assuming that the cores are more lightweight. */
-    printf ("Total system power = %f W # Sum of the previous three lines\n",
-        10 + core_power + total_system_power / 1000);
-    printf ("Energy Delay product (EDP) = %2.9f J.s\n",
-        (10 + core_power +
-         total_system_power / 1000) * (float) ((double) CYCLE_VAL /
-           (double) 3200000000) *
-        (float) ((double) CYCLE_VAL / (double) 3200000000));
-  }
+#ifndef USIMM_NO_MAIN
+  int
+main (int argc, char *argv[])
+{
+  usimm_sim_t sim = { 0 };
 
-  return 0;
+  sim.config_file = argc > 1 ? argv[1] : NULL;
+  sim.num_traces = argc - 2;
+  sim.trace_names = (const char **) (argv + 2);
+  return usimm_sim_run (&sim);
 }
+#endif
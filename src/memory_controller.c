@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "utlist.h"
@@ -8,96 +9,456 @@
 
 #include "params.h"
 #include "memory_controller.h"
+#include "page_policy.h"
+#include "qos.h"
+#include "interference.h"
+#include "refresh_policy.h"
+#include "data_bus.h"
+#include "energy.h"
+#include "prefetch.h"
+#include "address_map.h"
+#include "row_predictor.h"
 #include "scheduler.h"
 #include "processor.h"
 
 // ROB Structure, used to release stall on instructions 
 // when the read request completes
-extern struct robstructure *ROB;
+extern USIMM_STATE struct robstructure *ROB;
 
 // Current Processor Cycle
-extern long long int CYCLE_VAL;
+extern USIMM_STATE long long int CYCLE_VAL;
 
 #define max(a,b) (((a)>(b))?(a):(b))
 
-#define BIG_ACTIVATION_WINDOW 1000000
+// tFAW allows at most 4 activates in a window, so the last 4 activates
+// of a rank are all that is needed to check it
+#define FAW_ACTIVATES 4
 
-// moving window that captures each activate issued in the past 
-int activation_record[MAX_NUM_CHANNELS][MAX_NUM_RANKS][BIG_ACTIVATION_WINDOW];
+// cycle given to empty activation record slots
+#define NO_ACTIVATE (-(1LL << 62))
+
+// per rank ring of the cycles of the last FAW_ACTIVATES activates
+USIMM_STATE long long int (**activation_record)[FAW_ACTIVATES];
+USIMM_STATE int **activation_record_head;
+
+// REF (or REFpb) commands owed per 8*T_REFI window and their duration
+static USIMM_STATE int refreshes_per_window;
+static USIMM_STATE int refresh_cycle_time;
+
+// the power state of each rank and the cycle it was entered
+static USIMM_STATE int **residency_state;
+static USIMM_STATE long long int **residency_since;
+
+// end of the last DRAM cycle simulated
+static USIMM_STATE long long int residency_end;
+
+// the cycle break-up heading was printed, before the first rank's power
+static USIMM_STATE int print_total_cycles;
+
+// refresh issue deadline that applies to a bank
+  static long long int
+refresh_deadline (int channel, int rank, int bank) 
+{
+  if (REFRESH_MODE == PER_BANK_REFRESH)
+    return bank_refresh_issue_deadline[channel][rank][bank];
+  return refresh_issue_deadline[channel][rank];
+}
+
+
+// 1 if the bank is in OR too close to its forced refresh period for a
+// command that keeps it busy for 'delay' cycles
+  static int
+refresh_blocks (int channel, int rank, int bank, int delay) 
+{
+  if (REFRESH_MODE == PER_BANK_REFRESH
+      && bank_forced_refresh_mode_on[channel][rank][bank])
+    return 1;
+  return forced_refresh_mode_on[channel][rank]
+    || ((CYCLE_VAL + delay) > refresh_deadline (channel, rank, bank));
+}
+
+
+  int
+get_refresh_cycle_time () 
+{
+  return refresh_cycle_time;
+}
 
 // record an activate in the activation record
   void
 record_activate (int channel, int rank, long long int cycle) 
 {
-  assert (activation_record[channel][rank][(cycle % BIG_ACTIVATION_WINDOW)] == 0);	//can't have two commands issued the same cycle - hence no two activations in the same cycle
-  activation_record[channel][rank][(cycle % BIG_ACTIVATION_WINDOW)] = 1;
+  int head = activation_record_head[channel][rank];
+  int last = (head + FAW_ACTIVATES - 1) % FAW_ACTIVATES;
+  assert (activation_record[channel][rank][last] != cycle);	//can't have two commands issued the same cycle - hence no two activations in the same cycle
+  activation_record[channel][rank][head] = cycle;
+  activation_record_head[channel][rank] = (head + 1) % FAW_ACTIVATES;
   return;
 }
 
 
 // Have there been 3 or less activates in the last T_FAW period 
   int
-is_T_FAW_met (int channel, int rank, int cycle) 
+is_T_FAW_met (int channel, int rank, long long int cycle) 
 {
-  int start = cycle;
   int number_of_activates = 0;
-  if (start >= T_FAW)
-
+  for (int i = 0; i < FAW_ACTIVATES; i++)
   {
-    for (int i = 1; i <= T_FAW; i++)
-
-    {
-      if (activation_record[channel][rank]
-          [(start - i) % BIG_ACTIVATION_WINDOW] == 1)
-        number_of_activates++;
-    }
+    long long int act = activation_record[channel][rank][i];
+    if (act >= cycle - T_FAW && act < cycle)
+      number_of_activates++;
   }
+  if (number_of_activates < 4)
+    return 1;
 
   else
+    return 0;
+}
 
-  {
-    for (int i = 1; i <= start; i++)
 
-    {
-      if (activation_record[channel][rank][start - i] %
-          BIG_ACTIVATION_WINDOW == 1)
-        number_of_activates++;
-    }
+// Carve 'bytes' out of a channel arena. With a NULL base nothing is
+// assigned and only the size is accumulated.
+  static void *
+carve (char *base, size_t * used, size_t bytes) 
+{
+  void *p = base ? base + *used : NULL;
+  *used += (bytes + 7) & ~(size_t) 7;
+  return p;
+}
+
+#define ALLOC_CHANNELS(table) \
+  ((table) = alloc_system_memory (NUM_CHANNELS, sizeof (*(table))))
+
+#define CARVE_RANKS(table) \
+  ((table)[channel] = carve (base, &used, NUM_RANKS * sizeof (**(table))))
+
+// the banks of all ranks of a channel are one block
+#define CARVE_BANKS(table) \
+  do \
+  { \
+    char *block; \
+    (table)[channel] = carve (base, &used, NUM_RANKS * sizeof (**(table))); \
+    block = carve (base, &used, \
+        NUM_RANKS * NUM_BANKS * sizeof (***(table))); \
+    for (int r = 0; base && r < NUM_RANKS; r++) \
+      (table)[channel][r] = \
+        (void *) (block + r * NUM_BANKS * sizeof (***(table))); \
+  } while (0)
+
+// Lay out the rank and bank state of one channel, state that is
+// touched every cycle first. Returns the size of the arena.
+  static size_t
+carve_channel_arena (int channel, char *base) 
+{
+  size_t used = 0;
+  CARVE_BANKS (dram_state);
+  CARVE_BANKS (cas_issued_current_cycle);
+  CARVE_BANKS (cmd_precharge_issuable);
+  CARVE_RANKS (cmd_all_bank_precharge_issuable);
+  CARVE_RANKS (cmd_powerdown_fast_issuable);
+  CARVE_RANKS (cmd_powerdown_slow_issuable);
+  CARVE_RANKS (cmd_powerup_issuable);
+  CARVE_RANKS (cmd_refresh_issuable);
+  CARVE_BANKS (cmd_refresh_bank_issuable);
+  CARVE_RANKS (activation_record);
+  CARVE_RANKS (activation_record_head);
+  CARVE_RANKS (next_refresh_completion_deadline);
+  CARVE_RANKS (last_refresh_completion_deadline);
+  CARVE_RANKS (forced_refresh_mode_on);
+  CARVE_RANKS (refresh_issue_deadline);
+  CARVE_RANKS (issued_forced_refresh_commands);
+  CARVE_RANKS (num_issued_refreshes);
+  CARVE_RANKS (refresh_pending);
+  CARVE_BANKS (bank_refresh_completion_deadline);
+  CARVE_BANKS (bank_refresh_issue_deadline);
+  CARVE_BANKS (bank_forced_refresh_mode_on);
+  CARVE_BANKS (num_issued_bank_refreshes);
+  CARVE_BANKS (bank_refresh_pending);
+  CARVE_RANKS (refresh_start);
+  CARVE_RANKS (refresh_end);
+  CARVE_RANKS (refresh_progress);
+  CARVE_RANKS (stats_time_spent_in_active_standby);
+  CARVE_RANKS (stats_time_spent_in_active_power_down);
+  CARVE_RANKS (stats_time_spent_in_precharge_power_down_fast);
+  CARVE_RANKS (stats_time_spent_in_precharge_power_down_slow);
+  CARVE_RANKS (stats_time_spent_in_power_up);
+  CARVE_RANKS (residency_state);
+  CARVE_RANKS (residency_since);
+  CARVE_RANKS (last_activate);
+  CARVE_RANKS (last_refresh);
+  CARVE_RANKS (average_gap_between_activates);
+  CARVE_RANKS (average_gap_between_refreshes);
+  CARVE_RANKS (stats_time_spent_terminating_reads_from_other_ranks);
+  CARVE_RANKS (stats_time_spent_terminating_writes_to_other_ranks);
+  CARVE_BANKS (stats_num_activate_read);
+  CARVE_BANKS (stats_num_activate_write);
+  CARVE_BANKS (stats_num_activate_spec);
+  CARVE_RANKS (stats_num_activate);
+  CARVE_BANKS (stats_num_precharge);
+  CARVE_BANKS (stats_num_read);
+  CARVE_BANKS (stats_num_write);
+  CARVE_RANKS (stats_num_powerdown_slow);
+  CARVE_RANKS (stats_num_powerdown_fast);
+  CARVE_RANKS (stats_num_powerup);
+  CARVE_RANKS (stats_num_refresh_pauses);
+  CARVE_RANKS (stats_num_refresh_resumes);
+  return used;
+}
+
+
+// Allocate the controller state for the configured dimensions. The
+// channel arenas are slices of one zeroed block.
+  static int
+alloc_memory_controller_state () 
+{
+  char *arena;
+  size_t arena_size;
+
+  ALLOC_CHANNELS (dram_state);
+  ALLOC_CHANNELS (cas_issued_current_cycle);
+  ALLOC_CHANNELS (cmd_precharge_issuable);
+  ALLOC_CHANNELS (cmd_all_bank_precharge_issuable);
+  ALLOC_CHANNELS (cmd_powerdown_fast_issuable);
+  ALLOC_CHANNELS (cmd_powerdown_slow_issuable);
+  ALLOC_CHANNELS (cmd_powerup_issuable);
+  ALLOC_CHANNELS (cmd_refresh_issuable);
+  ALLOC_CHANNELS (cmd_refresh_bank_issuable);
+  ALLOC_CHANNELS (activation_record);
+  ALLOC_CHANNELS (activation_record_head);
+  ALLOC_CHANNELS (next_refresh_completion_deadline);
+  ALLOC_CHANNELS (last_refresh_completion_deadline);
+  ALLOC_CHANNELS (forced_refresh_mode_on);
+  ALLOC_CHANNELS (refresh_issue_deadline);
+  ALLOC_CHANNELS (issued_forced_refresh_commands);
+  ALLOC_CHANNELS (num_issued_refreshes);
+  ALLOC_CHANNELS (refresh_pending);
+  ALLOC_CHANNELS (bank_refresh_completion_deadline);
+  ALLOC_CHANNELS (bank_refresh_issue_deadline);
+  ALLOC_CHANNELS (bank_forced_refresh_mode_on);
+  ALLOC_CHANNELS (num_issued_bank_refreshes);
+  ALLOC_CHANNELS (bank_refresh_pending);
+  ALLOC_CHANNELS (refresh_start);
+  ALLOC_CHANNELS (refresh_end);
+  ALLOC_CHANNELS (refresh_progress);
+  ALLOC_CHANNELS (stats_time_spent_in_active_standby);
+  ALLOC_CHANNELS (stats_time_spent_in_active_power_down);
+  ALLOC_CHANNELS (stats_time_spent_in_precharge_power_down_fast);
+  ALLOC_CHANNELS (stats_time_spent_in_precharge_power_down_slow);
+  ALLOC_CHANNELS (stats_time_spent_in_power_up);
+  ALLOC_CHANNELS (residency_state);
+  ALLOC_CHANNELS (residency_since);
+  ALLOC_CHANNELS (last_activate);
+  ALLOC_CHANNELS (last_refresh);
+  ALLOC_CHANNELS (average_gap_between_activates);
+  ALLOC_CHANNELS (average_gap_between_refreshes);
+  ALLOC_CHANNELS (stats_time_spent_terminating_reads_from_other_ranks);
+  ALLOC_CHANNELS (stats_time_spent_terminating_writes_to_other_ranks);
+  ALLOC_CHANNELS (stats_num_activate_read);
+  ALLOC_CHANNELS (stats_num_activate_write);
+  ALLOC_CHANNELS (stats_num_activate_spec);
+  ALLOC_CHANNELS (stats_num_activate);
+  ALLOC_CHANNELS (stats_num_precharge);
+  ALLOC_CHANNELS (stats_num_read);
+  ALLOC_CHANNELS (stats_num_write);
+  ALLOC_CHANNELS (stats_num_powerdown_slow);
+  ALLOC_CHANNELS (stats_num_powerdown_fast);
+  ALLOC_CHANNELS (stats_num_powerup);
+  ALLOC_CHANNELS (stats_num_refresh_pauses);
+  ALLOC_CHANNELS (stats_num_refresh_resumes);
+
+  // per channel scalars
+  ALLOC_CHANNELS (command_issued_current_cycle);
+  ALLOC_CHANNELS (last_cas_rank);
+  ALLOC_CHANNELS (last_cas_bank);
+  ALLOC_CHANNELS (read_queue_head);
+  ALLOC_CHANNELS (write_queue_head);
+  ALLOC_CHANNELS (read_queue_length);
+  ALLOC_CHANNELS (write_queue_length);
+  ALLOC_CHANNELS (stats_reads_merged_per_channel);
+  ALLOC_CHANNELS (stats_writes_merged_per_channel);
+  ALLOC_CHANNELS (stats_reads_seen);
+  ALLOC_CHANNELS (stats_writes_seen);
+  ALLOC_CHANNELS (stats_reads_completed);
+  ALLOC_CHANNELS (stats_writes_completed);
+  ALLOC_CHANNELS (stats_average_read_latency);
+  ALLOC_CHANNELS (stats_average_read_queue_latency);
+  ALLOC_CHANNELS (stats_average_write_latency);
+  ALLOC_CHANNELS (stats_average_write_queue_latency);
+  ALLOC_CHANNELS (stats_page_hits);
+  ALLOC_CHANNELS (stats_read_row_hit_rate);
+
+  arena_size = carve_channel_arena (0, NULL);
+  arena = alloc_system_memory (NUM_CHANNELS, arena_size);
+  if (!arena || !stats_read_row_hit_rate)
+  {
+    fprintf (usimm_out, "PANIC: cannot allocate memory controller state\n");
+    return -1;
   }
-  if (number_of_activates < 4)
-    return 1;
+  for (int channel = 0; channel < NUM_CHANNELS; channel++)
+    carve_channel_arena (channel, arena + channel * arena_size);
+  return 0;
+}
 
+
+// Blocks of alloc_system_memory (), on a list that free_system_memory ()
+// walks. The union keeps the memory after the header aligned.
+typedef union system_block
+{
+  struct
+  {
+    union system_block *prev;
+    union system_block *next;
+  } link;
+  long double align;
+} system_block_t;
+
+static USIMM_STATE system_block_t *system_blocks;
+
+
+  static void
+link_system_block (system_block_t * block)
+{
+  block->link.prev = NULL;
+  block->link.next = system_blocks;
+  if (system_blocks)
+    system_blocks->link.prev = block;
+  system_blocks = block;
+}
+
+
+  static void
+unlink_system_block (system_block_t * block)
+{
+  if (block->link.prev)
+    block->link.prev->link.next = block->link.next;
   else
-    return 0;
+    system_blocks = block->link.next;
+  if (block->link.next)
+    block->link.next->link.prev = block->link.prev;
+}
+
+
+  void *
+alloc_system_memory (size_t count, size_t size) 
+{
+  system_block_t *block = calloc (1, sizeof (system_block_t) + count * size);
+
+  if (!block)
+    return NULL;
+  link_system_block (block);
+  return block + 1;
+}
+
+
+  void *
+realloc_system_memory (void *memory, size_t size) 
+{
+  system_block_t *block;
+
+  if (!memory)
+    return alloc_system_memory (1, size);
+  block = (system_block_t *) memory - 1;
+  unlink_system_block (block);
+  system_block_t *moved = realloc (block, sizeof (system_block_t) + size);
+  if (!moved)
+  {
+    link_system_block (block);
+    return NULL;
+  }
+  link_system_block (moved);
+  return moved + 1;
 }
 
 
-// shift the moving window, clear out the past
   void
-flush_activate_record (int channel, int rank, long long int cycle) 
+free_system_memory () 
 {
-  if (cycle >= T_FAW + PROCESSOR_CLK_MULTIPLIER)
+  while (system_blocks)
+  {
+    system_block_t *next = system_blocks->link.next;
+    free (system_blocks);
+    system_blocks = next;
+  }
+}
 
+
+  static void *
+alloc_table (size_t size, int dims) 
+{
+  size_t pointers = NUM_CHANNELS * sizeof (void *);
+  size_t rows = dims == 3 ? NUM_CHANNELS * NUM_RANKS * sizeof (void *) : 0;
+  size_t elements = (size_t) NUM_CHANNELS * NUM_RANKS *
+    (dims == 3 ? NUM_BANKS : 1);
+  char *block = alloc_system_memory (1, pointers + rows + elements * size);
+  void **channel_ptr = (void **) block;
+  void **rank_ptr = (void **) (block + pointers);
+  char *data = block + pointers + rows;
+
+  if (!block)
   {
-    for (int i = 1; i <= PROCESSOR_CLK_MULTIPLIER; i++)
-      activation_record[channel][rank][(cycle - T_FAW - i) % BIG_ACTIVATION_WINDOW] = 0;	// make sure cycle >tFAW
+    fprintf (usimm_out, "PANIC: cannot allocate scheduler state\n");
+    exit (-1);
   }
-}  
+  for (int c = 0; c < NUM_CHANNELS; c++)
+  {
+    if (dims == 3)
+    {
+      channel_ptr[c] = &rank_ptr[c * NUM_RANKS];
+      for (int r = 0; r < NUM_RANKS; r++)
+        rank_ptr[c * NUM_RANKS + r] =
+          data + ((size_t) c * NUM_RANKS + r) * NUM_BANKS * size;
+    }
+    else
+      channel_ptr[c] = data + (size_t) c * NUM_RANKS * size;
+  }
+  return block;
+}
+
+
+  void *
+alloc_rank_table (size_t size) 
+{
+  return alloc_table (size, 2);
+}
+
+
+  void *
+alloc_bank_table (size_t size) 
+{
+  return alloc_table (size, 3);
+}
+
 
 // initialize dram variables and statistics
-  void
+  int
 init_memory_controller_vars () 
 {
+  if (alloc_memory_controller_state ())
+    return -1;
+  if (REFRESH_MODE == PER_BANK_REFRESH)
+  {
+    refreshes_per_window = 8;
+    refresh_cycle_time = T_RFCPB;
+  }
+  else
+  {
+    refreshes_per_window = 8 * REFRESH_GRANULARITY;
+    refresh_cycle_time = REFRESH_GRANULARITY == 4 ? T_RFC4 :
+      REFRESH_GRANULARITY == 2 ? T_RFC2 : T_RFC;
+  }
   num_read_merge = 0;
   num_write_merge = 0;
+  residency_end = 0;
+  print_total_cycles = 0;
   for (int i = 0; i < NUM_CHANNELS; i++)
 
   {
     for (int j = 0; j < NUM_RANKS; j++)
 
     {
-      for (int w = 0; w < BIG_ACTIVATION_WINDOW; w++)
-        activation_record[i][j][w] = 0;
+      for (int w = 0; w < FAW_ACTIVATES; w++)
+        activation_record[i][j][w] = NO_ACTIVATE;
+      activation_record_head[i][j] = 0;
       for (int k = 0; k < NUM_BANKS; k++)
 
       {
@@ -115,6 +476,15 @@ init_memory_controller_vars ()
         stats_num_read[i][j][k] = 0;
         stats_num_write[i][j][k] = 0;
         cas_issued_current_cycle[i][j][k] = 0;
+
+        // stagger the per-bank refresh windows of a rank
+        bank_refresh_completion_deadline[i][j][k] = 8 * T_REFI +
+          (long long int) k * (8 * T_REFI / PROCESSOR_CLK_MULTIPLIER /
+              NUM_BANKS) * PROCESSOR_CLK_MULTIPLIER;
+        bank_refresh_issue_deadline[i][j][k] =
+          bank_refresh_completion_deadline[i][j][k] - T_RP -
+          refreshes_per_window * refresh_cycle_time;
+        bank_refresh_pending[i][j][k] = refreshes_per_window;
       }  cmd_all_bank_precharge_issuable[i][j] = 0;
       cmd_powerdown_fast_issuable[i][j] = 0;
       cmd_powerdown_slow_issuable[i][j] = 0;
@@ -124,8 +494,13 @@ init_memory_controller_vars ()
       last_refresh_completion_deadline[i][j] = 0;
       forced_refresh_mode_on[i][j] = 0;
       refresh_issue_deadline[i][j] =
-        next_refresh_completion_deadline[i][j] - T_RP - 8 * T_RFC;
+        next_refresh_completion_deadline[i][j] - T_RP -
+        refreshes_per_window * refresh_cycle_time;
+      if (REFRESH_MODE == PER_BANK_REFRESH)
+        refresh_issue_deadline[i][j] = bank_refresh_issue_deadline[i][j][0];
       num_issued_refreshes[i][j] = 0;
+      refresh_pending[i][j] = refreshes_per_window *
+        (REFRESH_MODE == PER_BANK_REFRESH ? NUM_BANKS : 1);
       stats_time_spent_in_active_power_down[i][j] = 0;
       stats_time_spent_in_precharge_power_down_slow[i][j] = 0;
       stats_time_spent_in_precharge_power_down_fast[i][j] = 0;
@@ -140,6 +515,8 @@ init_memory_controller_vars ()
       command_issued_current_cycle[i] = 0;
     }   read_queue_head[i] = NULL;
     write_queue_head[i] = NULL;
+    last_cas_rank[i] = -1;
+    last_cas_bank[i] = -1;
     read_queue_length[i] = 0;
     write_queue_length[i] = 0;
     command_issued_current_cycle[i] = 0;
@@ -157,7 +534,9 @@ init_memory_controller_vars ()
     stats_average_write_queue_latency[i] = 0;
     stats_page_hits[i] = 0;
     stats_read_row_hit_rate[i] = 0;
-  } }  
+  }
+  return 0;
+}
 
 /********************************************************/ 
 /*	Utility Functions				*/ 
@@ -176,73 +555,71 @@ log_base2 (unsigned int new_value)
 }
 
 
+// log_base2 rounded up: the number of bits needed for new_value ids
+  unsigned int
+ceil_log2 (unsigned int new_value)
+{
+  unsigned int bits = log_base2 (new_value);
+  if ((1U << bits) < new_value)
+    bits++;
+  return bits;
+}
+
+
+// bank group of a bank: the low bits of the bank id
+  int
+get_bank_group (int bank) 
+{
+  return bank % NUM_BANK_GROUPS;
+}
+
+
+  int
+is_same_bank_group (int bank1, int bank2) 
+{
+  return get_bank_group (bank1) == get_bank_group (bank2);
+}
+
+
+// Does a column command for this request go to a different bank group
+// than the last column command on its channel? Such back-to-back
+// column commands only need T_CCD_S instead of T_CCD_L.
+  int
+is_cas_to_other_bank_group (request_t * request) 
+{
+  int channel = request->dram_addr.channel;
+  return last_cas_rank[channel] != request->dram_addr.rank
+    || !is_same_bank_group (last_cas_bank[channel], request->dram_addr.bank);
+}
+
+
+// Minimum gap the last column command on the channel imposes on a
+// column command of the same type to this bank: T_CCD_L within a bank
+// group, T_CCD_S across groups and the rank switch across ranks.
+// Schedulers can prefer the request with the smallest gap.
+  int
+get_cas_to_cas_gap (int channel, int rank, int bank) 
+{
+  if (last_cas_rank[channel] < 0)
+    return 0;
+  if (last_cas_rank[channel] != rank)
+    return T_DATA_TRANS + T_RTRS;
+  if (is_same_bank_group (last_cas_bank[channel], bank))
+    return max (T_CCD_L, T_DATA_TRANS);
+  return max (T_CCD_S, T_DATA_TRANS);
+}
+
+
 // Function to decompose the incoming DRAM address into the
 // constituent channel, rank, bank, row and column ids. 
 // Note : To prevent memory leaks, call free() on the pointer returned
 // by this function after you have used the return value.
+// decode_address() in address_map.h returns the same fields by value.
 dram_address_t * calc_dram_addr (long long int physical_address) 
 {
-  long long int input_a, temp_b, temp_a;
-  int channelBitWidth = log_base2 (NUM_CHANNELS);
-  int rankBitWidth = log_base2 (NUM_RANKS);
-  int bankBitWidth = log_base2 (NUM_BANKS);
-  int rowBitWidth = log_base2 (NUM_ROWS);
-  int colBitWidth = log_base2 (NUM_COLUMNS);
-  int byteOffsetWidth = log_base2 (CACHE_LINE_SIZE);
   dram_address_t * this_a =
     (dram_address_t *) malloc (sizeof (dram_address_t));
-  this_a->actual_address = physical_address;
-  input_a = physical_address;
-  input_a = input_a >> byteOffsetWidth;	// strip out the cache_offset
-  if (ADDRESS_MAPPING == 1)
-
-  {
-    temp_b = input_a;
-    input_a = input_a >> colBitWidth;
-    temp_a = input_a << colBitWidth;
-    this_a->column = temp_a ^ temp_b;	//strip out the column address
-    temp_b = input_a;
-    input_a = input_a >> channelBitWidth;
-    temp_a = input_a << channelBitWidth;
-    this_a->channel = temp_a ^ temp_b;	// strip out the channel address
-    temp_b = input_a;
-    input_a = input_a >> bankBitWidth;
-    temp_a = input_a << bankBitWidth;
-    this_a->bank = temp_a ^ temp_b;	// strip out the bank address 
-    temp_b = input_a;
-    input_a = input_a >> rankBitWidth;
-    temp_a = input_a << rankBitWidth;
-    this_a->rank = temp_a ^ temp_b;	// strip out the rank address
-    temp_b = input_a;
-    input_a = input_a >> rowBitWidth;
-    temp_a = input_a << rowBitWidth;
-    this_a->row = temp_a ^ temp_b;	// strip out the row number
-  }
-
-  else
-
-  {
-    temp_b = input_a;
-    input_a = input_a >> channelBitWidth;
-    temp_a = input_a << channelBitWidth;
-    this_a->channel = temp_a ^ temp_b;	// strip out the channel address
-    temp_b = input_a;
-    input_a = input_a >> bankBitWidth;
-    temp_a = input_a << bankBitWidth;
-    this_a->bank = temp_a ^ temp_b;	// strip out the bank address 
-    temp_b = input_a;
-    input_a = input_a >> rankBitWidth;
-    temp_a = input_a << rankBitWidth;
-    this_a->rank = temp_a ^ temp_b;	// strip out the rank address
-    temp_b = input_a;
-    input_a = input_a >> colBitWidth;
-    temp_a = input_a << colBitWidth;
-    this_a->column = temp_a ^ temp_b;	//strip out the column address
-    temp_b = input_a;
-    input_a = input_a >> rowBitWidth;
-    temp_a = input_a << rowBitWidth;
-    this_a->row = temp_a ^ temp_b;	// strip out the row number
-  }
+  *this_a = decode_address (physical_address);
   return (this_a);
 }
 
@@ -259,7 +636,7 @@ init_new_node (long long int physical_address, long long int arrival_time,
   if (new_node == NULL)
 
   {
-    printf ("FATAL : Malloc Error\n");
+    fprintf (usimm_out, "FATAL : Malloc Error\n");
     exit (-1);
   }
 
@@ -278,15 +655,12 @@ init_new_node (long long int physical_address, long long int arrival_time,
     new_node->request_served = 0;
     new_node->instruction_id = instruction_id;
     new_node->instruction_pc = instruction_pc;
+    new_node->row_event = ROW_EVENT_NONE;
+    new_node->stall_cause = STALL_NONE;
+    new_node->interference = 0;
+    new_node->prefetch = 0;
     new_node->next = NULL;
-    dram_address_t * this_node_addr = calc_dram_addr (physical_address);
-    new_node->dram_addr.actual_address = physical_address;
-    new_node->dram_addr.channel = this_node_addr->channel;
-    new_node->dram_addr.rank = this_node_addr->rank;
-    new_node->dram_addr.bank = this_node_addr->bank;
-    new_node->dram_addr.row = this_node_addr->row;
-    new_node->dram_addr.column = this_node_addr->column;
-    free (this_node_addr);
+    new_node->dram_addr = decode_address (physical_address);
     new_node->user_ptr = NULL;
     return (new_node);
   }
@@ -306,9 +680,7 @@ read_matches_write_or_read_queue (long long int physical_address)
 {
 
   //get channel info
-  dram_address_t * this_addr = calc_dram_addr (physical_address);
-  int channel = this_addr->channel;
-  free (this_addr);
+  int channel = decode_address (physical_address).channel;
   request_t * wr_ptr = NULL;
   request_t * rd_ptr = NULL;
   LL_FOREACH (write_queue_head[channel], wr_ptr) 
@@ -341,9 +713,7 @@ write_exists_in_write_queue (long long int physical_address)
 {
 
   //get channel info
-  dram_address_t * this_addr = calc_dram_addr (physical_address);
-  int channel = this_addr->channel;
-  free (this_addr);
+  int channel = decode_address (physical_address).channel;
   request_t * wr_ptr = NULL;
   LL_FOREACH (write_queue_head[channel], wr_ptr) 
   {
@@ -367,15 +737,17 @@ request_t * insert_read (long long int physical_address,
   optype_t this_op = READ;
 
   //get channel info
-  dram_address_t * this_addr = calc_dram_addr (physical_address);
-  int channel = this_addr->channel;
-  free (this_addr);
+  int channel = decode_address (physical_address).channel;
   stats_reads_seen[channel]++;
   request_t * new_node =
     init_new_node (physical_address, arrival_time, this_op, thread_id,
         instruction_id, instruction_pc);
   LL_APPEND (read_queue_head[channel], new_node);
   read_queue_length[channel]++;
+  if (ROW_PREDICTOR)
+    observe_request (new_node);
+  observe_interference_read (new_node);
+  observe_refresh_read (new_node);
 
   //UT_MEM_DEBUG("\nCyc: %lld New READ:%lld Core:%d Chan:%d Rank:%d Bank:%d Row:%lld RD_Q_Length:%lld\n", CYCLE_VAL, new_node->id, new_node->thread_id, new_node->dram_addr.channel,  new_node->dram_addr.rank,  new_node->dram_addr.bank,  new_node->dram_addr.row, read_queue_length[channel]);
   return new_node;
@@ -388,9 +760,7 @@ request_t * insert_write (long long int physical_address,
     int instruction_id) 
 {
   optype_t this_op = WRITE;
-  dram_address_t * this_addr = calc_dram_addr (physical_address);
-  int channel = this_addr->channel;
-  free (this_addr);
+  int channel = decode_address (physical_address).channel;
   stats_writes_seen[channel]++;
   request_t * new_node =
     init_new_node (physical_address, arrival_time, this_op, thread_id,
@@ -432,18 +802,20 @@ update_read_queue_commands (int channel)
       case PRECHARGING:
       case REFRESHING:
         curr->next_command = ACT_CMD;
-        if (CYCLE_VAL >= dram_state[channel][rank][bank].next_act
-            && is_T_FAW_met (channel, rank, CYCLE_VAL))
-          curr->command_issuable = 1;
+        if (CYCLE_VAL < dram_state[channel][rank][bank].next_act)
+          curr->stall_cause =
+            dram_state[channel][rank][bank].state == REFRESHING
+            ? STALL_REFRESH : STALL_ACTIVATE;
+
+        else if (!is_T_FAW_met (channel, rank, CYCLE_VAL))
+          curr->stall_cause = STALL_FAW;
 
         else
-          curr->command_issuable = 0;
+          curr->stall_cause = STALL_NONE;
 
         // check if we are in OR too close to the forced refresh period
-        if (forced_refresh_mode_on[channel][rank]
-            || ((CYCLE_VAL + T_RAS) >
-              refresh_issue_deadline[channel][rank]))
-          curr->command_issuable = 0;
+        if (refresh_blocks (channel, rank, bank, T_RAS))
+          curr->stall_cause = STALL_REFRESH;
         break;
       case ROW_ACTIVE:
 
@@ -457,14 +829,12 @@ update_read_queue_commands (int channel)
         {
           curr->next_command = COL_READ_CMD;
           if (CYCLE_VAL >= dram_state[channel][rank][bank].next_read)
-            curr->command_issuable = 1;
+            curr->stall_cause = STALL_NONE;
 
           else
-            curr->command_issuable = 0;
-          if (forced_refresh_mode_on[channel][rank]
-              || ((CYCLE_VAL + T_RTP) >
-                refresh_issue_deadline[channel][rank]))
-            curr->command_issuable = 0;
+            curr->stall_cause = STALL_COLUMN;
+          if (refresh_blocks (channel, rank, bank, T_RTP))
+            curr->stall_cause = STALL_REFRESH;
         }
 
         else
@@ -472,14 +842,12 @@ update_read_queue_commands (int channel)
         {
           curr->next_command = PRE_CMD;
           if (CYCLE_VAL >= dram_state[channel][rank][bank].next_pre)
-            curr->command_issuable = 1;
+            curr->stall_cause = STALL_NONE;
 
           else
-            curr->command_issuable = 0;
-          if (forced_refresh_mode_on[channel][rank]
-              || ((CYCLE_VAL + T_RP) >
-                refresh_issue_deadline[channel][rank]))
-            curr->command_issuable = 0;
+            curr->stall_cause = STALL_PRECHARGE;
+          if (refresh_blocks (channel, rank, bank, T_RP))
+            curr->stall_cause = STALL_REFRESH;
         }
         break;
 
@@ -490,15 +858,15 @@ update_read_queue_commands (int channel)
       case ACTIVE_POWER_DOWN:
         curr->next_command = PWR_UP_CMD;
         if (CYCLE_VAL >= dram_state[channel][rank][bank].next_powerup)
-          curr->command_issuable = 1;
+          curr->stall_cause = STALL_NONE;
 
         else
-          curr->command_issuable = 0;
+          curr->stall_cause = STALL_POWER_UP;
         if ((dram_state[channel][rank][bank].state ==
               PRECHARGE_POWER_DOWN_SLOW)
             && ((CYCLE_VAL + T_XP_DLL) >
               refresh_issue_deadline[channel][rank]))
-          curr->command_issuable = 0;
+          curr->stall_cause = STALL_REFRESH;
 
         else
           if (((dram_state[channel][rank][bank].state ==
@@ -506,11 +874,12 @@ update_read_queue_commands (int channel)
                 || (dram_state[channel][rank][bank].state ==
                   ACTIVE_POWER_DOWN))
               && ((CYCLE_VAL + T_XP) > refresh_issue_deadline[channel][rank]))
-            curr->command_issuable = 0;
+            curr->stall_cause = STALL_REFRESH;
         break;
       default:
         break;
     }
+    curr->command_issuable = curr->stall_cause == STALL_NONE;
   }
 }
 
@@ -534,18 +903,20 @@ update_write_queue_commands (int channel)
       case PRECHARGING:
       case REFRESHING:
         curr->next_command = ACT_CMD;
-        if (CYCLE_VAL >= dram_state[channel][rank][bank].next_act
-            && is_T_FAW_met (channel, rank, CYCLE_VAL))
-          curr->command_issuable = 1;
+        if (CYCLE_VAL < dram_state[channel][rank][bank].next_act)
+          curr->stall_cause =
+            dram_state[channel][rank][bank].state == REFRESHING
+            ? STALL_REFRESH : STALL_ACTIVATE;
+
+        else if (!is_T_FAW_met (channel, rank, CYCLE_VAL))
+          curr->stall_cause = STALL_FAW;
 
         else
-          curr->command_issuable = 0;
+          curr->stall_cause = STALL_NONE;
 
         // check if we are in or too close to the forced refresh period
-        if (forced_refresh_mode_on[channel][rank]
-            || ((CYCLE_VAL + T_RAS) >
-              refresh_issue_deadline[channel][rank]))
-          curr->command_issuable = 0;
+        if (refresh_blocks (channel, rank, bank, T_RAS))
+          curr->stall_cause = STALL_REFRESH;
         break;
       case ROW_ACTIVE:
         if (row == dram_state[channel][rank][bank].active_row)
@@ -553,14 +924,13 @@ update_write_queue_commands (int channel)
         {
           curr->next_command = COL_WRITE_CMD;
           if (CYCLE_VAL >= dram_state[channel][rank][bank].next_write)
-            curr->command_issuable = 1;
+            curr->stall_cause = STALL_NONE;
 
           else
-            curr->command_issuable = 0;
-          if (forced_refresh_mode_on[channel][rank]
-              || ((CYCLE_VAL + T_CWD + T_DATA_TRANS + T_WR) >
-                refresh_issue_deadline[channel][rank]))
-            curr->command_issuable = 0;
+            curr->stall_cause = STALL_COLUMN;
+          if (refresh_blocks (channel, rank, bank,
+                T_CWD + T_DATA_TRANS + T_WR))
+            curr->stall_cause = STALL_REFRESH;
         }
 
         else
@@ -568,14 +938,12 @@ update_write_queue_commands (int channel)
         {
           curr->next_command = PRE_CMD;
           if (CYCLE_VAL >= dram_state[channel][rank][bank].next_pre)
-            curr->command_issuable = 1;
+            curr->stall_cause = STALL_NONE;
 
           else
-            curr->command_issuable = 0;
-          if (forced_refresh_mode_on[channel][rank]
-              || ((CYCLE_VAL + T_RP) >
-                refresh_issue_deadline[channel][rank]))
-            curr->command_issuable = 0;
+            curr->stall_cause = STALL_PRECHARGE;
+          if (refresh_blocks (channel, rank, bank, T_RP))
+            curr->stall_cause = STALL_REFRESH;
         }
         break;
       case PRECHARGE_POWER_DOWN_SLOW:
@@ -583,17 +951,17 @@ update_write_queue_commands (int channel)
       case ACTIVE_POWER_DOWN:
         curr->next_command = PWR_UP_CMD;
         if (CYCLE_VAL >= dram_state[channel][rank][bank].next_powerup)
-          curr->command_issuable = 1;
+          curr->stall_cause = STALL_NONE;
 
         else
-          curr->command_issuable = 0;
+          curr->stall_cause = STALL_POWER_UP;
         if (forced_refresh_mode_on[channel][rank])
-          curr->command_issuable = 0;
+          curr->stall_cause = STALL_REFRESH;
         if ((dram_state[channel][rank][bank].state ==
               PRECHARGE_POWER_DOWN_SLOW)
             && ((CYCLE_VAL + T_XP_DLL) >
               refresh_issue_deadline[channel][rank]))
-          curr->command_issuable = 0;
+          curr->stall_cause = STALL_REFRESH;
 
         else
           if (((dram_state[channel][rank][bank].state ==
@@ -601,11 +969,12 @@ update_write_queue_commands (int channel)
                 || (dram_state[channel][rank][bank].state ==
                   ACTIVE_POWER_DOWN))
               && ((CYCLE_VAL + T_XP) > refresh_issue_deadline[channel][rank]))
-            curr->command_issuable = 0;
+            curr->stall_cause = STALL_REFRESH;
         break;
       default:
         break;
     }
+    curr->command_issuable = curr->stall_cause == STALL_NONE;
   }
 }
 
@@ -668,8 +1037,8 @@ issue_request_command (request_t * request)
       || command_issued_current_cycle[request->dram_addr.channel])
 
   {
-    printf
-      ("PANIC: SCHED_ERROR : Command for request selected can not be issued in  cycle:%lld.\n",
+    fprintf
+      (usimm_out, "PANIC: SCHED_ERROR : Command for request selected can not be issued in  cycle:%lld.\n",
        CYCLE_VAL);
     return 0;
   }
@@ -706,7 +1075,8 @@ issue_request_command (request_t * request)
       for (int i = 0; i < NUM_BANKS; i++)
         if (i != bank)
           dram_state[channel][rank][i].next_act =
-            max (cycle + T_RRD, dram_state[channel][rank][i].next_act);
+            max (cycle + (is_same_bank_group (i, bank) ? T_RRD_L : T_RRD_S),
+                dram_state[channel][rank][i].next_act);
       record_activate (channel, rank, cycle);
       if (request->operation_type == READ)
         stats_num_activate_read[channel][rank][bank]++;
@@ -744,8 +1114,9 @@ issue_request_command (request_t * request)
 
           else
             dram_state[channel][i][j].next_read =
-              max (cycle + max (T_CCD, T_DATA_TRANS),
-                  dram_state[channel][i][j].next_read);
+              max (cycle +
+                  max (is_same_bank_group (j, bank) ? T_CCD_L : T_CCD_S,
+                    T_DATA_TRANS), dram_state[channel][i][j].next_read);
           dram_state[channel][i][j].next_write =
             max (cycle + T_CAS + T_DATA_TRANS + T_RTRS - T_CWD,
                 dram_state[channel][i][j].next_write);
@@ -759,23 +1130,32 @@ issue_request_command (request_t * request)
       request->dispatch_time = CYCLE_VAL;
       request->request_served = 1;
 
-      // update the ROB with the completion time
-      ROB[request->thread_id].comptime[request->instruction_id] =
-        request->completion_time + PIPELINEDEPTH;
-      stats_reads_completed[channel]++;
-      stats_average_read_latency[channel] =
-        ((stats_reads_completed[channel] -
-          1) * stats_average_read_latency[channel] +
-         request->latency) / stats_reads_completed[channel];
-      stats_average_read_queue_latency[channel] =
-        ((stats_reads_completed[channel] -
-          1) * stats_average_read_queue_latency[channel] +
-         (request->dispatch_time -
-          request->arrival_time)) / stats_reads_completed[channel];
+      // update the ROB with the completion time (reads from libusimm.h
+      // have no ROB entry)
+      if (request->instruction_id >= 0 && !request->prefetch)
+        ROB[request->thread_id].comptime[request->instruction_id] =
+          request->completion_time + PIPELINEDEPTH;
+
+      // prefetches keep their own count and latency in prefetch.c
+      if (request->prefetch)
+        prefetch_filled (request);
+      else
+      {
+        stats_reads_completed[channel]++;
+        stats_average_read_latency[channel] =
+          ((stats_reads_completed[channel] -
+            1) * stats_average_read_latency[channel] +
+           request->latency) / stats_reads_completed[channel];
+        stats_average_read_queue_latency[channel] =
+          ((stats_reads_completed[channel] -
+            1) * stats_average_read_queue_latency[channel] +
+           (request->dispatch_time -
+            request->arrival_time)) / stats_reads_completed[channel];
+      }
 
       //UT_MEM_DEBUG("Req:%lld finishes at Cycle: %lld\n", request->id, request->completion_time);
 
-      //printf("Cycle: %10lld, Reads  Completed = %5lld, this_latency= %5lld, latency = %f\n", CYCLE_VAL, stats_reads_completed[channel], request->latency, stats_average_read_latency[channel]);     
+      //fprintf(usimm_out, "Cycle: %10lld, Reads  Completed = %5lld, this_latency= %5lld, latency = %f\n", CYCLE_VAL, stats_reads_completed[channel], request->latency, stats_average_read_latency[channel]);     
       stats_num_read[channel][rank][bank]++;
       for (int i = 0; i < NUM_RANKS; i++)
 
@@ -786,6 +1166,8 @@ issue_request_command (request_t * request)
       }
       command_issued_current_cycle[channel] = 1;
       cas_issued_current_cycle[channel][rank][bank] = 1;
+      last_cas_rank[channel] = rank;
+      last_cas_bank[channel] = bank;
       break;
     case COL_WRITE_CMD:
       assert (dram_state[channel][rank][bank].state == ROW_ACTIVE);
@@ -820,11 +1202,13 @@ issue_request_command (request_t * request)
           else
 
           {
+            int same_group = is_same_bank_group (j, bank);
             dram_state[channel][i][j].next_write =
-              max (cycle + max (T_CCD, T_DATA_TRANS),
-                  dram_state[channel][i][j].next_write);
+              max (cycle + max (same_group ? T_CCD_L : T_CCD_S,
+                    T_DATA_TRANS), dram_state[channel][i][j].next_write);
             dram_state[channel][i][j].next_read =
-              max (cycle + T_CWD + T_DATA_TRANS + T_WTR,
+              max (cycle + T_CWD + T_DATA_TRANS +
+                  (same_group ? T_WTR_L : T_WTR_S),
                   dram_state[channel][i][j].next_read);
           }
         }
@@ -849,7 +1233,7 @@ issue_request_command (request_t * request)
 
       //UT_MEM_DEBUG("Req:%lld finishes at Cycle: %lld\n", request->id, request->completion_time);
 
-      //printf("Cycle: %10lld, Writes Completed = %5lld, this_latency= %5lld, latency = %f\n", CYCLE_VAL, stats_writes_completed[channel], request->latency, stats_average_write_latency[channel]);   
+      //fprintf(usimm_out, "Cycle: %10lld, Writes Completed = %5lld, this_latency= %5lld, latency = %f\n", CYCLE_VAL, stats_writes_completed[channel], request->latency, stats_average_write_latency[channel]);   
       for (int i = 0; i < NUM_RANKS; i++)
 
       {
@@ -859,6 +1243,8 @@ issue_request_command (request_t * request)
       }
       command_issued_current_cycle[channel] = 1;
       cas_issued_current_cycle[channel][rank][bank] = 2;
+      last_cas_rank[channel] = rank;
+      last_cas_bank[channel] = bank;
       break;
     case PRE_CMD:
       assert (dram_state[channel][rank][bank].state == ROW_ACTIVE
@@ -957,6 +1343,14 @@ issue_request_command (request_t * request)
     default:
       break;
   }
+  update_residency (channel, rank);
+  charge_command_energy (channel, rank, request->thread_id, cmd);
+  observe_page_command (request, cmd);
+  observe_qos_command (request, cmd);
+  observe_interference (request, cmd);
+  observe_refresh_command (request, cmd);
+  observe_data_bus (request, cmd);
+  request->stall_cause = STALL_ISSUED;
   return 1;
 }
 
@@ -1069,8 +1463,7 @@ is_powerup_allowed (int channel, int rank)
 is_activate_allowed (int channel, int rank, int bank) 
 {
   if (command_issued_current_cycle[channel]
-      || forced_refresh_mode_on[channel][rank]
-      || (CYCLE_VAL + T_RAS > refresh_issue_deadline[channel][rank]))
+      || refresh_blocks (channel, rank, bank, T_RAS))
     return 0;
   if ((dram_state[channel][rank][bank].state == IDLE
         || dram_state[channel][rank][bank].state == PRECHARGING
@@ -1099,10 +1492,10 @@ is_autoprecharge_allowed (int channel, int rank, int bank)
           dram_state[channel][rank][bank].next_pre);
   if (((cas_issued_current_cycle[channel][rank][bank] == 1)
         && ((start_precharge + T_RP) <=
-          refresh_issue_deadline[channel][rank]))
+          refresh_deadline (channel, rank, bank)))
       || ((cas_issued_current_cycle[channel][rank][bank] == 2)
         && ((start_precharge + T_RP) <=
-          refresh_issue_deadline[channel][rank])))
+          refresh_deadline (channel, rank, bank))))
     return 1;
 
   else
@@ -1115,8 +1508,7 @@ is_autoprecharge_allowed (int channel, int rank, int bank)
 is_precharge_allowed (int channel, int rank, int bank) 
 {
   if (command_issued_current_cycle[channel]
-      || forced_refresh_mode_on[channel][rank]
-      || (CYCLE_VAL + T_RP > refresh_issue_deadline[channel][rank]))
+      || refresh_blocks (channel, rank, bank, T_RP))
     return 0;
   if ((dram_state[channel][rank][bank].state == ROW_ACTIVE
         || dram_state[channel][rank][bank].state == IDLE
@@ -1160,8 +1552,10 @@ is_all_bank_precharge_allowed (int channel, int rank)
   int
 is_refresh_allowed (int channel, int rank) 
 {
+  // per-bank refresh mode only refreshes with REFpb
   if (command_issued_current_cycle[channel]
-      || forced_refresh_mode_on[channel][rank])
+      || forced_refresh_mode_on[channel][rank]
+      || REFRESH_MODE == PER_BANK_REFRESH)
     return 0;
   for (int b = 0; b < NUM_BANKS; b++)
 
@@ -1173,14 +1567,34 @@ is_refresh_allowed (int channel, int rank)
 }
 
 
+// function to see if a bank can be refreshed on its own this cycle
+  int
+is_refresh_bank_allowed (int channel, int rank, int bank) 
+{
+  if (command_issued_current_cycle[channel]
+      || REFRESH_MODE != PER_BANK_REFRESH
+      || bank_forced_refresh_mode_on[channel][rank][bank])
+    return 0;
+  if ((dram_state[channel][rank][bank].state == IDLE
+        || dram_state[channel][rank][bank].state == PRECHARGING
+        || dram_state[channel][rank][bank].state == REFRESHING)
+      && CYCLE_VAL >= dram_state[channel][rank][bank].next_refresh
+      && CYCLE_VAL >= dram_state[channel][rank][bank].next_act)
+    return 1;
+
+  else
+    return 0;
+}
+
+
 // Function to put a rank into the low power mode
   int
 issue_powerdown_command (int channel, int rank, command_t cmd) 
 {
   if (command_issued_current_cycle[channel])
   {
-    printf
-      ("PANIC : SCHED_ERROR: Got beat. POWER_DOWN command not issuable in cycle:%lld\n",
+    fprintf
+      (usimm_out, "PANIC : SCHED_ERROR: Got beat. POWER_DOWN command not issuable in cycle:%lld\n",
        CYCLE_VAL);
     return 0;
   }
@@ -1189,8 +1603,8 @@ issue_powerdown_command (int channel, int rank, command_t cmd)
   if ((cmd != PWR_DN_FAST_CMD) && (cmd != PWR_DN_SLOW_CMD))
 
   {
-    printf
-      ("PANIC: SCHED_ERROR : Only PWR_DN_SLOW_CMD or PWR_DN_FAST_CMD can be used to put DRAM rank to sleep\n");
+    fprintf
+      (usimm_out, "PANIC: SCHED_ERROR : Only PWR_DN_SLOW_CMD or PWR_DN_FAST_CMD can be used to put DRAM rank to sleep\n");
     return 0;
   }
 
@@ -1201,8 +1615,8 @@ issue_powerdown_command (int channel, int rank, command_t cmd)
         && !is_powerdown_slow_allowed (channel, rank)))
 
   {
-    printf
-      ("PANIC : SCHED_ERROR: POWER_DOWN command not issuable in cycle:%lld\n",
+    fprintf
+      (usimm_out, "PANIC : SCHED_ERROR: POWER_DOWN command not issuable in cycle:%lld\n",
        CYCLE_VAL);
     return 0;
   }
@@ -1245,11 +1659,79 @@ issue_powerdown_command (int channel, int rank, command_t cmd)
       dram_state[channel][rank][i].state = ACTIVE_POWER_DOWN;
     }
   }
+  update_residency (channel, rank);
   command_issued_current_cycle[channel] = 1;
   return 1;
 }
 
 
+// Bring all banks of a rank out of power down
+  static void
+power_up_rank (int channel, int rank) 
+{
+  long long int cycle = CYCLE_VAL;
+  for (int i = 0; i < NUM_BANKS; i++)
+
+  {
+    if (dram_state[channel][rank][i].state ==
+        PRECHARGE_POWER_DOWN_SLOW
+        || dram_state[channel][rank][i].state ==
+        PRECHARGE_POWER_DOWN_FAST)
+
+    {
+      dram_state[channel][rank][i].state = IDLE;
+      dram_state[channel][rank][i].active_row = -1;
+    }
+
+    else
+
+    {
+      dram_state[channel][rank][i].state = ROW_ACTIVE;
+    }
+    if (dram_state[channel][rank][i].state ==
+        PRECHARGE_POWER_DOWN_SLOW)
+
+    {
+      dram_state[channel][rank][i].next_powerdown =
+        max (cycle + T_XP_DLL,
+            dram_state[channel][rank][i].next_powerdown);
+      dram_state[channel][rank][i].next_pre =
+        max (cycle + T_XP_DLL, dram_state[channel][rank][i].next_pre);
+      dram_state[channel][rank][i].next_read =
+        max (cycle + T_XP_DLL,
+            dram_state[channel][rank][i].next_read);
+      dram_state[channel][rank][i].next_write =
+        max (cycle + T_XP_DLL,
+            dram_state[channel][rank][i].next_write);
+      dram_state[channel][rank][i].next_act =
+        max (cycle + T_XP_DLL, dram_state[channel][rank][i].next_act);
+      dram_state[channel][rank][i].next_refresh =
+        max (cycle + T_XP_DLL,
+            dram_state[channel][rank][i].next_refresh);
+    }
+
+    else
+
+    {
+      dram_state[channel][rank][i].next_powerdown =
+        max (cycle + T_XP,
+            dram_state[channel][rank][i].next_powerdown);
+      dram_state[channel][rank][i].next_pre =
+        max (cycle + T_XP, dram_state[channel][rank][i].next_pre);
+      dram_state[channel][rank][i].next_read =
+        max (cycle + T_XP, dram_state[channel][rank][i].next_read);
+      dram_state[channel][rank][i].next_write =
+        max (cycle + T_XP, dram_state[channel][rank][i].next_write);
+      dram_state[channel][rank][i].next_act =
+        max (cycle + T_XP, dram_state[channel][rank][i].next_act);
+      dram_state[channel][rank][i].next_refresh =
+        max (cycle + T_XP, dram_state[channel][rank][i].next_refresh);
+    }
+  }
+  update_residency (channel, rank);
+}
+
+
 // Function to power a rank up
   int
 issue_powerup_command (int channel, int rank) 
@@ -1257,8 +1739,8 @@ issue_powerup_command (int channel, int rank)
   if (!is_powerup_allowed (channel, rank))
 
   {
-    printf
-      ("PANIC : SCHED_ERROR: POWER_UP command not issuable in cycle:%lld\n",
+    fprintf
+      (usimm_out, "PANIC : SCHED_ERROR: POWER_UP command not issuable in cycle:%lld\n",
        CYCLE_VAL);
     return 0;
   }
@@ -1266,65 +1748,7 @@ issue_powerup_command (int channel, int rank)
   else
 
   {
-    long long int cycle = CYCLE_VAL;
-    for (int i = 0; i < NUM_BANKS; i++)
-
-    {
-      if (dram_state[channel][rank][i].state ==
-          PRECHARGE_POWER_DOWN_SLOW
-          || dram_state[channel][rank][i].state ==
-          PRECHARGE_POWER_DOWN_FAST)
-
-      {
-        dram_state[channel][rank][i].state = IDLE;
-        dram_state[channel][rank][i].active_row = -1;
-      }
-
-      else
-
-      {
-        dram_state[channel][rank][i].state = ROW_ACTIVE;
-      }
-      if (dram_state[channel][rank][i].state ==
-          PRECHARGE_POWER_DOWN_SLOW)
-
-      {
-        dram_state[channel][rank][i].next_powerdown =
-          max (cycle + T_XP_DLL,
-              dram_state[channel][rank][i].next_powerdown);
-        dram_state[channel][rank][i].next_pre =
-          max (cycle + T_XP_DLL, dram_state[channel][rank][i].next_pre);
-        dram_state[channel][rank][i].next_read =
-          max (cycle + T_XP_DLL,
-              dram_state[channel][rank][i].next_read);
-        dram_state[channel][rank][i].next_write =
-          max (cycle + T_XP_DLL,
-              dram_state[channel][rank][i].next_write);
-        dram_state[channel][rank][i].next_act =
-          max (cycle + T_XP_DLL, dram_state[channel][rank][i].next_act);
-        dram_state[channel][rank][i].next_refresh =
-          max (cycle + T_XP_DLL,
-              dram_state[channel][rank][i].next_refresh);
-      }
-
-      else
-
-      {
-        dram_state[channel][rank][i].next_powerdown =
-          max (cycle + T_XP,
-              dram_state[channel][rank][i].next_powerdown);
-        dram_state[channel][rank][i].next_pre =
-          max (cycle + T_XP, dram_state[channel][rank][i].next_pre);
-        dram_state[channel][rank][i].next_read =
-          max (cycle + T_XP, dram_state[channel][rank][i].next_read);
-        dram_state[channel][rank][i].next_write =
-          max (cycle + T_XP, dram_state[channel][rank][i].next_write);
-        dram_state[channel][rank][i].next_act =
-          max (cycle + T_XP, dram_state[channel][rank][i].next_act);
-        dram_state[channel][rank][i].next_refresh =
-          max (cycle + T_XP, dram_state[channel][rank][i].next_refresh);
-      }
-    }
+    power_up_rank (channel, rank);
     command_issued_current_cycle[channel] = 1;
     return 1;
   }
@@ -1365,11 +1789,11 @@ issue_autoprecharge (int channel, int rank, int bank)
       max (start_precharge + T_RP,
           dram_state[channel][rank][bank].next_refresh);
     stats_num_precharge[channel][rank][bank]++;
+    update_residency (channel, rank);
 
     // reset the cas_issued_current_cycle 
-    for (int r = 0; r < NUM_RANKS; r++)
-      for (int b = 0; b < NUM_BANKS; b++)
-        cas_issued_current_cycle[channel][r][b] = 0;
+    memset (cas_issued_current_cycle[channel][0], 0,
+        NUM_RANKS * NUM_BANKS * sizeof (int));
     return 1;
   }
 }
@@ -1382,8 +1806,8 @@ issue_activate_command (int channel, int rank, int bank, long long int row)
   if (!is_activate_allowed (channel, rank, bank))
 
   {
-    printf
-      ("PANIC : SCHED_ERROR: ACTIVATE command not issuable in cycle:%lld\n",
+    fprintf
+      (usimm_out, "PANIC : SCHED_ERROR: ACTIVATE command not issuable in cycle:%lld\n",
        CYCLE_VAL);
     return 0;
   }
@@ -1409,10 +1833,14 @@ issue_activate_command (int channel, int rank, int bank, long long int row)
     for (int i = 0; i < NUM_BANKS; i++)
       if (i != bank)
         dram_state[channel][rank][i].next_act =
-          max (cycle + T_RRD, dram_state[channel][rank][i].next_act);
+          max (cycle + (is_same_bank_group (i, bank) ? T_RRD_L : T_RRD_S),
+              dram_state[channel][rank][i].next_act);
     record_activate (channel, rank, cycle);
     stats_num_activate[channel][rank]++;
     stats_num_activate_spec[channel][rank][bank]++;
+    observe_page_activate (channel, rank, bank);
+    update_residency (channel, rank);
+    charge_command_energy (channel, rank, -1, ACT_CMD);
     average_gap_between_activates[channel][rank] =
       ((average_gap_between_activates[channel][rank] *
         (stats_num_activate[channel][rank] - 1)) + (CYCLE_VAL -
@@ -1433,8 +1861,8 @@ issue_precharge_command (int channel, int rank, int bank)
   if (!is_precharge_allowed (channel, rank, bank))
 
   {
-    printf
-      ("PANIC : SCHED_ERROR: PRECHARGE command not issuable in cycle:%lld\n",
+    fprintf
+      (usimm_out, "PANIC : SCHED_ERROR: PRECHARGE command not issuable in cycle:%lld\n",
        CYCLE_VAL);
     return 0;
   }
@@ -1454,6 +1882,7 @@ issue_precharge_command (int channel, int rank, int bank)
     dram_state[channel][rank][bank].next_refresh =
       max (CYCLE_VAL + T_RP, dram_state[channel][rank][bank].next_refresh);
     stats_num_precharge[channel][rank][bank]++;
+    update_residency (channel, rank);
     command_issued_current_cycle[channel] = 1;
     return 1;
   }
@@ -1467,8 +1896,8 @@ issue_all_bank_precharge_command (int channel, int rank)
   if (!is_all_bank_precharge_allowed (channel, rank))
 
   {
-    printf
-      ("PANIC : SCHED_ERROR: ALL_BANK_PRECHARGE command not issuable in cycle:%lld\n",
+    fprintf
+      (usimm_out, "PANIC : SCHED_ERROR: ALL_BANK_PRECHARGE command not issuable in cycle:%lld\n",
        CYCLE_VAL);
     return 0;
   }
@@ -1494,8 +1923,8 @@ issue_refresh_command (int channel, int rank)
   if (!is_refresh_allowed (channel, rank))
 
   {
-    printf
-      ("PANIC : SCHED_ERROR: REFRESH command not issuable in cycle:%lld\n",
+    fprintf
+      (usimm_out, "PANIC : SCHED_ERROR: REFRESH command not issuable in cycle:%lld\n",
        CYCLE_VAL);
     return 0;
   }
@@ -1504,127 +1933,142 @@ issue_refresh_command (int channel, int rank)
 
   {
     num_issued_refreshes[channel][rank]++;
-    long long int cycle = CYCLE_VAL;
-    if (dram_state[channel][rank][0].state == PRECHARGE_POWER_DOWN_SLOW)
-
-    {
-      for (int b = 0; b < NUM_BANKS; b++)
 
-      {
-        dram_state[channel][rank][b].next_act =
-          max (cycle + T_XP_DLL + T_RFC,
-              dram_state[channel][rank][b].next_act);
-        dram_state[channel][rank][b].next_pre =
-          max (cycle + T_XP_DLL + T_RFC,
-              dram_state[channel][rank][b].next_pre);
-        dram_state[channel][rank][b].next_refresh =
-          max (cycle + T_XP_DLL + T_RFC,
-              dram_state[channel][rank][b].next_refresh);
-        dram_state[channel][rank][b].next_powerdown =
-          max (cycle + T_XP_DLL + T_RFC,
-              dram_state[channel][rank][b].next_powerdown);
-      } }
+    // the refresh starts once the rank is powered up and precharged
+    long long int start = CYCLE_VAL;
+    if (dram_state[channel][rank][0].state == PRECHARGE_POWER_DOWN_SLOW)
+      start += T_XP_DLL;
 
     else if (dram_state[channel][rank][0].state ==
         PRECHARGE_POWER_DOWN_FAST)
-
-    {
-      for (int b = 0; b < NUM_BANKS; b++)
-
-      {
-        dram_state[channel][rank][b].next_act =
-          max (cycle + T_XP + T_RFC,
-              dram_state[channel][rank][b].next_act);
-        dram_state[channel][rank][b].next_pre =
-          max (cycle + T_XP + T_RFC,
-              dram_state[channel][rank][b].next_pre);
-        dram_state[channel][rank][b].next_refresh =
-          max (cycle + T_XP + T_RFC,
-              dram_state[channel][rank][b].next_refresh);
-        dram_state[channel][rank][b].next_powerdown =
-          max (cycle + T_XP + T_RFC,
-              dram_state[channel][rank][b].next_powerdown);
-      } }
+      start += T_XP;
 
     else if (dram_state[channel][rank][0].state == ACTIVE_POWER_DOWN)
-
-    {
-      for (int b = 0; b < NUM_BANKS; b++)
-
-      {
-        dram_state[channel][rank][b].next_act =
-          max (cycle + T_XP + T_RP + T_RFC,
-              dram_state[channel][rank][b].next_act);
-        dram_state[channel][rank][b].next_pre =
-          max (cycle + T_XP + T_RP + T_RFC,
-              dram_state[channel][rank][b].next_pre);
-        dram_state[channel][rank][b].next_refresh =
-          max (cycle + T_XP + T_RP + T_RFC,
-              dram_state[channel][rank][b].next_refresh);
-        dram_state[channel][rank][b].next_powerdown =
-          max (cycle + T_XP + T_RP + T_RFC,
-              dram_state[channel][rank][b].next_powerdown);
-      } }
+      start += T_XP + T_RP;
 
     else			// rank powered up
     {
-      int flag = 0;
       for (int b = 0; b < NUM_BANKS; b++)
 
       {
         if (dram_state[channel][rank][b].state == ROW_ACTIVE)
 
         {
-          flag = 1;
+          start += T_RP;	// at least a single bank is open
           break;
         }
       }
-      if (flag)		// at least a single bank is open
-      {
-        for (int b = 0; b < NUM_BANKS; b++)
-
-        {
-          dram_state[channel][rank][b].next_act =
-            max (cycle + T_RP + T_RFC,
-                dram_state[channel][rank][b].next_act);
-          dram_state[channel][rank][b].next_pre =
-            max (cycle + T_RP + T_RFC,
-                dram_state[channel][rank][b].next_pre);
-          dram_state[channel][rank][b].next_refresh =
-            max (cycle + T_RP + T_RFC,
-                dram_state[channel][rank][b].next_refresh);
-          dram_state[channel][rank][b].next_powerdown =
-            max (cycle + T_RP + T_RFC,
-                dram_state[channel][rank][b].next_powerdown);
-        } }
-
-      else			// everything precharged
-      {
-        for (int b = 0; b < NUM_BANKS; b++)
+    }
 
-        {
-          dram_state[channel][rank][b].next_act =
-            max (cycle + T_RFC,
-                dram_state[channel][rank][b].next_act);
-          dram_state[channel][rank][b].next_pre =
-            max (cycle + T_RFC,
-                dram_state[channel][rank][b].next_pre);
-          dram_state[channel][rank][b].next_refresh =
-            max (cycle + T_RFC,
-                dram_state[channel][rank][b].next_refresh);
-          dram_state[channel][rank][b].next_powerdown =
-            max (cycle + T_RFC,
-                dram_state[channel][rank][b].next_powerdown);
-        } }  } for (int b = 0; b < NUM_BANKS; b++)
+    // a paused refresh only does its remaining segments
+    long long int end =
+      start + refresh_cycle_time - refresh_progress[channel][rank];
+    if (refresh_progress[channel][rank])
+    {
+      assert (end - start > 0 && end - start < refresh_cycle_time);
+      stats_num_refresh_resumes[channel][rank]++;
+    }
+    refresh_start[channel][rank] = start;
+    refresh_end[channel][rank] = end;
+    charge_refresh_energy (channel, rank, end - start);
+    for (int b = 0; b < NUM_BANKS; b++)
 
     {
+      dram_state[channel][rank][b].next_act =
+        max (end, dram_state[channel][rank][b].next_act);
+      dram_state[channel][rank][b].next_pre =
+        max (end, dram_state[channel][rank][b].next_pre);
+      dram_state[channel][rank][b].next_refresh =
+        max (end, dram_state[channel][rank][b].next_refresh);
+      dram_state[channel][rank][b].next_powerdown =
+        max (end, dram_state[channel][rank][b].next_powerdown);
       dram_state[channel][rank][b].active_row = -1;
       dram_state[channel][rank][b].state = REFRESHING;
-    } command_issued_current_cycle[channel] = 1;
+    }
+    update_residency (channel, rank);
+    command_issued_current_cycle[channel] = 1;
     return 1;
   }
 }
 
+
+// Function to refresh a single bank (REFRESH_MODE 1). The bank must be
+// precharged, the other banks of the rank carry on.
+  int
+issue_refresh_bank_command (int channel, int rank, int bank) 
+{
+  if (!is_refresh_bank_allowed (channel, rank, bank))
+
+  {
+    fprintf
+      (usimm_out, "PANIC : SCHED_ERROR: REFRESH_BANK command not issuable in cycle:%lld\n",
+       CYCLE_VAL);
+    return 0;
+  }
+  num_issued_bank_refreshes[channel][rank][bank]++;
+  charge_bank_refresh_energy (channel, rank, 1);
+  long long int end = CYCLE_VAL + refresh_cycle_time;
+  dram_state[channel][rank][bank].next_act =
+    max (end, dram_state[channel][rank][bank].next_act);
+  dram_state[channel][rank][bank].next_pre =
+    max (end, dram_state[channel][rank][bank].next_pre);
+  dram_state[channel][rank][bank].next_refresh =
+    max (end, dram_state[channel][rank][bank].next_refresh);
+  dram_state[channel][rank][bank].next_powerdown =
+    max (end, dram_state[channel][rank][bank].next_powerdown);
+  dram_state[channel][rank][bank].active_row = -1;
+  dram_state[channel][rank][bank].state = REFRESHING;
+  update_residency (channel, rank);
+  command_issued_current_cycle[channel] = 1;
+  return 1;
+}
+
+
+// Pause the REF in progress on a rank at the next segment boundary if
+// a read is waiting for the rank. The REF is not counted; the segments
+// done are kept in refresh_progress and the next REF to the rank only
+// does the segments left.
+  static void
+pause_refresh (int channel, int rank) 
+{
+  long long int done = CYCLE_VAL - refresh_start[channel][rank];
+  long long int segment =
+    refresh_cycle_time / PROCESSOR_CLK_MULTIPLIER / REFRESH_PAUSE_SEGMENTS *
+    PROCESSOR_CLK_MULTIPLIER;
+  request_t *rd_ptr = NULL;
+  int read_waiting = 0;
+
+  if (segment == 0)
+    segment = PROCESSOR_CLK_MULTIPLIER;
+  if (done <= 0 || done % segment)
+    return;
+  LL_FOREACH (read_queue_head[channel], rd_ptr)
+  {
+    if (rd_ptr->dram_addr.rank == rank && !rd_ptr->request_served)
+    {
+      read_waiting = 1;
+      break;
+    }
+  }
+  if (!read_waiting)
+    return;
+  refresh_progress[channel][rank] += done;
+  charge_refresh_energy (channel, rank,
+      CYCLE_VAL - refresh_end[channel][rank]);
+  // no REF in progress, refresh_progress is kept for the next one
+  refresh_end[channel][rank] = 0;
+  if (num_issued_refreshes[channel][rank] > 0)
+    num_issued_refreshes[channel][rank]--;
+  stats_num_refresh_pauses[channel][rank]++;
+  for (int b = 0; b < NUM_BANKS; b++)
+  {
+    dram_state[channel][rank][b].next_act = CYCLE_VAL;
+    dram_state[channel][rank][b].next_pre = CYCLE_VAL;
+    dram_state[channel][rank][b].next_refresh = CYCLE_VAL;
+    dram_state[channel][rank][b].next_powerdown = CYCLE_VAL;
+  }
+}
+
   void
 issue_forced_refresh_commands (int channel, int rank) 
 {
@@ -1641,45 +2085,164 @@ issue_forced_refresh_commands (int channel, int rank)
       next_refresh_completion_deadline[channel][rank];
     dram_state[channel][rank][b].next_powerdown =
       next_refresh_completion_deadline[channel][rank];
-  } }   void
+  }
+  update_residency (channel, rank);
+}
 
-gather_stats (int channel) 
-{
-  for (int i = 0; i < NUM_RANKS; i++)
 
-  {
-    if (dram_state[channel][i][0].state == PRECHARGE_POWER_DOWN_SLOW)
-      stats_time_spent_in_precharge_power_down_slow[channel][i] +=
-        PROCESSOR_CLK_MULTIPLIER;
+// A bank reached its per-bank refresh issue deadline: it does its
+// remaining REFpb commands back to back until the end of its window.
+// A powered down rank is woken up for it.
+  static void
+issue_forced_bank_refresh (int channel, int rank, int bank) 
+{
+  long long int end = bank_refresh_completion_deadline[channel][rank][bank];
+  if (dram_state[channel][rank][0].state == PRECHARGE_POWER_DOWN_SLOW
+      || dram_state[channel][rank][0].state == PRECHARGE_POWER_DOWN_FAST
+      || dram_state[channel][rank][0].state == ACTIVE_POWER_DOWN)
+    power_up_rank (channel, rank);
+  dram_state[channel][rank][bank].state = REFRESHING;
+  dram_state[channel][rank][bank].active_row = -1;
+  dram_state[channel][rank][bank].next_act = end;
+  dram_state[channel][rank][bank].next_pre = end;
+  dram_state[channel][rank][bank].next_refresh = end;
+  dram_state[channel][rank][bank].next_powerdown = end;
+  update_residency (channel, rank);
+}
 
-    else if (dram_state[channel][i][0].state == PRECHARGE_POWER_DOWN_FAST)
-      stats_time_spent_in_precharge_power_down_fast[channel][i] +=
-        PROCESSOR_CLK_MULTIPLIER ;
 
-    else if (dram_state[channel][i][0].state == ACTIVE_POWER_DOWN)
-      stats_time_spent_in_active_power_down[channel][i] +=
-        PROCESSOR_CLK_MULTIPLIER;
+// per-bank counterpart of the rank refresh bookkeeping in
+// update_memory (). The rank deadline becomes the earliest bank
+// deadline, which is what the rank-wide commands check.
+  static void
+update_bank_refresh (int channel, int rank) 
+{
+  long long int earliest = bank_refresh_issue_deadline[channel][rank][0];
+  int pending = 0;
+  for (int b = 0; b < NUM_BANKS; b++)
 
-    else
+  {
+    if (CYCLE_VAL == bank_refresh_completion_deadline[channel][rank][b])
 
     {
-      for (int b = 0; b < NUM_BANKS; b++)
+      num_issued_bank_refreshes[channel][rank][b] = 0;
+      bank_refresh_completion_deadline[channel][rank][b] =
+        CYCLE_VAL + 8 * T_REFI;
+      bank_refresh_issue_deadline[channel][rank][b] =
+        bank_refresh_completion_deadline[channel][rank][b] - T_RP -
+        refreshes_per_window * refresh_cycle_time;
+      bank_forced_refresh_mode_on[channel][rank][b] = 0;
+    }
 
-      {
-        if (dram_state[channel][i][b].state == ROW_ACTIVE)
+    else if ((CYCLE_VAL == bank_refresh_issue_deadline[channel][rank][b])
+        && (num_issued_bank_refreshes[channel][rank][b] <
+          refreshes_per_window))
 
-        {
-          stats_time_spent_in_active_standby[channel][i] +=
-            PROCESSOR_CLK_MULTIPLIER;
-          break;
-        }
-      }
-      stats_time_spent_in_power_up[channel][i] +=
-        PROCESSOR_CLK_MULTIPLIER;
+    {
+      bank_forced_refresh_mode_on[channel][rank][b] = 1;
+      charge_bank_refresh_energy (channel, rank, refreshes_per_window -
+          num_issued_bank_refreshes[channel][rank][b]);
+      issue_forced_bank_refresh (channel, rank, b);
     }
+
+    else if (CYCLE_VAL < bank_refresh_issue_deadline[channel][rank][b])
+      bank_refresh_issue_deadline[channel][rank][b] =
+        bank_refresh_completion_deadline[channel][rank][b] - T_RP -
+        max (refreshes_per_window -
+            num_issued_bank_refreshes[channel][rank][b], 0)
+        * refresh_cycle_time;
+    bank_refresh_pending[channel][rank][b] =
+      bank_forced_refresh_mode_on[channel][rank][b] ? 0 :
+      max (refreshes_per_window -
+          num_issued_bank_refreshes[channel][rank][b], 0);
+    pending += bank_refresh_pending[channel][rank][b];
+    if (bank_refresh_issue_deadline[channel][rank][b] < earliest)
+      earliest = bank_refresh_issue_deadline[channel][rank][b];
   }
+  refresh_issue_deadline[channel][rank] = earliest;
+  refresh_pending[channel][rank] = pending;
 }
 
+
+// Power-state residency, charged to the stats_time_spent_in_*
+// counters when a rank's state changes instead of sampled every DRAM
+// cycle. A rank is in power down if bank 0 is, else in active standby
+// if a bank has a row open, else in precharge standby; both standby
+// states count as power up.
+  static residency_t
+rank_residency (int channel, int rank) 
+{
+  switch (dram_state[channel][rank][0].state)
+  {
+    case PRECHARGE_POWER_DOWN_SLOW:
+      return RESIDENCY_PRECHARGE_POWER_DOWN_SLOW;
+    case PRECHARGE_POWER_DOWN_FAST:
+      return RESIDENCY_PRECHARGE_POWER_DOWN_FAST;
+    case ACTIVE_POWER_DOWN:
+      return RESIDENCY_ACTIVE_POWER_DOWN;
+    default:
+      break;
+  }
+  for (int b = 0; b < NUM_BANKS; b++)
+    if (dram_state[channel][rank][b].state == ROW_ACTIVE)
+      return RESIDENCY_ACTIVE_STANDBY;
+  return RESIDENCY_PRECHARGE_STANDBY;
+}
+
+
+// charge the cycles from the rank's last state change to 'until' to
+// its state
+  static void
+charge_residency (int channel, int rank, long long int until) 
+{
+  long long int cycles = until - residency_since[channel][rank];
+
+  switch (residency_state[channel][rank])
+  {
+    case RESIDENCY_PRECHARGE_POWER_DOWN_SLOW:
+      stats_time_spent_in_precharge_power_down_slow[channel][rank] += cycles;
+      break;
+    case RESIDENCY_PRECHARGE_POWER_DOWN_FAST:
+      stats_time_spent_in_precharge_power_down_fast[channel][rank] += cycles;
+      break;
+    case RESIDENCY_ACTIVE_POWER_DOWN:
+      stats_time_spent_in_active_power_down[channel][rank] += cycles;
+      break;
+    case RESIDENCY_ACTIVE_STANDBY:
+      stats_time_spent_in_active_standby[channel][rank] += cycles;
+      stats_time_spent_in_power_up[channel][rank] += cycles;
+      break;
+    default:
+      stats_time_spent_in_power_up[channel][rank] += cycles;
+      break;
+  }
+  charge_background_energy (channel, rank, residency_state[channel][rank],
+      residency_since[channel][rank], cycles);
+  residency_since[channel][rank] = until;
+}
+
+
+// Called after the bank states of a rank change. The state a rank is
+// in at the end of a DRAM cycle counts for the whole cycle.
+  void
+update_residency (int channel, int rank) 
+{
+  residency_t state = rank_residency (channel, rank);
+
+  if (state == residency_state[channel][rank])
+    return;
+  charge_residency (channel, rank, CYCLE_VAL);
+  residency_state[channel][rank] = state;
+}
+
+
+  void
+settle_residency (int channel, int rank) 
+{
+  charge_residency (channel, rank, residency_end);
+}
+
+
   void
 print_stats (int channel) 
 {
@@ -1707,26 +2270,38 @@ print_stats (int channel)
         activates_for_spec += stats_num_activate_spec[c][r][b];
         read_cmds += stats_num_read[c][r][b];
         write_cmds += stats_num_write[c][r][b];
-      } }  printf ("-------- Channel %d Stats-----------\n", c);
-    printf ("Total Reads Serviced :          %-7lld\n",
+      } }  fprintf (usimm_out, "-------- Channel %d Stats-----------\n", c);
+    fprintf (usimm_out, "Total Reads Serviced :          %-7lld\n",
         stats_reads_completed[c]);
-    printf ("Total Writes Serviced :         %-7lld\n",
+    fprintf (usimm_out, "Total Writes Serviced :         %-7lld\n",
         stats_writes_completed[c]);
-    printf ("Average Read Latency :          %7.5f\n",
+    fprintf (usimm_out, "Average Read Latency :          %7.5f\n",
         (double) stats_average_read_latency[c]);
-    printf ("Average Read Queue Latency :    %7.5f\n",
+    fprintf (usimm_out, "Average Read Queue Latency :    %7.5f\n",
         (double) stats_average_read_queue_latency[c]);
-    printf ("Average Write Latency :         %7.5f\n",
+    fprintf (usimm_out, "Average Write Latency :         %7.5f\n",
         (double) stats_average_write_latency[c]);
-    printf ("Average Write Queue Latency :   %7.5f\n",
+    fprintf (usimm_out, "Average Write Queue Latency :   %7.5f\n",
         (double) stats_average_write_queue_latency[c]);
-    printf ("Read Page Hit Rate :            %7.5f\n",
+    fprintf (usimm_out, "Read Page Hit Rate :            %7.5f\n",
         ((double)
          (read_cmds - activates_for_reads -
           activates_for_spec) / read_cmds));
-    printf ("Write Page Hit Rate :           %7.5f\n",
+    fprintf (usimm_out, "Write Page Hit Rate :           %7.5f\n",
         ((double) (write_cmds - activates_for_writes) / write_cmds));
-    printf ("------------------------------------\n");
+    if (REFRESH_PAUSE_SEGMENTS)
+
+    {
+      long long int pauses = 0;
+      for (int r = 0; r < NUM_RANKS; r++)
+        pauses += stats_num_refresh_pauses[c][r];
+      fprintf (usimm_out, "Refresh Pauses :                %-7lld\n", pauses);
+      long long int resumes = 0;
+      for (int r = 0; r < NUM_RANKS; r++)
+        resumes += stats_num_refresh_resumes[c][r];
+      fprintf (usimm_out, "Refresh Resumes :               %-7lld\n", resumes);
+    }
+    fprintf (usimm_out, "------------------------------------\n");
   } }  void
 
 update_issuable_commands (int channel) 
@@ -1745,6 +2320,10 @@ update_issuable_commands (int channel)
       is_powerdown_slow_allowed (channel, rank);
     cmd_refresh_issuable[channel][rank] =
       is_refresh_allowed (channel, rank);
+    if (REFRESH_MODE == PER_BANK_REFRESH)
+      for (int bank = 0; bank < NUM_BANKS; bank++)
+        cmd_refresh_bank_issuable[channel][rank][bank] =
+          is_refresh_bank_allowed (channel, rank, bank);
     cmd_powerup_issuable[channel][rank] =
       is_powerup_allowed (channel, rank);
   } }  
@@ -1754,23 +2333,40 @@ update_issuable_commands (int channel)
   void
 update_memory () 
 {
+  residency_end = CYCLE_VAL + PROCESSOR_CLK_MULTIPLIER;
   for (int channel = 0; channel < NUM_CHANNELS; channel++)
 
   {
 
     // make every channel ready to receive a new command
     command_issued_current_cycle[channel] = 0;
+
+    // the banks of all ranks of a channel are one block
+    memset (cas_issued_current_cycle[channel][0], 0,
+        NUM_RANKS * NUM_BANKS * sizeof (int));
     for (int rank = 0; rank < NUM_RANKS; rank++)
 
     {
 
-      //reset variable
-      for (int bank = 0; bank < NUM_BANKS; bank++)
-        cas_issued_current_cycle[channel][rank][bank] = 0;
+      // a REF issued by the scheduler finished (its paused segments
+      // included) or may be paused
+      if (refresh_end[channel][rank]
+          && CYCLE_VAL >= refresh_end[channel][rank])
+
+      {
+        refresh_progress[channel][rank] = 0;
+        refresh_end[channel][rank] = 0;
+      }
+
+      else if (refresh_end[channel][rank] && REFRESH_PAUSE_SEGMENTS
+          && !forced_refresh_mode_on[channel][rank])
+        pause_refresh (channel, rank);
+      if (REFRESH_MODE == PER_BANK_REFRESH)
 
-      // clean out the activate record for
-      // CYCLE_VAL - T_FAW
-      flush_activate_record (channel, rank, CYCLE_VAL);
+      {
+        update_bank_refresh (channel, rank);
+        continue;
+      }
 
       // if we are at the refresh completion
       // deadline
@@ -1781,24 +2377,30 @@ update_memory ()
         // calculate the next
         // refresh_issue_deadline
         num_issued_refreshes[channel][rank] = 0;
+        // the forced refreshes finished a paused REF
+        refresh_progress[channel][rank] = 0;
         last_refresh_completion_deadline[channel][rank] = CYCLE_VAL;
         next_refresh_completion_deadline[channel][rank] =
           CYCLE_VAL + 8 * T_REFI;
         refresh_issue_deadline[channel][rank] =
           next_refresh_completion_deadline[channel][rank] - T_RP -
-          8 * T_RFC;
+          refreshes_per_window * refresh_cycle_time;
         forced_refresh_mode_on[channel][rank] = 0;
         issued_forced_refresh_commands[channel][rank] = 0;
       }
 
       else if ((CYCLE_VAL == refresh_issue_deadline[channel][rank])
-          && (num_issued_refreshes[channel][rank] < 8))
+          && (num_issued_refreshes[channel][rank] < refreshes_per_window))
 
       {
 
         // refresh_issue_deadline has been
         // reached. Do the auto-refreshes
         forced_refresh_mode_on[channel][rank] = 1;
+        charge_refresh_energy (channel, rank,
+            (long long int) (refreshes_per_window -
+              num_issued_refreshes[channel][rank]) * refresh_cycle_time
+            - refresh_progress[channel][rank]);
         issue_forced_refresh_commands (channel, rank);
       }
 
@@ -1808,12 +2410,13 @@ update_memory ()
 
         //update the refresh_issue deadline
         refresh_issue_deadline[channel][rank] =
-          next_refresh_completion_deadline[channel][rank] - T_RP - (8 -
-              num_issued_refreshes
-              [channel]
-              [rank])
-          * T_RFC;
+          next_refresh_completion_deadline[channel][rank] - T_RP -
+          (refreshes_per_window - num_issued_refreshes[channel][rank])
+          * refresh_cycle_time;
       }
+      refresh_pending[channel][rank] =
+        forced_refresh_mode_on[channel][rank] ? 0 :
+        max (refreshes_per_window - num_issued_refreshes[channel][rank], 0);
     }
 
     // update the variables corresponding to the non-queue
@@ -1904,7 +2507,9 @@ than every tRC, then pds_act will be derated to give "psch_act" (SCHeduled Power
   float total_chip_power;
   float total_rank_power;
   long long int writes = 0, reads = 0;
-  static int print_total_cycles = 0;
+
+  // bring the residency counters up to the end of the simulation
+  settle_residency (channel, rank);
 
   /*----------------------------------------------------
   //Calculating DataSheet Power
@@ -1925,10 +2530,10 @@ than every tRC, then pds_act will be derated to give "psch_act" (SCHeduled Power
   //This is dependent on the termination configuration of the simulated configuration
   //our simulator uses the same config as that used in the Tech Note
   ----------------------------------------------------*/ 
-  pds_dq = 3.2 * 10;
-  pds_termW = 0;
-  pds_termRoth = 24.9 * 10;
-  pds_termWoth = 20.8 * 11;
+  pds_dq = ODT_DQ_MW;
+  pds_termW = ODT_TERM_WRITE_MW;
+  pds_termRoth = ODT_TERM_READ_OTHER_MW;
+  pds_termWoth = ODT_TERM_WRITE_OTHER_MW;
 
   /*----------------------------------------------------
   //Derating worst case power to represent system activity
@@ -1997,8 +2602,14 @@ than every tRC, then pds_act will be derated to give "psch_act" (SCHeduled Power
   /*----------------------------------------------------
   //pds_ref assumes that there is always a refresh happening.
   //in reality, refresh consumes only T_RFC out of every t_REFI
+  //(T_RFC2 out of every T_REFI/2 and T_RFC4 out of every T_REFI/4
+  //with fine granularity refresh). Per-bank refresh refreshes the
+  //same cells and, without a per-bank IDD5, is charged the same.
   ----------------------------------------------------*/ 
-  psch_ref = pds_ref * T_RFC / T_REFI;
+  if (REFRESH_MODE == PER_BANK_REFRESH)
+    psch_ref = pds_ref * T_RFC / T_REFI;
+  else
+    psch_ref = pds_ref * refresh_cycle_time * REFRESH_GRANULARITY / T_REFI;
   psch_dq = pds_dq * (reads * T_DATA_TRANS) / CYCLE_VAL;
   psch_termW = pds_termW * (writes * T_DATA_TRANS) / CYCLE_VAL;
   psch_termRoth =
@@ -2024,29 +2635,29 @@ than every tRC, then pds_act will be derated to give "psch_act" (SCHeduled Power
        stats_time_spent_in_active_power_down[channel][rank])) / CYCLE_VAL);
   if (print_total_cycles == 0)
   {
-    printf
-      ("\n#-----------------------------Simulated Cycles Break-Up-------------------------------------------\n");
-    printf
-      ("Note:  1.(Read Cycles + Write Cycles + Read Other + Write Other) should add up to %% cycles during which\n");
-    printf
-      ("          the channel is busy. This should be the same for all Ranks on a Channel\n");
-    printf
-      ("       2.(PRE_PDN_FAST + PRE_PDN_SLOW + ACT_PDN + ACT_STBY + PRE_STBY) should add up to 100%%\n");
-    printf
-      ("       3.Power Down means Clock Enable, CKE = 0. In Standby mode, CKE = 1\n");
-    printf
-      ("#-------------------------------------------------------------------------------------------------\n");
-    printf ("Total Simulation Cycles                      %11lld\n",
+    fprintf
+      (usimm_out, "\n#-----------------------------Simulated Cycles Break-Up-------------------------------------------\n");
+    fprintf
+      (usimm_out, "Note:  1.(Read Cycles + Write Cycles + Read Other + Write Other) should add up to %% cycles during which\n");
+    fprintf
+      (usimm_out, "          the channel is busy. This should be the same for all Ranks on a Channel\n");
+    fprintf
+      (usimm_out, "       2.(PRE_PDN_FAST + PRE_PDN_SLOW + ACT_PDN + ACT_STBY + PRE_STBY) should add up to 100%%\n");
+    fprintf
+      (usimm_out, "       3.Power Down means Clock Enable, CKE = 0. In Standby mode, CKE = 1\n");
+    fprintf
+      (usimm_out, "#-------------------------------------------------------------------------------------------------\n");
+    fprintf (usimm_out, "Total Simulation Cycles                      %11lld\n",
         CYCLE_VAL);
-    printf
-      ("---------------------------------------------------------------\n\n");
+    fprintf
+      (usimm_out, "---------------------------------------------------------------\n\n");
     print_total_cycles = 1;
   }
   if (print_stats_type == 0)
   {
 
     /*
-       printf ("%3d %6d %13.2f %13.2f %13.2f %13.2f %15.2f %15.2f %15.2f %13.2f %11.2f \n",\
+       fprintf (usimm_out, "%3d %6d %13.2f %13.2f %13.2f %13.2f %15.2f %15.2f %15.2f %13.2f %11.2f \n",\
        channel,\
        rank,\
        (double)reads/CYCLE_VAL,\
@@ -2060,51 +2671,51 @@ than every tRC, then pds_act will be derated to give "psch_act" (SCHeduled Power
        (((double)(CYCLE_VAL - stats_time_spent_in_active_standby[channel][rank]- stats_time_spent_in_precharge_power_down_slow[channel][rank] - stats_time_spent_in_precharge_power_down_fast[channel][rank] - stats_time_spent_in_active_power_down[channel][rank]))/CYCLE_VAL)
        );
        */ 
-    printf
-      ("Channel %d Rank %d Read Cycles(%%)           %9.2f # %% cycles the Rank performed a Read\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d Read Cycles(%%)           %9.2f # %% cycles the Rank performed a Read\n",
        channel, rank, (double) reads * T_DATA_TRANS / CYCLE_VAL);
-    printf
-      ("Channel %d Rank %d Write Cycles(%%)          %9.2f # %% cycles the Rank performed a Write\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d Write Cycles(%%)          %9.2f # %% cycles the Rank performed a Write\n",
        channel, rank, (double) writes * T_DATA_TRANS / CYCLE_VAL);
-    printf
-      ("Channel %d Rank %d Read Other(%%)            %9.2f # %% cycles other Ranks on the channel performed a Read\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d Read Other(%%)            %9.2f # %% cycles other Ranks on the channel performed a Read\n",
        channel, rank,
        ((double)
        stats_time_spent_terminating_reads_from_other_ranks[channel][rank]
        / CYCLE_VAL));
-    printf
-      ("Channel %d Rank %d Write Other(%%)           %9.2f # %% cycles other Ranks on the channel performed a Write\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d Write Other(%%)           %9.2f # %% cycles other Ranks on the channel performed a Write\n",
        channel, rank,
        ((double)
        stats_time_spent_terminating_writes_to_other_ranks[channel][rank]
        / CYCLE_VAL));
-    printf
-      ("Channel %d Rank %d PRE_PDN_FAST(%%)          %9.2f # %% cycles the Rank was in Fast Power Down and all Banks were Precharged\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d PRE_PDN_FAST(%%)          %9.2f # %% cycles the Rank was in Fast Power Down and all Banks were Precharged\n",
        channel, rank,
        ((double)
        stats_time_spent_in_precharge_power_down_fast[channel][rank] /
        CYCLE_VAL));
-    printf
-      ("Channel %d Rank %d PRE_PDN_SLOW(%%)          %9.2f # %% cycles the Rank was in Slow Power Down and all Banks were Precharged\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d PRE_PDN_SLOW(%%)          %9.2f # %% cycles the Rank was in Slow Power Down and all Banks were Precharged\n",
        channel, rank,
        ((double)
        stats_time_spent_in_precharge_power_down_slow[channel][rank] /
        CYCLE_VAL));
-    printf
-      ("Channel %d Rank %d ACT_PDN(%%)               %9.2f # %% cycles the Rank was in Active Power Down and atleast one Bank was Active\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d ACT_PDN(%%)               %9.2f # %% cycles the Rank was in Active Power Down and atleast one Bank was Active\n",
        channel, rank,
        ((double) stats_time_spent_in_active_power_down[channel][rank] /
        CYCLE_VAL));
-    printf
-      ("Channel %d Rank %d ACT_STBY(%%)              %9.2f # %% cycles the Rank was in Standby and atleast one bank was Active\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d ACT_STBY(%%)              %9.2f # %% cycles the Rank was in Standby and atleast one bank was Active\n",
        channel, rank,
        ((double) stats_time_spent_in_active_standby[channel][rank] /
        CYCLE_VAL));
-    printf
-      ("Channel %d Rank %d PRE_STBY(%%)              %9.2f # %% cycles the Rank was in Standby and all Banks were Precharged\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d PRE_STBY(%%)              %9.2f # %% cycles the Rank was in Standby and all Banks were Precharged\n",
        channel, rank, time_in_pre_stby);
-    printf
-      ("---------------------------------------------------------------\n\n");
+    fprintf
+      (usimm_out, "---------------------------------------------------------------\n\n");
   }
   else if (print_stats_type == 1)
   {
@@ -2112,46 +2723,46 @@ than every tRC, then pds_act will be derated to give "psch_act" (SCHeduled Power
     /*----------------------------------------------------
     // Total Power is the sum total of all the components calculated above
     ----------------------------------------------------*/ 
-    printf
-      ("Channel %d Rank %d Background(mw)          %9.2f # depends only on Power Down time and time all banks were precharged\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d Background(mw)          %9.2f # depends only on Power Down time and time all banks were precharged\n",
        channel, rank,
        psch_act_pdn + psch_act_stby + psch_pre_pdn_slow +
        psch_pre_pdn_fast + psch_pre_stby);
-    printf
-      ("Channel %d Rank %d Act(mW)                 %9.2f # power spend bringing data to the row buffer\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d Act(mW)                 %9.2f # power spend bringing data to the row buffer\n",
        channel, rank, psch_act);
-    printf
-      ("Channel %d Rank %d Read(mW)                %9.2f # power spent doing a Read  after the Row Buffer is open\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d Read(mW)                %9.2f # power spent doing a Read  after the Row Buffer is open\n",
        channel, rank, psch_rd);
-    printf
-      ("Channel %d Rank %d Write(mW)               %9.2f # power spent doing a Write after the Row Buffer is open\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d Write(mW)               %9.2f # power spent doing a Write after the Row Buffer is open\n",
        channel, rank, psch_wr);
-    printf
-      ("Channel %d Rank %d Read Terminate(mW)      %9.2f # power dissipated in ODT resistors during Read\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d Read Terminate(mW)      %9.2f # power dissipated in ODT resistors during Read\n",
        channel, rank, psch_dq);
-    printf
-      ("Channel %d Rank %d Write Terminate(mW)     %9.2f # power dissipated in ODT resistors during Write\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d Write Terminate(mW)     %9.2f # power dissipated in ODT resistors during Write\n",
        channel, rank, psch_termW);
-    printf
-      ("Channel %d Rank %d termRoth(mW)            %9.2f # power dissipated in ODT resistors during Reads  in other ranks\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d termRoth(mW)            %9.2f # power dissipated in ODT resistors during Reads  in other ranks\n",
        channel, rank, psch_termRoth);
-    printf
-      ("Channel %d Rank %d termWoth(mW)            %9.2f # power dissipated in ODT resistors during Writes in other ranks\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d termWoth(mW)            %9.2f # power dissipated in ODT resistors during Writes in other ranks\n",
        channel, rank, psch_termWoth);
-    printf
-      ("Channel %d Rank %d Refresh(mW)             %9.2f # depends on frequency of Refresh (tREFI)\n",
+    fprintf
+      (usimm_out, "Channel %d Rank %d Refresh(mW)             %9.2f # depends on frequency of Refresh (tREFI)\n",
        channel, rank, psch_ref);
-    printf
-      ("---------------------------------------------------------------\n");
-    printf
-      ("Channel %d Rank %d Total Rank Power(mW)    %9.2f # (Sum of above components)*(num chips in each Rank)\n",
+    fprintf
+      (usimm_out, "---------------------------------------------------------------\n");
+    fprintf
+      (usimm_out, "Channel %d Rank %d Total Rank Power(mW)    %9.2f # (Sum of above components)*(num chips in each Rank)\n",
        channel, rank, total_rank_power);
-    printf
-      ("---------------------------------------------------------------\n\n");
+    fprintf
+      (usimm_out, "---------------------------------------------------------------\n\n");
 
     /*
 
-       printf("%3d %11d %16.2f %16.2f %17.2f %13.2f %13.2f %20.2f %21.2f %24.2f %12.2f %13.2f\n",\
+       fprintf(usimm_out, "%3d %11d %16.2f %16.2f %17.2f %13.2f %13.2f %20.2f %21.2f %24.2f %12.2f %13.2f\n",\
        channel,\
        rank,\
        total_rank_power, \
@@ -2169,19 +2780,19 @@ than every tRC, then pds_act will be derated to give "psch_act" (SCHeduled Power
        */ 
 
     /*
-       printf("Channel:%d Rank:%d Total background power : %f mW\n", channel, rank, psch_act_pdn+psch_act_stby+psch_pre_pdn_slow+psch_pre_pdn_fast+psch_pre_stby);
-       printf("Channel:%d, Rank:%d Total activate power : %f,%f,%d,%f mW\n", channel, rank, psch_act,pds_act,T_RC,average_gap_between_activates[channel][rank]);
-       printf("Channel:%d, Rank:%d Total I/O and termination power: %f rd:%f wr:%f dq:%f termW:%f termRoth:%f termWoth:%f mW\n", channel, rank, psch_rd+psch_wr+psch_dq+psch_termW+psch_termRoth+psch_termWoth, psch_rd, psch_wr, psch_dq, psch_termW, psch_termRoth, psch_termWoth);
+       fprintf(usimm_out, "Channel:%d Rank:%d Total background power : %f mW\n", channel, rank, psch_act_pdn+psch_act_stby+psch_pre_pdn_slow+psch_pre_pdn_fast+psch_pre_stby);
+       fprintf(usimm_out, "Channel:%d, Rank:%d Total activate power : %f,%f,%d,%f mW\n", channel, rank, psch_act,pds_act,T_RC,average_gap_between_activates[channel][rank]);
+       fprintf(usimm_out, "Channel:%d, Rank:%d Total I/O and termination power: %f rd:%f wr:%f dq:%f termW:%f termRoth:%f termWoth:%f mW\n", channel, rank, psch_rd+psch_wr+psch_dq+psch_termW+psch_termRoth+psch_termWoth, psch_rd, psch_wr, psch_dq, psch_termW, psch_termRoth, psch_termWoth);
 
-       printf("Channel:%d, Rank:%d Total refresh power: %f mW\n", channel, rank, psch_ref);
-       printf("Channel:%d, Rank:%d Total Rank power: %f mW\n\n", channel, rank, total_rank_power);
-       printf("------------------------------------------------\n");
+       fprintf(usimm_out, "Channel:%d, Rank:%d Total refresh power: %f mW\n", channel, rank, psch_ref);
+       fprintf(usimm_out, "Channel:%d, Rank:%d Total Rank power: %f mW\n\n", channel, rank, total_rank_power);
+       fprintf(usimm_out, "------------------------------------------------\n");
        */ 
   }
   else
   {
-    printf
-      ("PANIC: FN_CALL_ERROR: In calculate_power(), print_stats_type can only be 1 or 0\n");
+    fprintf
+      (usimm_out, "PANIC: FN_CALL_ERROR: In calculate_power(), print_stats_type can only be 1 or 0\n");
     assert (-1);
   }
   return total_rank_power;
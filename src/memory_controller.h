@@ -1,13 +1,19 @@
 #ifndef __MEMORY_CONTROLLER_H__
 #define __MEMORY_CONTROLLER_H__
 
-#define MAX_NUM_CHANNELS 16
-#define MAX_NUM_RANKS 16
-#define MAX_NUM_BANKS 32
+#include <stddef.h>
+
+#include "usimm.h"
+
+// All per-channel, per-rank and per-bank state below is sized from
+// NUM_CHANNELS, NUM_RANKS and NUM_BANKS by init_memory_controller_vars().
+// The [rank] and [rank][bank] arrays of one channel are carved out of a
+// single per-channel arena, so x[channel][rank][bank] indexing works as
+// before and a channel's state stays together in memory.
 
 // Moved here from main.c 
-long long int *committed; // total committed instructions in each core
-long long int *fetched;   // total fetched instructions in each core
+USIMM_GLOBAL long long int *committed; // total committed instructions in each core
+USIMM_GLOBAL long long int *fetched;   // total fetched instructions in each core
 
 
 //////////////////////////////////////////////////
@@ -21,6 +27,7 @@ typedef struct draddr
   int channel;	// channel id
   int rank;	// rank id
   int bank;	// bank id
+  int bank_group;	// bank group id, bank % NUM_BANK_GROUPS
   long long int row;	// row/page id
   int column;	// column id
 } dram_address_t;
@@ -31,6 +38,17 @@ typedef enum {ACT_CMD, COL_READ_CMD, PRE_CMD, COL_WRITE_CMD, PWR_DN_SLOW_CMD, PW
 // Request Types
 typedef enum {READ, WRITE} optype_t;
 
+// How a request found its bank, set by the first DRAM command issued
+// for it (see page_policy.h)
+typedef enum {ROW_EVENT_NONE, ROW_HIT, ROW_MISS, ROW_CONFLICT} row_event_t;
+
+// Why a request's next command was not issued in a DRAM cycle (see
+// stall.h). update_read_queue_commands () and
+// update_write_queue_commands () set the timing causes, or STALL_NONE
+// if the command is issuable; issue_request_command () sets
+// STALL_ISSUED.
+typedef enum {STALL_NONE, STALL_ACTIVATE, STALL_FAW, STALL_REFRESH, STALL_COLUMN, STALL_PRECHARGE, STALL_POWER_UP, STALL_ISSUED, STALL_COMMAND_BUS, STALL_SCHEDULER, NUM_STALL_CAUSES} stall_cause_t;
+
 // Single request structure self-explanatory
 typedef struct req
 {
@@ -47,6 +65,10 @@ typedef struct req
   int request_served; // if request has it's final command issued or not
   int instruction_id; // 0 to ROBSIZE-1
   long long int instruction_pc; // phy address of instruction that generated this request (valid only for reads)
+  row_event_t row_event; // row hit, miss or conflict
+  stall_cause_t stall_cause; // why its next command waits this cycle
+  long long int interference; // cycles other threads delayed this request
+  int prefetch; // a prefetch read, with no ROB entry (see prefetch.h)
   void * user_ptr; // user_specified data
   struct req * next;
 } request_t;
@@ -72,82 +94,113 @@ typedef struct bnk
 }bank_t;
 
 // contains the states of all banks in the system 
-bank_t dram_state[MAX_NUM_CHANNELS][MAX_NUM_RANKS][MAX_NUM_BANKS];
+USIMM_GLOBAL bank_t ***dram_state;
 
 // command issued this cycle to this channel
-int command_issued_current_cycle[MAX_NUM_CHANNELS];
+USIMM_GLOBAL int *command_issued_current_cycle;
+
+// rank and bank of the last column command on each channel (-1 before the first)
+USIMM_GLOBAL int *last_cas_rank;
+USIMM_GLOBAL int *last_cas_bank;
 
 // cas command issued this cycle to this channel
-int cas_issued_current_cycle[MAX_NUM_CHANNELS][MAX_NUM_RANKS][MAX_NUM_BANKS]; // 1/2 for COL_READ/COL_WRITE
+USIMM_GLOBAL int ***cas_issued_current_cycle; // 1/2 for COL_READ/COL_WRITE
 
 // Per channel read queue
-request_t * read_queue_head[MAX_NUM_CHANNELS];
+USIMM_GLOBAL request_t **read_queue_head;
 
 // Per channel write queue
-request_t * write_queue_head[MAX_NUM_CHANNELS];
+USIMM_GLOBAL request_t **write_queue_head;
 
 // issuables_for_different commands
-int cmd_precharge_issuable[MAX_NUM_CHANNELS][MAX_NUM_RANKS][MAX_NUM_BANKS];
-int cmd_all_bank_precharge_issuable[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-int cmd_powerdown_fast_issuable[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-int cmd_powerdown_slow_issuable[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-int cmd_powerup_issuable[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-int cmd_refresh_issuable[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
+USIMM_GLOBAL int ***cmd_precharge_issuable;
+USIMM_GLOBAL int **cmd_all_bank_precharge_issuable;
+USIMM_GLOBAL int **cmd_powerdown_fast_issuable;
+USIMM_GLOBAL int **cmd_powerdown_slow_issuable;
+USIMM_GLOBAL int **cmd_powerup_issuable;
+USIMM_GLOBAL int **cmd_refresh_issuable;
+USIMM_GLOBAL int ***cmd_refresh_bank_issuable;
 
 
-// refresh variables
-long long int next_refresh_completion_deadline[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-long long int last_refresh_completion_deadline[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-int forced_refresh_mode_on[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-int refresh_issue_deadline[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-int issued_forced_refresh_commands[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-int num_issued_refreshes[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
+// REFRESH_MODE values
+#define ALL_BANK_REFRESH 0
+#define PER_BANK_REFRESH 1
 
-long long int read_queue_length[MAX_NUM_CHANNELS];
-long long int write_queue_length[MAX_NUM_CHANNELS];
+// refresh variables
+USIMM_GLOBAL long long int **next_refresh_completion_deadline;
+USIMM_GLOBAL long long int **last_refresh_completion_deadline;
+USIMM_GLOBAL int **forced_refresh_mode_on;
+USIMM_GLOBAL int **refresh_issue_deadline;
+USIMM_GLOBAL int **issued_forced_refresh_commands;
+USIMM_GLOBAL int **num_issued_refreshes;
+
+// REF commands the rank still owes in its current refresh window, not
+// counting those a forced refresh is doing (REFpb commands summed over
+// the banks in per-bank refresh mode)
+USIMM_GLOBAL int **refresh_pending;
+
+// per-bank refresh (REFRESH_MODE 1): every bank has its own window,
+// deadline and forced refresh
+USIMM_GLOBAL long long int ***bank_refresh_completion_deadline;
+USIMM_GLOBAL long long int ***bank_refresh_issue_deadline;
+USIMM_GLOBAL int ***bank_forced_refresh_mode_on;
+USIMM_GLOBAL int ***num_issued_bank_refreshes;
+USIMM_GLOBAL int ***bank_refresh_pending;
+
+// refresh pausing (REFRESH_PAUSE_SEGMENTS): the cycles in which the
+// REF in progress refreshes, and the cycles of a paused REF already
+// done that the next REF to the rank does not repeat
+USIMM_GLOBAL long long int **refresh_start;
+USIMM_GLOBAL long long int **refresh_end;
+USIMM_GLOBAL long long int **refresh_progress;
+
+USIMM_GLOBAL long long int *read_queue_length;
+USIMM_GLOBAL long long int *write_queue_length;
 
 // Stats
-long long int num_read_merge ;
-long long int num_write_merge ;
-long long int stats_reads_merged_per_channel[MAX_NUM_CHANNELS];
-long long int stats_writes_merged_per_channel[MAX_NUM_CHANNELS];
-long long int stats_reads_seen[MAX_NUM_CHANNELS];
-long long int stats_writes_seen[MAX_NUM_CHANNELS];
-long long int stats_reads_completed[MAX_NUM_CHANNELS];
-long long int stats_writes_completed[MAX_NUM_CHANNELS];
-
-double stats_average_read_latency[MAX_NUM_CHANNELS];
-double stats_average_read_queue_latency[MAX_NUM_CHANNELS];
-double stats_average_write_latency[MAX_NUM_CHANNELS];
-double stats_average_write_queue_latency[MAX_NUM_CHANNELS];
-
-long long int stats_page_hits[MAX_NUM_CHANNELS];
-double stats_read_row_hit_rate[MAX_NUM_CHANNELS];
+USIMM_GLOBAL long long int num_read_merge ;
+USIMM_GLOBAL long long int num_write_merge ;
+USIMM_GLOBAL long long int *stats_reads_merged_per_channel;
+USIMM_GLOBAL long long int *stats_writes_merged_per_channel;
+USIMM_GLOBAL long long int *stats_reads_seen;
+USIMM_GLOBAL long long int *stats_writes_seen;
+USIMM_GLOBAL long long int *stats_reads_completed;
+USIMM_GLOBAL long long int *stats_writes_completed;
+
+USIMM_GLOBAL double *stats_average_read_latency;
+USIMM_GLOBAL double *stats_average_read_queue_latency;
+USIMM_GLOBAL double *stats_average_write_latency;
+USIMM_GLOBAL double *stats_average_write_queue_latency;
+
+USIMM_GLOBAL long long int *stats_page_hits;
+USIMM_GLOBAL double *stats_read_row_hit_rate;
 
 // Time spent in various states
-long long int stats_time_spent_in_active_standby[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-long long int stats_time_spent_in_active_power_down[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-long long int stats_time_spent_in_precharge_power_down_fast[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-long long int stats_time_spent_in_precharge_power_down_slow[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-long long int stats_time_spent_in_power_up[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-long long int last_activate[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-long long int last_refresh[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-double average_gap_between_activates[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-double average_gap_between_refreshes[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-long long int stats_time_spent_terminating_reads_from_other_ranks[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-long long int stats_time_spent_terminating_writes_to_other_ranks[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
+USIMM_GLOBAL long long int **stats_time_spent_in_active_standby;
+USIMM_GLOBAL long long int **stats_time_spent_in_active_power_down;
+USIMM_GLOBAL long long int **stats_time_spent_in_precharge_power_down_fast;
+USIMM_GLOBAL long long int **stats_time_spent_in_precharge_power_down_slow;
+USIMM_GLOBAL long long int **stats_time_spent_in_power_up;
+USIMM_GLOBAL long long int **last_activate;
+USIMM_GLOBAL long long int **last_refresh;
+USIMM_GLOBAL double **average_gap_between_activates;
+USIMM_GLOBAL double **average_gap_between_refreshes;
+USIMM_GLOBAL long long int **stats_time_spent_terminating_reads_from_other_ranks;
+USIMM_GLOBAL long long int **stats_time_spent_terminating_writes_to_other_ranks;
 
 // Command Counters
-long long int stats_num_activate_read[MAX_NUM_CHANNELS][MAX_NUM_RANKS][MAX_NUM_BANKS];
-long long int stats_num_activate_write[MAX_NUM_CHANNELS][MAX_NUM_RANKS][MAX_NUM_BANKS];
-long long int stats_num_activate_spec[MAX_NUM_CHANNELS][MAX_NUM_RANKS][MAX_NUM_BANKS];
-long long int stats_num_activate[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-long long int stats_num_precharge[MAX_NUM_CHANNELS][MAX_NUM_RANKS][MAX_NUM_BANKS];
-long long int stats_num_read[MAX_NUM_CHANNELS][MAX_NUM_RANKS][MAX_NUM_BANKS];
-long long int stats_num_write[MAX_NUM_CHANNELS][MAX_NUM_RANKS][MAX_NUM_BANKS];
-long long int stats_num_powerdown_slow[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-long long int stats_num_powerdown_fast[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-long long int stats_num_powerup[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
+USIMM_GLOBAL long long int ***stats_num_activate_read;
+USIMM_GLOBAL long long int ***stats_num_activate_write;
+USIMM_GLOBAL long long int ***stats_num_activate_spec;
+USIMM_GLOBAL long long int **stats_num_activate;
+USIMM_GLOBAL long long int ***stats_num_precharge;
+USIMM_GLOBAL long long int ***stats_num_read;
+USIMM_GLOBAL long long int ***stats_num_write;
+USIMM_GLOBAL long long int **stats_num_powerdown_slow;
+USIMM_GLOBAL long long int **stats_num_powerdown_fast;
+USIMM_GLOBAL long long int **stats_num_powerup;
+USIMM_GLOBAL long long int **stats_num_refresh_pauses;
+USIMM_GLOBAL long long int **stats_num_refresh_resumes;
 
 
 
@@ -155,9 +208,23 @@ long long int stats_num_powerup[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
 
 // to get log with base 2
 unsigned int log_base2(unsigned int new_value);
+unsigned int ceil_log2(unsigned int new_value);
+
+// bank group helpers (see NUM_BANK_GROUPS in params.h)
+int get_bank_group(int bank);
+int is_same_bank_group(int bank1, int bank2);
+
+// 1 if the request's column command would switch bank group (or rank)
+// relative to the last column command on its channel, i.e. is only
+// held off by T_CCD_S rather than T_CCD_L
+int is_cas_to_other_bank_group(request_t * request);
+
+// CAS-to-CAS gap after the channel's last column command for a column
+// command to this bank (T_CCD_L, T_CCD_S or the rank switch time)
+int get_cas_to_cas_gap(int channel, int rank, int bank);
 
-// initialize memory_controller variables
-void init_memory_controller_vars();
+// initialize memory_controller variables; -1 if they cannot be allocated
+int init_memory_controller_vars();
 
 // called every cycle to update the read/write queues
 void update_memory();
@@ -186,6 +253,12 @@ int is_powerup_allowed(int channel,int rank);
 // refresh allowed or not
 int is_refresh_allowed(int channel,int rank);
 
+// per-bank refresh allowed or not
+int is_refresh_bank_allowed(int channel,int rank,int bank);
+
+// duration of one REF (T_RFC, T_RFC2 or T_RFC4) or REFpb (T_RFCPB)
+int get_refresh_cycle_time();
+
 
 // issues command to make progress on a request
 int issue_request_command(request_t * req);
@@ -208,6 +281,9 @@ int issue_all_bank_precharge_command(int channel, int rank);
 // refresh all banks
 int issue_refresh_command(int channel, int rank);
 
+// refresh one bank (REFRESH_MODE 1)
+int issue_refresh_bank_command(int channel, int rank, int bank);
+
 // autoprecharge all banks
 int issue_autoprecharge(int channel, int rank, int bank);
 
@@ -223,12 +299,47 @@ request_t* insert_read(long long int physical_address, long long int arrival_cyc
 // enqueue a write into the corresponding write queue (returns ptr to new_node)
 request_t* insert_write(long long int physical_address, long long int arrival_time, int thread_id, int instruction_id);
 
-// update stats counters
-void gather_stats(int channel);
+// zeroed [NUM_CHANNELS][NUM_RANKS] and [NUM_CHANNELS][NUM_RANKS][NUM_BANKS]
+// tables of 'size'-byte elements, for per-rank and per-bank scheduler state
+void *alloc_rank_table(size_t size);
+void *alloc_bank_table(size_t size);
+
+// zeroed memory for state that lasts the whole simulation, like calloc ()
+// and realloc (); free_system_memory () releases all of it when the
+// system is torn down (see usimm_free_system ())
+void *alloc_system_memory(size_t count, size_t size);
+void *realloc_system_memory(void *memory, size_t size);
+void free_system_memory();
+
+// power states a rank's time is accounted to (see update_residency)
+typedef enum
+{
+  RESIDENCY_PRECHARGE_STANDBY, RESIDENCY_ACTIVE_STANDBY,
+  RESIDENCY_PRECHARGE_POWER_DOWN_SLOW, RESIDENCY_PRECHARGE_POWER_DOWN_FAST,
+  RESIDENCY_ACTIVE_POWER_DOWN
+} residency_t;
+
+// account the time of a rank in its power state after its bank states
+// change (the stats_time_spent_in_* counters are up to date in
+// calculate_power)
+void update_residency(int channel, int rank);
+
+// charge the time of a rank in its power state up to the end of the
+// last DRAM cycle simulated
+void settle_residency(int channel, int rank);
 
 // print statistics
 void print_stats();
 
+// On die termination power per chip in mW, from the Micron technical
+// note whose termination configuration the simulator uses: the DQ of
+// a read, the rank being written, and the other ranks of the channel
+// during a read and a write (used by calculate_power and energy.c)
+#define ODT_DQ_MW (3.2 * 10)
+#define ODT_TERM_WRITE_MW 0
+#define ODT_TERM_READ_OTHER_MW (24.9 * 10)
+#define ODT_TERM_WRITE_OTHER_MW (20.8 * 11)
+
 // calculate power for each channel
 float calculate_power(int channel, int rank, int print_stats_type, int chips_per_rank);
 #endif // __MEM_CONTROLLER_HH__
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "params.h"
+#include "memory_controller.h"
+#include "open_loop.h"
+
+extern USIMM_STATE long long int CYCLE_VAL;
+
+#define MAXLINESIZE 64
+
+typedef struct
+{
+  // the next request of the trace
+  int have_request;
+  int done;
+  long long int cycle;
+  char type;
+  long long int address;
+  long long int pc;
+  // stats
+  long long int reads;
+  long long int writes;
+  long long int reads_merged;
+  long long int writes_merged;
+  long long int late;		// arrival cycle before the previous one's
+  long long int first_cycle;
+  long long int last_cycle;
+} injector_t;
+
+static USIMM_STATE injector_t *injectors;
+
+
+  int
+init_open_loop ()
+{
+  if (TRACE_FORMAT != USIMM_TRACE && TRACE_FORMAT != TIMESTAMPED_TRACE)
+  {
+    fprintf (usimm_out, "PANIC: unknown TRACE_FORMAT %d\n", TRACE_FORMAT);
+    return -1;
+  }
+  injectors = alloc_system_memory (NUMCORES, sizeof (injector_t));
+  for (int c = 0; c < NUMCORES; c++)
+    injectors[c].first_cycle = -1;
+  return 0;
+}
+
+
+// 1 if a request was read, 0 at the end of the trace, -1 on a bad line
+  static int
+read_request (injector_t * in, FILE * trace)
+{
+  char line[MAXLINESIZE];
+
+  if (!fgets (line, MAXLINESIZE, trace))
+    return 0;
+  in->pc = 0;
+  if (sscanf (line, "%lld %c %Lx %Lx", &in->cycle, &in->type, &in->address,
+        &in->pc) < 3 || (in->type != 'R' && in->type != 'W'))
+    return -1;
+  return 1;
+}
+
+
+  static void
+inject (int core, injector_t * in, long long int address)
+{
+  if (in->type == 'R')
+  {
+    in->reads++;
+    if (read_matches_write_or_read_queue (address))
+      in->reads_merged++;
+    else
+      insert_read (address, CYCLE_VAL, core, -1, in->pc);
+  }
+  else
+  {
+    in->writes++;
+    if (write_exists_in_write_queue (address))
+      in->writes_merged++;
+    else
+      insert_write (address, CYCLE_VAL, core, -1);
+  }
+  fetched[core]++;
+  committed[core]++;
+}
+
+
+  int
+inject_open_loop (int core, FILE * trace, long long int prefix)
+{
+  injector_t *in = &injectors[core];
+
+  while (!in->done)
+  {
+    if (!in->have_request)
+    {
+      int status = read_request (in, trace);
+      if (status < 0)
+        return -1;
+      if (!status)
+      {
+        in->done = 1;
+        break;
+      }
+      in->have_request = 1;
+      if (in->cycle < in->last_cycle)
+        in->late++;
+      if (in->first_cycle < 0)
+        in->first_cycle = in->cycle;
+      if (in->cycle > in->last_cycle)
+        in->last_cycle = in->cycle;
+    }
+    if (in->cycle > CYCLE_VAL)
+      return 0;
+    inject (core, in, in->address + prefix);
+    in->have_request = 0;
+  }
+  return 1;
+}
+
+
+  void
+print_open_loop_stats ()
+{
+  if (TRACE_FORMAT != TIMESTAMPED_TRACE)
+    return;
+  fprintf (usimm_out, "------------------------------------\n");
+  fprintf (usimm_out, "Open-loop injection\n");
+  for (int c = 0; c < NUMCORES; c++)
+  {
+    injector_t *in = &injectors[c];
+    long long int requests = in->reads + in->writes;
+    long long int span =
+      in->first_cycle < 0 ? 0 : in->last_cycle - in->first_cycle + 1;
+    fprintf (usimm_out, "Core %d: reads %lld (merged %lld), writes %lld (merged %lld), out of order %lld\n",
+        c, in->reads, in->reads_merged, in->writes, in->writes_merged,
+        in->late);
+    fprintf (usimm_out, "Core %d: arrivals from cycle %lld to %lld, offered load %.3f requests per 1000 cycles\n",
+        c, in->first_cycle, in->last_cycle,
+        span ? 1000.0 * requests / span : 0.0);
+  }
+}
@@ -0,0 +1,46 @@
+#ifndef __OPEN_LOOP_H__
+#define __OPEN_LOOP_H__
+
+#include <stdio.h>
+
+// Open-loop injection of timestamped traces.
+//
+// USIMM traces are fetched through the ROB (closed loop): a core stalls
+// when its ROB or a write queue fills, so the memory system sets the
+// pace of the trace. Traces captured from accelerators, NICs or DMA
+// engines give the time each request was issued instead, and the load
+// they offer should not depend on how fast memory answers. With
+//
+//   TRACE_FORMAT  1
+//
+// in the config file every trace line is
+//
+//   <cycle> R <address> [<pc>]
+//   <cycle> W <address>
+//
+// with the CPU cycle at which the request arrives (in decimal,
+// non-decreasing) and a hex address, as in USIMM traces. A request is
+// added to the read or write queue at its cycle whatever the state of
+// the queues, so write queues may grow past WQ_CAPACITY. Reads of a
+// line in the write or read queue and writes of a line in the write
+// queue are merged as usual. There is no ROB, core model, LLC or
+// prefetcher. A trace is done at its last request and the simulation
+// ends once the read and write queues have drained.
+//
+// The requests each trace injected, the span of its arrival cycles and
+// the load it offered are printed at the end.
+
+#define USIMM_TRACE 0
+#define TIMESTAMPED_TRACE 1
+
+// -1 if TRACE_FORMAT is unknown
+int init_open_loop ();
+
+// inject the requests of 'core' that arrive by this cycle, adding
+// 'prefix' to their addresses; 0 while the trace has requests left, 1
+// once it is done, -1 on a bad line
+int inject_open_loop (int core, FILE * trace, long long int prefix);
+
+void print_open_loop_stats ();
+
+#endif // __OPEN_LOOP_H__
@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "utlist.h"
+
+#include "params.h"
+#include "memory_controller.h"
+#include "page_policy.h"
+
+extern USIMM_STATE long long int CYCLE_VAL;
+
+// row of the last column access to each bank, -1 if none
+static USIMM_STATE long long int ***last_row;
+// cycle of the last column access to, or ACT of, the open row
+static USIMM_STATE long long int ***last_use;
+// 2-bit open/close predictor
+static USIMM_STATE int ***open_counter;
+// column accesses to the open row
+static USIMM_STATE int ***open_accesses;
+
+static USIMM_STATE long long int ***stats_num_premature_closes;
+static USIMM_STATE long long int **stats_num_policy_precharges;
+
+static int close_always (int channel, int rank, int bank);
+static int close_unused (int channel, int rank, int bank);
+static int close_predicted (int channel, int rank, int bank);
+static int close_capped (int channel, int rank, int bank);
+
+typedef struct
+{
+  const char *name;
+  int (*close_after_cas) (int channel, int rank, int bank);
+  int (*close_when_idle) (int channel, int rank, int bank);
+} page_policy_t;
+
+static page_policy_t page_policies[] = {
+  {"none", NULL, NULL},
+  {"open", NULL, NULL},
+  {"close", close_always, NULL},
+  {"timeout", NULL, close_unused},
+  {"predictive", close_predicted, NULL},
+  {"capped", close_capped, NULL},
+};
+
+#define NUM_PAGE_POLICIES \
+  ((int) (sizeof (page_policies) / sizeof (page_policies[0])))
+
+
+  int
+init_page_policy ()
+{
+  if (PAGE_POLICY < 0 || PAGE_POLICY >= NUM_PAGE_POLICIES)
+  {
+    fprintf (usimm_out, "PANIC: unknown PAGE_POLICY %d\n", PAGE_POLICY);
+    return -1;
+  }
+  page_policy_mode = alloc_system_memory (NUM_CHANNELS, sizeof (int));
+  last_row = alloc_bank_table (sizeof (long long int));
+  last_use = alloc_bank_table (sizeof (long long int));
+  open_counter = alloc_bank_table (sizeof (int));
+  open_accesses = alloc_bank_table (sizeof (int));
+  stats_num_row_hits = alloc_bank_table (sizeof (long long int));
+  stats_num_row_misses = alloc_bank_table (sizeof (long long int));
+  stats_num_row_conflicts = alloc_bank_table (sizeof (long long int));
+  stats_num_premature_closes = alloc_bank_table (sizeof (long long int));
+  stats_num_policy_precharges = alloc_rank_table (sizeof (long long int));
+  for (int c = 0; c < NUM_CHANNELS; c++)
+  {
+    page_policy_mode[c] = PAGE_POLICY;
+    for (int r = 0; r < NUM_RANKS; r++)
+      for (int b = 0; b < NUM_BANKS; b++)
+      {
+        last_row[c][r][b] = -1;
+        open_counter[c][r][b] = 2;
+      }
+  }
+  return 0;
+}
+
+
+  int
+set_page_policy (int channel, int policy)
+{
+  if (policy < 0 || policy >= NUM_PAGE_POLICIES)
+  {
+    fprintf (usimm_out, "PANIC: unknown page policy %d\n", policy);
+    return -1;
+  }
+  page_policy_mode[channel] = policy;
+  return 0;
+}
+
+
+  void
+observe_page_command (request_t * request, command_t cmd)
+{
+  int channel = request->dram_addr.channel;
+  int rank = request->dram_addr.rank;
+  int bank = request->dram_addr.bank;
+  long long int row = request->dram_addr.row;
+  int *counter = &open_counter[channel][rank][bank];
+
+  if (cmd != ACT_CMD && cmd != PRE_CMD && cmd != COL_READ_CMD
+      && cmd != COL_WRITE_CMD)
+    return;
+  if (request->row_event == ROW_EVENT_NONE)
+  {
+    if (cmd == PRE_CMD)
+    {
+      request->row_event = ROW_CONFLICT;
+      stats_num_row_conflicts[channel][rank][bank]++;
+      *counter = *counter > 0 ? *counter - 1 : 0;
+    }
+    else if (cmd == ACT_CMD)
+    {
+      request->row_event = ROW_MISS;
+      stats_num_row_misses[channel][rank][bank]++;
+      if (row == last_row[channel][rank][bank])
+      {
+        stats_num_premature_closes[channel][rank][bank]++;
+        *counter = *counter < 3 ? *counter + 1 : 3;
+      }
+      else if (last_row[channel][rank][bank] >= 0)
+        *counter = *counter > 0 ? *counter - 1 : 0;
+    }
+    else
+    {
+      request->row_event = ROW_HIT;
+      stats_num_row_hits[channel][rank][bank]++;
+      *counter = *counter < 3 ? *counter + 1 : 3;
+    }
+  }
+  if (cmd == ACT_CMD)
+    observe_page_activate (channel, rank, bank);
+  if (cmd == COL_READ_CMD || cmd == COL_WRITE_CMD)
+  {
+    last_row[channel][rank][bank] = row;
+    last_use[channel][rank][bank] = CYCLE_VAL;
+    open_accesses[channel][rank][bank]++;
+  }
+}
+
+
+  void
+observe_page_activate (int channel, int rank, int bank)
+{
+  last_use[channel][rank][bank] = CYCLE_VAL;
+  open_accesses[channel][rank][bank] = 0;
+}
+
+
+// is a queued request still waiting for the row
+  static int
+row_wanted (int channel, int rank, int bank, long long int row)
+{
+  request_t *ptr = NULL;
+  LL_FOREACH (read_queue_head[channel], ptr)
+  {
+    if (!ptr->request_served && ptr->dram_addr.rank == rank
+        && ptr->dram_addr.bank == bank && ptr->dram_addr.row == row)
+      return 1;
+  }
+  LL_FOREACH (write_queue_head[channel], ptr)
+  {
+    if (!ptr->request_served && ptr->dram_addr.rank == rank
+        && ptr->dram_addr.bank == bank && ptr->dram_addr.row == row)
+      return 1;
+  }
+  return 0;
+}
+
+
+  static int
+close_always (int channel, int rank, int bank)
+{
+  return 1;
+}
+
+
+  static int
+close_unused (int channel, int rank, int bank)
+{
+  return CYCLE_VAL - last_use[channel][rank][bank] >= PAGE_TIMEOUT;
+}
+
+
+  static int
+close_predicted (int channel, int rank, int bank)
+{
+  return open_counter[channel][rank][bank] < 2;
+}
+
+
+  static int
+close_capped (int channel, int rank, int bank)
+{
+  return open_accesses[channel][rank][bank] >= PAGE_HIT_CAP;
+}
+
+
+  void
+page_policy (int channel)
+{
+  page_policy_t *policy = &page_policies[page_policy_mode[channel]];
+
+  // none and open close no rows
+  if (!policy->close_after_cas && !policy->close_when_idle)
+    return;
+
+  // the bank of this cycle's column command, unless the scheduler
+  // already auto-precharged it
+  if (policy->close_after_cas && command_issued_current_cycle[channel]
+      && last_cas_rank[channel] >= 0)
+  {
+    int r = last_cas_rank[channel];
+    int b = last_cas_bank[channel];
+    if (cas_issued_current_cycle[channel][r][b]
+        && dram_state[channel][r][b].state == ROW_ACTIVE
+        && !row_wanted (channel, r, b, dram_state[channel][r][b].active_row)
+        && policy->close_after_cas (channel, r, b)
+        && issue_autoprecharge (channel, r, b))
+      stats_num_policy_precharges[channel][r]++;
+  }
+
+  if (policy->close_when_idle && !command_issued_current_cycle[channel])
+  {
+    for (int r = 0; r < NUM_RANKS; r++)
+      for (int b = 0; b < NUM_BANKS; b++)
+      {
+        bank_t *bank = &dram_state[channel][r][b];
+        if (bank->state == ROW_ACTIVE
+            && policy->close_when_idle (channel, r, b)
+            && !row_wanted (channel, r, b, bank->active_row)
+            && is_precharge_allowed (channel, r, b))
+        {
+          issue_precharge_command (channel, r, b);
+          stats_num_policy_precharges[channel][r]++;
+          return;
+        }
+      }
+  }
+}
+
+
+  void
+print_page_policy_stats ()
+{
+  int enabled = 0;
+
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    enabled |= page_policy_mode[c] != NO_PAGE_POLICY;
+  if (!enabled)
+    return;
+
+  fprintf (usimm_out, "------------------------------------\n");
+  for (int c = 0; c < NUM_CHANNELS; c++)
+  {
+    long long int hits = 0, misses = 0, conflicts = 0, premature = 0;
+    long long int precharges = 0;
+    for (int r = 0; r < NUM_RANKS; r++)
+    {
+      for (int b = 0; b < NUM_BANKS; b++)
+      {
+        hits += stats_num_row_hits[c][r][b];
+        misses += stats_num_row_misses[c][r][b];
+        conflicts += stats_num_row_conflicts[c][r][b];
+        premature += stats_num_premature_closes[c][r][b];
+      }
+      precharges += stats_num_policy_precharges[c][r];
+    }
+    long long int total = hits + misses + conflicts;
+    fprintf (usimm_out, "Channel %d: page policy %s\n", c,
+        page_policies[page_policy_mode[c]].name);
+    fprintf (usimm_out, "Channel %d: row hits %lld (%.2f%%) misses %lld (%.2f%%) conflicts %lld (%.2f%%)\n",
+        c, hits, total ? 100.0 * hits / total : 0.0,
+        misses, total ? 100.0 * misses / total : 0.0,
+        conflicts, total ? 100.0 * conflicts / total : 0.0);
+    fprintf (usimm_out, "Channel %d: premature closes %lld, precharges by the policy %lld\n",
+        c, premature, precharges);
+  }
+}
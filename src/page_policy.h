@@ -0,0 +1,76 @@
+#ifndef __PAGE_POLICY_H__
+#define __PAGE_POLICY_H__
+
+#include "memory_controller.h"
+
+// Page policies.
+//
+// A page policy decides when an open row is closed. It runs every DRAM
+// cycle after schedule () (and the refresh policy and speculation), so
+// a scheduler only has to pick requests and gets its rows closed for
+// it. It is selected in the config file and can be changed per channel
+// at run time with set_page_policy ():
+//
+//   PAGE_POLICY   0   // none: rows are closed by the scheduler or on a conflict
+//   PAGE_POLICY   1   // open page: the same, named for the stats
+//   PAGE_POLICY   2   // close page: auto-precharge after every column access
+//   PAGE_POLICY   3   // timeout: precharge a row unused for PAGE_TIMEOUT cycles
+//   PAGE_POLICY   4   // predictive: per-bank 2-bit open/close predictor
+//   PAGE_POLICY   5   // capped: auto-precharge after PAGE_HIT_CAP column accesses
+//   PAGE_TIMEOUT  N   // DRAM cycles, T_RC by default
+//   PAGE_HIT_CAP  N   // column accesses to a row, 4 by default
+//
+// A policy is an entry in the policy table of page_policy.c with two
+// optional functions: one asked after a column access whether to
+// auto-precharge the bank, and one asked on a cycle the command bus is
+// free whether to precharge an open row. Neither closes a row a queued
+// request still wants.
+//
+// Row buffer accounting: every request is classified by the first DRAM
+// command issued for it. A column command means the row was open (a
+// hit), an ACT that the bank was closed (a miss) and a PRE that another
+// row was open (a conflict). A miss to the row last accessed in the
+// bank was a premature close. The counts are kept for every policy,
+// including the scheduler's own, so policies can be compared on a
+// workload or a phase of it.
+//
+// The predictive policy keeps a 2-bit saturating counter per bank.
+// Hits and premature closes count up, conflicts and misses to another
+// row count down, and the row is closed after a column access while the
+// counter is below 2.
+
+#define NO_PAGE_POLICY 0
+#define OPEN_PAGE_POLICY 1
+#define CLOSE_PAGE_POLICY 2
+#define TIMEOUT_PAGE_POLICY 3
+#define PREDICTIVE_PAGE_POLICY 4
+#define CAPPED_PAGE_POLICY 5
+
+// page policy of each channel
+USIMM_GLOBAL int *page_policy_mode;
+
+// row buffer accounting per bank
+USIMM_GLOBAL long long int ***stats_num_row_hits;
+USIMM_GLOBAL long long int ***stats_num_row_misses;
+USIMM_GLOBAL long long int ***stats_num_row_conflicts;
+
+// allocate the policy state and check PAGE_POLICY; -1 if it is unknown
+int init_page_policy ();
+
+// switch the page policy of a channel; -1 if 'policy' is unknown
+int set_page_policy (int channel, int policy);
+
+// account for a command issued for a request (called by
+// issue_request_command)
+void observe_page_command (request_t * request, command_t cmd);
+
+// an ACT opened a row (called for requests and speculative ACTs)
+void observe_page_activate (int channel, int rank, int bank);
+
+// close rows as the policy of the channel decides; called every DRAM
+// cycle after schedule ()
+void page_policy (int channel);
+
+void print_page_policy_stats ();
+
+#endif // __PAGE_POLICY_H__
@@ -1,165 +1,353 @@
 #ifndef __PARAMS_H__
 #define __PARAMS_H__
 
+#include "usimm.h"
+
 /********************/
 /* Processor params */
 /********************/
 // number of cores in mulicore 
-int NUMCORES;
+USIMM_GLOBAL int NUMCORES;
 
 // processor clock frequency multiplier : multiplying the
 // DRAM_CLK_FREQUENCY by the following parameter gives the processor
 // clock frequency 
- int PROCESSOR_CLK_MULTIPLIER;
+USIMM_GLOBAL int PROCESSOR_CLK_MULTIPLIER;
 
 //size of ROB
- int ROBSIZE ;// 128;		
+USIMM_GLOBAL int ROBSIZE ;// 128;		
 
 // maximum commit width
- int MAX_RETIRE ;// 2;
+USIMM_GLOBAL int MAX_RETIRE ;// 2;
 
 // maximum instruction fetch width
- int MAX_FETCH ;// 4;	
+USIMM_GLOBAL int MAX_FETCH ;// 4;	
 
 // depth of pipeline
- int PIPELINEDEPTH ;// 5;
+USIMM_GLOBAL int PIPELINEDEPTH ;// 5;
+
+// power of a core while its thread runs, and of everything outside the
+// cores and DRAM (uncore, disk, I/O, cooling), in W. A negative value
+// derives them from NUM_CHANNELS (see usimm_init_system), matching the
+// supplied configs: 5/10 W for 1 channel, 10/40 W for 4 channels.
+USIMM_GLOBAL float CORE_POWER ;// -1;
+USIMM_GLOBAL float MISC_POWER ;// -1;
 
 
 /*****************************/
 /* DRAM System Configuration */
 /*****************************/
 // total number of channels in the system
- int NUM_CHANNELS ;// 1;
+USIMM_GLOBAL int NUM_CHANNELS ;// 1;
 
 // number of ranks per channel
- int NUM_RANKS ;// 2;
+USIMM_GLOBAL int NUM_RANKS ;// 2;
 
 // number of banks per rank
- int NUM_BANKS ;// 8;
+USIMM_GLOBAL int NUM_BANKS ;// 8;
+
+// number of bank groups per rank (DDR4/DDR5), 0 or 1 for none. The
+// low bits of the bank id select the group: bank b is in group
+// b % NUM_BANK_GROUPS.
+USIMM_GLOBAL int NUM_BANK_GROUPS ;// 1;
 
 // number of rows per bank
- int NUM_ROWS ;// 32768;
+USIMM_GLOBAL int NUM_ROWS ;// 32768;
 
 // number of columns per rank
- int NUM_COLUMNS ;// 128;
+USIMM_GLOBAL int NUM_COLUMNS ;// 128;
 
 // cache-line size (bytes)
- int CACHE_LINE_SIZE ;// 64;
+USIMM_GLOBAL int CACHE_LINE_SIZE ;// 64;
 
 // total number of address bits (i.e. indicates size of memory)
- int ADDRESS_BITS ;// 32;
+USIMM_GLOBAL int ADDRESS_BITS ;// 32;
+
+// DRAM chip parameter (.vi) file, e.g. 4Gb_x8.vi. Left empty, one of
+// the supplied files is picked from NUM_CHANNELS and NUMCORES.
+USIMM_GLOBAL char DRAM_DEVICE[256];
+
+// ':' separated directories searched for DRAM_DEVICE ("input" if empty)
+USIMM_GLOBAL char DRAM_DEVICE_PATH[1024];
+
+// DRAM chips per rank; 0 derives it from the device width (x4, x8, x16)
+// on a 64-bit rank
+USIMM_GLOBAL int CHIPS_PER_RANK ;// 0;
 
 /****************************/
 /* DRAM Chip Specifications */
 /****************************/
 
 // dram frequency (not datarate) in MHz
- int DRAM_CLK_FREQUENCY ;// 800;
+USIMM_GLOBAL int DRAM_CLK_FREQUENCY ;// 800;
 
 // All the following timing parameters should be 
 // entered in the config file in terms of memory 
 // clock cycles.
 
 // RAS to CAS delay
- int T_RCD ;// 44;
+USIMM_GLOBAL int T_RCD ;// 44;
 
 // PRE to RAS
- int T_RP ;// 44;
+USIMM_GLOBAL int T_RP ;// 44;
 
 // ColumnRD to Data burst
- int T_CAS ;// 44;
+USIMM_GLOBAL int T_CAS ;// 44;
 
 // RAS to PRE delay
- int T_RAS ;// 112;
+USIMM_GLOBAL int T_RAS ;// 112;
 
 // Row Cycle time
- int T_RC ;// 156;
+USIMM_GLOBAL int T_RC ;// 156;
 
 // ColumnWR to Data burst
- int T_CWD ;// 20;
+USIMM_GLOBAL int T_CWD ;// 20;
 
 // write recovery time (COL_WR to PRE)
- int T_WR ;// 48;
+USIMM_GLOBAL int T_WR ;// 48;
 
 // write to read turnaround
- int T_WTR ;// 24;
+USIMM_GLOBAL int T_WTR ;// 24;
+
+// write to read turnaround to a different/the same bank group
+// (default T_WTR)
+USIMM_GLOBAL int T_WTR_S;
+USIMM_GLOBAL int T_WTR_L;
 
 // rank to rank switching time
- int T_RTRS ;// 8;
+USIMM_GLOBAL int T_RTRS ;// 8;
 
 // Data transfer
- int T_DATA_TRANS ;// 16;
+USIMM_GLOBAL int T_DATA_TRANS ;// 16;
 
 // Read to PRE
- int T_RTP ;// 24;
+USIMM_GLOBAL int T_RTP ;// 24;
 
 // CAS to CAS
- int T_CCD ;// 16;
+USIMM_GLOBAL int T_CCD ;// 16;
+
+// CAS to CAS in a different/the same bank group (default T_CCD)
+USIMM_GLOBAL int T_CCD_S;
+USIMM_GLOBAL int T_CCD_L;
 
 // Power UP time fast
- int T_XP ;// 20;
+USIMM_GLOBAL int T_XP ;// 20;
 
 // Power UP time slow
- int T_XP_DLL ;// 40;
+USIMM_GLOBAL int T_XP_DLL ;// 40;
 
 // Power down entry
- int T_CKE ;// 16;
+USIMM_GLOBAL int T_CKE ;// 16;
 
 // Minimum power down duration
- int T_PD_MIN ;// 16;
+USIMM_GLOBAL int T_PD_MIN ;// 16;
 
 // rank to rank delay (ACTs to same rank)
- int T_RRD ;// 20;
+USIMM_GLOBAL int T_RRD ;// 20;
+
+// ACT to ACT in a different/the same bank group (default T_RRD)
+USIMM_GLOBAL int T_RRD_S;
+USIMM_GLOBAL int T_RRD_L;
 
 // four bank activation window
- int T_FAW ;// 128;
+USIMM_GLOBAL int T_FAW ;// 128;
 
 // refresh interval
- int T_REFI;
+USIMM_GLOBAL int T_REFI;
 
  // refresh cycle time
- int T_RFC;
+USIMM_GLOBAL int T_RFC;
+
+// refresh cycle time in DDR4 fine granularity refresh 2x/4x mode
+// (default 3/4 and 1/2 of T_RFC, close to the 8Gb DDR4 ratios)
+USIMM_GLOBAL int T_RFC2;
+USIMM_GLOBAL int T_RFC4;
+
+// per-bank refresh cycle time (default T_RFC/2)
+USIMM_GLOBAL int T_RFCPB;
+
+// refresh mode
+// 0 refreshes all banks of a rank with one REF command
+// 1 refreshes one bank at a time with REFpb commands (LPDDR style);
+//   each bank owes 8 REFpb per 8*T_REFI window and the windows of the
+//   banks of a rank are staggered
+USIMM_GLOBAL int REFRESH_MODE ;// 0;
+
+// DDR4 fine granularity refresh for REFRESH_MODE 0: 1, 2 or 4 REF
+// commands of T_RFC, T_RFC2 or T_RFC4 per T_REFI
+USIMM_GLOBAL int REFRESH_GRANULARITY ;// 1;
+
+// refresh pausing: a REF issued by the scheduler is split into this
+// many segments and is paused at a segment boundary when a read waits
+// for the rank. The next REF to the rank only does the remaining
+// segments. 0 disables pausing.
+USIMM_GLOBAL int REFRESH_PAUSE_SEGMENTS ;// 0;
+
+// refresh policy (see refresh_policy.h)
+// 0 leaves refresh to the scheduler and the forced refresh
+// 1 is elastic refresh
+USIMM_GLOBAL int REFRESH_POLICY ;// 0;
+
+// open-row predictor (see row_predictor.h)
+// 0 none, 1 per-PC stride, 2 global history buffer, 3 per-PC row reuse
+USIMM_GLOBAL int ROW_PREDICTOR ;// 0;
+
+// 1 lets the controller issue speculative ACT/PRE commands from the
+// row predictor when the scheduler leaves the command bus free
+USIMM_GLOBAL int SPECULATIVE_ACTIVATE ;// 0;
+
+// 0 keeps speculation to ACTs on closed banks: a predicted row is never
+// opened by closing the row in its way
+USIMM_GLOBAL int SPECULATIVE_PRECHARGE ;// 1;
+
+// page policy (see page_policy.h)
+// 0 none, 1 open, 2 close, 3 timeout, 4 per-bank 2-bit predictor,
+// 5 capped
+USIMM_GLOBAL int PAGE_POLICY ;// 0;
+
+// cycles an unused row stays open with the timeout page policy
+USIMM_GLOBAL int PAGE_TIMEOUT ;// T_RC;
+
+// column accesses a row gets before the capped page policy closes it
+USIMM_GLOBAL int PAGE_HIT_CAP ;// 4;
+
+// power policy (see power_policy.h)
+// 0 none, 1 timeout, 2 adaptive timeout, 3 adaptive with queue-aware exit
+USIMM_GLOBAL int POWER_POLICY ;// 0;
+
+// idle cycles before a rank is powered down by the timeout power policy
+USIMM_GLOBAL int POWER_TIMEOUT ;// 0;
+
+// write drain (see write_drain.h)
+// 0 fixed watermarks, 1 adaptive watermarks
+USIMM_GLOBAL int WRITE_DRAIN_POLICY ;// 0;
+
+// begin draining writes above WRITE_HI_WM writes, stop at WRITE_LO_WM
+USIMM_GLOBAL int WRITE_HI_WM ;// 40;
+USIMM_GLOBAL int WRITE_LO_WM ;// 20;
+
+// 1 drains writes one rank at a time
+USIMM_GLOBAL int WRITE_BATCH_PER_RANK ;// 0;
+
+// 1 issues writes in idle cycles outside write drains
+USIMM_GLOBAL int EAGER_WRITEBACK ;// 0;
+
+// thread QoS (see qos.h)
+// 0 none, 1 classes and bandwidth shares, 2 BLISS, 3 slowdown first
+USIMM_GLOBAL int QOS_POLICY ;// 0;
+
+// per-thread priority classes and bandwidth shares, e.g. "0,0,1,1"
+USIMM_GLOBAL char QOS_CLASSES[256];
+USIMM_GLOBAL char QOS_SHARES[256];
+
+// 1 to estimate and print each thread's slowdown from the interference
+// its reads suffer (see interference.h); QOS_POLICY 3 turns the
+// estimation on without the printout
+USIMM_GLOBAL int INTERFERENCE_STATS ;// 0;
+
+// core model (see core_model.h)
+// 0 ooo, 1 mlp (load PC dependence hints), 2 blocking reads
+USIMM_GLOBAL int CORE_POLICY ;// 0;
+
+// reads a core can have in the read queues, 0 for no limit
+USIMM_GLOBAL int MSHR_SIZE ;// 0;
+
+// last-level cache filter (see llc.h), LLC_SIZE in KB, 0 for none
+USIMM_GLOBAL int LLC_SIZE ;// 0;
+USIMM_GLOBAL int LLC_WAYS ;// 16;
+USIMM_GLOBAL int LLC_LATENCY ;// 20;
+
+// 0 LRU, 1 random, 2 SRRIP
+USIMM_GLOBAL int LLC_REPLACEMENT ;// 0;
+
+// prefetchers (see prefetch.h)
+// 0 none, 1 stream, 2 stride, 3 delta correlation
+USIMM_GLOBAL int PREFETCHER ;// 0;
+USIMM_GLOBAL int PREFETCH_DEGREE ;// 2;
+USIMM_GLOBAL int PREFETCH_BUFFER ;// 64;
+
+// 0 prefetches wait behind demand reads, 1 they compete
+USIMM_GLOBAL int PREFETCH_PRIORITY ;// 0;
+
+// trace format (see open_loop.h): 0 usimm traces fetched through the
+// ROB (closed loop), 1 timestamped requests injected at their cycle
+// (open loop)
+USIMM_GLOBAL int TRACE_FORMAT ;// 0;
+
+// 1 to charge the cycles requests wait in the queues to their causes
+// (see stall.h)
+USIMM_GLOBAL int STALL_STATS ;// 0;
+
+// 1 to account the data-bus cycles of each channel by use, and the
+// CPU cycles per line of their time series, 0 for none (see data_bus.h)
+USIMM_GLOBAL int BUS_STATS ;// 0;
+USIMM_GLOBAL int BUS_STATS_INTERVAL ;// 0;
+
+// 1 to charge DRAM energy per command and power-state interval, and the
+// CPU cycles per line of its time series, 0 for none (see energy.h)
+USIMM_GLOBAL int ENERGY_STATS ;// 0;
+USIMM_GLOBAL int ENERGY_INTERVAL ;// 0;
+
+// memory DVFS (see dvfs.h): ':' separated .vi files of the operating
+// points besides DRAM_DEVICE, the policy (0 none, 1 bandwidth), the CPU
+// cycles between its decisions, its target data-bus utilization in %,
+// and the cycles a switch holds the channels to relock the DLL
+USIMM_GLOBAL char DVFS_DEVICES[1024];
+USIMM_GLOBAL int DVFS_POLICY ;// 0;
+USIMM_GLOBAL int DVFS_INTERVAL ;// 100000;
+USIMM_GLOBAL int DVFS_TARGET_UTIL ;// 50;
+USIMM_GLOBAL int DVFS_RELOCK ;// 512;
 
 /****************************/
 /* VOLTAGE & CURRENT VALUES */
 /****************************/
 
-float VDD;
+USIMM_GLOBAL float VDD;
 
-float IDD0;
+USIMM_GLOBAL float IDD0;
 
-float IDD1;
+USIMM_GLOBAL float IDD1;
 
-float IDD2P0;
+USIMM_GLOBAL float IDD2P0;
 
-float IDD2P1;
+USIMM_GLOBAL float IDD2P1;
 
-float IDD2N;
+USIMM_GLOBAL float IDD2N;
 
-float IDD3P;
+USIMM_GLOBAL float IDD3P;
 
-float IDD3N;
+USIMM_GLOBAL float IDD3N;
 
-float IDD4R;
+USIMM_GLOBAL float IDD4R;
 
-float IDD4W;
+USIMM_GLOBAL float IDD4W;
 
-float IDD5;
+USIMM_GLOBAL float IDD5;
 
 /******************************/
 /* MEMORY CONTROLLER Settings */
 /******************************/
 
 // maximum capacity of write queue (per channel)
- int WQ_CAPACITY ;// 64;
+USIMM_GLOBAL int WQ_CAPACITY ;// 64;
 
 //  int ADDRESS_MAPPING mode
 // 1 is consecutive cache-lines to same row
 // 2 is consecutive cache-lines striped across different banks 
- int ADDRESS_MAPPING ;// 1;
+// 3 is the field order given by ADDRESS_MAP_ORDER (see address_map.h)
+USIMM_GLOBAL int ADDRESS_MAPPING ;// 1;
+
+// field order for ADDRESS_MAPPING 3, least significant field first
+USIMM_GLOBAL char ADDRESS_MAP_ORDER[256];
+
+// XOR row bits into the bank/channel/rank index
+// 0 is off, 1 XORs the low row bits, 2 folds all row bits
+USIMM_GLOBAL int ADDRESS_MAP_BANK_XOR ;// 0;
+USIMM_GLOBAL int ADDRESS_MAP_CHANNEL_XOR ;// 0;
+USIMM_GLOBAL int ADDRESS_MAP_RANK_XOR ;// 0;
 
  // WQ associative lookup 
- int WQ_LOOKUP_LATENCY;
+USIMM_GLOBAL int WQ_LOOKUP_LATENCY;
 
 
 #endif // __PARAMS_H__
@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "utlist.h"
+
+#include "params.h"
+#include "memory_controller.h"
+#include "power_policy.h"
+
+extern USIMM_STATE long long int CYCLE_VAL;
+
+// idle periods of 2^k - 1 to 2^(k+1) - 2 DRAM cycles go to bucket k
+#define NUM_IDLE_BUCKETS 24
+// idle periods recorded before the adaptive timeout is used
+#define MIN_IDLE_SAMPLES 16
+// the histograms are halved every this many idle periods
+#define IDLE_DECAY_SAMPLES 256
+
+typedef struct
+{
+  long long int idle_since;	// -1 while requests are queued
+  long long int count[NUM_IDLE_BUCKETS];
+  long long int length[NUM_IDLE_BUCKETS];	// CPU cycles
+  long long int samples;
+  long long int timeout;	// adaptive timeout, -1 for never
+  int asleep;			// powered down when last looked at
+  int sleep_state;		// bank 0 state while powered down
+  long long int wait_since;	// first request queued while asleep, -1 if none
+  long long int awake_at;	// end of the last power-up's T_XP or T_XP_DLL
+  long long int entries;
+  long long int exits;
+  long long int demand_exits;	// power-ups with requests waiting
+  long long int wake_delay;	// CPU cycles
+  long long int delayed_cycles;	// request-CPU cycles
+} power_rank_t;
+
+static USIMM_STATE power_rank_t **power_ranks;
+
+// requests queued for each rank of the channel this cycle
+static USIMM_STATE int *queued;
+
+static const char *power_policy_names[] = {
+  "none", "timeout", "adaptive", "queue-aware"
+};
+
+#define NUM_POWER_POLICIES \
+  ((int) (sizeof (power_policy_names) / sizeof (power_policy_names[0])))
+
+
+  int
+init_power_policy ()
+{
+  if (POWER_POLICY < 0 || POWER_POLICY >= NUM_POWER_POLICIES)
+  {
+    fprintf (usimm_out, "PANIC: unknown POWER_POLICY %d\n", POWER_POLICY);
+    return -1;
+  }
+  power_policy_mode = alloc_system_memory (NUM_CHANNELS, sizeof (int));
+  power_ranks = alloc_rank_table (sizeof (power_rank_t));
+  queued = alloc_system_memory (NUM_RANKS, sizeof (int));
+  for (int c = 0; c < NUM_CHANNELS; c++)
+  {
+    power_policy_mode[c] = POWER_POLICY;
+    for (int r = 0; r < NUM_RANKS; r++)
+    {
+      power_ranks[c][r].timeout = POWER_TIMEOUT;
+      power_ranks[c][r].wait_since = -1;
+    }
+  }
+  return 0;
+}
+
+
+  int
+set_power_policy (int channel, int policy)
+{
+  if (policy < 0 || policy >= NUM_POWER_POLICIES)
+  {
+    fprintf (usimm_out, "PANIC: unknown power policy %d\n", policy);
+    return -1;
+  }
+  power_policy_mode[channel] = policy;
+  return 0;
+}
+
+
+  static long long int
+bucket_start (int k)
+{
+  return ((1LL << k) - 1) * PROCESSOR_CLK_MULTIPLIER;
+}
+
+
+// average time the past idle periods of a rank lasted past 'elapsed'
+// idle cycles, over those that lasted about as long
+  static long long int
+expected_idle (power_rank_t * p, long long int elapsed)
+{
+  long long int count = 0, length = 0;
+
+  for (int k = NUM_IDLE_BUCKETS - 1; k >= 0; k--)
+  {
+    if (bucket_start (k + 1) <= elapsed)
+      break;
+    count += p->count[k];
+    length += p->length[k];
+  }
+  return count ? length / count - elapsed : 0;
+}
+
+
+  static void
+record_idle_period (power_rank_t * p, long long int cycles)
+{
+  long long int dram_cycles = cycles / PROCESSOR_CLK_MULTIPLIER;
+  int k = 0;
+
+  while (k < NUM_IDLE_BUCKETS - 1 && dram_cycles + 1 >= (2LL << k))
+    k++;
+  p->count[k]++;
+  p->length[k] += cycles;
+  if (++p->samples % IDLE_DECAY_SAMPLES == 0)
+    for (int b = 0; b < NUM_IDLE_BUCKETS; b++)
+    {
+      p->count[b] /= 2;
+      p->length[b] /= 2;
+    }
+
+  // the shortest idle time worth a power-down after it
+  p->timeout = -1;
+  for (k = 0; k < NUM_IDLE_BUCKETS; k++)
+    if (expected_idle (p, bucket_start (k)) >= T_PD_MIN + T_XP)
+    {
+      p->timeout = bucket_start (k);
+      break;
+    }
+}
+
+
+  static long long int
+idle_timeout (int channel, power_rank_t * p)
+{
+  if (power_policy_mode[channel] == TIMEOUT_POWER_POLICY
+      || p->samples < MIN_IDLE_SAMPLES)
+    return POWER_TIMEOUT;
+  return p->timeout;
+}
+
+
+  static int
+is_asleep (int state)
+{
+  return state == PRECHARGE_POWER_DOWN_SLOW
+    || state == PRECHARGE_POWER_DOWN_FAST || state == ACTIVE_POWER_DOWN;
+}
+
+
+  void
+power_policy (int channel)
+{
+  request_t *ptr = NULL;
+  int reads = 0;
+
+  if (power_policy_mode[channel] == NO_POWER_POLICY)
+    return;
+  for (int r = 0; r < NUM_RANKS; r++)
+    queued[r] = 0;
+  LL_FOREACH (read_queue_head[channel], ptr)
+  {
+    if (!ptr->request_served)
+    {
+      queued[ptr->dram_addr.rank]++;
+      reads++;
+    }
+  }
+  LL_FOREACH (write_queue_head[channel], ptr)
+    queued[ptr->dram_addr.rank]++;
+
+  for (int r = 0; r < NUM_RANKS; r++)
+  {
+    power_rank_t *p = &power_ranks[channel][r];
+    int state = dram_state[channel][r][0].state;
+    int asleep = is_asleep (state);
+
+    // a power-up, by the scheduler, a refresh or this policy
+    if (p->asleep && !asleep)
+    {
+      p->awake_at = CYCLE_VAL +
+        (p->sleep_state == PRECHARGE_POWER_DOWN_SLOW ? T_XP_DLL : T_XP);
+      p->exits++;
+      if (queued[r] && p->wait_since < 0)
+        p->wait_since = CYCLE_VAL;
+      if (p->wait_since >= 0)
+      {
+        p->demand_exits++;
+        p->wake_delay += p->awake_at - p->wait_since;
+        p->wait_since = -1;
+      }
+    }
+    if (!p->asleep && asleep)
+      p->entries++;
+    p->asleep = asleep;
+    if (asleep)
+      p->sleep_state = state;
+
+    if (queued[r])
+    {
+      if (p->idle_since >= 0)
+      {
+        record_idle_period (p, CYCLE_VAL - p->idle_since);
+        p->idle_since = -1;
+      }
+      if (asleep && p->wait_since < 0)
+        p->wait_since = CYCLE_VAL;
+      if (asleep || CYCLE_VAL < p->awake_at)
+        p->delayed_cycles += (long long int) queued[r] *
+          PROCESSOR_CLK_MULTIPLIER;
+      if (asleep && is_powerup_allowed (channel, r))
+        issue_powerup_command (channel, r);
+      continue;
+    }
+
+    if (p->idle_since < 0)
+      p->idle_since = CYCLE_VAL;
+    long long int timeout = idle_timeout (channel, p);
+    long long int idle = CYCLE_VAL - p->idle_since;
+    if (asleep || timeout < 0 || idle < timeout)
+      continue;
+    command_t cmd = PWR_DN_FAST_CMD;
+    if (power_policy_mode[channel] == QUEUE_AWARE_POWER_POLICY && !reads
+        && p->samples >= MIN_IDLE_SAMPLES
+        && expected_idle (p, idle) >= T_PD_MIN + T_XP_DLL
+        && is_powerdown_slow_allowed (channel, r))
+      cmd = PWR_DN_SLOW_CMD;
+    if (cmd == PWR_DN_SLOW_CMD || is_powerdown_fast_allowed (channel, r))
+      issue_powerdown_command (channel, r, cmd);
+  }
+}
+
+
+  void
+print_power_policy_stats ()
+{
+  // ns per CPU cycle; mA * V * ns = pJ
+  double cycle_ns =
+    1000.0 / ((double) DRAM_CLK_FREQUENCY * PROCESSOR_CLK_MULTIPLIER);
+  double saved_total = 0;
+  long long int delayed_total = 0;
+  int enabled = 0;
+
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    enabled |= power_policy_mode[c] != NO_POWER_POLICY;
+  if (!enabled)
+    return;
+
+  fprintf (usimm_out, "------------------------------------\n");
+  fprintf (usimm_out, "Power policy: %s, POWER_TIMEOUT %d\n",
+      power_policy_names[power_policy_mode[0]], POWER_TIMEOUT);
+  fprintf (usimm_out, "%-16s %8s %8s %8s %8s %10s %14s %10s %7s %10s %9s\n",
+      "", "pdn", "pdn_slow", "exits", "demand", "wake_avg",
+      "delayed_cycles", "timeout", "asleep%", "saved_uJ", "saved_mW");
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    for (int r = 0; r < NUM_RANKS; r++)
+    {
+      power_rank_t *p = &power_ranks[c][r];
+      settle_residency (c, r);
+      long long int slow =
+        stats_time_spent_in_precharge_power_down_slow[c][r];
+      long long int fast =
+        stats_time_spent_in_precharge_power_down_fast[c][r];
+      long long int act = stats_time_spent_in_active_power_down[c][r];
+      double saved = ((IDD2N - IDD2P0) * slow + (IDD2N - IDD2P1) * fast +
+          (IDD3N - IDD3P) * act) * VDD * cycle_ns * CHIPS_PER_RANK;
+      fprintf (usimm_out, "Channel %d Rank %d %8lld %8lld %8lld %8lld %10.2f %14lld %10lld %7.2f %10.2f %9.2f\n",
+          c, r, p->entries, stats_num_powerdown_slow[c][r], p->exits, p->demand_exits,
+          p->demand_exits ? (double) p->wake_delay / p->demand_exits : 0.0,
+          p->delayed_cycles, idle_timeout (c, p),
+          CYCLE_VAL ? 100.0 * (slow + fast + act) / CYCLE_VAL : 0.0,
+          saved / 1e6, CYCLE_VAL ? saved / (CYCLE_VAL * cycle_ns) : 0.0);
+      saved_total += saved;
+      delayed_total += p->delayed_cycles;
+    }
+  fprintf (usimm_out, "Power-down saved %.2f uJ (%.2f mW) for %lld request-cycles waiting on power-up\n",
+      saved_total / 1e6,
+      CYCLE_VAL ? saved_total / (CYCLE_VAL * cycle_ns) : 0.0, delayed_total);
+}
@@ -0,0 +1,64 @@
+#ifndef __POWER_POLICY_H__
+#define __POWER_POLICY_H__
+
+#include "memory_controller.h"
+
+// Power-management policies.
+//
+// A power policy decides when an idle rank is powered down and in
+// which mode, and powers it up again when a request arrives for it. It
+// runs every DRAM cycle after schedule () and the other controller
+// policies, on a cycle they left the command bus free, so any
+// scheduler can use it. It is selected in the config file and can be
+// changed per channel at run time with set_power_policy ():
+//
+//   POWER_POLICY   0   // none: power-down is left to the scheduler
+//   POWER_POLICY   1   // timeout: fast-exit power-down after POWER_TIMEOUT idle cycles
+//   POWER_POLICY   2   // adaptive: the timeout follows a histogram of idle gaps
+//   POWER_POLICY   3   // queue-aware: adaptive, with slow or fast exit by the queues
+//   POWER_TIMEOUT  N   // DRAM cycles, 0 to power down as soon as a rank is idle
+//
+// A rank is idle while no request for it is queued. The length of
+// every idle period of a rank is recorded in a histogram with log2
+// buckets, halved every IDLE_DECAY_SAMPLES periods to follow program
+// phases. The adaptive policy powers a rank down after the shortest
+// idle time past which the past idle periods lasted on average at
+// least T_PD_MIN + T_XP longer, the least a power-down is worth; it
+// uses POWER_TIMEOUT until MIN_IDLE_SAMPLES periods are recorded, and
+// does not power down if no idle time qualifies.
+//
+// The queue-aware policy picks the exit mode too: slow exit (DLL off,
+// IDD2P0, T_XP_DLL to exit) for a precharged rank when no read is
+// queued on the channel and the idle period is expected to last
+// T_PD_MIN + T_XP_DLL longer, fast exit (IDD2P1 or IDD3P, T_XP)
+// otherwise.
+//
+// The cost of the policy is what requests lose to power-up: the time
+// from the first request queued for a sleeping rank until the rank can
+// take commands again (T_XP or T_XP_DLL after the power-up), and the
+// request-cycles spent waiting in that time. Its benefit is the energy
+// saved against staying in standby: the time in each power-down state
+// at the IDD2N - IDD2P0, IDD2N - IDD2P1 or IDD3N - IDD3P current of
+// the .vi file. Both are printed per rank at the end.
+
+#define NO_POWER_POLICY 0
+#define TIMEOUT_POWER_POLICY 1
+#define ADAPTIVE_POWER_POLICY 2
+#define QUEUE_AWARE_POWER_POLICY 3
+
+// power policy of each channel
+USIMM_GLOBAL int *power_policy_mode;
+
+// allocate the policy state and check POWER_POLICY; -1 if it is unknown
+int init_power_policy ();
+
+// switch the power policy of a channel; -1 if 'policy' is unknown
+int set_power_policy (int channel, int policy);
+
+// power ranks down and up as the policy of the channel decides; called
+// every DRAM cycle after schedule ()
+void power_policy (int channel);
+
+void print_power_policy_stats ();
+
+#endif // __POWER_POLICY_H__
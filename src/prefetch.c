@@ -0,0 +1,415 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "utlist.h"
+
+#include "params.h"
+#include "memory_controller.h"
+#include "address_map.h"
+#include "processor.h"
+#include "prefetch.h"
+#include "write_drain.h"
+
+extern USIMM_STATE long long int CYCLE_VAL;
+extern USIMM_STATE struct robstructure *ROB;
+
+typedef struct
+{
+  long long int line;		// -1 if empty
+  long long int ready;		// when the data arrives, -1 while queued
+  request_t *pending;		// the prefetch read while queued
+} buffer_entry_t;
+
+typedef struct
+{
+  long long int last_line;	// -1 if unused
+  int direction;
+  int confidence;
+  long long int last_use;
+} stream_t;
+
+typedef struct
+{
+  long long int pc;
+  long long int last_line;
+  long long int stride;
+  int confidence;
+  long long int deltas[DELTA_HISTORY];
+  int num_deltas;		// deltas remembered, the newest last
+} pc_entry_t;
+
+typedef struct
+{
+  buffer_entry_t *buffer;
+  int buffer_next;		// FIFO replacement
+  stream_t streams[STREAM_TABLE_SIZE];
+  pc_entry_t *pcs;
+  // stats
+  long long int issued;
+  long long int timely;
+  long long int late;
+  long long int unused;
+  long long int demand_misses;
+  long long int filled;
+  double average_latency;
+  long long int held;		// not issued, write queue under pressure
+} prefetcher_t;
+
+static USIMM_STATE prefetcher_t *prefetchers;
+
+static const char *prefetcher_names[] =
+  { "none", "stream", "stride", "delta correlation" };
+
+
+  int
+init_prefetch ()
+{
+  if (PREFETCHER < NO_PREFETCHER || PREFETCHER > DELTA_PREFETCHER)
+  {
+    fprintf (usimm_out, "PANIC: unknown PREFETCHER %d\n", PREFETCHER);
+    return -1;
+  }
+  if (PREFETCH_DEGREE < 1 || PREFETCH_BUFFER < 1)
+  {
+    fprintf (usimm_out, "PANIC: PREFETCH_DEGREE and PREFETCH_BUFFER must be positive\n");
+    return -1;
+  }
+  prefetchers = alloc_system_memory (NUMCORES, sizeof (prefetcher_t));
+  for (int c = 0; c < NUMCORES; c++)
+  {
+    prefetcher_t *p = &prefetchers[c];
+    p->buffer = alloc_system_memory (PREFETCH_BUFFER, sizeof (buffer_entry_t));
+    for (int i = 0; i < PREFETCH_BUFFER; i++)
+      p->buffer[i].line = -1;
+    for (int i = 0; i < STREAM_TABLE_SIZE; i++)
+      p->streams[i].last_line = -1;
+    p->pcs = alloc_system_memory (PC_TABLE_SIZE, sizeof (pc_entry_t));
+    for (int i = 0; i < PC_TABLE_SIZE; i++)
+      p->pcs[i].last_line = -1;
+  }
+  return 0;
+}
+
+
+// stable partition of a read queue: demand reads, then prefetches
+  static void
+demote_prefetches (int channel)
+{
+  request_t *prefetches = NULL;
+  request_t **prefetch_tail = &prefetches;
+  request_t **link = &read_queue_head[channel];
+
+  while (*link)
+  {
+    request_t *ptr = *link;
+    if (!ptr->prefetch)
+    {
+      link = &ptr->next;
+      continue;
+    }
+    *link = ptr->next;
+    ptr->next = NULL;
+    *prefetch_tail = ptr;
+    prefetch_tail = &ptr->next;
+  }
+  *link = prefetches;
+}
+
+
+  void
+update_prefetch ()
+{
+  if (PREFETCHER == NO_PREFETCHER || PREFETCH_PRIORITY)
+    return;
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    demote_prefetches (c);
+}
+
+
+  static buffer_entry_t *
+find_line (prefetcher_t * p, long long int line)
+{
+  for (int i = 0; i < PREFETCH_BUFFER; i++)
+    if (p->buffer[i].line == line)
+      return &p->buffer[i];
+  return NULL;
+}
+
+
+  int
+prefetch_lookup (int core, int index)
+{
+  prefetcher_t *p = &prefetchers[core];
+
+  if (PREFETCHER == NO_PREFETCHER)
+    return PREFETCH_MISS;
+  buffer_entry_t *e =
+    find_line (p, ROB[core].mem_address[index] / CACHE_LINE_SIZE);
+  if (!e)
+  {
+    p->demand_misses++;
+    return PREFETCH_MISS;
+  }
+
+  e->line = -1;
+  if (e->pending)
+  {
+    // the demand read takes over the queued prefetch
+    e->pending->prefetch = 0;
+    e->pending->instruction_id = index;
+    e->pending->instruction_pc = ROB[core].instrpc[index];
+    e->pending = NULL;
+    p->late++;
+    return PREFETCH_LATE;
+  }
+  ROB[core].comptime[index] =
+    (e->ready > CYCLE_VAL ? e->ready : CYCLE_VAL) + WQ_LOOKUP_LATENCY +
+    PIPELINEDEPTH;
+  p->timely++;
+  return PREFETCH_HIT;
+}
+
+
+  static int
+line_queued (long long int address)
+{
+  int channel = decode_address (address).channel;
+  request_t *ptr = NULL;
+  LL_FOREACH (read_queue_head[channel], ptr)
+  {
+    if (ptr->physical_address / CACHE_LINE_SIZE == address / CACHE_LINE_SIZE)
+      return 1;
+  }
+  return 0;
+}
+
+
+  static void
+issue_prefetch (int core, long long int line)
+{
+  prefetcher_t *p = &prefetchers[core];
+  long long int address = line * CACHE_LINE_SIZE;
+
+  if (line < 0 || find_line (p, line) || line_queued (address))
+    return;
+
+  // a prefetch read would only delay a channel that is, or is about to
+  // be, draining writes
+  int channel = decode_address (address).channel;
+  if (drain_writes[channel] || write_queue_length[channel] >= WRITE_HI_WM)
+  {
+    p->held++;
+    return;
+  }
+
+  // FIFO replacement, skipping the prefetches still queued
+  for (int tries = 0; tries < PREFETCH_BUFFER; tries++)
+  {
+    buffer_entry_t *e = &p->buffer[p->buffer_next];
+    p->buffer_next = (p->buffer_next + 1) % PREFETCH_BUFFER;
+    if (e->pending)
+      continue;
+    if (e->line >= 0)
+      p->unused++;
+    e->line = line;
+    e->ready = -1;
+    e->pending = insert_read (address, CYCLE_VAL, core, -1, 0);
+    e->pending->prefetch = 1;
+    p->issued++;
+    return;
+  }
+}
+
+
+  static void
+train_stream (int core, long long int line)
+{
+  prefetcher_t *p = &prefetchers[core];
+  stream_t *s = NULL;
+  stream_t *lru = &p->streams[0];
+
+  for (int i = 0; i < STREAM_TABLE_SIZE; i++)
+  {
+    stream_t *t = &p->streams[i];
+    if (t->last_line >= 0 && llabs (line - t->last_line) <= STREAM_WINDOW)
+    {
+      s = t;
+      break;
+    }
+    if (t->last_use < lru->last_use)
+      lru = t;
+  }
+  if (!s)
+  {
+    lru->last_line = line;
+    lru->direction = 0;
+    lru->confidence = 0;
+    lru->last_use = CYCLE_VAL;
+    return;
+  }
+  s->last_use = CYCLE_VAL;
+  if (line == s->last_line)
+    return;
+
+  int direction = line > s->last_line ? 1 : -1;
+  if (direction == s->direction)
+    s->confidence++;
+  else
+  {
+    s->direction = direction;
+    s->confidence = 0;
+  }
+  s->last_line = line;
+  if (s->confidence)
+    for (int d = 1; d <= PREFETCH_DEGREE; d++)
+      issue_prefetch (core, line + d * direction);
+}
+
+
+  static pc_entry_t *
+find_pc (int core, long long int pc)
+{
+  unsigned long long int hash = pc ^ (pc >> 8) ^ (pc >> 16);
+  pc_entry_t *e = &prefetchers[core].pcs[hash % PC_TABLE_SIZE];
+  if (e->pc != pc || e->last_line < 0)
+  {
+    e->pc = pc;
+    e->last_line = -1;
+    e->stride = 0;
+    e->confidence = 0;
+    e->num_deltas = 0;
+  }
+  return e;
+}
+
+
+  static void
+train_stride (int core, long long int line, long long int pc)
+{
+  pc_entry_t *e = find_pc (core, pc);
+
+  if (e->last_line >= 0)
+  {
+    long long int stride = line - e->last_line;
+    if (stride && stride == e->stride)
+    {
+      if (e->confidence < 3)
+        e->confidence++;
+    }
+    else if (e->confidence)
+      e->confidence--;
+    else
+      e->stride = stride;
+  }
+  e->last_line = line;
+  if (e->confidence >= 2)
+    for (int d = 1; d <= PREFETCH_DEGREE; d++)
+      issue_prefetch (core, line + d * e->stride);
+}
+
+
+// look for the last two deltas earlier in the history and replay the
+// deltas that followed them
+  static void
+train_delta (int core, long long int line, long long int pc)
+{
+  pc_entry_t *e = find_pc (core, pc);
+  long long int *h = e->deltas;
+
+  if (e->last_line < 0 || line == e->last_line)
+  {
+    e->last_line = line;
+    return;
+  }
+  if (e->num_deltas == DELTA_HISTORY)
+  {
+    for (int i = 1; i < DELTA_HISTORY; i++)
+      h[i - 1] = h[i];
+    e->num_deltas--;
+  }
+  h[e->num_deltas++] = line - e->last_line;
+  e->last_line = line;
+
+  int n = e->num_deltas;
+  if (n < 3)
+    return;
+  for (int i = n - 3; i >= 1; i--)
+  {
+    if (h[i - 1] != h[n - 2] || h[i] != h[n - 1])
+      continue;
+    long long int target = line;
+    for (int j = i + 1, d = 0; d < PREFETCH_DEGREE; j++, d++)
+    {
+      // past the newest delta, the pattern repeats
+      target += h[j < n ? j : i + 1 + (j - i - 1) % (n - i - 1)];
+      issue_prefetch (core, target);
+    }
+    return;
+  }
+}
+
+
+  void
+prefetch_train (int core, long long int physical_address,
+    long long int instruction_pc)
+{
+  long long int line = physical_address / CACHE_LINE_SIZE;
+
+  switch (PREFETCHER)
+  {
+    case STREAM_PREFETCHER:
+      train_stream (core, line);
+      break;
+    case STRIDE_PREFETCHER:
+      train_stride (core, line, instruction_pc);
+      break;
+    case DELTA_PREFETCHER:
+      train_delta (core, line, instruction_pc);
+      break;
+    default:
+      break;
+  }
+}
+
+
+  void
+prefetch_filled (request_t * request)
+{
+  prefetcher_t *p = &prefetchers[request->thread_id];
+  p->filled++;
+  p->average_latency +=
+    (request->latency - p->average_latency) / p->filled;
+  for (int i = 0; i < PREFETCH_BUFFER; i++)
+    if (p->buffer[i].pending == request)
+    {
+      p->buffer[i].pending = NULL;
+      p->buffer[i].ready = request->completion_time;
+      return;
+    }
+}
+
+
+  void
+print_prefetch_stats ()
+{
+  if (PREFETCHER == NO_PREFETCHER)
+    return;
+  fprintf (usimm_out, "------------------------------------\n");
+  fprintf (usimm_out, "Prefetcher: %s, degree %d, %d line buffer, %s priority\n",
+      prefetcher_names[PREFETCHER], PREFETCH_DEGREE, PREFETCH_BUFFER,
+      PREFETCH_PRIORITY ? "equal" : "low");
+  for (int c = 0; c < NUMCORES; c++)
+  {
+    prefetcher_t *p = &prefetchers[c];
+    long long int used = p->timely + p->late;
+    fprintf (usimm_out, "Core %d: prefetches %lld, used %lld (timely %lld, late %lld), evicted unused %lld\n",
+        c, p->issued, used, p->timely, p->late, p->unused);
+    fprintf (usimm_out, "Core %d: accuracy %.2f%%, coverage %.2f%%, timeliness %.2f%%\n",
+        c, p->issued ? 100.0 * used / p->issued : 0.0,
+        used + p->demand_misses ?
+        100.0 * used / (used + p->demand_misses) : 0.0,
+        used ? 100.0 * p->timely / used : 0.0);
+    fprintf (usimm_out, "Core %d: prefetches filled %lld, average latency %.2f, held for write drains %lld\n",
+        c, p->filled, p->average_latency, p->held);
+  }
+}
@@ -0,0 +1,83 @@
+#ifndef __PREFETCH_H__
+#define __PREFETCH_H__
+
+#include "memory_controller.h"
+
+// Hardware prefetchers.
+//
+// A prefetcher per core watches the demand reads the core sends to
+// memory (after the LLC, if any) and inserts prefetch reads for the
+// lines it expects next into the read queues. Prefetch reads have
+// request->prefetch set and no ROB entry; their data goes to a per-core
+// prefetch buffer at the controller. Configured in the config file:
+//
+//   PREFETCHER         0   // none
+//   PREFETCHER         1   // stream: sequential lines around a miss
+//   PREFETCHER         2   // stride: per load PC constant stride
+//   PREFETCHER         3   // delta correlation: per load PC delta
+//                          // history (DCPT, Grannaes et al., JILP 2011)
+//   PREFETCH_DEGREE    N   // prefetches per trigger, 2 by default
+//   PREFETCH_BUFFER    N   // lines in each core's buffer, 64 by default
+//   PREFETCH_PRIORITY  0   // prefetches wait behind demand reads
+//   PREFETCH_PRIORITY  1   // prefetches compete with demand reads
+//
+// With priority 0 the read queues are reordered every DRAM cycle so
+// demand reads come before prefetches (keeping their order otherwise),
+// so schedulers that walk the read queue serve demand reads first
+// without changes. A scheduler can also test request->prefetch itself.
+//
+// A demand read that finds its line in the prefetch buffer completes
+// after WQ_LOOKUP_LATENCY (a timely prefetch). One that finds the
+// prefetch still in the read queue takes the prefetch over, as a demand
+// read, and completes with it (a late prefetch). The prefetches issued,
+// their accuracy (the fraction used), coverage (the fraction of demand
+// misses they served) and timeliness (the fraction of used prefetches
+// that were timely) are printed at the end.
+
+#define NO_PREFETCHER 0
+#define STREAM_PREFETCHER 1
+#define STRIDE_PREFETCHER 2
+#define DELTA_PREFETCHER 3
+
+// prefetch_lookup () results
+#define PREFETCH_MISS 0
+#define PREFETCH_HIT 1
+#define PREFETCH_LATE 2
+
+// stream prefetcher: streams tracked per core, and how far (in lines) a
+// miss can be from a stream to extend it
+#define STREAM_TABLE_SIZE 16
+#define STREAM_WINDOW 16
+
+// stride and delta prefetchers: load PCs tracked per core
+#define PC_TABLE_SIZE 256
+
+// delta prefetcher: deltas remembered per load PC
+#define DELTA_HISTORY 16
+
+// allocate the prefetcher state and check its parameters; -1 if they
+// are bad
+int init_prefetch ();
+
+// reorder the read queues for PREFETCH_PRIORITY 0; called every DRAM
+// cycle before schedule ()
+void update_prefetch ();
+
+// a demand read from ROB entry 'index' of 'core' missed the LLC: serve
+// it from the prefetch buffer (PREFETCH_HIT, its completion time set),
+// from a prefetch in the read queue (PREFETCH_LATE) or not at all
+// (PREFETCH_MISS)
+int prefetch_lookup (int core, int index);
+
+// train the prefetcher of a core on a demand read that missed the LLC,
+// and issue the prefetches it asks for
+void prefetch_train (int core, long long int physical_address,
+    long long int instruction_pc);
+
+// the data of a prefetch read is on its way (called by
+// issue_request_command)
+void prefetch_filled (request_t * request);
+
+void print_prefetch_stats ();
+
+#endif // __PREFETCH_H__
@@ -0,0 +1,242 @@
+#define _POSIX_C_SOURCE 200809L	// strtok_r
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "params.h"
+#include "memory_controller.h"
+#include "qos.h"
+#include "interference.h"
+
+extern USIMM_STATE long long int CYCLE_VAL;
+
+// weight of the past in the attained service average
+#define QOS_HISTORY_WEIGHT 0.875
+
+typedef struct
+{
+  int class;
+  int share;
+  double attained;		// averaged over the past quanta
+  long long int quantum_service;
+  int blacklisted;
+  long long int times_blacklisted;
+} qos_thread_t;
+
+static USIMM_STATE qos_thread_t *threads;
+
+// BLISS streak of each channel
+static USIMM_STATE int *streak_thread;
+static USIMM_STATE int *streak_length;
+
+static const char *qos_policy_names[] = { "none", "share", "bliss", "slowdown" };
+
+
+// per-thread list such as "0,0,1,1"; threads not listed get 'fallback'
+  static int
+parse_thread_list (const char *name, const char *list, int *values,
+    int fallback, int min)
+{
+  char copy[256];
+  int t = 0;
+
+  for (int i = 0; i < NUMCORES; i++)
+    values[i] = fallback;
+  strncpy (copy, list, sizeof (copy) - 1);
+  copy[sizeof (copy) - 1] = '\0';
+  for (char *save, *tok = strtok_r (copy, ", ", &save); tok && t < NUMCORES;
+      tok = strtok_r (NULL, ", ", &save), t++)
+  {
+    char *end;
+    long value = strtol (tok, &end, 10);
+    if (*end || value < min)
+    {
+      fprintf (usimm_out, "PANIC: bad %s entry '%s'\n", name, tok);
+      return -1;
+    }
+    values[t] = value;
+  }
+  return 0;
+}
+
+
+  int
+init_qos ()
+{
+  int values[NUMCORES];
+
+  if (QOS_POLICY < NO_QOS_POLICY || QOS_POLICY > SLOWDOWN_QOS_POLICY)
+  {
+    fprintf (usimm_out, "PANIC: unknown QOS_POLICY %d\n", QOS_POLICY);
+    return -1;
+  }
+  threads = alloc_system_memory (NUMCORES, sizeof (qos_thread_t));
+  qos_rank = alloc_system_memory (NUMCORES, sizeof (int));
+  streak_thread = alloc_system_memory (NUM_CHANNELS, sizeof (int));
+  streak_length = alloc_system_memory (NUM_CHANNELS, sizeof (int));
+
+  if (parse_thread_list ("QOS_CLASSES", QOS_CLASSES, values, 0, 0))
+    return -1;
+  for (int t = 0; t < NUMCORES; t++)
+    threads[t].class = values[t];
+  if (parse_thread_list ("QOS_SHARES", QOS_SHARES, values, 1, 1))
+    return -1;
+  for (int t = 0; t < NUMCORES; t++)
+    threads[t].share = values[t];
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    streak_thread[c] = -1;
+  return 0;
+}
+
+
+// policy score within a class, lower is served first
+  static double
+thread_score (int t)
+{
+  switch (QOS_POLICY)
+  {
+    case SHARE_QOS_POLICY:
+      return threads[t].attained / threads[t].share;
+    case BLISS_QOS_POLICY:
+      return threads[t].blacklisted;
+    case SLOWDOWN_QOS_POLICY:
+      return -estimated_slowdown (t);
+    default:
+      return 0;
+  }
+}
+
+
+// does thread a rank strictly before thread b
+  static int
+ranks_before (int a, int b)
+{
+  if (threads[a].class != threads[b].class)
+    return threads[a].class > threads[b].class;
+  return thread_score (a) < thread_score (b);
+}
+
+
+  static int
+compare_requests (request_t * a, request_t * b)
+{
+  return qos_rank[a->thread_id] - qos_rank[b->thread_id];
+}
+
+
+// stable sort of a read queue by thread rank
+  static void
+sort_read_queue (int channel)
+{
+  request_t *sorted = NULL;
+  request_t *tail = NULL;
+
+  for (int rank = 0; rank < NUMCORES && read_queue_head[channel]; rank++)
+  {
+    request_t **link = &read_queue_head[channel];
+    while (*link)
+    {
+      request_t *ptr = *link;
+      if (qos_rank[ptr->thread_id] != rank)
+      {
+        link = &ptr->next;
+        continue;
+      }
+      *link = ptr->next;
+      ptr->next = NULL;
+      if (tail)
+        tail->next = ptr;
+      else
+        sorted = ptr;
+      tail = ptr;
+    }
+  }
+  read_queue_head[channel] = sorted;
+}
+
+
+  void
+update_qos ()
+{
+  if (QOS_POLICY == NO_QOS_POLICY)
+    return;
+
+  // quanta and blacklist clearing
+  if (CYCLE_VAL % QOS_QUANTUM < PROCESSOR_CLK_MULTIPLIER)
+    for (int t = 0; t < NUMCORES; t++)
+    {
+      threads[t].attained = QOS_HISTORY_WEIGHT * threads[t].attained +
+        (1 - QOS_HISTORY_WEIGHT) * threads[t].quantum_service;
+      threads[t].quantum_service = 0;
+    }
+  if (CYCLE_VAL % BLISS_CLEAR_INTERVAL < PROCESSOR_CLK_MULTIPLIER)
+    for (int t = 0; t < NUMCORES; t++)
+      threads[t].blacklisted = 0;
+
+  for (int t = 0; t < NUMCORES; t++)
+  {
+    qos_rank[t] = 0;
+    for (int u = 0; u < NUMCORES; u++)
+      if (ranks_before (u, t))
+        qos_rank[t]++;
+  }
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    sort_read_queue (c);
+}
+
+
+  int
+qos_compare (request_t * a, request_t * b)
+{
+  if (QOS_POLICY == NO_QOS_POLICY)
+    return 0;
+  return compare_requests (a, b);
+}
+
+
+  void
+observe_qos_command (request_t * request, command_t cmd)
+{
+  int channel = request->dram_addr.channel;
+  int t = request->thread_id;
+
+  if (QOS_POLICY == NO_QOS_POLICY
+      || (cmd != COL_READ_CMD && cmd != COL_WRITE_CMD))
+    return;
+  threads[t].quantum_service += T_DATA_TRANS;
+
+  // BLISS counts the requests served in a row for one thread
+  if (streak_thread[channel] == t)
+    streak_length[channel]++;
+  else
+  {
+    streak_thread[channel] = t;
+    streak_length[channel] = 1;
+  }
+  if (streak_length[channel] > BLISS_THRESHOLD && !threads[t].blacklisted)
+  {
+    threads[t].blacklisted = 1;
+    threads[t].times_blacklisted++;
+  }
+}
+
+
+  void
+print_qos_stats ()
+{
+  if (QOS_POLICY == NO_QOS_POLICY)
+    return;
+  fprintf (usimm_out, "------------------------------------\n");
+  fprintf (usimm_out, "QoS policy: %s\n", qos_policy_names[QOS_POLICY]);
+  for (int t = 0; t < NUMCORES; t++)
+  {
+    qos_thread_t *th = &threads[t];
+    fprintf (usimm_out, "Core %d: class %d share %d attained service %.0f",
+        t, th->class, th->share, th->attained);
+    if (QOS_POLICY == SLOWDOWN_QOS_POLICY)
+      fprintf (usimm_out, " estimated slowdown %.3f", estimated_slowdown (t));
+    if (QOS_POLICY == BLISS_QOS_POLICY)
+      fprintf (usimm_out, " blacklisted %lld times", th->times_blacklisted);
+    fprintf (usimm_out, "\n");
+  }
+}
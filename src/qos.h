@@ -0,0 +1,71 @@
+#ifndef __QOS_H__
+#define __QOS_H__
+
+#include "memory_controller.h"
+
+// Thread-aware QoS.
+//
+// The QoS layer ranks the threads every DRAM cycle and reorders each
+// read queue by thread rank before schedule () runs. Requests of one
+// thread keep their arrival order, so any scheduler that walks the read
+// queue and takes the first request it likes (FCFS, FR-FCFS, ...) serves
+// the better-ranked threads first without changes. A scheduler can also
+// compare requests itself with qos_compare () or read qos_rank. It is
+// configured in the config file:
+//
+//   QOS_POLICY   0         // none: the read queues stay in arrival order
+//   QOS_POLICY   1         // priority classes and bandwidth shares
+//   QOS_POLICY   2         // BLISS blacklisting
+//   QOS_POLICY   3         // highest estimated slowdown first
+//   QOS_CLASSES  0,0,1,1   // priority class of each thread, higher first
+//   QOS_SHARES   1,1,2,2   // bandwidth share of each thread
+//
+// Threads in a higher class always rank first, whatever the policy.
+// Within a class:
+//
+// - policy 1 ranks the thread with the least attained service per
+//   share first (ATLAS, Kim et al., HPCA 2010, weighted by share). The
+//   attained service is the data bus time of a thread's requests on
+//   all channels, averaged over QOS_QUANTUM quanta.
+// - policy 2 ranks threads that had more than BLISS_THRESHOLD requests
+//   served in a row on a channel last (blacklisted), until the
+//   blacklist is cleared every BLISS_CLEAR_INTERVAL cycles (Subramanian
+//   et al., ICCD 2014).
+// - policy 3 ranks the thread with the highest estimated slowdown
+//   first. Slowdowns are estimated online from the interference each
+//   thread's reads suffer (see interference.h), and printed at the
+//   end.
+
+#define NO_QOS_POLICY 0
+#define SHARE_QOS_POLICY 1
+#define BLISS_QOS_POLICY 2
+#define SLOWDOWN_QOS_POLICY 3
+
+// attained service is averaged over quanta of this many cycles
+#define QOS_QUANTUM 1000000
+
+#define BLISS_THRESHOLD 4
+#define BLISS_CLEAR_INTERVAL 10000
+
+// rank of each thread this cycle, 0 is served first
+USIMM_GLOBAL int *qos_rank;
+
+// allocate the QoS state, parse QOS_CLASSES and QOS_SHARES; -1 if
+// QOS_POLICY or a list is bad
+int init_qos ();
+
+// rank the threads and reorder the read queues; called every DRAM
+// cycle before schedule ()
+void update_qos ();
+
+// <0 if request a should be served before b, >0 if after, 0 if the
+// threads rank the same
+int qos_compare (request_t * a, request_t * b);
+
+// account for a command issued for a request (called by
+// issue_request_command)
+void observe_qos_command (request_t * request, command_t cmd);
+
+void print_qos_stats ();
+
+#endif // __QOS_H__
@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "params.h"
+#include "memory_controller.h"
+#include "refresh_policy.h"
+
+extern USIMM_STATE long long int CYCLE_VAL;
+
+// reads waiting for each bank and each rank, counted as reads are
+// inserted and issued
+static USIMM_STATE int ***reads_waiting;
+static USIMM_STATE int **rank_reads_waiting;
+
+// idle period lengths are averaged with this weight (1/2^n)
+#define IDLE_HISTORY_SHIFT 3
+
+static void elastic_refresh (int channel);
+
+typedef struct
+{
+  const char *name;
+  void (*issue) (int channel);
+} refresh_policy_t;
+
+static refresh_policy_t refresh_policies[] = {
+  {"none", NULL},
+  {"elastic", elastic_refresh},
+};
+
+#define NUM_REFRESH_POLICIES \
+  ((int) (sizeof (refresh_policies) / sizeof (refresh_policies[0])))
+
+
+  int
+get_max_postponed_refreshes ()
+{
+  if (REFRESH_MODE == PER_BANK_REFRESH)
+    return MAX_POSTPONED_REFRESHES;
+  return MAX_POSTPONED_REFRESHES * REFRESH_GRANULARITY;
+}
+
+
+  int
+init_refresh_policy ()
+{
+  if (REFRESH_POLICY < 0 || REFRESH_POLICY >= NUM_REFRESH_POLICIES)
+  {
+    fprintf (usimm_out, "PANIC: unknown REFRESH_POLICY %d\n", REFRESH_POLICY);
+    return -1;
+  }
+  reads_waiting = alloc_bank_table (sizeof (int));
+  rank_reads_waiting = alloc_rank_table (sizeof (int));
+  refresh_urgency = alloc_rank_table (sizeof (refresh_urgency_t));
+  refresh_postponed = alloc_rank_table (sizeof (int));
+  bank_refresh_postponed = alloc_bank_table (sizeof (int));
+  rank_idle_since = alloc_rank_table (sizeof (long long int));
+  predicted_idle_cycles = alloc_rank_table (sizeof (long long int));
+  stats_num_policy_refreshes = alloc_rank_table (sizeof (long long int));
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    for (int r = 0; r < NUM_RANKS; r++)
+    {
+      rank_idle_since[c][r] = 0;
+      predicted_idle_cycles[c][r] = get_refresh_cycle_time ();
+    }
+  return 0;
+}
+
+
+// REFs that became due since 'window_start' at one every 'interval'
+// and have not been issued
+  static int
+postponed_refreshes (long long int window_start, int interval, int issued)
+{
+  long long int due = 0;
+  int max_postponed = get_max_postponed_refreshes ();
+  if (CYCLE_VAL > window_start)
+    due = (CYCLE_VAL - window_start) / interval;
+  if (due - issued < 0)
+    return 0;
+  return due - issued > max_postponed ? max_postponed : due - issued;
+}
+
+
+  void
+observe_refresh_read (request_t * request)
+{
+  dram_address_t *a = &request->dram_addr;
+
+  reads_waiting[a->channel][a->rank][a->bank]++;
+  rank_reads_waiting[a->channel][a->rank]++;
+}
+
+
+  void
+observe_refresh_command (request_t * request, command_t cmd)
+{
+  dram_address_t *a = &request->dram_addr;
+
+  if (cmd != COL_READ_CMD)
+    return;
+  reads_waiting[a->channel][a->rank][a->bank]--;
+  rank_reads_waiting[a->channel][a->rank]--;
+}
+
+
+  void
+update_refresh_state (int channel)
+{
+  int max_postponed = get_max_postponed_refreshes ();
+
+  for (int r = 0; r < NUM_RANKS; r++)
+  {
+    int idle = !rank_reads_waiting[channel][r];
+    int postponed = 0;
+
+    // postponed REFs
+    if (REFRESH_MODE == PER_BANK_REFRESH)
+    {
+      for (int b = 0; b < NUM_BANKS; b++)
+      {
+        if (bank_forced_refresh_mode_on[channel][r][b])
+          bank_refresh_postponed[channel][r][b] = 0;
+        else
+          bank_refresh_postponed[channel][r][b] =
+            postponed_refreshes (bank_refresh_completion_deadline[channel][r]
+                [b] - 8 * T_REFI, T_REFI,
+                num_issued_bank_refreshes[channel][r][b]);
+        if (bank_refresh_postponed[channel][r][b] > postponed)
+          postponed = bank_refresh_postponed[channel][r][b];
+      }
+    }
+    else if (!forced_refresh_mode_on[channel][r])
+      postponed =
+        postponed_refreshes (last_refresh_completion_deadline[channel][r],
+            T_REFI / REFRESH_GRANULARITY, num_issued_refreshes[channel][r]);
+    refresh_postponed[channel][r] = postponed;
+
+    if (forced_refresh_mode_on[channel][r]
+        || CYCLE_VAL + T_RAS > refresh_issue_deadline[channel][r])
+      refresh_urgency[channel][r] = REFRESH_URGENCY_FORCED;
+    else if (2 * postponed >= max_postponed)
+      refresh_urgency[channel][r] = REFRESH_URGENCY_HIGH;
+    else if (postponed)
+      refresh_urgency[channel][r] = REFRESH_URGENCY_LOW;
+    else
+      refresh_urgency[channel][r] = REFRESH_URGENCY_NONE;
+
+    // idle periods
+    if (idle && rank_idle_since[channel][r] < 0)
+      rank_idle_since[channel][r] = CYCLE_VAL;
+    else if (!idle && rank_idle_since[channel][r] >= 0)
+    {
+      long long int length = CYCLE_VAL - rank_idle_since[channel][r];
+      predicted_idle_cycles[channel][r] +=
+        (length - predicted_idle_cycles[channel][r]) >> IDLE_HISTORY_SHIFT;
+      rank_idle_since[channel][r] = -1;
+    }
+  }
+}
+
+
+  static void
+elastic_refresh (int channel)
+{
+  int max_postponed = get_max_postponed_refreshes ();
+
+  for (int r = 0; r < NUM_RANKS; r++)
+  {
+    if (command_issued_current_cycle[channel])
+      return;
+    if (REFRESH_MODE == PER_BANK_REFRESH)
+    {
+      // the idle bank with the most postponed REFpb
+      int bank = -1;
+      for (int b = 0; b < NUM_BANKS; b++)
+        if (bank_refresh_postponed[channel][r][b]
+            && !reads_waiting[channel][r][b]
+            && is_refresh_bank_allowed (channel, r, b)
+            && (bank < 0 || bank_refresh_postponed[channel][r][b] >
+              bank_refresh_postponed[channel][r][bank]))
+          bank = b;
+      if (bank >= 0)
+      {
+        issue_refresh_bank_command (channel, r, bank);
+        stats_num_policy_refreshes[channel][r]++;
+      }
+      continue;
+    }
+    if (!refresh_postponed[channel][r] || rank_idle_since[channel][r] < 0)
+      continue;
+
+    // wait for a shorter idle period the more REFs are postponed
+    long long int delay = predicted_idle_cycles[channel][r] *
+      (max_postponed - refresh_postponed[channel][r]) / max_postponed;
+    if (CYCLE_VAL - rank_idle_since[channel][r] >= delay
+        && is_refresh_allowed (channel, r))
+    {
+      issue_refresh_command (channel, r);
+      stats_num_policy_refreshes[channel][r]++;
+    }
+  }
+}
+
+
+  void
+refresh_policy (int channel)
+{
+  if (refresh_policies[REFRESH_POLICY].issue)
+    refresh_policies[REFRESH_POLICY].issue (channel);
+}
+
+
+  void
+print_refresh_policy_stats ()
+{
+  if (REFRESH_POLICY == NO_REFRESH_POLICY)
+    return;
+  fprintf (usimm_out, "------------------------------------\n");
+  fprintf (usimm_out, "Refresh policy: %s\n", refresh_policies[REFRESH_POLICY].name);
+  for (int c = 0; c < NUM_CHANNELS; c++)
+  {
+    long long int issued = 0;
+    long long int idle = 0;
+    for (int r = 0; r < NUM_RANKS; r++)
+    {
+      issued += stats_num_policy_refreshes[c][r];
+      idle += predicted_idle_cycles[c][r];
+    }
+    fprintf (usimm_out, "Channel %d: refreshes issued by the policy %lld, predicted idle period %lld cycles\n",
+        c, issued, idle / NUM_RANKS);
+  }
+}
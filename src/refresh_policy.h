@@ -0,0 +1,95 @@
+#ifndef __REFRESH_POLICY_H__
+#define __REFRESH_POLICY_H__
+
+#include "memory_controller.h"
+
+// Refresh policies.
+//
+// The controller only forces refreshes when a rank (or, with per-bank
+// refresh, a bank) reaches its refresh issue deadline. A refresh
+// policy runs every DRAM cycle after schedule () and may issue REF or
+// REFpb commands earlier, when the scheduler left the command bus
+// free, so that refreshes hide in idle periods instead of stalling
+// reads at the deadline. It is selected in the config file:
+//
+//   REFRESH_POLICY  0   // none: refreshes come from the scheduler or the deadline
+//   REFRESH_POLICY  1   // elastic refresh
+//
+// A policy is a function in refresh_policy.c listed in its policy
+// table. Whatever the policy, the state below is updated before
+// schedule () every DRAM cycle so schedulers can take refresh into
+// account too.
+//
+// A REF is due every T_REFI (T_REFI/2 or T_REFI/4 with fine
+// granularity refresh, T_REFI per bank with per-bank refresh). Due
+// REFs that have not been issued are postponed; DDR allows up to 8 of
+// them (16 and 32 with FGR 2x and 4x), after which the controller
+// forces them.
+//
+// A rank is idle while no read waits for it. Buffered writes do not
+// end an idle period. The length of the next idle period is predicted
+// by an exponential average of the past ones.
+//
+// Elastic refresh (Stuecheli et al., MICRO 2010) issues a postponed
+// REF once the rank has been idle for the predicted idle time scaled
+// down by how many REFs are postponed: with few postponed it waits for
+// long idle periods, close to the limit it refreshes in any gap. With
+// per-bank refresh it refreshes the idle bank with the most postponed
+// REFpb.
+
+#define NO_REFRESH_POLICY 0
+#define ELASTIC_REFRESH_POLICY 1
+
+// REFs that may be postponed at 1x refresh rate
+#define MAX_POSTPONED_REFRESHES 8
+
+typedef enum
+{
+  REFRESH_URGENCY_NONE,		// nothing postponed
+  REFRESH_URGENCY_LOW,		// some REFs postponed
+  REFRESH_URGENCY_HIGH,		// at least half the postponable REFs postponed
+  REFRESH_URGENCY_FORCED	// forced refresh on or too close to issue an ACT
+} refresh_urgency_t;
+
+// per rank urgency, for schedule ()
+USIMM_GLOBAL refresh_urgency_t **refresh_urgency;
+
+// REFs due but not yet issued (with per-bank refresh, the most of any
+// bank of the rank)
+USIMM_GLOBAL int **refresh_postponed;
+USIMM_GLOBAL int ***bank_refresh_postponed;
+
+// cycle the current idle period of the rank began, -1 if busy
+USIMM_GLOBAL long long int **rank_idle_since;
+
+// predicted length of the next idle period of the rank
+USIMM_GLOBAL long long int **predicted_idle_cycles;
+
+// refreshes issued by the policy
+USIMM_GLOBAL long long int **stats_num_policy_refreshes;
+
+// allocate the policy state and check REFRESH_POLICY; -1 if it is
+// unknown
+int init_refresh_policy ();
+
+// count a read inserted in the read queue (called by insert_read)
+void observe_refresh_read (request_t * request);
+
+// account for a command issued for a request (called by
+// issue_request_command)
+void observe_refresh_command (request_t * request, command_t cmd);
+
+// update the postponed counts, urgency and idle periods; called every
+// DRAM cycle before schedule ()
+void update_refresh_state (int channel);
+
+// give the policy the chance to issue a refresh; called every DRAM
+// cycle after schedule ()
+void refresh_policy (int channel);
+
+// most REFs the controller lets a rank (or bank) postpone
+int get_max_postponed_refreshes ();
+
+void print_refresh_policy_stats ();
+
+#endif // __REFRESH_POLICY_H__
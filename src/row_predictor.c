@@ -0,0 +1,348 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utlist.h"
+
+#include "params.h"
+#include "memory_controller.h"
+#include "address_map.h"
+#include "row_predictor.h"
+
+extern USIMM_STATE long long int CYCLE_VAL;
+
+#define STRIDE_TABLE_SIZE 1024
+// addresses ahead predicted for a confirmed stride
+#define STRIDE_DEGREE 6
+
+#define GHB_SIZE 512
+#define GHB_INDEX_SIZE 1024
+// history entries after the last visit that are predicted
+#define GHB_DEGREE 4
+
+#define PC_TABLE_SIZE 1024
+
+// a prediction not acted upon within this many cycles is dropped
+#define PREDICTION_LIFETIME (8 * T_RC)
+
+typedef struct
+{
+  long long int last_address;
+  long long int stride;
+  int confidence;
+} stride_entry_t;
+
+typedef struct
+{
+  dram_address_t addr;
+  long long int seq;		// position in the history, -1 if empty
+  int link;			// previous entry of the same row
+  long long int link_seq;	// seq the link is valid for
+} ghb_entry_t;
+
+typedef struct
+{
+  dram_address_t addr;
+  int reuse;			// 2-bit saturating counter
+  int valid;
+} pc_entry_t;
+
+typedef struct
+{
+  long long int checked;
+  long long int correct;
+  long long int activates;
+  long long int precharges;
+  long long int useful;
+  long long int wasted;
+  long long int expired;
+} row_predictor_stats_t;
+
+static USIMM_STATE stride_entry_t stride_table[STRIDE_TABLE_SIZE];
+static USIMM_STATE ghb_entry_t ghb[GHB_SIZE];
+static USIMM_STATE int ghb_index[GHB_INDEX_SIZE];
+static USIMM_STATE long long int ghb_seq;
+static USIMM_STATE pc_entry_t pc_table[PC_TABLE_SIZE];
+
+static USIMM_STATE long long int ***predicted_at;
+// row opened by a speculative ACT and not yet used, -1 if none
+static USIMM_STATE long long int ***speculative_row;
+static USIMM_STATE row_predictor_stats_t *stats;
+
+static const char *predictor_names[] = { "none", "stride", "ghb", "pc" };
+
+
+  int
+init_row_predictor ()
+{
+  if (ROW_PREDICTOR < NO_ROW_PREDICTOR || ROW_PREDICTOR > PC_ROW_PREDICTOR)
+  {
+    fprintf (usimm_out, "PANIC: unknown ROW_PREDICTOR %d\n", ROW_PREDICTOR);
+    return -1;
+  }
+  predicted_row = alloc_bank_table (sizeof (long long int));
+  predicted_at = alloc_bank_table (sizeof (long long int));
+  speculative_row = alloc_bank_table (sizeof (long long int));
+  stats = alloc_system_memory (NUM_CHANNELS, sizeof (row_predictor_stats_t));
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    for (int r = 0; r < NUM_RANKS; r++)
+      for (int b = 0; b < NUM_BANKS; b++)
+      {
+        predicted_row[c][r][b] = -1;
+        speculative_row[c][r][b] = -1;
+      }
+  memset (stride_table, 0, sizeof (stride_table));
+  memset (pc_table, 0, sizeof (pc_table));
+  memset (ghb, 0, sizeof (ghb));
+  for (int i = 0; i < GHB_SIZE; i++)
+    ghb[i].seq = -1;
+  for (int i = 0; i < GHB_INDEX_SIZE; i++)
+    ghb_index[i] = -1;
+  ghb_seq = 0;
+  return 0;
+}
+
+
+  static void
+predict (dram_address_t addr)
+{
+  predicted_row[addr.channel][addr.rank][addr.bank] = addr.row;
+  predicted_at[addr.channel][addr.rank][addr.bank] = CYCLE_VAL;
+}
+
+
+  static int
+same_row (dram_address_t a, dram_address_t b)
+{
+  return a.channel == b.channel && a.rank == b.rank && a.bank == b.bank
+    && a.row == b.row;
+}
+
+
+  static void
+observe_stride (request_t * request)
+{
+  stride_entry_t *e = &stride_table[request->instruction_pc %
+    STRIDE_TABLE_SIZE];
+  long long int address = request->physical_address;
+  long long int stride = address - e->last_address;
+
+  if (e->last_address && stride && stride == e->stride)
+    e->confidence = e->confidence < 3 ? e->confidence + 1 : 3;
+  else
+  {
+    e->stride = stride;
+    e->confidence = 0;
+  }
+  e->last_address = address;
+  if (!e->confidence)
+    return;
+
+  // the next row of the stream on each bank it reaches
+  for (int k = 1; k <= STRIDE_DEGREE; k++)
+  {
+    long long int next = address + k * e->stride;
+    if (next < 0)
+      break;
+    dram_address_t next_addr = decode_address (next);
+    if (!same_row (next_addr, request->dram_addr))
+      predict (next_addr);
+  }
+}
+
+
+  static int
+ghb_hash (dram_address_t addr)
+{
+  unsigned long long int key = addr.row;
+  key = key * NUM_BANKS + addr.bank;
+  key = key * NUM_RANKS + addr.rank;
+  key = key * NUM_CHANNELS + addr.channel;
+  return (key ^ (key >> 10) ^ (key >> 20)) % GHB_INDEX_SIZE;
+}
+
+
+  static void
+observe_ghb (request_t * request)
+{
+  int head = ghb_seq % GHB_SIZE;
+  int key = ghb_hash (request->dram_addr);
+  int link = ghb_index[key];
+
+  ghb[head].addr = request->dram_addr;
+  ghb[head].seq = ghb_seq;
+  ghb[head].link = link;
+  ghb[head].link_seq = link >= 0 ? ghb[link].seq : -1;
+  ghb_index[key] = head;
+  ghb_seq++;
+
+  // the last visit to this row, if it is still in the history
+  if (link < 0 || ghb[link].seq != ghb[head].link_seq
+      || !same_row (ghb[link].addr, request->dram_addr))
+    return;
+  for (int k = 1; k <= GHB_DEGREE; k++)
+  {
+    long long int seq = ghb[head].link_seq + k;
+    if (seq >= ghb[head].seq)
+      break;
+    dram_address_t next_addr = ghb[seq % GHB_SIZE].addr;
+    if (!same_row (next_addr, request->dram_addr))
+      predict (next_addr);
+  }
+}
+
+
+  static void
+observe_pc (request_t * request)
+{
+  pc_entry_t *e = &pc_table[request->instruction_pc % PC_TABLE_SIZE];
+
+  if (e->valid && same_row (e->addr, request->dram_addr))
+    e->reuse = e->reuse < 3 ? e->reuse + 1 : 3;
+  else if (e->reuse > 0)
+    e->reuse--;
+  e->addr = request->dram_addr;
+  e->valid = 1;
+  if (e->reuse >= 2)
+    predict (request->dram_addr);
+}
+
+
+  void
+observe_request (request_t * request)
+{
+  dram_address_t addr = request->dram_addr;
+  long long int row = predicted_row[addr.channel][addr.rank][addr.bank];
+
+  if (row >= 0)
+  {
+    stats[addr.channel].checked++;
+    if (row == addr.row)
+      stats[addr.channel].correct++;
+    predicted_row[addr.channel][addr.rank][addr.bank] = -1;
+  }
+  switch (ROW_PREDICTOR)
+  {
+    case STRIDE_ROW_PREDICTOR:
+      observe_stride (request);
+      break;
+    case GHB_ROW_PREDICTOR:
+      observe_ghb (request);
+      break;
+    case PC_ROW_PREDICTOR:
+      observe_pc (request);
+      break;
+    default:
+      break;
+  }
+}
+
+
+  long long int
+predict_next_row (int channel, int rank, int bank)
+{
+  if (predicted_row[channel][rank][bank] >= 0
+      && CYCLE_VAL - predicted_at[channel][rank][bank] > PREDICTION_LIFETIME)
+  {
+    predicted_row[channel][rank][bank] = -1;
+    stats[channel].expired++;
+  }
+  return predicted_row[channel][rank][bank];
+}
+
+
+  int
+issue_speculative_command (int channel)
+{
+  request_t *ptr = NULL;
+  int queued[NUM_RANKS][NUM_BANKS];
+
+  if (command_issued_current_cycle[channel])
+    return 0;
+  for (int r = 0; r < NUM_RANKS; r++)
+    for (int b = 0; b < NUM_BANKS; b++)
+      queued[r][b] = 0;
+  LL_FOREACH (read_queue_head[channel], ptr)
+    queued[ptr->dram_addr.rank][ptr->dram_addr.bank] = 1;
+  LL_FOREACH (write_queue_head[channel], ptr)
+    queued[ptr->dram_addr.rank][ptr->dram_addr.bank] = 1;
+
+  for (int r = 0; r < NUM_RANKS; r++)
+    for (int b = 0; b < NUM_BANKS; b++)
+    {
+      long long int row = predict_next_row (channel, r, b);
+      bank_t *bank = &dram_state[channel][r][b];
+      if (row < 0 || queued[r][b])
+        continue;
+      if ((bank->state == IDLE || bank->state == PRECHARGING
+            || bank->state == REFRESHING)
+          && is_activate_allowed (channel, r, b))
+      {
+        issue_activate_command (channel, r, b, row);
+        speculative_row[channel][r][b] = row;
+        predicted_row[channel][r][b] = -1;
+        stats[channel].activates++;
+        return 1;
+      }
+      if (bank->state == ROW_ACTIVE && bank->active_row == row)
+        predicted_row[channel][r][b] = -1;
+      else if (SPECULATIVE_PRECHARGE && bank->state == ROW_ACTIVE
+          && is_precharge_allowed (channel, r, b))
+      {
+        // the ACT follows once the precharge is done
+        issue_precharge_command (channel, r, b);
+        stats[channel].precharges++;
+        return 1;
+      }
+    }
+  return 0;
+}
+
+
+  void
+speculate (int channel)
+{
+  if (ROW_PREDICTOR == NO_ROW_PREDICTOR)
+    return;
+  for (int r = 0; r < NUM_RANKS; r++)
+    for (int b = 0; b < NUM_BANKS; b++)
+    {
+      long long int row = speculative_row[channel][r][b];
+      if (row < 0)
+        continue;
+      if (cas_issued_current_cycle[channel][r][b]
+          && dram_state[channel][r][b].active_row == row)
+      {
+        stats[channel].useful++;
+        speculative_row[channel][r][b] = -1;
+      }
+      else if (dram_state[channel][r][b].state != ROW_ACTIVE
+          || dram_state[channel][r][b].active_row != row)
+      {
+        stats[channel].wasted++;
+        speculative_row[channel][r][b] = -1;
+      }
+    }
+  if (SPECULATIVE_ACTIVATE)
+    issue_speculative_command (channel);
+}
+
+
+  void
+print_row_predictor_stats ()
+{
+  if (ROW_PREDICTOR == NO_ROW_PREDICTOR)
+    return;
+  fprintf (usimm_out, "------------------------------------\n");
+  fprintf (usimm_out, "Row predictor: %s\n", predictor_names[ROW_PREDICTOR]);
+  for (int c = 0; c < NUM_CHANNELS; c++)
+  {
+    fprintf (usimm_out, "Channel %d: predictions checked %lld correct %lld (%.2f%%) expired %lld\n",
+        c, stats[c].checked, stats[c].correct,
+        stats[c].checked ? 100.0 * stats[c].correct / stats[c].checked : 0.0,
+        stats[c].expired);
+    fprintf (usimm_out, "Channel %d: speculative ACT %lld (useful %lld, wasted %lld), speculative PRE %lld\n",
+        c, stats[c].activates, stats[c].useful, stats[c].wasted,
+        stats[c].precharges);
+  }
+}
@@ -0,0 +1,69 @@
+#ifndef __ROW_PREDICTOR_H__
+#define __ROW_PREDICTOR_H__
+
+#include "memory_controller.h"
+
+// Open-row prediction and speculative activates.
+//
+// A row predictor watches the reads the controller accepts and predicts
+// the next row each bank will be asked for. The prediction can be used
+// to open that row before its read arrives (a speculative ACT), or to
+// close the row in its way (a speculative PRE). It is selected in the
+// config file:
+//
+//   ROW_PREDICTOR         0   // none
+//   ROW_PREDICTOR         1   // per-PC address stride
+//   ROW_PREDICTOR         2   // global history buffer, row correlation
+//   ROW_PREDICTOR         3   // per-PC open row (row reuse)
+//   SPECULATIVE_ACTIVATE  1   // the controller speculates after schedule ()
+//   SPECULATIVE_PRECHARGE 0   // speculative ACTs only, no speculative PREs
+//
+// The stride predictor learns the address stride of each load PC and
+// predicts the rows of the next few addresses of a confirmed stream.
+// The GHB predictor keeps the recent rows in a global history buffer
+// linked by row and predicts that the rows that followed the last
+// visit to the current row follow again (G/AC of Nesbit and Smith).
+// The PC predictor keeps the last row of each load PC with a 2-bit
+// counter of how often the PC comes back to it, and predicts that a
+// PC with row reuse asks for its row again.
+//
+// With SPECULATIVE_ACTIVATE the controller calls
+// issue_speculative_command () on every DRAM cycle in which schedule ()
+// and the refresh policy left the command bus free. A scheduler can
+// also call it itself, e.g. when it has nothing else to issue, with
+// SPECULATIVE_ACTIVATE 0. A bank with a queued request is never the
+// target of a speculative command.
+//
+// Accuracy: a prediction is checked against the next read to its
+// bank. A speculative ACT is useful if a column command reads or writes
+// the opened row before it is closed, wasted otherwise.
+
+#define NO_ROW_PREDICTOR 0
+#define STRIDE_ROW_PREDICTOR 1
+#define GHB_ROW_PREDICTOR 2
+#define PC_ROW_PREDICTOR 3
+
+// predicted row of every bank, -1 if none
+USIMM_GLOBAL long long int ***predicted_row;
+
+// allocate the predictor state and check ROW_PREDICTOR; -1 if it is
+// unknown
+int init_row_predictor ();
+
+// learn from a read accepted by the controller (called by insert_read)
+void observe_request (request_t * request);
+
+// predicted next row of a bank, -1 if none
+long long int predict_next_row (int channel, int rank, int bank);
+
+// issue a speculative ACT or PRE on the channel if a prediction allows
+// one this cycle; returns 1 if a command was issued
+int issue_speculative_command (int channel);
+
+// account for the speculative ACTs and, with SPECULATIVE_ACTIVATE,
+// speculate; called every DRAM cycle after schedule ()
+void speculate (int channel);
+
+void print_row_predictor_stats ();
+
+#endif // __ROW_PREDICTOR_H__
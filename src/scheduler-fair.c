@@ -1,23 +1,32 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include "utlist.h"
 #include "utils.h"
 
 #include "memory_controller.h"
+#include "write_drain.h"
+#include "params.h"
 
 #define MAX_THREADS 100
 #define MAX_CREDITS 1024
 
-extern long long int CYCLE_VAL;
+extern USIMM_STATE long long int CYCLE_VAL;
 
 // currency used to arbitrate data bus usage between threads 
-int dbus_credits[MAX_NUM_CHANNELS][MAX_THREADS];
+USIMM_STATE int (*dbus_credits)[MAX_THREADS];
 
 // used to make sure each thread gets one dbus_credit per cycle
-long long int last_cycle_credited[MAX_NUM_CHANNELS];
+USIMM_STATE long long int *last_cycle_credited;
 
 // fair scheduler stats
-long long int count_col_read[MAX_NUM_CHANNELS][MAX_THREADS];
-long long int credits_at_read[MAX_NUM_CHANNELS][MAX_THREADS];
+USIMM_STATE long long int (*count_col_read)[MAX_THREADS];
+USIMM_STATE long long int (*credits_at_read)[MAX_THREADS];
+
+// how many writes have been performed since beginning current write drain
+USIMM_STATE int *writes_done_this_drain;
+
+// flag saying that we're only draining the write queue because there are no reads to schedule
+USIMM_STATE int *draining_writes_due_to_rq_empty;
 
   void
 init_scheduler_vars ()
@@ -25,18 +34,23 @@ init_scheduler_vars ()
   // initialize all scheduler variables here
 
   int i, j;
-  for (i = 0; i < MAX_NUM_CHANNELS; i++)
+  dbus_credits = alloc_system_memory (NUM_CHANNELS, sizeof (*dbus_credits));
+  count_col_read = alloc_system_memory (NUM_CHANNELS, sizeof (*count_col_read));
+  credits_at_read = alloc_system_memory (NUM_CHANNELS, sizeof (*credits_at_read));
+  last_cycle_credited = alloc_system_memory (NUM_CHANNELS, sizeof (long long int));
+  writes_done_this_drain = alloc_system_memory (NUM_CHANNELS, sizeof (int));
+  draining_writes_due_to_rq_empty = alloc_system_memory (NUM_CHANNELS, sizeof (int));
+
+  for (i = 0; i < NUM_CHANNELS; i++)
   {
     for (j = 0; j < MAX_THREADS; j++)
     {
       // all threads start out with maximum credits
       dbus_credits[i][j] = MAX_CREDITS;
-      count_col_read[i][j] = 0;
-      credits_at_read[i][j] = 0;
     }
   }
 
-  for (i = 0; i < MAX_NUM_CHANNELS; i++)
+  for (i = 0; i < NUM_CHANNELS; i++)
   {
     last_cycle_credited[i] = CYCLE_VAL;
   }
@@ -44,23 +58,9 @@ init_scheduler_vars ()
   return;
 }
 
-// write queue high water mark; begin draining writes if write queue exceeds this value
-#define HI_WM 40
-
-// end write queue drain once write queue has this many writes in it
-#define LO_WM 20
-
 // when switching to write drain mode, write at least this many times before switching back to read mode
 #define MIN_WRITES_ONCE_WRITING_HAS_BEGUN 1
 
-// 1 means we are in write-drain mode for that channel
-int drain_writes[MAX_NUM_CHANNELS];
-
-// how many writes have been performed since beginning current write drain
-int writes_done_this_drain[MAX_NUM_CHANNELS];
-
-// flag saying that we're only draining the write queue because there are no reads to schedule
-int draining_writes_due_to_rq_empty[MAX_NUM_CHANNELS];
 
 /* Each cycle it is possible to issue a valid command from the read or write queues
    OR
@@ -105,8 +105,11 @@ schedule (int channel)
   request_t *rd_ptr = NULL;
   request_t *wr_ptr = NULL;
 
+  update_write_watermarks (channel);
+
   // begin write drain if we're above the high water mark
-  if ((write_queue_length[channel] > HI_WM) && (!drain_writes[channel]))
+  if ((write_queue_length[channel] > write_hi_wm[channel])
+      && (!drain_writes[channel]))
   {
     drain_writes[channel] = 1;
     writes_done_this_drain[channel] = 0;
@@ -122,7 +125,8 @@ schedule (int channel)
   }
 
   // end write drain if we're below the low water mark
-  if ((drain_writes[channel]) && (write_queue_length[channel] <= LO_WM)
+  if ((drain_writes[channel])
+      && (write_queue_length[channel] <= write_lo_wm[channel])
       && (!draining_writes_due_to_rq_empty[channel]))
   {
     drain_writes[channel] = 0;
@@ -229,15 +233,15 @@ scheduler_stats ()
 {
   /* Nothing to print for now. */
 
-  printf ("Average number of credits when performing a COL_READ_CMD\n");
-  for (int i = 0; i < MAX_NUM_CHANNELS; i++)
+  fprintf (usimm_out, "Average number of credits when performing a COL_READ_CMD\n");
+  for (int i = 0; i < NUM_CHANNELS; i++)
   {
     if (count_col_read[i][0] == 0)
     {
       break;
     }
 
-    printf ("Channel %d\n", i);
+    fprintf (usimm_out, "Channel %d\n", i);
 
     for (int j = 0; j < MAX_THREADS; j++)
     {
@@ -246,7 +250,7 @@ scheduler_stats ()
         break;
       }
 
-      printf ("\tThread %d credits: %f\n", j,
+      fprintf (usimm_out, "\tThread %d credits: %f\n", j,
           ((float) credits_at_read[i][j]) /
           ((float) count_col_read[i][j]));
     }
@@ -1,13 +1,16 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include "utlist.h"
 #include "utils.h"
 
 #include "memory_controller.h"
+#include "write_drain.h"
 #include "params.h"
 
-extern long long int CYCLE_VAL;
+extern USIMM_STATE long long int CYCLE_VAL;
+
+USIMM_STATE long int ***count_col_hits;
 
-long int count_col_hits[MAX_NUM_CHANNELS][MAX_NUM_RANKS][MAX_NUM_BANKS];
 
   void
 init_scheduler_vars ()
@@ -22,28 +25,11 @@ init_scheduler_vars ()
       fprintf(stderr, "CAPN env variable setting failed");
       */
 
-  for (int i = 0; i < MAX_NUM_CHANNELS; i++)
-  {
-    for (int j = 0; j < MAX_NUM_RANKS; j++)
-    {
-      for (int k = 0; k < MAX_NUM_BANKS; k++)
-      {
-        count_col_hits[i][j][k] = 0;
-      }
-    }
-  }
+  count_col_hits = alloc_bank_table (sizeof (long int));
 
   return;
 }
 
-// write queue high water mark; begin draining writes if write queue exceeds this value
-#define HI_WM 40
-
-// end write queue drain once write queue has this many writes in it
-#define LO_WM 20
-
-// 1 means we are in write-drain mode for that channel
-int drain_writes[MAX_NUM_CHANNELS];
 
 /* Each cycle it is possible to issue a valid command from the read or write queues
    OR
@@ -72,29 +58,7 @@ schedule (int channel)
   request_t *wr_ptr = NULL;
 
 
-  // if in write drain mode, keep draining writes until the
-  // write queue occupancy drops to LO_WM
-  if (drain_writes[channel] && (write_queue_length[channel] > LO_WM))
-  {
-    drain_writes[channel] = 1;	// Keep draining.
-  }
-  else
-  {
-    drain_writes[channel] = 0;	// No need to drain.
-  }
-
-  // initiate write drain if either the write queue occupancy
-  // has reached the HI_WM , OR, if there are no pending read
-  // requests
-  if (write_queue_length[channel] > HI_WM)
-  {
-    drain_writes[channel] = 1;
-  }
-  else
-  {
-    if (!read_queue_length[channel])
-      drain_writes[channel] = 1;
-  }
+  update_write_drain (channel);
 
 
   // If in write drain mode, look through all the write queue
@@ -106,7 +70,7 @@ schedule (int channel)
     LL_FOREACH (write_queue_head[channel], wr_ptr)
     {
       // if COL_WRITE_CMD is the next command, then that means the appropriate row must already be open
-      if (wr_ptr->command_issuable
+      if (wr_ptr->command_issuable && write_batch_allowed (wr_ptr)
           && (wr_ptr->next_command == COL_WRITE_CMD))
       {
         count_col_hits[channel][wr_ptr->dram_addr.rank][wr_ptr->dram_addr.bank]++;
@@ -125,7 +89,7 @@ schedule (int channel)
     LL_FOREACH (write_queue_head[channel], wr_ptr)
     {
       // if no open rows, just issue any other available commands
-      if (wr_ptr->command_issuable)
+      if (wr_ptr->command_issuable && write_batch_allowed (wr_ptr))
       {
         issue_request_command (wr_ptr);
         count_col_hits[channel][wr_ptr->dram_addr.rank][wr_ptr->dram_addr.bank] = 0;
@@ -1,8 +1,10 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include "utlist.h"
 #include "utils.h"
 
 #include "memory_controller.h"
+#include "write_drain.h"
 #include "params.h"
 
 /* A basic FCFS policy augmented with a not-so-clever close-page policy.
@@ -10,41 +12,25 @@
    a bank that recently serviced a column-wr and close it (precharge it). */
 
 
-extern long long int CYCLE_VAL;
+extern USIMM_STATE long long int CYCLE_VAL;
 
 /* A data structure to see if a bank is a candidate for precharge. */
-int recent_colacc[MAX_NUM_CHANNELS][MAX_NUM_RANKS][MAX_NUM_BANKS];
+USIMM_STATE int ***recent_colacc;
 
 /* Keeping track of how many preemptive precharges are performed. */
-long long int num_aggr_precharge = 0;
+USIMM_STATE long long int num_aggr_precharge = 0;
+
 
 void
 init_scheduler_vars ()
 {
   // initialize all scheduler variables here
-  int i, j, k;
-  for (i = 0; i < MAX_NUM_CHANNELS; i++)
-    {
-      for (j = 0; j < MAX_NUM_RANKS; j++)
-	{
-	  for (k = 0; k < MAX_NUM_BANKS; k++)
-	    {
-	      recent_colacc[i][j][k] = 0;
-	    }
-	}
-    }
+  recent_colacc = alloc_bank_table (sizeof (int));
+  num_aggr_precharge = 0;
 
   return;
 }
 
-// write queue high water mark; begin draining writes if write queue exceeds this value
-#define HI_WM 40
-
-// end write queue drain once write queue has this many writes in it
-#define LO_WM 20
-
-// 1 means we are in write-drain mode for that channel
-int drain_writes[MAX_NUM_CHANNELS];
 
 /* Each cycle it is possible to issue a valid command from the read or write queues
    OR
@@ -75,29 +61,7 @@ schedule (int channel)
   int i, j;
 
 
-  // if in write drain mode, keep draining writes until the
-  // write queue occupancy drops to LO_WM
-  if (drain_writes[channel] && (write_queue_length[channel] > LO_WM))
-    {
-      drain_writes[channel] = 1;	// Keep draining.
-    }
-  else
-    {
-      drain_writes[channel] = 0;	// No need to drain.
-    }
-
-  // initiate write drain if either the write queue occupancy
-  // has reached the HI_WM , OR, if there are no pending read
-  // requests
-  if (write_queue_length[channel] > HI_WM)
-    {
-      drain_writes[channel] = 1;
-    }
-  else
-    {
-      if (!read_queue_length[channel])
-	drain_writes[channel] = 1;
-    }
+  update_write_drain (channel);
 
 
   // If in write drain mode, look through all the write queue
@@ -107,7 +71,7 @@ schedule (int channel)
     {
       LL_FOREACH (write_queue_head[channel], wr_ptr)
       {
-	if (wr_ptr->command_issuable)
+	if (wr_ptr->command_issuable && write_batch_allowed (wr_ptr))
 	  {
 	    /* Before issuing the command, see if this bank is now a candidate for closure (if it just did a column-rd/wr).
 	       If the bank just did an activate or precharge, it is not a candidate for closure. */
@@ -180,5 +144,5 @@ void
 scheduler_stats ()
 {
   /* Nothing to print for now. */
-  printf ("Number of aggressive precharges: %lld\n", num_aggr_precharge);
+  fprintf (usimm_out, "Number of aggressive precharges: %lld\n", num_aggr_precharge);
 }
@@ -1,19 +1,22 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include "utlist.h"
 #include "utils.h"
 
 #include "memory_controller.h"
+#include "write_drain.h"
 #include "params.h"
 
-extern long long int CYCLE_VAL;
+extern USIMM_STATE long long int CYCLE_VAL;
 #define MAX_THREADS  64
 
-double threshold_open;
-long long accesses[MAX_NUM_CHANNELS][MAX_THREADS];
-long int hits[MAX_NUM_CHANNELS][MAX_THREADS];
+USIMM_STATE double threshold_open;
+USIMM_STATE long long (*accesses)[MAX_THREADS];
+USIMM_STATE long int (*hits)[MAX_THREADS];
 
 /* Keeping track of how many preemptive precharges are performed. */
-long long int num_aggr_precharge = 0;
+USIMM_STATE long long int num_aggr_precharge = 0;
+
 
   void
 init_scheduler_vars ()
@@ -21,26 +24,13 @@ init_scheduler_vars ()
   threshold_open = T_RP / (T_RP+T_RCD);
   // initialize all scheduler variables here
 
-  for (int i = 0; i < MAX_NUM_CHANNELS; i++)
-  {
-    for (int j = 0; j < MAX_THREADS; j++)
-    {
-      hits[i][j] = 0;
-      accesses[i][j] = 0;
-    }
-  }
+  hits = alloc_system_memory (NUM_CHANNELS, sizeof (*hits));
+  accesses = alloc_system_memory (NUM_CHANNELS, sizeof (*accesses));
+  num_aggr_precharge = 0;
 
   return;
 }
 
-// write queue high water mark; begin draining writes if write queue exceeds this value
-#define HI_WM 40
-
-// end write queue drain once write queue has this many writes in it
-#define LO_WM 20
-
-// 1 means we are in write-drain mode for that channel
-int drain_writes[MAX_NUM_CHANNELS];
 
 /* Each cycle it is possible to issue a valid command from the read or write queues
    OR
@@ -69,29 +59,7 @@ schedule (int channel)
   request_t *wr_ptr = NULL;
 
 
-  // if in write drain mode, keep draining writes until the
-  // write queue occupancy drops to LO_WM
-  if (drain_writes[channel] && (write_queue_length[channel] > LO_WM))
-  {
-    drain_writes[channel] = 1;	// Keep draining.
-  }
-  else
-  {
-    drain_writes[channel] = 0;	// No need to drain.
-  }
-
-  // initiate write drain if either the write queue occupancy
-  // has reached the HI_WM , OR, if there are no pending read
-  // requests
-  if (write_queue_length[channel] > HI_WM)
-  {
-    drain_writes[channel] = 1;
-  }
-  else
-  {
-    if (!read_queue_length[channel])
-      drain_writes[channel] = 1;
-  }
+  update_write_drain (channel);
 
 
   // If in write drain mode, look through all the write queue
@@ -103,7 +71,7 @@ schedule (int channel)
     LL_FOREACH (write_queue_head[channel], wr_ptr)
     {
       // if COL_WRITE_CMD is the next command, then that means the appropriate row must already be open
-      if (wr_ptr->command_issuable
+      if (wr_ptr->command_issuable && write_batch_allowed (wr_ptr)
           && (wr_ptr->next_command == COL_WRITE_CMD))
       {
         hits[channel][wr_ptr->thread_id]++;
@@ -122,7 +90,7 @@ schedule (int channel)
     LL_FOREACH (write_queue_head[channel], wr_ptr)
     {
       // if no open rows, just issue any other available commands
-      if (wr_ptr->command_issuable)
+      if (wr_ptr->command_issuable && write_batch_allowed (wr_ptr))
       {
         issue_request_command (wr_ptr);
         accesses[channel][wr_ptr->thread_id]++;
@@ -187,5 +155,5 @@ schedule (int channel)
   void
 scheduler_stats ()
 {
-  printf ("Number of aggressive precharges: %lld\n", num_aggr_precharge);
+  fprintf (usimm_out, "Number of aggressive precharges: %lld\n", num_aggr_precharge);
 }
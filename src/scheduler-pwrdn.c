@@ -1,57 +1,35 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include "utlist.h"
 #include "utils.h"
 
 #include "memory_controller.h"
+#include "write_drain.h"
+#include "power_policy.h"
 #include "params.h"
 
 
 /*  A simple FCFS scheduler with an aggressive power-down policy.
-    In any cycle, if the memory controller is unable to fire a
-    command to a channel, it instead fires a POWER_DOWN_FAST
-    command.                                                   */
+    Ranks are powered down (fast exit) by the controller's timeout
+    power policy as soon as no request is queued for them, or after
+    POWER_TIMEOUT idle cycles; a POWER_POLICY in the config file
+    replaces it (see power_policy.h).                          */
 
 
-extern long long int CYCLE_VAL;
+extern USIMM_STATE long long int CYCLE_VAL;
 
-/* A variable to keep track of whether I've already fired
-   a power down command to a rank.  */
-long long int pwrdn[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-
-/* A stat to keep track of how long a rank stays in power-down mode.
-   This matches up quite closely with a rank's time spent in ACT_PDN. */
-long long int timedn[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
-
-// keep track of idle cycles
-long long int timeidle[MAX_NUM_CHANNELS][MAX_NUM_RANKS];
 
   void
 init_scheduler_vars ()
 {
-  int i, j;
   // initialize all scheduler variables here
-  for (i = 0; i < MAX_NUM_CHANNELS; i++)
-  {
-    for (j = 0; j < MAX_NUM_RANKS; j++)
-    {
-      /* Initializing pwrdn and timedn arrays. */
-      pwrdn[i][j] = 0;
-      timedn[i][j] = 0;
-      timeidle[i][j] = 0;
-    }
-  }
+  for (int c = 0; c < NUM_CHANNELS; c++)
+    if (power_policy_mode[c] == NO_POWER_POLICY)
+      set_power_policy (c, TIMEOUT_POWER_POLICY);
 
   return;
 }
 
-// write queue high water mark; begin draining writes if write queue exceeds this value
-#define HI_WM 40
-
-// end write queue drain once write queue has this many writes in it
-#define LO_WM 20
-
-// 1 means we are in write-drain mode for that channel
-int drain_writes[MAX_NUM_CHANNELS];
 
 /* Each cycle it is possible to issue a valid command from the read or write queues
    OR
@@ -79,49 +57,9 @@ schedule (int channel)
 {
   request_t *rd_ptr = NULL;
   request_t *wr_ptr = NULL;
-  int i;
-
 
-  /* Since a refresh operation wakes a rank, mark the ranks as not being in power-dn mode. */
-  if ((CYCLE_VAL % (8 * T_REFI)) == 0)
-  {
-    // printf("All banks powered up after refresh %lld.\n",CYCLE_VAL);
-    for (i = 0; i < NUM_RANKS; i++)
-    {
-      if (pwrdn[channel][i])
-      {
-        timedn[channel][i] =
-          timedn[channel][i] + CYCLE_VAL - pwrdn[channel][i];
-        pwrdn[channel][i] = 0;
-        timeidle[channel][i] = 0;
-      }
-    }
-  }
 
-
-  // if in write drain mode, keep draining writes until the
-  // write queue occupancy drops to LO_WM
-  if (drain_writes[channel] && (write_queue_length[channel] > LO_WM))
-  {
-    drain_writes[channel] = 1;	// Keep draining.
-  }
-  else
-  {
-    drain_writes[channel] = 0;	// No need to drain.
-  }
-
-  // initiate write drain if either the write queue occupancy
-  // has reached the HI_WM , OR, if there are no pending read
-  // requests
-  if (write_queue_length[channel] > HI_WM)
-  {
-    drain_writes[channel] = 1;
-  }
-  else
-  {
-    if (!read_queue_length[channel])
-      drain_writes[channel] = 1;
-  }
+  update_write_drain (channel);
 
 
   // If in write drain mode, look through all the write queue
@@ -129,50 +67,14 @@ schedule (int channel)
   // issue the command for the first request that is ready
   if (drain_writes[channel])
   {
-
     LL_FOREACH (write_queue_head[channel], wr_ptr)
     {
-      if (wr_ptr->command_issuable)
+      if (wr_ptr->command_issuable && write_batch_allowed (wr_ptr))
       {
-        if (issue_request_command(wr_ptr))
-        {
-          /* If the command was successful, mark that the rank has now been woken up.  Just book-keeping being done. */
-          if (pwrdn[wr_ptr->dram_addr.channel][wr_ptr->dram_addr.rank])
-          {
-            timedn[wr_ptr->dram_addr.channel][wr_ptr->dram_addr.rank] = 
-              timedn[wr_ptr->dram_addr.channel][wr_ptr->dram_addr.rank] + 
-              CYCLE_VAL - pwrdn[wr_ptr->dram_addr.channel][wr_ptr->dram_addr.rank];
-
-            pwrdn[wr_ptr->dram_addr.channel][wr_ptr->dram_addr.rank] = 0;
-            // printf("Powering up c%d r%d in cycle %lld\n", wr_ptr->dram_addr.channel, wr_ptr->dram_addr.rank, CYCLE_VAL);
-          }
-          timeidle[wr_ptr->dram_addr.channel][wr_ptr->dram_addr.rank] = 0;
-        }
-
+        issue_request_command (wr_ptr);
         break;
       }
     }
-    /* If you were unable to drain any writes this cycle, go ahead and try to power down. */
-    for (i = 0; i < NUM_RANKS; i++)
-    {
-      if (!pwrdn[channel][i]) 
-      {
-        if (timeidle[channel][i] >= PWRN)
-        {
-          if (is_powerdown_fast_allowed (channel, i))
-          {
-            if (issue_powerdown_command (channel, i, PWR_DN_FAST_CMD))
-            {
-              pwrdn[channel][i] = CYCLE_VAL;
-              timeidle[channel][i] = 0;
-              // printf("Powered down c%d r%d in cycle %lld\n", channel, i, CYCLE_VAL);
-              return;
-            }
-          }
-        } 
-        timeidle[channel][i]++;
-      }
-    }
     return;
   }
 
@@ -180,63 +82,18 @@ schedule (int channel)
   // look through the queue and find the first request whose
   // command can be issued in this cycle and issue it 
   // Simple FCFS 
-  if (!drain_writes[channel])
+  LL_FOREACH (read_queue_head[channel], rd_ptr)
   {
-    LL_FOREACH (read_queue_head[channel], rd_ptr)
+    if (rd_ptr->command_issuable)
     {
-      if (rd_ptr->command_issuable)
-      {
-        if (issue_request_command (rd_ptr))
-        {
-          /* If the command was successful, mark that the rank has now been woken up.  Just book-keeping being done. */
-          if (pwrdn[rd_ptr->dram_addr.channel][rd_ptr->dram_addr.rank])
-          {
-            timedn[rd_ptr->dram_addr.channel][rd_ptr->dram_addr.rank] = 
-              timedn[rd_ptr->dram_addr.channel][rd_ptr->dram_addr.rank] + 
-              CYCLE_VAL - pwrdn[rd_ptr->dram_addr.channel][rd_ptr->dram_addr.rank];
-            pwrdn[rd_ptr->dram_addr.channel][rd_ptr->dram_addr.rank] = 0;
-            // printf("Powering up c%d r%d in cycle %lld\n", rd_ptr->dram_addr.channel, rd_ptr->dram_addr.rank, CYCLE_VAL);
-          }
-          timeidle[rd_ptr->dram_addr.channel][rd_ptr->dram_addr.rank] = 0;
-        }
-        break;
-      }
-    }
-    /* If you were unable to issue any reads this cycle, go ahead and try to power down. */
-    for (i = 0; i < NUM_RANKS; i++)
-    {
-      if (!pwrdn[channel][i]) 
-      {
-        if (timeidle[channel][i] >= PWRN) 
-        {
-          if (is_powerdown_fast_allowed (channel, i))
-          {
-            if (issue_powerdown_command (channel, i, PWR_DN_FAST_CMD))
-            {
-              pwrdn[channel][i] = CYCLE_VAL;
-              timeidle[channel][i] = 0;
-              // printf("Powered down c%d r%d in cycle %lld\n", channel, i, CYCLE_VAL);
-              return;
-            }
-          }
-        } 
-        timeidle[channel][i]++;
-      }
+      issue_request_command (rd_ptr);
+      break;
     }
-    return;
   }
 }
 
   void
 scheduler_stats ()
 {
-  int i, j;
-  printf ("Printing scheduler stats\n");
-  for (i = 0; i < NUM_CHANNELS; i++)
-  {
-    for (j = 0; j < NUM_RANKS; j++)
-    {
-      printf ("Power down time c%d r%d  %lld\n", i, j, timedn[i][j]);
-    }
-  }
+  /* The power-down stats are printed with the power policy's. */
 }
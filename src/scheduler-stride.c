@@ -3,107 +3,19 @@
 #include "utils.h"
 #include "params.h"
 #include <stdlib.h>
+#include <string.h>
 
 #include "memory_controller.h"
+#include "write_drain.h"
+#include "address_map.h"
 
 #define MAXGHBSIZE 512
 #define MAXINDEXTABLE 1024
 
 
-//function to convert physical to DRAM address
-dram_address_t calc_dram_addr_copy(long long int physical_address)
-{
-
-
-	long long int input_a, temp_b, temp_a;
-
-	int channelBitWidth = log_base2(NUM_CHANNELS);
-	int rankBitWidth = log_base2(NUM_RANKS);
-	int bankBitWidth = log_base2(NUM_BANKS);
-	int rowBitWidth = log_base2(NUM_ROWS);
-	int colBitWidth = log_base2(NUM_COLUMNS);
-	int byteOffsetWidth = log_base2(CACHE_LINE_SIZE);
-
-
-
-	dram_address_t  this_a ;
-
-	this_a.actual_address = physical_address;
-
-	input_a = physical_address;
-
-	input_a = input_a >> byteOffsetWidth;		  // strip out the cache_offset
-
-
-	if(ADDRESS_MAPPING == 1)
-	{
-		temp_b = input_a;				
-		input_a = input_a >> colBitWidth;
-		temp_a  = input_a << colBitWidth;
-		this_a.column = temp_a ^ temp_b;		//strip out the column address
-		
-
-		temp_b = input_a;   				
-		input_a = input_a >> channelBitWidth;
-		temp_a  = input_a << channelBitWidth;
-		this_a.channel = temp_a ^ temp_b; 		// strip out the channel address
-
-
-		temp_b = input_a;				
-		input_a = input_a >> bankBitWidth;
-		temp_a  = input_a << bankBitWidth;
-		this_a.bank = temp_a ^ temp_b;		// strip out the bank address 
-
-
-		temp_b = input_a;			
-		input_a = input_a >> rankBitWidth;
-		temp_a  = input_a << rankBitWidth;
-		this_a.rank = temp_a ^ temp_b;     		// strip out the rank address
-
-
-		temp_b = input_a;		
-		input_a = input_a >> rowBitWidth;
-		temp_a  = input_a << rowBitWidth;
-		this_a.row = temp_a ^ temp_b;		// strip out the row number
-	}
-	else
-	{
-		temp_b = input_a;   	
-		input_a = input_a >> channelBitWidth;
-		temp_a  = input_a << channelBitWidth;
-		this_a.channel = temp_a ^ temp_b; 		// strip out the channel address
-
-
-		temp_b = input_a;
-		input_a = input_a >> bankBitWidth;
-		temp_a  = input_a << bankBitWidth;
-		this_a.bank = temp_a ^ temp_b;		// strip out the bank address 
-
-
-		temp_b = input_a;
-		input_a = input_a >> rankBitWidth;
-		temp_a  = input_a << rankBitWidth;
-		this_a.rank = temp_a ^ temp_b;     		// strip out the rank address
-
-
-		temp_b = input_a;
-		input_a = input_a >> colBitWidth;
-		temp_a  = input_a << colBitWidth;
-		this_a.column = temp_a ^ temp_b;		//strip out the column address
-
-
-		temp_b = input_a;
-		input_a = input_a >> rowBitWidth;
-		temp_a  = input_a << rowBitWidth;
-		this_a.row = temp_a ^ temp_b;			// strip out the row number
-	}
-	return(this_a);
-}
-
-
 //GHB variables (global)
-int GHBhead;
-int GHBmaxed;
+USIMM_STATE int GHBhead;
+USIMM_STATE int GHBmaxed;
 
 
 struct GHBentry
@@ -121,7 +33,7 @@ struct GHBentry
 
 
 //GHB
-struct GHBentry GHB[MAXGHBSIZE];
+USIMM_STATE struct GHBentry GHB[MAXGHBSIZE];
 
 
 struct ToBeIssued
@@ -132,7 +44,7 @@ struct ToBeIssued
 	long long int row;
 };
 
-struct ToBeIssued tbi[MAX_NUM_CHANNELS];
+USIMM_STATE struct ToBeIssued *tbi;
 
 
 
@@ -145,35 +57,35 @@ struct StrideTableentry
 
 
 //variables required for stats print
-int number_of_spec_activates;
-int number_of_hits;
+USIMM_STATE int number_of_spec_activates;
+USIMM_STATE int number_of_hits;
 
-int activates[MAX_NUM_CHANNELS][MAX_NUM_RANKS][MAX_NUM_BANKS];
+USIMM_STATE int ***activates;
 		
 
 //stride table
-struct StrideTableentry ST[1024];
+USIMM_STATE struct StrideTableentry ST[1024];
  
 
 
-extern long long int CYCLE_VAL;
+extern USIMM_STATE long long int CYCLE_VAL;
 
 //previous read queue sizes
-int prev_rqsize[MAX_NUM_CHANNELS];
+USIMM_STATE int *prev_rqsize;
 
 //index table
-struct GHBentry * IndexTable[MAXINDEXTABLE];
+USIMM_STATE struct GHBentry * IndexTable[MAXINDEXTABLE];
 
 //ggenerate index for inex table
 int generateindex (  int thread_id, long long int instruction_pc, long long int physical_address)
 {
 	long long int xorred;
-	//printf("thread_id is %X, instr_pc is %llX, addr is %llX \n",thread_id, instruction_pc, physical_address);
+	//fprintf(usimm_out, "thread_id is %X, instr_pc is %llX, addr is %llX \n",thread_id, instruction_pc, physical_address);
 	xorred = instruction_pc ^ physical_address;
 	xorred = xorred & 0x00000000000000FF;
 	thread_id = thread_id & 0x00000003;
 	thread_id = thread_id << 8;
-	//printf("index is %d %X\n",thread_id + (int)xorred);
+	//fprintf(usimm_out, "index is %d %X\n",thread_id + (int)xorred);
 	return (thread_id + (int)xorred);
 }
 
@@ -231,55 +143,37 @@ void push ( dram_address_t dram_addr,int thread_id, long long int instruction_pc
 }
 
 
+
 void init_scheduler_vars()
 {
 	int i;
 	// initialize all scheduler variables here
-	for (i=0; i<MAX_NUM_CHANNELS;i++)
-	{
-		prev_rqsize[i] = 0;
-	}
+	prev_rqsize = alloc_system_memory(NUM_CHANNELS, sizeof(int));
+	tbi = alloc_system_memory(NUM_CHANNELS, sizeof(struct ToBeIssued));
 	number_of_spec_activates=0;
 	number_of_hits=0;
 
-	
-	int o;
-		int p;
-		
-		for(i=0;i<MAX_NUM_CHANNELS;i++){
-		for (o=0; o<MAX_NUM_RANKS; o++) {
-	  		for (p=0; p<MAX_NUM_BANKS; p++) {
-	     			activates[i][o][p]=0;
-					
-	  		}
-		}
-		}
+	activates = alloc_bank_table(sizeof(int));
 	GHBhead = -1;
 	GHBmaxed = 0;
 	for (i=0; i<MAXINDEXTABLE ; i++)
 	{
 		IndexTable[i] = NULL;
 	}
+	memset(GHB, 0, sizeof(GHB));
+	memset(ST, 0, sizeof(ST));
 	for (i=0; i<MAXGHBSIZE ; i++)
 	{
 		GHB[i].number = i;
 	}
 
-		for (i=0 ; i<MAX_NUM_CHANNELS ; i++)
+		for (i=0 ; i<NUM_CHANNELS ; i++)
 	{
 		tbi[i].issue = 0;
 	}
 	return;
 }
 
-// write queue high water mark; begin draining writes if write queue exceeds this value
-#define HI_WM 40
-
-// end write queue drain once write queue has this many writes in it
-#define LO_WM 20
-
-// 1 means we are in write-drain mode for that channel
-int drain_writes[MAX_NUM_CHANNELS];
 
 /* Each cycle it is possible to issue a valid command from the read or write queues
    OR
@@ -328,35 +222,16 @@ void schedule(int channel)
 	prev_rqsize[channel] = read_queue_length[channel];
 
 
-	// if in write drain mode, keep draining writes until the
-	// write queue occupancy drops to LO_WM
-	if (drain_writes[channel] && (write_queue_length[channel] > LO_WM)) {
-	  drain_writes[channel] = 1; // Keep draining.
-	}
-	else {
-	  drain_writes[channel] = 0; // No need to drain.
-	}
-
-	// initiate write drain if either the write queue occupancy
-	// has reached the HI_WM , OR, if there are no pending read
-	// requests
-	if(write_queue_length[channel] > HI_WM)
-	{
-		drain_writes[channel] = 1;
-	}
-	else {
-	  if (!read_queue_length[channel])
-	    drain_writes[channel] = 1;
-	}
+	update_write_drain (channel);
 	
 	int j;
 	
 	int o;
 		int p;
 		
-		int Isused[MAX_NUM_RANKS][MAX_NUM_BANKS];
-		for (o=0; o<MAX_NUM_RANKS; o++) {
-	  		for (p=0; p<MAX_NUM_BANKS; p++) {
+		int Isused[NUM_RANKS][NUM_BANKS];
+		for (o=0; o<NUM_RANKS; o++) {
+	  		for (p=0; p<NUM_BANKS; p++) {
 	     			Isused[o][p]=0;
 					
 	  		}
@@ -377,7 +252,7 @@ void schedule(int channel)
 			ST[wr_ptr->instruction_pc%1024].detected = 0;
 			
 			//first ready served
-			if(wr_ptr->command_issuable && wr_ptr->next_command == COL_WRITE_CMD)
+			if(wr_ptr->command_issuable && write_batch_allowed(wr_ptr) && wr_ptr->next_command == COL_WRITE_CMD)
 			{
 				if(activates[channel][wr_ptr->dram_addr.rank][wr_ptr->dram_addr.bank] == 1)
 					number_of_hits ++;
@@ -406,7 +281,7 @@ void schedule(int channel)
 				ST[wr_ptr->instruction_pc%1024].prev_address = wr_ptr->physical_address;	
 			}
 
-			if(wr_ptr->command_issuable)
+			if(wr_ptr->command_issuable && write_batch_allowed(wr_ptr))
 			{
 				if(wr_ptr->next_command == PRE_CMD)
 					activates[channel][wr_ptr->dram_addr.rank][wr_ptr->dram_addr.bank] = 0 ;
@@ -505,8 +380,8 @@ void schedule(int channel)
 				for(j=1;j<7;j++)
 				{
 					long long int next_physical= ST[wr_ptr->instruction_pc%1024].prev_address + j*ST[wr_ptr->instruction_pc%1024].laststride;
-					dram_address_t next_dram_addr=calc_dram_addr_copy(next_physical);
-					dram_address_t prev_address = calc_dram_addr_copy(ST[wr_ptr->instruction_pc%1024].prev_address);
+					dram_address_t next_dram_addr=decode_address(next_physical);
+					dram_address_t prev_address = decode_address(ST[wr_ptr->instruction_pc%1024].prev_address);
 					if (next_dram_addr.channel==channel)
 					{
 						if((prev_address.rank!=next_dram_addr.rank)||(prev_address.bank!=next_dram_addr.bank)||(prev_address.row!=next_dram_addr.row))
@@ -558,8 +433,8 @@ void schedule(int channel)
 				for(j=1;j<7;j++)
 				{
 					long long int next_physical= ST[rd_ptr->instruction_pc%1024].prev_address + j*ST[rd_ptr->instruction_pc%1024].laststride;
-					dram_address_t next_dram_addr=calc_dram_addr_copy(next_physical);
-					dram_address_t prev_address = calc_dram_addr_copy(ST[rd_ptr->instruction_pc%1024].prev_address);
+					dram_address_t next_dram_addr=decode_address(next_physical);
+					dram_address_t prev_address = decode_address(ST[rd_ptr->instruction_pc%1024].prev_address);
 					if (next_dram_addr.channel==channel)
 					{
 						if((prev_address.rank!=next_dram_addr.rank)||(prev_address.bank!=next_dram_addr.bank)||(prev_address.row!=next_dram_addr.row))
@@ -670,8 +545,8 @@ void schedule(int channel)
 
 void scheduler_stats()
 {
-	printf("\nNumber of speculative activates = %d ", number_of_spec_activates);
-	printf("\nNumber of row hits = %d ", number_of_hits);
+	fprintf(usimm_out, "\nNumber of speculative activates = %d ", number_of_spec_activates);
+	fprintf(usimm_out, "\nNumber of row hits = %d ", number_of_hits);
 	
 
   /* Nothing to print for now. */
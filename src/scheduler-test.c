@@ -1,8 +1,10 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include "utlist.h"
 #include "utils.h"
 
 #include "memory_controller.h"
+#include "write_drain.h"
 #include "params.h"
 
 /* A scheduling algorithm based on Priority Based Fair Scheduling policy
@@ -20,19 +22,19 @@
    a bank that recently serviced a column-wr and close it (precharge it). */
 
 
-extern long long int CYCLE_VAL;
+extern USIMM_STATE long long int CYCLE_VAL;
 #define MAX_THREADS  64
 
-long CAPN;
+USIMM_STATE long CAPN;
 
 /* A data structure to see if a bank is a candidate for precharge. */
-int recent_colacc[MAX_NUM_CHANNELS][MAX_NUM_RANKS][MAX_NUM_BANKS];
+USIMM_STATE int ***recent_colacc;
 
 /* Keeping track of how many preemptive precharges are performed. */
-long long int num_aggr_precharge = 0;
-double priority[MAX_NUM_CHANNELS][MAX_THREADS];
-long long accesses[MAX_NUM_CHANNELS][MAX_THREADS];
-long long hits[MAX_NUM_CHANNELS][MAX_THREADS];
+USIMM_STATE long long int num_aggr_precharge = 0;
+USIMM_STATE double (*priority)[MAX_THREADS];
+USIMM_STATE long long (*accesses)[MAX_THREADS];
+USIMM_STATE long long (*hits)[MAX_THREADS];
 
 int get_core_highest_priority(int channel)
 {
@@ -45,41 +47,23 @@ int get_core_highest_priority(int channel)
 }
 
 
+
   void
 init_scheduler_vars ()
 {
   CAPN = T_RP / (T_RP+T_RCD);
   // initialize all scheduler variables here
-  int i, j, k;
-  for (i = 0; i < MAX_NUM_CHANNELS; i++)
-  {
-    for (j = 0; j < MAX_NUM_RANKS; j++)
-    {
-      for (k = 0; k < MAX_NUM_BANKS; k++)
-      {
-        recent_colacc[i][j][k] = 0;
-      }
-    }
-  }
-  for(int channel = 0; channel < NUM_CHANNELS; channel++) 
-    for(int core =0; core < NUMCORES; core++)  {
-      accesses[channel][core] = 0;
-      hits[channel][core]     = 0;
-    }
+  recent_colacc = alloc_bank_table (sizeof (int));
+  priority = alloc_system_memory (NUM_CHANNELS, sizeof (*priority));
+  accesses = alloc_system_memory (NUM_CHANNELS, sizeof (*accesses));
+  hits = alloc_system_memory (NUM_CHANNELS, sizeof (*hits));
+  num_aggr_precharge = 0;
 
 
 
   return;
 }
 
-// write queue high water mark; begin draining writes if write queue exceeds this value
-#define HI_WM 40
-
-// end write queue drain once write queue has this many writes in it
-#define LO_WM 20
-
-// 1 means we are in write-drain mode for that channel
-int drain_writes[MAX_NUM_CHANNELS];
 
 /* Each cycle it is possible to issue a valid command from the read or write queues
    OR
@@ -110,29 +94,7 @@ schedule (int channel)
   int i, j;
 
 
-  // if in write drain mode, keep draining writes until the
-  // write queue occupancy drops to LO_WM
-  if (drain_writes[channel] && (write_queue_length[channel] > LO_WM))
-  {
-    drain_writes[channel] = 1;	// Keep draining.
-  }
-  else
-  {
-    drain_writes[channel] = 0;	// No need to drain.
-  }
-
-  // initiate write drain if either the write queue occupancy
-  // has reached the HI_WM , OR, if there are no pending read
-  // requests
-  if (write_queue_length[channel] > HI_WM)
-  {
-    drain_writes[channel] = 1;
-  }
-  else
-  {
-    if (!read_queue_length[channel])
-      drain_writes[channel] = 1;
-  }
+  update_write_drain (channel);
 
 
   // If in write drain mode, look through all the write queue
@@ -143,7 +105,7 @@ schedule (int channel)
 
     LL_FOREACH (write_queue_head[channel], wr_ptr)
     {
-      if (wr_ptr->command_issuable)
+      if (wr_ptr->command_issuable && write_batch_allowed (wr_ptr))
       {
         /* Before issuing the command, see if this bank is now a candidate for closure (if it just did a column-rd/wr).
            If the bank just did an activate or precharge, it is not a candidate for closure. */
@@ -248,5 +210,5 @@ schedule (int channel)
 scheduler_stats ()
 {
   /* Nothing to print for now. */
-  printf ("Number of aggressive precharges: %lld\n", num_aggr_precharge);
+  fprintf (usimm_out, "Number of aggressive precharges: %lld\n", num_aggr_precharge);
 }
@@ -1,10 +1,14 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include "utlist.h"
 #include "utils.h"
 
 #include "memory_controller.h"
+#include "write_drain.h"
+#include "params.h"
+
+extern USIMM_STATE long long int CYCLE_VAL;
 
-extern long long int CYCLE_VAL;
 
 void
 init_scheduler_vars ()
@@ -14,14 +18,6 @@ init_scheduler_vars ()
   return;
 }
 
-// write queue high water mark; begin draining writes if write queue exceeds this value
-#define HI_WM 40
-
-// end write queue drain once write queue has this many writes in it
-#define LO_WM 20
-
-// 1 means we are in write-drain mode for that channel
-int drain_writes[MAX_NUM_CHANNELS];
 
 /* Each cycle it is possible to issue a valid command from the read or write queues
    OR
@@ -50,29 +46,7 @@ schedule (int channel)
   request_t *wr_ptr = NULL;
 
 
-  // if in write drain mode, keep draining writes until the
-  // write queue occupancy drops to LO_WM
-  if (drain_writes[channel] && (write_queue_length[channel] > LO_WM))
-    {
-      drain_writes[channel] = 1;	// Keep draining.
-    }
-  else
-    {
-      drain_writes[channel] = 0;	// No need to drain.
-    }
-
-  // initiate write drain if either the write queue occupancy
-  // has reached the HI_WM , OR, if there are no pending read
-  // requests
-  if (write_queue_length[channel] > HI_WM)
-    {
-      drain_writes[channel] = 1;
-    }
-  else
-    {
-      if (!read_queue_length[channel])
-	drain_writes[channel] = 1;
-    }
+  update_write_drain (channel);
 
 
   // If in write drain mode, look through all the write queue
@@ -83,7 +57,7 @@ schedule (int channel)
 
       LL_FOREACH (write_queue_head[channel], wr_ptr)
       {
-	if (wr_ptr->command_issuable)
+	if (wr_ptr->command_issuable && write_batch_allowed (wr_ptr))
 	  {
 	    issue_request_command (wr_ptr);
 	    break;
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "utlist.h"
+
+#include "params.h"
+#include "memory_controller.h"
+#include "stall.h"
+
+static const char *stall_cause_names[NUM_STALL_CAUSES] = {
+  "-", "act", "faw", "refresh", "column", "pre", "powerup", "issued",
+  "cmd_bus", "sched"
+};
+
+typedef struct
+{
+  long long int cycles[2][NUM_STALL_CAUSES];	// [READ/WRITE][cause]
+} stall_counts_t;
+
+static USIMM_STATE stall_counts_t *channel_stalls;
+static USIMM_STATE stall_counts_t **rank_stalls;
+static USIMM_STATE stall_counts_t *thread_stalls;
+
+
+  void
+init_stall ()
+{
+  if (!STALL_STATS)
+    return;
+  channel_stalls = alloc_system_memory (NUM_CHANNELS, sizeof (stall_counts_t));
+  rank_stalls = alloc_rank_table (sizeof (stall_counts_t));
+  thread_stalls = alloc_system_memory (NUMCORES, sizeof (stall_counts_t));
+}
+
+
+  static void
+charge_queue (int channel, request_t * head)
+{
+  request_t *curr = NULL;
+
+  LL_FOREACH (head, curr)
+  {
+    // added after the controller updated its queues this cycle (a
+    // prefetch), it has not been looked at yet
+    if (curr->next_command == NOP)
+      continue;
+    stall_cause_t cause = curr->stall_cause;
+    if (cause == STALL_NONE)
+      cause = command_issued_current_cycle[channel] ? STALL_COMMAND_BUS
+        : STALL_SCHEDULER;
+    int type = curr->operation_type;
+    channel_stalls[channel].cycles[type][cause] += PROCESSOR_CLK_MULTIPLIER;
+    rank_stalls[channel][curr->dram_addr.rank].cycles[type][cause] +=
+      PROCESSOR_CLK_MULTIPLIER;
+    if (curr->thread_id >= 0 && curr->thread_id < NUMCORES)
+      thread_stalls[curr->thread_id].cycles[type][cause] +=
+        PROCESSOR_CLK_MULTIPLIER;
+  }
+}
+
+
+  void
+account_stalls (int channel)
+{
+  if (!STALL_STATS)
+    return;
+  charge_queue (channel, read_queue_head[channel]);
+  charge_queue (channel, write_queue_head[channel]);
+}
+
+
+  static void
+print_counts (const char *name, stall_counts_t * counts)
+{
+  static const char *types[2] = { "reads", "writes" };
+
+  for (int type = READ; type <= WRITE; type++)
+  {
+    char label[64];
+    long long int total = 0;
+
+    for (int s = STALL_NONE + 1; s < NUM_STALL_CAUSES; s++)
+      total += counts->cycles[type][s];
+    snprintf (label, sizeof (label), "%s %s", name, types[type]);
+    fprintf (usimm_out, "%-24s %13lld", label, total);
+    for (int s = STALL_NONE + 1; s < NUM_STALL_CAUSES; s++)
+      fprintf (usimm_out, " %7.2f",
+          total ? 100.0 * counts->cycles[type][s] / total : 0.0);
+    fprintf (usimm_out, "\n");
+  }
+}
+
+
+  void
+print_stall_stats ()
+{
+  char name[64];
+
+  if (!STALL_STATS)
+    return;
+  fprintf (usimm_out, "------------------------------------\n");
+  fprintf (usimm_out, "Stall causes: CPU cycles requests spent queued, %% by cause\n");
+  fprintf (usimm_out, "%-24s %13s", "", "cycles");
+  for (int s = STALL_NONE + 1; s < NUM_STALL_CAUSES; s++)
+    fprintf (usimm_out, " %7s", stall_cause_names[s]);
+  fprintf (usimm_out, "\n");
+  for (int c = 0; c < NUM_CHANNELS; c++)
+  {
+    snprintf (name, sizeof (name), "Channel %d", c);
+    print_counts (name, &channel_stalls[c]);
+    for (int r = 0; r < NUM_RANKS; r++)
+    {
+      snprintf (name, sizeof (name), "Channel %d Rank %d", c, r);
+      print_counts (name, &rank_stalls[c][r]);
+    }
+  }
+  for (int t = 0; t < NUMCORES; t++)
+  {
+    snprintf (name, sizeof (name), "Core %d", t);
+    print_counts (name, &thread_stalls[t]);
+  }
+}
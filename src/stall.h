@@ -0,0 +1,42 @@
+#ifndef __STALL_H__
+#define __STALL_H__
+
+#include "memory_controller.h"
+
+// Stall-cause attribution.
+//
+// With
+//
+//   STALL_STATS  1
+//
+// in the config file, every DRAM cycle a request spends in a read or
+// write queue is charged to what its next command (stall_cause in
+// request_t) waited for that cycle:
+//
+// - act: the bank's next ACT (T_RP, T_RC, T_RRD);
+// - faw: the rank's four-activate window (T_FAW);
+// - refresh: a refresh in progress or due, or a rank in forced refresh;
+// - column: the bank's next column command (T_RCD after the ACT,
+//   T_CCD, T_WTR, T_RTRS);
+// - pre: the bank's next PRE (T_RAS, T_RTP, T_WR);
+// - powerup: the rank leaving power-down (T_XP);
+// - issued: its command was issued;
+// - cmd_bus: its command could issue, but the command bus carried
+//   another command (another request's, a refresh, a power-down or a
+//   policy precharge);
+// - sched: its command could issue and nothing else did, so the
+//   scheduling policy held it back.
+//
+// The cycles of each cause, in CPU cycles, are added up per channel,
+// per rank and per thread, for reads and writes apart, and printed at
+// the end as shares of the time requests spent queued.
+
+void init_stall ();
+
+// charge the requests queued on 'channel' for this DRAM cycle (called
+// after all commands of the cycle are issued)
+void account_stalls (int channel);
+
+void print_stall_stats ();
+
+#endif // __STALL_H__
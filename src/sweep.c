@@ -0,0 +1,197 @@
+#define _POSIX_C_SOURCE 200809L	// fmemopen
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "usimm.h"
+
+// Parameter sweeps in one process.
+//
+//   usimm-sweep [-j threads] outdir trace... -- config...
+//
+// runs every config with the same traces on 'threads' worker threads
+// (one per CPU by default). Each worker runs one simulation at a time
+// and takes the next config when it is done (see usimm.h). The traces
+// are read into memory once and every simulation reads them from
+// there. A simulation's output goes to
+// outdir/<config name>.txt, and a line of results per config is printed
+// when all are done. Build with "make sweep SCHEDULER=scheduler-*.c".
+
+typedef struct
+{
+  char *data;
+  size_t size;
+} trace_buffer_t;
+
+typedef struct
+{
+  usimm_sim_t sim;
+  const char *output;
+  int status;
+} sweep_run_t;
+
+static trace_buffer_t *buffers;
+static const char **trace_names;
+static int num_traces;
+
+// the runs, handed out to the workers in order
+static sweep_run_t *runs;
+static int num_runs;
+static int next_run;
+static pthread_mutex_t next_run_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+  static int
+read_trace (const char *name, trace_buffer_t * buffer)
+{
+  FILE *fp = fopen (name, "r");
+  size_t capacity = 1 << 20;
+
+  if (!fp)
+    return 0;
+  buffer->data = malloc (capacity);
+  buffer->size = 0;
+  while (!feof (fp) && !ferror (fp))
+  {
+    if (buffer->size == capacity)
+    {
+      capacity *= 2;
+      buffer->data = realloc (buffer->data, capacity);
+    }
+    buffer->size += fread (buffer->data + buffer->size, 1,
+        capacity - buffer->size, fp);
+  }
+  fclose (fp);
+  return 1;
+}
+
+
+  static void
+run_simulation (sweep_run_t * run)
+{
+  FILE **traces = calloc (num_traces, sizeof (FILE *));
+
+  run->status = -1;
+  run->sim.out = fopen (run->output, "w");
+  if (!run->sim.out)
+  {
+    fprintf (stderr, "Cannot write %s\n", run->output);
+    free (traces);
+    return;
+  }
+  for (int t = 0; t < num_traces; t++)
+  {
+    // fmemopen () does not take empty buffers
+    traces[t] = buffers[t].size ?
+      fmemopen (buffers[t].data, buffers[t].size, "r") :
+      fopen ("/dev/null", "r");
+    if (!traces[t])
+      fprintf (stderr, "Cannot open trace %s\n", trace_names[t]);
+  }
+  run->sim.num_traces = num_traces;
+  run->sim.trace_names = trace_names;
+  run->sim.traces = traces;
+  run->status = usimm_sim_run (&run->sim);
+  for (int t = 0; t < num_traces; t++)
+    if (traces[t])
+      fclose (traces[t]);
+  fclose (run->sim.out);
+  free (traces);
+}
+
+
+// a worker runs the simulations one after the other on its thread;
+// usimm_sim_run () frees each one's state before it returns
+  static void *
+run_worker (void *arg)
+{
+  for (;;)
+  {
+    pthread_mutex_lock (&next_run_lock);
+    int r = next_run < num_runs ? next_run++ : -1;
+    pthread_mutex_unlock (&next_run_lock);
+    if (r < 0)
+      return NULL;
+    run_simulation (&runs[r]);
+  }
+}
+
+
+  int
+main (int argc, char *argv[])
+{
+  int threads = sysconf (_SC_NPROCESSORS_ONLN);
+  int arg = 1;
+
+  if (arg + 1 < argc && !strcmp (argv[arg], "-j"))
+  {
+    threads = atoi (argv[arg + 1]);
+    arg += 2;
+  }
+  if (threads < 1)
+    threads = 1;
+
+  int split = arg + 1;
+  while (split < argc && strcmp (argv[split], "--"))
+    split++;
+  if (arg >= argc || split == arg + 1 || split + 1 >= argc)
+  {
+    printf ("usage: %s [-j threads] outdir trace... -- config...\n",
+        argv[0]);
+    return -3;
+  }
+  const char *outdir = argv[arg];
+  mkdir (outdir, 0777);
+  num_traces = split - arg - 1;
+  trace_names = (const char **) (argv + arg + 1);
+  num_runs = argc - split - 1;
+  const char **configs = (const char **) (argv + split + 1);
+
+  buffers = calloc (num_traces, sizeof (trace_buffer_t));
+  for (int t = 0; t < num_traces; t++)
+    if (!read_trace (trace_names[t], &buffers[t]))
+    {
+      printf ("Missing input trace file %s.  Quitting.\n", trace_names[t]);
+      return -5;
+    }
+
+  runs = calloc (num_runs, sizeof (sweep_run_t));
+  for (int r = 0; r < num_runs; r++)
+  {
+    const char *slash = strrchr (configs[r], '/');
+    const char *name = slash ? slash + 1 : configs[r];
+    char *output = malloc (strlen (outdir) + strlen (name) + 6);
+
+    sprintf (output, "%s/%s.txt", outdir, name);
+    runs[r].sim.config_file = configs[r];
+    runs[r].output = output;
+  }
+  if (threads > num_runs)
+    threads = num_runs;
+  pthread_t *tids = calloc (threads, sizeof (pthread_t));
+  for (int w = 0; w < threads; w++)
+    pthread_create (&tids[w], NULL, run_worker, NULL);
+  for (int w = 0; w < threads; w++)
+    pthread_join (tids[w], NULL);
+
+  int failed = 0;
+  printf ("%-32s %14s %16s %12s %14s\n", "config", "cycles",
+      "sum of times", "power (W)", "EDP (J.s)");
+  for (int r = 0; r < num_runs; r++)
+  {
+    usimm_sim_t *sim = &runs[r].sim;
+    if (runs[r].status)
+    {
+      printf ("%-32s failed (%d), see %s\n", configs[r], runs[r].status,
+          runs[r].output);
+      failed = 1;
+      continue;
+    }
+    printf ("%-32s %14lld %16lld %12.3f %14.9f\n", configs[r], sim->cycles,
+        sim->total_time_done, sim->system_power, sim->edp);
+  }
+  return failed;
+}
@@ -0,0 +1,95 @@
+#ifndef __USIMM_H__
+#define __USIMM_H__
+
+#include <stdio.h>
+
+// One simulation at a time per thread.
+//
+// A simulation is described by a usimm_sim_t and run by
+// usimm_sim_run (); main () only fills one in from its arguments.
+// There is no simulator context object, and schedulers are not handed
+// one: the simulator state (the parameters in params.h, the DRAM and
+// queue state in memory_controller.h, the modules' and the scheduler's
+// own variables) keeps its global names, so schedulers use it as
+// before, but every such variable is declared USIMM_STATE. Built with -DUSIMM_THREADS
+// that makes it thread-local, so simulations on different threads do
+// not share state: many can run side by side in one process (see
+// sweep.c), sharing traces that were read into memory once.
+//
+// A thread has one memory system at a time. usimm_init_system () resets
+// the state before it reads the configuration, and usimm_free_system ()
+// frees what the system allocated, so a thread runs any number of
+// simulations one after the other: usimm_sim_run () frees its system
+// when it returns, and usimm_destroy () (see libusimm.h) frees one made
+// by usimm_create (). The simulator is not reentrant: two simulations
+// cannot be interleaved on one thread, so a libusimm callback must not
+// start another one.
+//
+// Variables of the simulator are defined once, in main.c, which
+// defines USIMM_DEFINE_GLOBALS; headers declare them USIMM_GLOBAL.
+// Scheduler variables are declared USIMM_STATE where they are defined.
+//
+// Everything the simulator prints goes to usimm_out. A bad
+// configuration is reported with a PANIC line and an error code from
+// usimm_init_system (), so a failed run does not take down the other
+// threads of the process; only running out of memory and the
+// controller's internal asserts still end the whole process.
+
+#ifdef USIMM_THREADS
+#define USIMM_STATE __thread
+#else
+#define USIMM_STATE
+#endif
+
+#ifdef USIMM_DEFINE_GLOBALS
+#define USIMM_GLOBAL USIMM_STATE
+#else
+#define USIMM_GLOBAL extern USIMM_STATE
+#endif
+
+typedef struct usimm_sim
+{
+  // inputs
+  const char *config_file;	// system configuration file
+  int num_traces;		// one trace (and core) each
+  const char **trace_names;	// for the MT prefixes and the output
+  FILE **traces;		// open traces, NULL to open trace_names
+  FILE *out;			// where the results go, NULL for stdout
+
+  // results, set when usimm_sim_run () returns 0
+  long long int cycles;		// total execution time in CPU cycles
+  long long int total_time_done;	// sum of the cores' execution times
+  double memory_power;		// W
+  double system_power;		// W
+  double edp;			// J.s
+} usimm_sim_t;
+
+// where the running simulation prints
+USIMM_GLOBAL FILE *usimm_out;
+
+// run one simulation to completion; 0 on success, else the error code
+// main () returns
+int usimm_sim_run (usimm_sim_t * sim);
+
+// Shared by the trace driver (usimm_sim_run) and libusimm.h.
+
+// read the system configuration and its DRAM device, and initialize the
+// controller, its modules and the scheduler; NUMCORES and ROB must be
+// set. 0 on success, else the error code main () returns. Fails if the
+// thread's last system was not freed
+int usimm_init_system (FILE * config, const char *config_file_name);
+
+// free the system of this thread and its queued requests, also after
+// usimm_init_system () failed; ROB and the other memory of the caller
+// go with it if they came from alloc_system_memory ()
+void usimm_free_system ();
+
+// one DRAM cycle of the controller and the scheduler; called every
+// PROCESSOR_CLK_MULTIPLIER CPU cycles
+void usimm_memory_cycle ();
+
+// print the stats of the controller, its modules and the scheduler and
+// the DRAM power; returns the memory system power in mW
+float usimm_print_memory_stats ();
+
+#endif // __USIMM_H__
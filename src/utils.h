@@ -8,7 +8,7 @@
 //#define SCHEDULER_DEBUG
 
 #ifdef CMD_DEBUG
-#define UT_MEM_DEBUG(...) printf(__VA_ARGS__)
+#define UT_MEM_DEBUG(...) fprintf(usimm_out, __VA_ARGS__)
 #else
 #define UT_MEM_DEBUG(...)
 #endif
@@ -16,7 +16,7 @@
 
 #define SCHEDULER_DEBUG
 #ifdef SCHEDULER_DEBUG
-#define SCHEDELUR_DEBUG_MSG(...) printf(__VA_ARGS__)
+#define SCHEDELUR_DEBUG_MSG(...) fprintf(usimm_out, __VA_ARGS__)
 #else
 #define SCHEDULER_DEBUG_MSG(...)
 #endif
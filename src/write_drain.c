@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "utlist.h"
+
+#include "params.h"
+#include "memory_controller.h"
+#include "write_drain.h"
+
+extern USIMM_STATE long long int CYCLE_VAL;
+
+// read queue occupancy is averaged with this weight (1/n)
+#define READ_PRESSURE_WEIGHT 64
+
+typedef enum
+{
+  BUS_IDLE,
+  BUS_READ,
+  BUS_WRITE
+} bus_direction_t;
+
+typedef struct
+{
+  long long int drains;
+  long long int drain_cycles;
+  long long int cycles;
+  long long int read_to_write;
+  long long int write_to_read;
+  long long int eager_writes;
+  long long int reads_seen;
+  long long int writes_seen;
+  bus_direction_t direction;
+} write_drain_stats_t;
+
+// average read queue occupancy
+static USIMM_STATE double *read_pressure;
+// rank the current drain keeps to, -1 if none
+static USIMM_STATE int *write_batch_rank;
+static USIMM_STATE int *was_draining;
+static USIMM_STATE write_drain_stats_t *stats;
+
+static const char *drain_policy_names[] = { "fixed", "adaptive" };
+
+
+  int
+init_write_drain ()
+{
+  if (WRITE_DRAIN_POLICY != FIXED_WRITE_DRAIN
+      && WRITE_DRAIN_POLICY != ADAPTIVE_WRITE_DRAIN)
+  {
+    fprintf (usimm_out, "PANIC: unknown WRITE_DRAIN_POLICY %d\n", WRITE_DRAIN_POLICY);
+    return -1;
+  }
+  drain_writes = alloc_system_memory (NUM_CHANNELS, sizeof (int));
+  write_hi_wm = alloc_system_memory (NUM_CHANNELS, sizeof (int));
+  write_lo_wm = alloc_system_memory (NUM_CHANNELS, sizeof (int));
+  read_pressure = alloc_system_memory (NUM_CHANNELS, sizeof (double));
+  write_batch_rank = alloc_system_memory (NUM_CHANNELS, sizeof (int));
+  was_draining = alloc_system_memory (NUM_CHANNELS, sizeof (int));
+  stats = alloc_system_memory (NUM_CHANNELS, sizeof (write_drain_stats_t));
+  for (int c = 0; c < NUM_CHANNELS; c++)
+  {
+    write_hi_wm[c] = WRITE_HI_WM;
+    write_lo_wm[c] = WRITE_LO_WM;
+    write_batch_rank[c] = -1;
+  }
+  return 0;
+}
+
+
+  void
+update_write_watermarks (int channel)
+{
+  if (WRITE_DRAIN_POLICY != ADAPTIVE_WRITE_DRAIN)
+    return;
+
+  read_pressure[channel] += (read_queue_length[channel] -
+      read_pressure[channel]) / READ_PRESSURE_WEIGHT;
+  double pressure = read_pressure[channel] / READ_PRESSURE_MAX;
+  if (pressure > 1)
+    pressure = 1;
+
+  int limit = WQ_CAPACITY - WRITE_DRAIN_HEADROOM;
+  if (limit < WRITE_HI_WM)
+    limit = WRITE_HI_WM;
+  int batch = WRITE_HI_WM - WRITE_LO_WM;
+  write_hi_wm[channel] = WRITE_HI_WM + (limit - WRITE_HI_WM) * pressure;
+  write_lo_wm[channel] = write_hi_wm[channel] - batch * (2 - pressure);
+  if (write_lo_wm[channel] < 0)
+    write_lo_wm[channel] = 0;
+}
+
+
+  int
+update_write_drain (int channel)
+{
+  request_t *wr_ptr = NULL;
+
+  update_write_watermarks (channel);
+
+  // if in write drain mode, keep draining writes until the
+  // write queue occupancy drops to the low watermark
+  if (drain_writes[channel]
+      && (write_queue_length[channel] > write_lo_wm[channel]))
+    drain_writes[channel] = 1;	// Keep draining.
+  else
+    drain_writes[channel] = 0;	// No need to drain.
+
+  // initiate write drain if either the write queue occupancy
+  // has reached the high watermark, OR, if there are no pending read
+  // requests
+  if (write_queue_length[channel] > write_hi_wm[channel])
+    drain_writes[channel] = 1;
+  else if (!read_queue_length[channel])
+    drain_writes[channel] = 1;
+
+  if (!WRITE_BATCH_PER_RANK)
+    return drain_writes[channel];
+  if (!drain_writes[channel])
+  {
+    write_batch_rank[channel] = -1;
+    return 0;
+  }
+
+  // keep to the rank of the batch while it has a write to issue,
+  // else move to the rank of the oldest write that can issue
+  int first = -1;
+  LL_FOREACH (write_queue_head[channel], wr_ptr)
+  {
+    if (!wr_ptr->command_issuable)
+      continue;
+    if (wr_ptr->dram_addr.rank == write_batch_rank[channel])
+      return 1;
+    if (first < 0)
+      first = wr_ptr->dram_addr.rank;
+  }
+  if (first >= 0)
+    write_batch_rank[channel] = first;
+  return 1;
+}
+
+
+  int
+write_batch_allowed (request_t * request)
+{
+  int channel = request->dram_addr.channel;
+  return !WRITE_BATCH_PER_RANK || !drain_writes[channel]
+    || write_batch_rank[channel] < 0
+    || request->dram_addr.rank == write_batch_rank[channel];
+}
+
+
+  static void
+eager_writeback (int channel)
+{
+  request_t *ptr = NULL;
+  int reads_waiting[NUM_RANKS];
+
+  for (int r = 0; r < NUM_RANKS; r++)
+    reads_waiting[r] = 0;
+  LL_FOREACH (read_queue_head[channel], ptr)
+  {
+    if (!ptr->request_served)
+      reads_waiting[ptr->dram_addr.rank] = 1;
+  }
+  LL_FOREACH (write_queue_head[channel], ptr)
+  {
+    if (ptr->command_issuable && !reads_waiting[ptr->dram_addr.rank])
+    {
+      issue_request_command (ptr);
+      stats[channel].eager_writes++;
+      return;
+    }
+  }
+}
+
+
+  void
+write_drain (int channel)
+{
+  write_drain_stats_t *s = &stats[channel];
+
+  if (EAGER_WRITEBACK && !drain_writes[channel]
+      && !command_issued_current_cycle[channel] && write_queue_length[channel])
+    eager_writeback (channel);
+
+  // time in drains with writes to drain
+  s->cycles++;
+  if (drain_writes[channel] && write_queue_length[channel])
+  {
+    s->drain_cycles++;
+    if (!was_draining[channel])
+      s->drains++;
+  }
+  was_draining[channel] = drain_writes[channel]
+    && write_queue_length[channel];
+
+  // a column command this cycle that goes the other way
+  if (stats_reads_completed[channel] > s->reads_seen)
+  {
+    if (s->direction == BUS_WRITE)
+      s->write_to_read++;
+    s->direction = BUS_READ;
+  }
+  else if (stats_writes_completed[channel] > s->writes_seen)
+  {
+    if (s->direction == BUS_READ)
+      s->read_to_write++;
+    s->direction = BUS_WRITE;
+  }
+  s->reads_seen = stats_reads_completed[channel];
+  s->writes_seen = stats_writes_completed[channel];
+}
+
+
+  void
+print_write_drain_stats ()
+{
+  fprintf (usimm_out, "------------------------------------\n");
+  fprintf (usimm_out, "Write drain: %s watermarks\n",
+      drain_policy_names[WRITE_DRAIN_POLICY]);
+  for (int c = 0; c < NUM_CHANNELS; c++)
+  {
+    write_drain_stats_t *s = &stats[c];
+    fprintf (usimm_out, "Channel %d: drains %lld, draining %.2f%% of the time, eager writes %lld\n",
+        c, s->drains, s->cycles ? 100.0 * s->drain_cycles / s->cycles : 0.0,
+        s->eager_writes);
+    fprintf (usimm_out, "Channel %d: turnarounds read-to-write %lld, write-to-read %lld\n",
+        c, s->read_to_write, s->write_to_read);
+  }
+}
@@ -0,0 +1,83 @@
+#ifndef __WRITE_DRAIN_H__
+#define __WRITE_DRAIN_H__
+
+#include "memory_controller.h"
+
+// Write drain.
+//
+// Writes are buffered in the write queue and drained in bursts so that
+// the data bus turns around between reads and writes as rarely as
+// possible. A scheduler calls update_write_drain () at the start of
+// schedule () and serves writes instead of reads while drain_writes is
+// set for the channel. It is configured in the config file:
+//
+//   WRITE_DRAIN_POLICY    0   // fixed watermarks
+//   WRITE_DRAIN_POLICY    1   // adaptive watermarks
+//   WRITE_HI_WM          40   // begin draining above this many writes
+//   WRITE_LO_WM          20   // stop draining at this many writes
+//   WRITE_BATCH_PER_RANK  1   // drain one rank at a time
+//   EAGER_WRITEBACK       1   // write in idle cycles outside drains
+//
+// A drain begins when the write queue holds more than the high
+// watermark, or when no read is waiting, and ends once the write queue
+// is down to the low watermark.
+//
+// With adaptive watermarks the high watermark rises with the average
+// read queue occupancy, from WRITE_HI_WM with no reads waiting to
+// WRITE_DRAIN_HEADROOM entries short of WQ_CAPACITY at
+// READ_PRESSURE_MAX reads, so writes wait while reads are queued. The
+// low watermark follows it WRITE_HI_WM - WRITE_LO_WM writes lower,
+// up to twice that as the read queue empties, so a drain is longer
+// (and turnarounds are fewer) when reads do not suffer from it.
+//
+// With per-rank batching a drain keeps to the rank of its last write
+// while that rank has a write it can issue, saving the rank-to-rank
+// switching time; schedulers check write_batch_allowed () before
+// issuing a write.
+//
+// Eager write-back issues a write on a DRAM cycle the command bus is
+// left free outside a drain, to a rank no read is waiting for, so
+// fewer writes are left for the drains.
+//
+// The controller calls write_drain () every DRAM cycle after
+// schedule () for eager write-back and the stats: the number of drains,
+// the time spent draining and the read-to-write and write-to-read
+// turnarounds of the data bus.
+
+#define FIXED_WRITE_DRAIN 0
+#define ADAPTIVE_WRITE_DRAIN 1
+
+// adaptive watermarks leave this many write queue entries free
+#define WRITE_DRAIN_HEADROOM 8
+
+// average read queue occupancy that raises the adaptive high watermark
+// the most
+#define READ_PRESSURE_MAX 16
+
+// 1 means we are in write-drain mode for that channel
+USIMM_GLOBAL int *drain_writes;
+
+// current watermarks of each channel
+USIMM_GLOBAL int *write_hi_wm;
+USIMM_GLOBAL int *write_lo_wm;
+
+// allocate the write drain state and check WRITE_DRAIN_POLICY; -1 if it
+// is unknown
+int init_write_drain ();
+
+// recompute the watermarks of a channel; done by update_write_drain (),
+// for schedulers with a drain state machine of their own
+void update_write_watermarks (int channel);
+
+// begin or end a drain on the channel; returns drain_writes[channel]
+int update_write_drain (int channel);
+
+// may the write be issued in the current drain (per-rank batching)
+int write_batch_allowed (request_t * request);
+
+// eager write-back and stats; called every DRAM cycle after schedule ()
+void write_drain (int channel);
+
+void print_write_drain_stats ();
+
+#endif // __WRITE_DRAIN_H__
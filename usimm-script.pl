@@ -27,6 +27,8 @@
 # 1) Make sure all your single thread bcmks have "$single_thread_time"
 #    (The times in this usimm-script.pl script represent single thread behavior 
 #    with an FCFS scheduler, and will be the ones used for the MSC)
+#    Benchmarks without one use the slowdown USIMM estimates online
+#    ("estimated slowdown" at the end of the output)
 # 2) $mt includes the programs excluded from the fairness calculations
 #
 # Written by Manjunath Shevgoor, shevgoor@cs.utah.edu
@@ -213,7 +215,8 @@ foreach $infile (@outputs) {
 				if (exists $single_thread_time{$single_thread_key}) {
 					$slowdown{$infile}{$n} = $time{$infile}{$n}/$single_thread_time{$single_thread_key};
 				} else {
-					die "ERROR: single_thread_time{$single_thread_key} does not exist n=$n... Exiting";
+# Filled in from the online estimate further down the file
+					$slowdown{$infile}{$n} = 0;
 				}	
 			} else {
 # SLowdown is marked negative to mark invalid				
@@ -234,6 +237,12 @@ foreach $infile (@outputs) {
 
 			$n++;
 
+		} elsif ($line =~/^Core (\d+): interference cycles .* estimated slowdown (\S+)/) {
+			if (!exists $mt{$file_name}
+					&& !exists $single_thread_time{"$bcmks[$1]"."$current_channel"}) {
+				$slowdown{$infile}{$1} = $2;
+				$max_slowdown{$infile} = $2 if ($max_slowdown{$infile} < $2);
+			}
 		} elsif ($line =~/Energy Delay product \(EDP\) = (\S+) J.s/) {
 			$edp{$infile} = $1;
 			$total_edp += $1;